@@ -23,10 +23,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
 
 #include "IOT_API.h"
 #include "IOT_defines.h"
 #include "IOT_WriteData.h"
+#include "IOT_Metrics.h"
+#include "IOT_ResponseDecoder.h"
+#include "IOT_DoubleFormat.h"
 #include "json/json.h"
 
 using namespace IOTAPI;
@@ -36,12 +43,25 @@ static std::string IOT_WRITE_PATH  = "/process/write";
 static std::string IOT_READ_PATH   = "/process/read";
 static std::string IOT_QUOTA_PATH  = "/quota";
 
+static const size_t   DEFAULT_CHUNK_MAX_SAMPLES = 1000;
+static const size_t   DEFAULT_CHUNK_MAX_BYTES   = 256 * 1024;
+static const size_t   DEFAULT_WRITE_CONCURRENCY = 4;
+static const uint32_t DEFAULT_WRITE_RETRIES     = 1;
 
-IOT_API::IOT_API(std::string serverAddress, std::string authName, std::string password, size_t timeout_s):
-    m_servAddr(serverAddress), m_authName(authName), m_password(password)
+
+IOT_API::IOT_API(std::string serverAddress, std::string authName, std::string password, size_t timeout_s,
+                 size_t maxConnections):
+    m_servAddr(serverAddress), m_authName(authName), m_password(password), m_timeout_s(timeout_s),
+    m_chunkMaxSamples(DEFAULT_CHUNK_MAX_SAMPLES), m_chunkMaxBytes(DEFAULT_CHUNK_MAX_BYTES),
+    m_writeConcurrency(DEFAULT_WRITE_CONCURRENCY), m_writeRetries(DEFAULT_WRITE_RETRIES),
+    m_clients(maxConnections, timeout_s), m_limiter(&m_ownLimiter)
 {
     RemoveTrailingSlash(m_servAddr);
-    m_client.SetRequestTimeout(timeout_s);
+}
+
+std::string IOT_API::WriteUrl(const std::string& devId) const
+{
+    return m_servAddr + IOT_WRITE_PATH + "/" + devId;
 }
 
 void IOT_API::RemoveTrailingSlash(std::string& str) const
@@ -54,249 +74,771 @@ void IOT_API::RemoveTrailingSlash(std::string& str) const
 IOTAPI_err IOT_API::GetDevices(std::vector<IOT_GetDevice>& devices) const
 {
     devices.clear();
+    return Request(m_servAddr + IOT_DEVICE_PATH, NULL, IOT_EP_DEVICES, "", [&devices](const std::string& response) {
+        IOT_ResponseDecoder::DecodeDevices(response, devices);
+        return IOT_ERR_OK;
+    });
+}
 
-    std::string response;
-    IOTAPI::IOTAPI_err ret = m_client.GetResource(m_servAddr + IOT_DEVICE_PATH, m_authName, m_password, response);
+IOTAPI_err IOT_API::GetDevice(const std::string& devId, IOT_GetDevice& device) const
+{
+    return Request(m_servAddr + IOT_DEVICE_PATH + "/" + devId, NULL, IOT_EP_DEVICES, devId, [&device](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDevice(response, device) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    });
+}
+
+IOTAPI::IOTAPI_err IOT_API::RegisterDevice(const IOT_RegDevice& device, std::string &devID) const
+{
+    devID = "";
+
+    std::string devJson;
+    if(!device.ToJSON(devJson)) {
+        return IOT_ERR_PARAM;
+    }
+
+    return Request(m_servAddr + IOT_DEVICE_PATH, &devJson, IOT_EP_DEVICES, "", [&devID](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDeviceId(response, devID) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    });
+}
 
-    Json::Value devicesAnswer;
-    if(ParseJson(response, devicesAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(devicesAnswer);
+IOTAPI::IOTAPI_err IOT_API::SendData(const std::string& devId, const IOT_WriteData& data) const {
+    std::vector<IOT_WriteData> writeVec;
+    writeVec.push_back(data);
+    return SendData(devId, writeVec);
+}
+
+IOTAPI_err IOT_API::ReadData(const std::string& devId, const IOT_ReadDataFilter& filter, std::vector<IOT_ReadData>& data) const
+{
+    std::string url = m_servAddr + IOT_READ_PATH + "/" + devId + filter.BuildParameterString();
+    return Request(url, NULL, IOT_EP_READ, devId, [&data](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDatanodes(response, "datanodeReads", data) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    });
+}
+
+IOTAPI_err IOT_API::GetDatanodes(const std::string& devId, std::vector<IOT_ReadData>& data) const
+{
+    std::string url = m_servAddr + IOT_DEVICE_PATH + "/" + devId + "/datanodes";
+    return Request(url, NULL, IOT_EP_DATANODES, devId, [&data](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDatanodes(response, "items", data) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    });
+}
+
+IOTAPI::IOTAPI_err IOT_API::SendData(const std::string& devId, const std::vector<IOT_WriteData>& data) const
+{
+    IOT_WriteResult result;
+    return SendData(devId, data, result);
+}
+
+IOTAPI::IOTAPI_err IOT_API::SendData(const std::string& devId, const std::vector<IOT_WriteData>& data,
+                                     IOT_WriteResult& result) const
+{
+    std::vector<WriteChunk> chunks;
+    IOTAPI_err prepared = PrepareWrite(data, chunks, result);
+    if(prepared != IOT_ERR_OK) {
+        return prepared;
+    }
+
+    std::string url = WriteUrl(devId);
+    std::vector<size_t> pending;
+    for(size_t i = 0; i < chunks.size(); ++i) {
+        pending.push_back(i);
+    }
+
+    std::vector<IOTAPI_err> chunkStatus(chunks.size(), IOT_ERR_GENERAL);
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    // All chunks together wait for the rate limiter at most the operation timeout
+    std::chrono::steady_clock::time_point throttleDeadline = started + std::chrono::seconds(m_timeout_s);
+
+    for(uint32_t attempt = 0; attempt <= m_writeRetries && !pending.empty(); ++attempt)
+    {
+        // Chunks the rate limiter holds back are not sent
+        std::vector<size_t> admitted;
+        for(size_t i = 0; i < pending.size(); ++i) {
+            if(Throttle(devId, throttleDeadline) == IOT_ERR_OK) {
+                admitted.push_back(pending[i]);
+            } else {
+                chunkStatus[pending[i]] = IOT_ERR_THROTTLED;
+            }
+        }
+        pending.swap(admitted);
+        if(pending.empty()) {
+            break;
         }
-        else if(devicesAnswer.isMember("items") && devicesAnswer["items"].isArray())
+
+        std::vector<const std::string*> payloads(pending.size());
+        for(size_t i = 0; i < pending.size(); ++i) {
+            payloads[i] = &chunks[pending[i]].payload;
+            result.m_payloadBytes += payloads[i]->size();
+        }
+
+        std::vector<std::string> responses;
+        std::vector<IOTAPI_err> results;
+        std::vector<IOT_RequestTiming> timings;
+
+        if(payloads.size() == 1) {
+            responses.resize(1);
+            results.resize(1);
+            timings.resize(1);
+            IOT_ClientPool::Lease client(m_clients);
+            results[0] = client->PostAndReadResponse(url, m_authName, m_password, *payloads[0], responses[0], &timings[0]);
+        } else {
+            IOT_ClientPool::Lease client(m_clients);
+            client->PostMultiple(url, m_authName, m_password, payloads, m_writeConcurrency, responses, results, &timings);
+        }
+
+        std::vector<size_t> retry;
+        for(size_t i = 0; i < pending.size(); ++i)
         {
-            ret = IOT_ERR_OK;
-            Json::Value::iterator it = devicesAnswer["items"].begin();
-            while(it != devicesAnswer["items"].end())
-            {
-                IOT_GetDevice newDevice;
-                if(newDevice.FromJSON(*it)) {
-                    devices.push_back(newDevice);
-                }
-                ++it;
+            IOTAPI_err ret = FinishChunk(devId, chunks[pending[i]], results[i], responses[i], timings[i], data, result);
+            chunkStatus[pending[i]] = ret;
+
+            if(IsRetryableError(ret)) {
+                retry.push_back(pending[i]);
             }
         }
+
+        pending.swap(retry);
     }
 
-    return ret;
+    return FinishWrite(chunks, chunkStatus, started, result);
 }
 
-IOTAPI_err IOT_API::GetDevice(const std::string& devId, IOT_GetDevice& device) const
+//! State of a write made by SendDataAsync(), shared by the callbacks of its requests
+struct IOT_API::AsyncWrite
 {
-    std::string response;
-    std::string url = m_servAddr + IOT_DEVICE_PATH + "/" + devId;
-    IOTAPI::IOTAPI_err ret = m_client.GetResource(url, m_authName, m_password, response);
-
-    Json::Value devicesAnswer;
-    if(ParseJson(response, devicesAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(devicesAnswer);
+    IOT_AsyncTransport* transport;
+    std::string devId;
+    std::string url;
+    const std::vector<IOT_WriteData>* data;
+    IOT_WriteResult* result;
+    std::vector<WriteChunk> chunks;
+    std::vector<IOTAPI_err> chunkStatus;
+    std::vector<uint32_t> attempts;
+    //! Chunks waiting to be posted, first sends and retries
+    std::vector<size_t> queued;
+    size_t inFlight;
+    std::chrono::steady_clock::time_point started;
+    Completion done;
+};
+
+void IOT_API::SendDataAsync(IOT_AsyncTransport& transport, const std::string& devId,
+                            const std::vector<IOT_WriteData>& data, IOT_WriteResult& result, Completion done) const
+{
+    std::shared_ptr<AsyncWrite> write = std::make_shared<AsyncWrite>();
+    IOTAPI_err prepared = PrepareWrite(data, write->chunks, result);
+    if(prepared != IOT_ERR_OK) {
+        if(done) {
+            done(prepared);
         }
-        else if(!device.FromJSON(devicesAnswer)) {
-            ret = IOT_ERR_GENERAL;
+        return;
+    }
+
+    write->transport = &transport;
+    write->devId = devId;
+    write->url = WriteUrl(devId);
+    write->data = &data;
+    write->result = &result;
+    write->chunkStatus.assign(write->chunks.size(), IOT_ERR_GENERAL);
+    write->attempts.assign(write->chunks.size(), 0);
+    for(size_t i = write->chunks.size(); i > 0; --i) {
+        write->queued.push_back(i - 1);
+    }
+    write->inFlight = 0;
+    write->started = std::chrono::steady_clock::now();
+    write->done.swap(done);
+
+    PostChunks(write);
+}
+
+void IOT_API::PostChunks(const std::shared_ptr<AsyncWrite>& write) const
+{
+    bool throttled = false;
+    while(!write->queued.empty() && write->inFlight < m_writeConcurrency)
+    {
+        size_t index = write->queued.back();
+        write->queued.pop_back();
+        write->attempts[index]++;
+
+        // Chunks the rate limiter does not let out now fail without waiting
+        if(m_limiter->TryAcquire(write->devId) != 0) {
+            write->chunkStatus[index] = IOT_ERR_THROTTLED;
+            throttled = true;
+            continue;
         }
+        write->inFlight++;
+
+        const WriteChunk& chunk = write->chunks[index];
+        write->result->m_payloadBytes += chunk.payload.size();
+
+        write->transport->Post(write->url, m_authName, m_password, chunk.payload,
+            [this, write, index](IOTAPI_err ret, const std::string& response, const IOT_RequestTiming& timing) {
+                write->inFlight--;
+                ret = FinishChunk(write->devId, write->chunks[index], ret, response, timing, *write->data, *write->result);
+                write->chunkStatus[index] = ret;
+
+                if(IsRetryableError(ret) && write->attempts[index] <= m_writeRetries) {
+                    write->queued.push_back(index);
+                }
+
+                if(write->inFlight == 0 && write->queued.empty()) {
+                    ret = FinishWrite(write->chunks, write->chunkStatus, write->started, *write->result);
+                    if(write->done) {
+                        write->done(ret);
+                    }
+                } else {
+                    PostChunks(write);
+                }
+            });
     }
 
-    return ret;
+    if(throttled && write->inFlight == 0 && write->queued.empty()) {
+        IOTAPI_err ret = FinishWrite(write->chunks, write->chunkStatus, write->started, *write->result);
+        if(write->done) {
+            write->done(ret);
+        }
+    }
 }
 
-IOTAPI::IOTAPI_err IOT_API::RegisterDevice(const IOT_RegDevice& device, std::string &devID) const
+IOTAPI::IOTAPI_err IOT_API::PrepareWrite(const std::vector<IOT_WriteData>& data, std::vector<WriteChunk>& chunks,
+                                         IOT_WriteResult& result) const
 {
-    devID = "";
+    result.Clear();
+    result.m_submitted = data.size();
+    result.m_status = IOT_ERR_PARAM;
 
-    std::string devJson;
-    IOTAPI::IOTAPI_err ret = IOT_ERR_PARAM;
+    if(data.empty()) {
+        return IOT_ERR_PARAM;
+    }
 
-    if(device.ToJSON(devJson))
+    // Serialize samples one by one so that the batch can be split by encoded size
+    std::vector<std::string> items(data.size());
+    PrecisionCursor cursor;
+    for(uint32_t i = 0; i < data.size(); ++i)
     {
-        std::string response;
-        ret = m_client.PostAndReadResponse(m_servAddr + IOT_DEVICE_PATH, m_authName, m_password, devJson, response);
-
-        Json::Value registeredDevice;
-        if(ParseJson(response, registeredDevice)) {
-            if(ret != IOTAPI::IOT_ERR_OK) {
-                ret = GetErrorCode(registeredDevice);
-            }
-            else if(registeredDevice.isMember("deviceId") && registeredDevice["deviceId"].isString()) {
-                devID = registeredDevice["deviceId"].asString();
-                ret = IOT_ERR_OK;
-            } else {
-                ret = IOT_ERR_GENERAL;
-            }
+        if(!AppendSample(data.at(i), cursor, items[i])) {
+            return IOT_ERR_PARAM;
         }
     }
 
-    return ret;
+    BuildWriteChunks(items, chunks);
+
+    result.m_chunks = chunks.size();
+    result.m_acceptedSamples.assign(data.size(), false);
+    return IOT_ERR_OK;
 }
 
-IOTAPI::IOTAPI_err IOT_API::SendData(const std::string& devId, const IOT_WriteData& data) const {
-    std::vector<IOT_WriteData> writeVec;
-    writeVec.push_back(data);
-    return SendData(devId, writeVec);
+IOTAPI::IOTAPI_err IOT_API::FinishChunk(const std::string& devId, const WriteChunk& chunk, IOTAPI::IOTAPI_err ret,
+                                        const std::string& response, const IOT_RequestTiming& timing,
+                                        const std::vector<IOT_WriteData>& data, IOT_WriteResult& result) const
+{
+    RecordTiming(IOT_EP_WRITE, timing, ret);
+    m_limiter->OnReply(devId, timing.httpCode, timing.retryAfterS);
+    ret = ParseWriteResponse(ret, response, data, chunk.begin, chunk.end, result.m_acceptedSamples);
+
+    size_t written = 0;
+    for(size_t s = chunk.begin; s < chunk.end; ++s) {
+        if(result.m_acceptedSamples[s]) {
+            ++written;
+        }
+    }
+    result.m_accepted += written;
+    IOT_Metrics::Instance().RecordWriteBatch(chunk.end - chunk.begin, written);
+
+    return ret;
 }
 
-IOTAPI_err IOT_API::ReadData(const std::string& devId, const IOT_ReadDataFilter& filter, std::vector<IOT_ReadData>& data) const
+IOTAPI::IOTAPI_err IOT_API::FinishWrite(const std::vector<WriteChunk>& chunks, const std::vector<IOTAPI::IOTAPI_err>& chunkStatus,
+                                        std::chrono::steady_clock::time_point started, IOT_WriteResult& result) const
 {
-    std::string response;
-    std::string url = m_servAddr + IOT_READ_PATH + "/" + devId + filter.BuildParameterString();
-    IOTAPI::IOTAPI_err ret = m_client.GetResource(url, m_authName, m_password, response);
+    result.m_latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    result.m_sampleStatus.resize(result.m_submitted, IOT_ERR_GENERAL);
 
-    Json::Value devicesAnswer;
-    if(ParseJson(response, devicesAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(devicesAnswer);
+    IOTAPI_err ret = IOT_ERR_OK;
+    for(size_t i = 0; i < chunkStatus.size(); ++i) {
+        for(size_t s = chunks[i].begin; s < chunks[i].end; ++s) {
+            result.m_sampleStatus[s] = chunkStatus[i];
         }
 
-        else if(devicesAnswer.isMember("datanodeReads") && devicesAnswer["datanodeReads"].isArray())
-        {
-            ret = IOT_ERR_OK;
-            Json::Value::iterator it = devicesAnswer["datanodeReads"].begin();
-            while(it != devicesAnswer["datanodeReads"].end())
-            {
-                IOT_ReadData item;
-
-                if(item.FromJSON(*it)) {
-                    data.push_back(item);
-                }
-                else {
-                    ret = IOTAPI::IOT_ERR_GENERAL;
-                    break;
-                }
-                ++it;
+        if(chunkStatus[i] != IOT_ERR_OK) {
+            if(ret == IOT_ERR_OK) {
+                ret = chunkStatus[i];
             }
+            result.m_failedChunks++;
         }
     }
 
+    result.m_status = ret;
     return ret;
 }
 
-IOTAPI_err IOT_API::GetDatanodes(const std::string& devId, std::vector<IOT_ReadData>& data) const
+bool IOT_API::SetWriteChunkLimits(size_t maxSamples, size_t maxBytes)
 {
-    std::string response;
-    std::string url = m_servAddr + IOT_DEVICE_PATH + "/" + devId + "/datanodes";
-    IOTAPI::IOTAPI_err ret = m_client.GetResource(url, m_authName, m_password, response);
+    if(maxSamples == 0 || maxBytes == 0) {
+        return false;
+    }
 
-    Json::Value datanodesAnswer;
-    if(ParseJson(response, datanodesAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(datanodesAnswer);
-        }
-        else if(datanodesAnswer.isMember("items") && datanodesAnswer["items"].isArray())
+    m_chunkMaxSamples = maxSamples;
+    m_chunkMaxBytes = maxBytes;
+    return true;
+}
+
+void IOT_API::SetWriteConcurrency(size_t connections, uint32_t retries)
+{
+    m_writeConcurrency = (connections > 0) ? connections : 1;
+    m_writeRetries = retries;
+}
+
+bool IOT_API::SetPrecision(const std::string& path, const std::string& name, int decimals)
+{
+    if(decimals == IOT_WriteData::NO_PRECISION) {
+        m_precision.erase(DatanodeKey(path, name));
+        return true;
+    }
+    if(decimals < 0 || decimals > IOT_DoubleFormat::MAX_DECIMALS) {
+        return false;
+    }
+
+    m_precision[DatanodeKey(path, name)] = decimals;
+    return true;
+}
+
+int IOT_API::GetPrecision(const std::string& path, const std::string& name) const
+{
+    if(m_precision.empty()) {
+        return IOT_WriteData::NO_PRECISION;
+    }
+
+    std::map<std::string, int>::const_iterator it = m_precision.find(DatanodeKey(path, name));
+    return (it != m_precision.end()) ? it->second : IOT_WriteData::NO_PRECISION;
+}
+
+bool IOT_API::AppendSample(const IOT_WriteData& sample, PrecisionCursor& cursor, std::string& json) const
+{
+    // Samples of a datanode share the interned name and path
+    if(&sample.GetName() != cursor.name || &sample.GetPath() != cursor.path) {
+        cursor.name = &sample.GetName();
+        cursor.path = &sample.GetPath();
+        cursor.decimals = GetPrecision(sample.GetPath(), sample.GetName());
+    }
+
+    return sample.AppendJSON(json, cursor.decimals);
+}
+
+IOTAPI_err IOT_API::SetHttpVersion(IOTAPI::IOT_HttpVersion version)
+{
+    return m_clients.SetHttpVersion(version);
+}
+
+IOTAPI_err IOT_API::SetKeepAlive(const IOT_KeepAlive& policy)
+{
+    return m_clients.SetKeepAlive(policy);
+}
+
+IOTAPI_err IOT_API::SetSessionFile(const std::string& path)
+{
+    return m_clients.SetSessionFile(path);
+}
+
+IOTAPI_err IOT_API::Warmup(size_t connections) const
+{
+    return m_clients.Warmup(m_servAddr + "/", connections);
+}
+
+size_t IOT_API::GetMaxConnections() const
+{
+    return m_clients.GetSize();
+}
+
+void IOT_API::SetRateLimiter(IOT_RateLimiter* limiter)
+{
+    m_limiter = (limiter != NULL) ? limiter : &m_ownLimiter;
+}
+
+IOT_RateLimiter& IOT_API::GetRateLimiter()
+{
+    return *m_limiter;
+}
+
+long IOT_API::GetThrottleDelayMs(const std::string& devId) const
+{
+    return m_limiter->GetDelayMs(devId);
+}
+
+IOTAPI_err IOT_API::Throttle(const std::string& devId) const
+{
+    return Throttle(devId, std::chrono::steady_clock::now() + std::chrono::seconds(m_timeout_s));
+}
+
+IOTAPI_err IOT_API::Throttle(const std::string& devId, std::chrono::steady_clock::time_point deadline) const
+{
+    std::chrono::steady_clock::duration left = deadline - std::chrono::steady_clock::now();
+    long leftMs = std::max<long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(left).count());
+    return m_limiter->Acquire(devId, static_cast<uint32_t>(leftMs)) ? IOT_ERR_OK : IOT_ERR_THROTTLED;
+}
+
+bool IOT_API::IsRetryableError(IOTAPI::IOTAPI_err err)
+{
+    // Only requests that provably did not reach the server, or that the
+    // server refused without processing, are safe to send again. A write
+    // that timed out or broke off after it was sent may have been stored.
+    switch(err) {
+    case IOT_ERR_CONN:
+    case IOT_ERR_SERVER:
+    case IOT_ERR_THROTTLED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void IOT_API::BuildWriteChunks(const std::vector<std::string>& items, std::vector<WriteChunk>& chunks) const
+{
+    chunks.clear();
+
+    size_t i = 0;
+    while(i < items.size())
+    {
+        WriteChunk chunk;
+        chunk.begin = i;
+        chunk.payload = "[";
+
+        // A single sample larger than the byte limit is sent in a chunk of its own
+        while(i < items.size() && (i - chunk.begin) < m_chunkMaxSamples &&
+              (i == chunk.begin || chunk.payload.size() + items[i].size() + 2 <= m_chunkMaxBytes))
         {
-            ret = IOT_ERR_OK;
-            Json::Value::iterator it = datanodesAnswer["items"].begin();
-            while(it != datanodesAnswer["items"].end())
-            {
-                IOT_ReadData item;
-
-                if(item.FromJSON(*it)) {
-                    data.push_back(item);
-                }
-                else {
-                    ret = IOTAPI::IOT_ERR_GENERAL;
-                    break;
-                }
-                ++it;
+            if(i != chunk.begin) {
+                chunk.payload += ",";
             }
+            chunk.payload += items[i];
+            ++i;
         }
+
+        chunk.payload += "]";
+        chunk.end = i;
+        chunks.push_back(chunk);
     }
+}
 
-    return ret;
+IOTAPI::IOTAPI_err IOT_API::ParseWriteResponse(IOTAPI::IOTAPI_err ret, const std::string& response,
+                                               const std::vector<IOT_WriteData>& data, size_t begin, size_t end,
+                                               std::vector<bool>& accepted) const
+{
+    if(ret != IOTAPI::IOT_ERR_OK) {
+        return GetErrorCode(response, ret);
+    }
+
+    // Without a written count nothing is known to be stored, so the write
+    // fails and no sample is marked written
+    IOT_ResponseDecoder::WriteReply reply;
+    IOT_ResponseDecoder::Result decoded = IOT_ResponseDecoder::DecodeWriteReply(response, reply);
+    if(decoded == IOT_ResponseDecoder::DECODE_MALFORMED || !reply.hasTotal) {
+        return IOT_ERR_GENERAL;
+    }
+
+    if(reply.totalWritten == end - begin) {
+        for(size_t i = begin; i < end; ++i) {
+            accepted[i] = true;
+        }
+        return IOT_ERR_OK;
+    }
+
+    // Partial write: the server reports written count per datanode. A datanode
+    // is accepted only if all of its samples in this request were written.
+    if(!reply.hasResponses) {
+        return IOT_ERR_WRITE_FAILED;
+    }
+
+    std::map<std::string, size_t> writtenPerNode;
+    for(size_t i = 0; i < reply.written.size(); ++i) {
+        writtenPerNode[DatanodeFromHref(reply.written[i].first)] += reply.written[i].second;
+    }
+
+    std::map<std::string, size_t> submittedPerNode;
+    for(size_t i = begin; i < end; ++i) {
+        submittedPerNode[DatanodeKey(data[i].GetPath(), data[i].GetName())]++;
+    }
+
+    for(size_t i = begin; i < end; ++i)
+    {
+        std::string key = DatanodeKey(data[i].GetPath(), data[i].GetName());
+        std::map<std::string, size_t>::const_iterator written = writtenPerNode.find(key);
+        if(written != writtenPerNode.end() && written->second == submittedPerNode[key]) {
+            accepted[i] = true;
+        }
+    }
+
+    return IOT_ERR_WRITE_FAILED;
 }
 
-IOTAPI::IOTAPI_err IOT_API::SendData(const std::string& devId, const std::vector<IOT_WriteData>& data) const
+std::string IOT_API::DatanodeKey(const std::string& path, const std::string& name)
 {
-    IOTAPI::IOTAPI_err ret = IOT_ERR_PARAM;
-    Json::Value writeData;
+    std::string key = path.empty() ? name : path + "/" + name;
+    size_t first = key.find_first_not_of('/');
+    return (first == std::string::npos) ? std::string() : key.substr(first);
+}
 
-    if(data.empty()) {
-        return ret;
+std::string IOT_API::DatanodeFromHref(const std::string& href)
+{
+    static const std::string param = "datanodes=";
+
+    size_t pos = href.find(param);
+    if(pos == std::string::npos) {
+        return std::string();
     }
+    pos += param.size();
 
-    for(uint32_t i = 0; i < data.size(); ++i)
+    std::string decoded;
+    while(pos < href.size() && href[pos] != '&' && href[pos] != ',')
     {
-        Json::Value oneData;
-        if(data.at(i).ToJSON(oneData)) {
-            writeData.append(oneData);
+        if(href[pos] == '%' && pos + 2 < href.size() && isxdigit(href[pos + 1]) && isxdigit(href[pos + 2])) {
+            decoded += static_cast<char>(strtol(href.substr(pos + 1, 2).c_str(), NULL, 16));
+            pos += 3;
         } else {
-            return ret;
+            decoded += href[pos];
+            ++pos;
         }
     }
 
-    std::string url = m_servAddr + IOT_WRITE_PATH + "/" + devId;
-    std::string response;
-    Json::FastWriter fastWriter;
-    std::string json = fastWriter.write(writeData);
-
-    ret = m_client.PostAndReadResponse(url, m_authName, m_password, json, response);
-
-    Json::Value writeAnswer;
-    if(ParseJson(response, writeAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(writeAnswer);
-        } else if(writeAnswer.isMember("totalWritten") && writeAnswer["totalWritten"].isIntegral()) {
-            if(writeAnswer["totalWritten"].asUInt() == data.size())
-                ret = IOT_ERR_OK;
-        } else {
-            ret = IOT_ERR_GENERAL;
+    return DatanodeKey("", decoded);
+}
+
+IOTAPI::IOTAPI_err IOT_API::ResendRejected(const std::string& devId, const std::vector<IOT_WriteData>& data,
+                                           IOT_WriteResult& result) const
+{
+    if(result.m_submitted != data.size()) {
+        return IOT_ERR_PARAM;
+    }
+
+    std::vector<size_t> rejected;
+    result.GetRejected(rejected);
+    if(rejected.empty()) {
+        result.m_status = IOT_ERR_OK;
+        return IOT_ERR_OK;
+    }
+
+    std::vector<IOT_WriteData> resend;
+    resend.reserve(rejected.size());
+    for(size_t i = 0; i < rejected.size(); ++i) {
+        resend.push_back(data[rejected[i]]);
+    }
+
+    IOT_WriteResult resendResult;
+    IOTAPI_err ret = SendData(devId, resend, resendResult);
+
+    if(result.m_sampleStatus.size() != result.m_submitted) {
+        result.m_sampleStatus.assign(result.m_submitted, result.m_status);
+    }
+
+    for(size_t i = 0; i < rejected.size(); ++i) {
+        if(resendResult.IsAccepted(i)) {
+            result.m_acceptedSamples[rejected[i]] = true;
         }
+        result.m_sampleStatus[rejected[i]] = resendResult.GetSampleStatus(i);
     }
 
+    result.m_accepted += resendResult.m_accepted;
+    result.m_payloadBytes += resendResult.m_payloadBytes;
+    result.m_latencyMs += resendResult.m_latencyMs;
+    result.m_chunks += resendResult.m_chunks;
+    result.m_failedChunks = resendResult.m_failedChunks;
+    result.m_status = ret;
     return ret;
 }
 
 IOTAPI_err IOT_API::GetQuota(IOT_Quota& quota) const
 {
-    std::string response;
-    IOTAPI::IOTAPI_err ret = m_client.GetResource(m_servAddr + IOT_QUOTA_PATH + "/all", m_authName, m_password, response);
-
-    Json::Value quotaAnswer;
-    if(ParseJson(response, quotaAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(quotaAnswer);
-        } else if(!quota.FromJSON(quotaAnswer)) {
-            ret = IOT_ERR_GENERAL;
+    return Request(m_servAddr + IOT_QUOTA_PATH + "/all", NULL, IOT_EP_QUOTA, "", [&quota](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeQuota(response, quota) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    });
+}
+
+IOTAPI_err IOT_API::GetQuota(const std::string& devId, IOT_QuotaDevice& quota) const
+{
+    return Request(m_servAddr + IOT_QUOTA_PATH + "/" + devId, NULL, IOT_EP_QUOTA, devId, [&quota](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeQuotaDevice(response, quota) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    });
+}
+
+void IOT_API::GetDevicesAsync(IOT_AsyncTransport& transport, std::vector<IOT_GetDevice>& devices, Completion done) const
+{
+    devices.clear();
+    RequestAsync(transport, m_servAddr + IOT_DEVICE_PATH, NULL, IOT_EP_DEVICES, "", [&devices](const std::string& response) {
+        IOT_ResponseDecoder::DecodeDevices(response, devices);
+        return IOT_ERR_OK;
+    }, done);
+}
+
+void IOT_API::GetDeviceAsync(IOT_AsyncTransport& transport, const std::string& devId, IOT_GetDevice& device,
+                             Completion done) const
+{
+    RequestAsync(transport, m_servAddr + IOT_DEVICE_PATH + "/" + devId, NULL, IOT_EP_DEVICES, devId, [&device](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDevice(response, device) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    }, done);
+}
+
+void IOT_API::RegisterDeviceAsync(IOT_AsyncTransport& transport, const IOT_RegDevice& device, std::string& devID,
+                                  Completion done) const
+{
+    devID = "";
+
+    std::string devJson;
+    if(!device.ToJSON(devJson)) {
+        if(done) {
+            done(IOT_ERR_PARAM);
         }
+        return;
     }
 
-    return ret;
+    RequestAsync(transport, m_servAddr + IOT_DEVICE_PATH, &devJson, IOT_EP_DEVICES, "", [&devID](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDeviceId(response, devID) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    }, done);
 }
 
-IOTAPI_err IOT_API::GetQuota(const std::string& devId, IOT_QuotaDevice& quota) const
+void IOT_API::ReadDataAsync(IOT_AsyncTransport& transport, const std::string& devId, const IOT_ReadDataFilter& filter,
+                            std::vector<IOT_ReadData>& data, Completion done) const
+{
+    std::string url = m_servAddr + IOT_READ_PATH + "/" + devId + filter.BuildParameterString();
+    RequestAsync(transport, url, NULL, IOT_EP_READ, devId, [&data](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDatanodes(response, "datanodeReads", data) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    }, done);
+}
+
+void IOT_API::GetDatanodesAsync(IOT_AsyncTransport& transport, const std::string& devId, std::vector<IOT_ReadData>& data,
+                                Completion done) const
+{
+    std::string url = m_servAddr + IOT_DEVICE_PATH + "/" + devId + "/datanodes";
+    RequestAsync(transport, url, NULL, IOT_EP_DATANODES, devId, [&data](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeDatanodes(response, "items", data) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    }, done);
+}
+
+void IOT_API::GetQuotaAsync(IOT_AsyncTransport& transport, IOT_Quota& quota, Completion done) const
+{
+    RequestAsync(transport, m_servAddr + IOT_QUOTA_PATH + "/all", NULL, IOT_EP_QUOTA, "", [&quota](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeQuota(response, quota) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    }, done);
+}
+
+void IOT_API::GetQuotaAsync(IOT_AsyncTransport& transport, const std::string& devId, IOT_QuotaDevice& quota,
+                            Completion done) const
+{
+    RequestAsync(transport, m_servAddr + IOT_QUOTA_PATH + "/" + devId, NULL, IOT_EP_QUOTA, devId, [&quota](const std::string& response) {
+        return (IOT_ResponseDecoder::DecodeQuotaDevice(response, quota) == IOT_ResponseDecoder::DECODE_INVALID) ?
+            IOT_ERR_GENERAL : IOT_ERR_OK;
+    }, done);
+}
+
+IOTAPI::IOTAPI_err IOT_API::Request(const std::string& url, const std::string* payload, IOTAPI::IOT_Endpoint endpoint,
+                                    const std::string& devId, const Decoder& decode) const
 {
+    IOTAPI_err ret = Throttle(devId);
+    if(ret != IOT_ERR_OK) {
+        return ret;
+    }
+
     std::string response;
-    std::string url = m_servAddr + IOT_QUOTA_PATH + "/" + devId;
-    IOTAPI::IOTAPI_err ret = m_client.GetResource(url, m_authName, m_password, response);
-
-    Json::Value quotaAnswer;
-    if(ParseJson(response, quotaAnswer)) {
-        if(ret != IOTAPI::IOT_ERR_OK) {
-            ret = GetErrorCode(quotaAnswer);
-        } else if(!quota.FromJSON(quotaAnswer)) {
-            ret = IOT_ERR_GENERAL;
+    IOT_RequestTiming timing;
+    {
+        IOT_ClientPool::Lease client(m_clients);
+        if(payload != NULL) {
+            ret = client->PostAndReadResponse(url, m_authName, m_password, *payload, response, &timing);
+        } else {
+            ret = client->GetResource(url, m_authName, m_password, response, &timing);
         }
     }
 
-    return ret;
+    ret = CheckReply(endpoint, devId, ret, response, timing);
+    return (ret == IOT_ERR_OK) ? decode(response) : ret;
 }
 
-bool IOT_API::ParseJson(const std::string& str, Json::Value& value) const
+void IOT_API::RequestAsync(IOT_AsyncTransport& transport, const std::string& url, const std::string* payload,
+                           IOTAPI::IOT_Endpoint endpoint, const std::string& devId, Decoder decode, Completion done) const
 {
-    Json::Reader json_reader;
+    if(m_limiter->TryAcquire(devId) != 0) {
+        if(done) {
+            done(IOT_ERR_THROTTLED);
+        }
+        return;
+    }
 
-    if(!json_reader.parse(str, value, false))
-    {
-        return false;
+    IOT_AsyncTransport::Callback callback =
+        [this, endpoint, devId, decode, done](IOTAPI_err ret, const std::string& response, const IOT_RequestTiming& timing) {
+            ret = CheckReply(endpoint, devId, ret, response, timing);
+            if(ret == IOT_ERR_OK) {
+                ret = decode(response);
+            }
+            if(done) {
+                done(ret);
+            }
+        };
+
+    if(payload != NULL) {
+        transport.Post(url, m_authName, m_password, *payload, callback);
+    } else {
+        transport.Get(url, m_authName, m_password, callback);
     }
+}
 
-    return true;
+IOTAPI::IOTAPI_err IOT_API::CheckReply(IOTAPI::IOT_Endpoint endpoint, const std::string& devId, IOTAPI::IOTAPI_err ret,
+                                       const std::string& response, const IOT_RequestTiming& timing) const
+{
+    RecordTiming(endpoint, timing, ret);
+    m_limiter->OnReply(devId, timing.httpCode, timing.retryAfterS);
+    return (ret != IOT_ERR_OK) ? GetErrorCode(response, ret) : ret;
 }
 
-IOTAPI::IOTAPI_err IOT_API::GetErrorCode(Json::Value& value) const
+IOTAPI_err IOT_API::GetRequestStats(IOTAPI::IOT_Endpoint endpoint, IOT_EndpointStats& stats) const
 {
+    if(endpoint < 0 || endpoint >= IOT_EP_COUNT) {
+        return IOT_ERR_PARAM;
+    }
+
+    stats.Clear();
+    for(size_t shard = 0; shard < IOT_Metrics::SHARDS; ++shard) {
+        m_stats[shard][endpoint].MergeTo(stats);
+    }
+
+    return IOT_ERR_OK;
+}
+
+void IOT_API::ResetRequestStats()
+{
+    for(size_t shard = 0; shard < IOT_Metrics::SHARDS; ++shard) {
+        for(int i = 0; i < IOT_EP_COUNT; ++i) {
+            m_stats[shard][i].Clear();
+        }
+    }
+}
+
+void IOT_API::RecordTiming(IOTAPI::IOT_Endpoint endpoint, const IOT_RequestTiming& timing, IOTAPI::IOTAPI_err ret) const
+{
+    IOT_Metrics::Instance().RecordRequest(endpoint, ret, timing);
+
+    m_stats[IOT_Metrics::GetShard()][endpoint].Record(timing, ret == IOT_ERR_OK);
+}
+
+IOTAPI::IOTAPI_err IOT_API::GetErrorCode(const std::string& response, IOTAPI::IOTAPI_err ret) const
+{
+    // Errors told by the HTTP status or the transfer stand, whatever the reply says
+    if(ret == IOT_ERR_THROTTLED || ret == IOT_ERR_SERVER || ret == IOT_ERR_TIMEOUT || ret == IOT_ERR_CONN) {
+        return ret;
+    }
+
     int code = 0;
-    if(value.isMember("code") && value["code"].isIntegral()) {
-        code = value["code"].asInt();
+    if(IOT_ResponseDecoder::DecodeErrorCode(response, code) == IOT_ResponseDecoder::DECODE_MALFORMED) {
+        return ret;
     }
 
     switch(code) {
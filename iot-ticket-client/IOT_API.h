@@ -26,6 +26,10 @@
 #include <string>
 #include <stdint.h>
 #include <vector>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
 #include "IOT_defines.h"
 #include "IOT_WriteData.h"
 #include "IOT_ReadData.h"
@@ -33,22 +37,40 @@
 #include "IOT_RegDevice.h"
 #include "IOT_GetDevice.h"
 #include "IOT_RestClient.h"
+#include "IOT_ClientPool.h"
+#include "IOT_AsyncTransport.h"
 #include "IOT_Quota.h"
 #include "IOT_QuotaDevice.h"
+#include "IOT_RateLimiter.h"
+#include "IOT_EndpointStats.h"
+#include "IOT_Metrics.h"
+#include "IOT_WriteResult.h"
 
 //! \brief Main interface of the IoT-Ticket C++ Client
-//! \note This class does not implement mutual exclusion for its operations.
-//!       If multithreaded access is required, each thread should create its
-//!       own instance from IOT_API.
+//! \note One instance can be shared by several threads. Each request is made
+//!       with an HTTP client leased from an internal pool without locking, so
+//!       up to maxConnections requests run in parallel. The Set...() functions
+//!       change settings used by all threads and should be called before the
+//!       instance is shared.
+//!       The ...Async() functions start the operation on an IOT_AsyncTransport
+//!       and return at once. The instance and output parameters must stay valid until the
+//!       completion is called from IOT_AsyncTransport::Poll().
 class IOT_API
 {
 public:
+    //! \brief Completion of an asynchronous operation
+    //! \param [in] ret - IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    typedef std::function<void(IOTAPI::IOTAPI_err ret)> Completion;
+
     //! \brief Constructor for IoT library
-    //! \param [in] serverAddress - IoT-Ticket server address to be used
-    //! \param [in] auth          - Username that is used for authentication when communicating with IoT-Ticket server
-    //! \param [in] password      - Password that is used for authentication when communicating with IoT-Ticket server
-    //! \param [in] timeout       - Timeout of single operation when communicating with the server
-    IOT_API(std::string serverAddress, std::string authName, std::string password, size_t timeout_s = 20);
+    //! \param [in] serverAddress  - IoT-Ticket server address to be used
+    //! \param [in] auth           - Username that is used for authentication when communicating with IoT-Ticket server
+    //! \param [in] password       - Password that is used for authentication when communicating with IoT-Ticket server
+    //! \param [in] timeout        - Timeout of single operation when communicating with the server
+    //! \param [in] maxConnections - Number of pooled HTTP clients, 0 for the number of CPU threads.
+    //!                              More concurrent requests add extra connections to the pool.
+    IOT_API(std::string serverAddress, std::string authName, std::string password, size_t timeout_s = 20,
+            size_t maxConnections = 0);
 
     //! \brief Returns devices from IoT-Ticket server
     //! \param [out] devices - Devices returned from IoT-Ticket server
@@ -73,6 +95,34 @@ public:
     //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
     IOTAPI::IOTAPI_err SendData(const std::string& devId, const std::vector<IOT_WriteData>& data) const;
 
+    //! \brief Send measurement data to the IoT-Ticket server and report details of the write
+    //! \note Large batches are split into several requests (see SetWriteChunkLimits())
+    //!       which are sent concurrently. Requests that did not reach the server
+    //!       (see IsRetryableError()) are retried, and result tells which samples
+    //!       were written. A request that timed out after it was sent fails with
+    //!       IOTAPI::IOT_ERR_TIMEOUT and is not retried, as it may have been stored.
+    //!       A successful HTTP reply that does not tell the written count, such as
+    //!       one that is not JSON, fails with IOTAPI::IOT_ERR_GENERAL and marks no
+    //!       sample written. The server may still have stored them, so resending
+    //!       after either error may duplicate samples.
+    //! \param [in] devId   - Device ID one wants to write to
+    //! \param [in] data    - Vector that contains the data to be written
+    //! \param [out] result - Number of accepted samples, payload size and latency of the write
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err SendData(const std::string& devId, const std::vector<IOT_WriteData>& data,
+                                IOT_WriteResult& result) const;
+
+    //! \brief Send again the samples that were not written by a previous SendData() call
+    //! \note The server reports written samples per datanode, so if any sample of a
+    //!       datanode was not written in a request, all samples of that datanode in
+    //!       the request are considered rejected.
+    //! \param [in] devId      - Device ID one wants to write to
+    //! \param [in] data       - The same vector that was passed to SendData()
+    //! \param [in,out] result - Result of the previous write, updated with the new outcome
+    //! \return IOTAPI::IOT_ERR_OK if all samples are now written, error code otherwise
+    IOTAPI::IOTAPI_err ResendRejected(const std::string& devId, const std::vector<IOT_WriteData>& data,
+                                      IOT_WriteResult& result) const;
+
     //! \brief Send single measurement to the IoT-Ticket server
     //! \param [in] devId - Device ID one wants to write to
     //! \param [in] data  - Data to be written
@@ -104,15 +154,231 @@ public:
     //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
     IOTAPI::IOTAPI_err GetQuota(const std::string& devId, IOT_QuotaDevice& quota) const;
 
+    //! \brief Asynchronous version of GetDevices()
+    void GetDevicesAsync(IOT_AsyncTransport& transport, std::vector<IOT_GetDevice>& devices, Completion done) const;
+
+    //! \brief Asynchronous version of GetDevice()
+    void GetDeviceAsync(IOT_AsyncTransport& transport, const std::string& devId, IOT_GetDevice& device,
+                        Completion done) const;
+
+    //! \brief Asynchronous version of RegisterDevice()
+    void RegisterDeviceAsync(IOT_AsyncTransport& transport, const IOT_RegDevice& device, std::string& devID,
+                             Completion done) const;
+
+    //! \brief Asynchronous version of SendData()
+    //! \note data must stay unchanged until the completion is called.
+    void SendDataAsync(IOT_AsyncTransport& transport, const std::string& devId, const std::vector<IOT_WriteData>& data,
+                       IOT_WriteResult& result, Completion done) const;
+
+    //! \brief Asynchronous version of ReadData()
+    void ReadDataAsync(IOT_AsyncTransport& transport, const std::string& devId, const IOT_ReadDataFilter& filter,
+                       std::vector<IOT_ReadData>& data, Completion done) const;
+
+    //! \brief Asynchronous version of GetDatanodes()
+    void GetDatanodesAsync(IOT_AsyncTransport& transport, const std::string& devId, std::vector<IOT_ReadData>& data,
+                           Completion done) const;
+
+    //! \brief Asynchronous version of GetQuota()
+    void GetQuotaAsync(IOT_AsyncTransport& transport, IOT_Quota& quota, Completion done) const;
+
+    //! \brief Asynchronous version of GetQuota() for single device
+    void GetQuotaAsync(IOT_AsyncTransport& transport, const std::string& devId, IOT_QuotaDevice& quota,
+                       Completion done) const;
+
+    //! \brief Get timing statistics of requests made to single server endpoint
+    //! \note Statistics are collected from every request made through this instance
+    //!       since construction or the last call to ResetRequestStats().
+    //! \param [in] endpoint - Endpoint for which the statistics are returned
+    //! \param [out] stats   - Snapshot of the collected statistics
+    //! \return IOTAPI::IOT_ERR_OK if successful, IOTAPI::IOT_ERR_PARAM for unknown endpoint
+    IOTAPI::IOTAPI_err GetRequestStats(IOTAPI::IOT_Endpoint endpoint, IOT_EndpointStats& stats) const;
+
+    //! \brief Clear request statistics of all endpoints
+    void ResetRequestStats();
+
+    //! \brief Set limits for splitting large writes into several requests
+    //! \param [in] maxSamples - Max number of samples in one request
+    //! \param [in] maxBytes   - Max JSON payload size of one request
+    //! \return false if a limit is zero
+    bool SetWriteChunkLimits(size_t maxSamples, size_t maxBytes);
+
+    //! \brief Set concurrency and retries of split writes
+    //! \param [in] connections - Max number of requests sent concurrently
+    //! \param [in] retries     - Number of times a failed request is retried
+    void SetWriteConcurrency(size_t connections, uint32_t retries);
+
+    //! \brief Round double values of a datanode to a number of decimals when they are written
+    //! \note Applies to SendData(), SendDataAsync() and IOT_PreparedWriter. Must be
+    //!       set before the instance is shared.
+    //! \param [in] path     - Path of the datanode
+    //! \param [in] name     - Name of the datanode
+    //! \param [in] decimals - 0...IOT_DoubleFormat::MAX_DECIMALS, or IOT_WriteData::NO_PRECISION
+    //!                        to write full precision again
+    //! \return false if decimals is out of range
+    bool SetPrecision(const std::string& path, const std::string& name, int decimals);
+
+    //! \brief Number of decimals double values of a datanode are rounded to
+    //! \return IOT_WriteData::NO_PRECISION if not set
+    int GetPrecision(const std::string& path, const std::string& name) const;
+
+    //! \brief Set HTTP version of blocking requests
+    //! \note Must be set before the first request. Asynchronous requests use
+    //!       the version set on IOT_AsyncTransport.
+    //! \param [in] version - HTTP version
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if requests have been made,
+    //!         IOTAPI::IOT_ERR_PARAM if libcurl does not support the version
+    IOTAPI::IOTAPI_err SetHttpVersion(IOTAPI::IOT_HttpVersion version);
+
+    //! \brief Set how idle connections of blocking requests are kept usable
+    //! \note Must be set before the first request. Asynchronous requests use
+    //!       the policy set on IOT_AsyncTransport.
+    //! \param [in] policy - Keepalive probes and max idle time
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if requests have been made
+    IOTAPI::IOTAPI_err SetKeepAlive(const IOT_KeepAlive& policy);
+
+    //! \brief Keep TLS sessions in a file so that the first connection after a restart resumes a session
+    //! \note Must be set before the first request. Requires libcurl 8.12.0 or
+    //!       newer built with SSLS-EXPORT.
+    //!       Anyone who can read the file can resume the sessions, so keep it
+    //!       in a private directory.
+    //! \param [in] path - Session file, created if it does not exist
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if requests have been made,
+    //!         IOTAPI::IOT_ERR_PARAM if libcurl cannot export sessions
+    IOTAPI::IOTAPI_err SetSessionFile(const std::string& path);
+
+    //! \brief Resolve the server name and open connections before the first request
+    //! \note Takes name lookup, TCP connect and TLS handshake out of the first
+    //!       SendData() after startup. Single request writes of the thread
+    //!       calling Warmup() and of threads leasing the other warmed
+    //!       connections go out on a ready connection.
+    //! \param [in] connections - Number of connections to open, at most the connection limit
+    //! \return IOTAPI::IOT_ERR_OK if connected, error code otherwise
+    IOTAPI::IOTAPI_err Warmup(size_t connections = 1) const;
+
+    //! \brief Number of pooled connections given to the constructor (CPU threads for 0)
+    size_t GetMaxConnections() const;
+
+    //! \brief Use a rate limiter shared with other instances of the same account
+    //! \note Each instance has a limiter of its own without rate limits, which
+    //!       pauses requests after 429 and 503 replies. A blocking request waits
+    //!       for the limiter at most the operation timeout, and fails with
+    //!       IOTAPI::IOT_ERR_THROTTLED without being sent if it would have to
+    //!       wait longer. Asynchronous requests do not wait but fail at once.
+    //!       Must be set before the instance is shared.
+    //! \param [in] limiter - Limiter to use, NULL for the own limiter. Must outlive the instance.
+    void SetRateLimiter(IOT_RateLimiter* limiter);
+
+    //! \brief Rate limiter in use, for configuration and introspection
+    IOT_RateLimiter& GetRateLimiter();
+
+    //! \brief Time until the rate limiter lets a request out
+    //! \param [in] devId - Device of the request, empty for requests not for a device
+    //! \return Milliseconds, 0 if now
+    long GetThrottleDelayMs(const std::string& devId = std::string()) const;
+
+    //! \brief Check if an operation may be retried after an error without duplicating data
+    //! \note True for errors where the request did not reach the server or was
+    //!       refused unprocessed: name lookup and connect failures, 429 and 503.
+    //!       Timeouts and other errors after the request was sent are not
+    //!       retried, as the server may have stored a write.
+    static bool IsRetryableError(IOTAPI::IOTAPI_err err);
+
 private:
+    friend class IOT_PreparedWriter;
+    friend class IOT_WriteTester;
+
+    //! Part of a write sent in one request
+    struct WriteChunk
+    {
+        size_t begin;
+        size_t end;
+        std::string payload;
+    };
+
+    //! State of a write made by SendDataAsync()
+    struct AsyncWrite;
+
+    //! Precision of the datanode of the previous sample of a write, so that
+    //! consecutive samples of a datanode are looked up once
+    struct PrecisionCursor
+    {
+        PrecisionCursor(): name(NULL), path(NULL), decimals(IOT_WriteData::NO_PRECISION) {}
+
+        //! Interned name and path of the previous sample
+        const std::string* name;
+        const std::string* path;
+        int decimals;
+    };
+
+    //! Decodes successful server reply into output parameters of an operation
+    typedef std::function<IOTAPI::IOTAPI_err(const std::string& response)> Decoder;
+
+    //! Make a request with a pooled client, POST if payload is given, and decode the reply.
+    //! devId selects the rate limiter lane, empty for requests not for a device.
+    IOTAPI::IOTAPI_err Request(const std::string& url, const std::string* payload, IOTAPI::IOT_Endpoint endpoint,
+                               const std::string& devId, const Decoder& decode) const;
+
+    //! Start a request on transport, POST if payload is given, and decode the reply on completion
+    void RequestAsync(IOT_AsyncTransport& transport, const std::string& url, const std::string* payload,
+                      IOTAPI::IOT_Endpoint endpoint, const std::string& devId, Decoder decode, Completion done) const;
+
+    //! Record timing of a completed request, pass its status to the rate limiter and map a failed reply to error code
+    IOTAPI::IOTAPI_err CheckReply(IOTAPI::IOT_Endpoint endpoint, const std::string& devId, IOTAPI::IOTAPI_err ret,
+                                  const std::string& response, const IOT_RequestTiming& timing) const;
+
+    //! Wait for the rate limiter to let a request out, at most the operation timeout
+    //! \return IOTAPI::IOT_ERR_THROTTLED if the request may not be sent
+    IOTAPI::IOTAPI_err Throttle(const std::string& devId) const;
+
+    //! Wait for the rate limiter to let a request out, at most until deadline
+    IOTAPI::IOTAPI_err Throttle(const std::string& devId, std::chrono::steady_clock::time_point deadline) const;
+
+    //! Serialize samples to write chunks and reset result for a new write
+    IOTAPI::IOTAPI_err PrepareWrite(const std::vector<IOT_WriteData>& data, std::vector<WriteChunk>& chunks,
+                                    IOT_WriteResult& result) const;
+
+    //! Handle reply to a chunk of a write, returns status of the chunk
+    IOTAPI::IOTAPI_err FinishChunk(const std::string& devId, const WriteChunk& chunk, IOTAPI::IOTAPI_err ret,
+                                   const std::string& response, const IOT_RequestTiming& timing,
+                                   const std::vector<IOT_WriteData>& data, IOT_WriteResult& result) const;
+
+    //! Set overall outcome of a write, and the status of each sample, from status of its chunks
+    IOTAPI::IOTAPI_err FinishWrite(const std::vector<WriteChunk>& chunks, const std::vector<IOTAPI::IOTAPI_err>& chunkStatus,
+                                   std::chrono::steady_clock::time_point started, IOT_WriteResult& result) const;
+
+    //! Post queued chunks of an asynchronous write up to the write concurrency
+    void PostChunks(const std::shared_ptr<AsyncWrite>& write) const;
+
+    //! Append sample to a write payload with the precision of its datanode
+    bool AppendSample(const IOT_WriteData& sample, PrecisionCursor& cursor, std::string& json) const;
+
+    //! Group serialized samples to requests according to the chunk limits
+    void BuildWriteChunks(const std::vector<std::string>& items, std::vector<WriteChunk>& chunks) const;
+
+    //! Check server reply for a write of data[begin...end-1] and mark the written samples.
+    //! A reply without the written count fails with IOTAPI::IOT_ERR_GENERAL and marks nothing.
+    IOTAPI::IOTAPI_err ParseWriteResponse(IOTAPI::IOTAPI_err ret, const std::string& response,
+                                          const std::vector<IOT_WriteData>& data, size_t begin, size_t end,
+                                          std::vector<bool>& accepted) const;
+
+    //! Datanode identifier used to match samples with server write results
+    static std::string DatanodeKey(const std::string& path, const std::string& name);
+
+    //! Extract datanode identifier from href of a write result
+    static std::string DatanodeFromHref(const std::string& href);
+
+    //! Address of the process data write endpoint of a device
+    std::string WriteUrl(const std::string& devId) const;
+
     //! Removes last forward slash from URL string if present
     void RemoveTrailingSlash(std::string& str) const;
 
-    //! Try to parse string to JSON object
-    bool ParseJson(const std::string& str, Json::Value& value) const;
+    //! Extract IoT-Ticket error code from server JSON reply. ret is kept if the reply is not JSON
+    //! or ret tells throttling, a server or a transfer error, which the client may retry.
+    IOTAPI::IOTAPI_err GetErrorCode(const std::string& response, IOTAPI::IOTAPI_err ret) const;
 
-    //! Extract IoT-Ticket error code from server JSON reply
-    IOTAPI::IOTAPI_err GetErrorCode(Json::Value& value) const;
+    //! Add timing of a completed request to endpoint statistics
+    void RecordTiming(IOTAPI::IOT_Endpoint endpoint, const IOT_RequestTiming& timing, IOTAPI::IOTAPI_err ret) const;
 
     //! Base address of the IoT-Ticket server API
     std::string m_servAddr;
@@ -123,8 +389,35 @@ private:
     //! Password for HTTP basic auth
     std::string m_password;
 
-    //! Client component that handles the HTTPS communication with server
-    IOT_RestClient m_client;
+    //! Timeout of single operation in seconds
+    size_t m_timeout_s;
+
+    //! Max number of samples in one write request
+    size_t m_chunkMaxSamples;
+
+    //! Max payload size of one write request
+    size_t m_chunkMaxBytes;
+
+    //! Max number of concurrent write requests
+    size_t m_writeConcurrency;
+
+    //! Number of retries for failed write requests
+    uint32_t m_writeRetries;
+
+    //! Decimals double values are rounded to, by DatanodeKey()
+    std::map<std::string, int> m_precision;
+
+    //! Clients that handle the HTTPS communication with server, one per concurrent request
+    mutable IOT_ClientPool m_clients;
+
+    //! Rate limiter used unless one is shared with SetRateLimiter()
+    IOT_RateLimiter m_ownLimiter;
+
+    //! Rate limiter in use
+    IOT_RateLimiter* m_limiter;
+
+    //! Request statistics of each endpoint, sharded per thread like IOT_Metrics
+    mutable IOT_SharedEndpointStats m_stats[IOT_Metrics::SHARDS][IOTAPI::IOT_EP_COUNT];
 };
 
 #endif //IOT_API_H
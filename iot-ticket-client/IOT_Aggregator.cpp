@@ -0,0 +1,366 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_Aggregator.h"
+#include <limits>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const char* const IOT_Aggregator::SUFFIX_MIN = "_min";
+const char* const IOT_Aggregator::SUFFIX_MAX = "_max";
+const char* const IOT_Aggregator::SUFFIX_MEAN = "_mean";
+const char* const IOT_Aggregator::SUFFIX_COUNT = "_count";
+
+//! Number of independent accumulators in the aggregation kernel
+static const size_t KERNEL_LANES = 4;
+
+IOT_Aggregator::Config::Config() :
+    windowMs(0),
+    slideMs(0),
+    functions(AGG_ALL)
+{
+}
+
+IOT_Aggregator::Channel::Channel() :
+    open(false),
+    paneStartMs(0)
+{
+    stats.received = 0;
+    stats.windows = 0;
+    stats.late = 0;
+}
+
+IOT_Aggregator::IOT_Aggregator()
+{
+}
+
+bool IOT_Aggregator::SetDefaultConfig(const Config& config)
+{
+    if(!IsValid(config)) {
+        return false;
+    }
+
+    m_default = config;
+    return true;
+}
+
+bool IOT_Aggregator::SetConfig(const std::string& path, const std::string& name, const Config& config)
+{
+    if(!IsValid(config)) {
+        return false;
+    }
+
+    std::string key = Key(path, name);
+    m_configs[key] = config;
+
+    // Aggregation state depends on the window, start over
+    std::map<std::string, Channel>::iterator it = m_channels.find(key);
+    if(it != m_channels.end()) {
+        it->second.config = config;
+        it->second.open = false;
+        it->second.buffer.clear();
+        it->second.panes.clear();
+    }
+    return true;
+}
+
+size_t IOT_Aggregator::Process(const IOT_WriteData& sample, std::vector<IOT_WriteData>& out)
+{
+    Channel& ch = GetChannel(sample.GetPath(), sample.GetName());
+
+    double value;
+    if(ch.config.windowMs == 0 || !sample.GetNumericValue(value)) {
+        out.push_back(sample);
+        return 1;
+    }
+
+    ch.unit = sample.GetUnit();
+    return Add(ch, sample.GetTimeMs(), value, out);
+}
+
+size_t IOT_Aggregator::Process(const std::string& path, const std::string& name, const std::string& unit,
+                               const uint64_t* timesMs, const double* values, size_t count,
+                               std::vector<IOT_WriteData>& out)
+{
+    Channel& ch = GetChannel(path, name);
+    if(ch.config.windowMs == 0) {
+        return 0;
+    }
+
+    ch.unit = unit;
+    size_t emitted = 0;
+    for(size_t i = 0; i < count; ++i) {
+        emitted += Add(ch, timesMs[i], values[i], out);
+    }
+    return emitted;
+}
+
+size_t IOT_Aggregator::Flush(std::vector<IOT_WriteData>& out)
+{
+    size_t emitted = 0;
+    for(std::map<std::string, Channel>::iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    {
+        Channel& ch = it->second;
+        if(ch.open) {
+            emitted += ClosePane(ch, out);
+            ch.open = false;
+            ch.panes.clear();
+        }
+    }
+    return emitted;
+}
+
+bool IOT_Aggregator::GetStats(const std::string& path, const std::string& name, Stats& stats) const
+{
+    std::map<std::string, Channel>::const_iterator it = m_channels.find(Key(path, name));
+    if(it == m_channels.end()) {
+        return false;
+    }
+
+    stats = it->second.stats;
+    return true;
+}
+
+bool IOT_Aggregator::IsValid(const Config& config)
+{
+    if(config.windowMs == 0) {
+        return true;
+    }
+
+    uint64_t slide = (config.slideMs == 0) ? config.windowMs : config.slideMs;
+    return slide <= config.windowMs && config.windowMs % slide == 0 && (config.functions & AGG_ALL) != 0;
+}
+
+std::string IOT_Aggregator::Key(const std::string& path, const std::string& name)
+{
+    return path + "/" + name;
+}
+
+void IOT_Aggregator::Aggregate(const double* values, size_t count, Pane& pane)
+{
+    double mins[KERNEL_LANES];
+    double maxs[KERNEL_LANES];
+    double sums[KERNEL_LANES];
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // Two vectors of two doubles per iteration, independent accumulators hide
+    // the latency of the additions
+    __m128d min0 = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    __m128d max0 = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d min1 = min0;
+    __m128d max1 = max0;
+    __m128d sum1 = sum0;
+
+    for(; i + KERNEL_LANES <= count; i += KERNEL_LANES) {
+        __m128d v0 = _mm_loadu_pd(values + i);
+        __m128d v1 = _mm_loadu_pd(values + i + 2);
+        min0 = _mm_min_pd(min0, v0);
+        min1 = _mm_min_pd(min1, v1);
+        max0 = _mm_max_pd(max0, v0);
+        max1 = _mm_max_pd(max1, v1);
+        sum0 = _mm_add_pd(sum0, v0);
+        sum1 = _mm_add_pd(sum1, v1);
+    }
+
+    _mm_storeu_pd(mins, min0);
+    _mm_storeu_pd(mins + 2, min1);
+    _mm_storeu_pd(maxs, max0);
+    _mm_storeu_pd(maxs + 2, max1);
+    _mm_storeu_pd(sums, sum0);
+    _mm_storeu_pd(sums + 2, sum1);
+#else
+    // Separate accumulators per lane keep the loop free of dependencies between
+    // consecutive elements, so the compiler can vectorize it
+    for(size_t l = 0; l < KERNEL_LANES; ++l) {
+        mins[l] = std::numeric_limits<double>::infinity();
+        maxs[l] = -std::numeric_limits<double>::infinity();
+        sums[l] = 0.0;
+    }
+
+    for(; i + KERNEL_LANES <= count; i += KERNEL_LANES) {
+        for(size_t l = 0; l < KERNEL_LANES; ++l) {
+            double v = values[i + l];
+            mins[l] = (v < mins[l]) ? v : mins[l];
+            maxs[l] = (v > maxs[l]) ? v : maxs[l];
+            sums[l] += v;
+        }
+    }
+#endif
+
+    for(; i < count; ++i) {
+        double v = values[i];
+        mins[0] = (v < mins[0]) ? v : mins[0];
+        maxs[0] = (v > maxs[0]) ? v : maxs[0];
+        sums[0] += v;
+    }
+
+    pane.min = mins[0];
+    pane.max = maxs[0];
+    pane.sum = sums[0];
+    for(size_t l = 1; l < KERNEL_LANES; ++l) {
+        pane.min = (mins[l] < pane.min) ? mins[l] : pane.min;
+        pane.max = (maxs[l] > pane.max) ? maxs[l] : pane.max;
+        pane.sum += sums[l];
+    }
+    pane.count = count;
+}
+
+IOT_Aggregator::Channel& IOT_Aggregator::GetChannel(const std::string& path, const std::string& name)
+{
+    std::string key = Key(path, name);
+
+    std::map<std::string, Channel>::iterator it = m_channels.find(key);
+    if(it != m_channels.end()) {
+        return it->second;
+    }
+
+    Channel& ch = m_channels[key];
+    std::map<std::string, Config>::const_iterator config = m_configs.find(key);
+    ch.config = (config != m_configs.end()) ? config->second : m_default;
+    ch.path = path;
+    ch.name = name;
+    return ch;
+}
+
+size_t IOT_Aggregator::Add(Channel& ch, uint64_t timeMs, double value, std::vector<IOT_WriteData>& out)
+{
+    const uint64_t slide = (ch.config.slideMs == 0) ? ch.config.windowMs : ch.config.slideMs;
+    const size_t windowPanes = ch.config.windowMs / slide;
+
+    ch.stats.received++;
+    if(isnan(value)) {
+        return 0;
+    }
+
+    if(!ch.open) {
+        ch.open = true;
+        ch.paneStartMs = timeMs - timeMs % slide;
+    } else if(timeMs < ch.paneStartMs) {
+        ch.stats.late++;
+        return 0;
+    }
+
+    size_t emitted = 0;
+    size_t closed = 0;
+    while(timeMs >= ch.paneStartMs + slide) {
+        if(closed > windowPanes) {
+            // Gap longer than the window, the skipped windows have no samples
+            ch.panes.clear();
+            ch.paneStartMs = timeMs - timeMs % slide;
+            break;
+        }
+        emitted += ClosePane(ch, out);
+        ++closed;
+    }
+
+    ch.buffer.push_back(value);
+    return emitted;
+}
+
+size_t IOT_Aggregator::ClosePane(Channel& ch, std::vector<IOT_WriteData>& out)
+{
+    const uint64_t slide = (ch.config.slideMs == 0) ? ch.config.windowMs : ch.config.slideMs;
+    const size_t windowPanes = ch.config.windowMs / slide;
+
+    Pane pane;
+    pane.count = 0;
+    if(!ch.buffer.empty()) {
+        Aggregate(&ch.buffer[0], ch.buffer.size(), pane);
+        ch.buffer.clear();
+    }
+
+    ch.panes.push_back(pane);
+    while(ch.panes.size() > windowPanes) {
+        ch.panes.pop_front();
+    }
+
+    ch.paneStartMs += slide;
+    return Emit(ch, ch.paneStartMs, out);
+}
+
+size_t IOT_Aggregator::Emit(Channel& ch, uint64_t endMs, std::vector<IOT_WriteData>& out)
+{
+    Pane window;
+    window.min = std::numeric_limits<double>::infinity();
+    window.max = -std::numeric_limits<double>::infinity();
+    window.sum = 0.0;
+    window.count = 0;
+
+    for(std::deque<Pane>::const_iterator it = ch.panes.begin(); it != ch.panes.end(); ++it)
+    {
+        if(it->count == 0) {
+            continue;
+        }
+        window.min = (it->min < window.min) ? it->min : window.min;
+        window.max = (it->max > window.max) ? it->max : window.max;
+        window.sum += it->sum;
+        window.count += it->count;
+    }
+
+    if(window.count == 0) {
+        return 0;
+    }
+
+    ch.stats.windows++;
+
+    IOT_WriteData data;
+    data.SetPath(ch.path);
+    data.SetTimeMs(endMs);
+
+    size_t emitted = 0;
+    const uint32_t functions = ch.config.functions;
+    if(functions & (AGG_MIN | AGG_MAX | AGG_MEAN)) {
+        data.SetUnit(ch.unit);
+    }
+    if(functions & AGG_MIN) {
+        data.SetName(ch.name + SUFFIX_MIN);
+        data.SetValue(window.min);
+        out.push_back(data);
+        ++emitted;
+    }
+    if(functions & AGG_MAX) {
+        data.SetName(ch.name + SUFFIX_MAX);
+        data.SetValue(window.max);
+        out.push_back(data);
+        ++emitted;
+    }
+    if(functions & AGG_MEAN) {
+        data.SetName(ch.name + SUFFIX_MEAN);
+        data.SetValue(window.sum / window.count);
+        out.push_back(data);
+        ++emitted;
+    }
+    if(functions & AGG_COUNT) {
+        data.SetName(ch.name + SUFFIX_COUNT);
+        data.SetUnit("");
+        data.SetValue(static_cast<int64_t>(window.count));
+        out.push_back(data);
+        ++emitted;
+    }
+
+    return emitted;
+}
@@ -0,0 +1,175 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_AGGREGATOR_H
+#define IOT_AGGREGATOR_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "IOT_WriteData.h"
+
+//! \brief Windowed aggregation of high rate numeric datanodes
+//! \note Raw samples of a datanode are collected into a contiguous buffer per
+//!       slide interval (pane). When a pane closes its min/max/sum/count are
+//!       computed in one pass, and every window is combined from the panes it
+//!       covers. A tumbling window has slide equal to the window length.
+//!       Each aggregate is emitted as its own datanode named after the source
+//!       datanode with a suffix, e.g. "Vibration_max", timestamped with the end
+//!       of the window. Windows without samples are not emitted.
+//!       Samples older than the open pane are dropped. Samples of unconfigured
+//!       datanodes and samples without a numeric value are passed as is.
+//!       The class is not thread safe.
+class IOT_Aggregator
+{
+public:
+    //! Aggregates that can be emitted, combine with bitwise or
+    typedef enum
+    {
+        AGG_MIN   = 0x01,
+        AGG_MAX   = 0x02,
+        AGG_MEAN  = 0x04,
+        AGG_COUNT = 0x08,
+        AGG_ALL   = 0x0F
+    } Function;
+
+    //! Aggregation settings of a datanode
+    struct Config
+    {
+        Config();
+
+        //! Window length in milliseconds, 0 to pass samples without aggregation
+        uint64_t windowMs;
+
+        //! Interval between windows in milliseconds. Must divide windowMs,
+        //! 0 or windowMs for tumbling windows.
+        uint64_t slideMs;
+
+        //! Aggregates to emit, bitmask of Function values
+        uint32_t functions;
+    };
+
+    //! Aggregation statistics of a datanode
+    struct Stats
+    {
+        uint64_t received;
+        uint64_t windows;
+        uint64_t late;
+    };
+
+    static const char* const SUFFIX_MIN;
+    static const char* const SUFFIX_MAX;
+    static const char* const SUFFIX_MEAN;
+    static const char* const SUFFIX_COUNT;
+
+    IOT_Aggregator();
+
+    //! \brief Set aggregation for datanodes without datanode specific settings
+    //! \return false if the settings are invalid
+    bool SetDefaultConfig(const Config& config);
+
+    //! \brief Set aggregation of a single datanode
+    //! \param [in] path   - Path of the datanode
+    //! \param [in] name   - Name of the datanode
+    //! \param [in] config - Aggregation settings
+    //! \return false if the settings are invalid
+    bool SetConfig(const std::string& path, const std::string& name, const Config& config);
+
+    //! \brief Aggregate a sample
+    //! \param [in]  sample - New sample, timestamps of a datanode should not decrease
+    //! \param [out] out    - Aggregates of completed windows are appended here
+    //! \return Number of samples appended
+    size_t Process(const IOT_WriteData& sample, std::vector<IOT_WriteData>& out);
+
+    //! \brief Aggregate a block of samples of one datanode
+    //! \note Avoids creating an IOT_WriteData for every raw sample of high rate signals.
+    //! \param [in]  path    - Path of the datanode
+    //! \param [in]  name    - Name of the datanode
+    //! \param [in]  unit    - Unit of the datanode, copied to min, max and mean
+    //! \param [in]  timesMs - Sample timestamps, Unix time in milliseconds
+    //! \param [in]  values  - Sample values
+    //! \param [in]  count   - Number of samples
+    //! \param [out] out     - Aggregates of completed windows are appended here
+    //! \return Number of samples appended, or 0 if the datanode is not aggregated
+    size_t Process(const std::string& path, const std::string& name, const std::string& unit,
+                   const uint64_t* timesMs, const double* values, size_t count,
+                   std::vector<IOT_WriteData>& out);
+
+    //! \brief Close the open panes and emit the windows ending with them, even
+    //!        though the windows are not complete yet
+    //! \param [out] out - Aggregates are appended here
+    //! \return Number of samples appended
+    size_t Flush(std::vector<IOT_WriteData>& out);
+
+    //! \brief Get aggregation statistics of a datanode
+    //! \return false if no samples of the datanode have been processed
+    bool GetStats(const std::string& path, const std::string& name, Stats& stats) const;
+
+private:
+    //! Aggregate of the samples of one slide interval
+    struct Pane
+    {
+        double min;
+        double max;
+        double sum;
+        uint64_t count;
+    };
+
+    //! State of a single datanode
+    struct Channel
+    {
+        Channel();
+
+        Config config;
+        Stats stats;
+
+        std::string path;
+        std::string name;
+        std::string unit;
+
+        //! Start of the open pane, values of which are in buffer
+        bool open;
+        uint64_t paneStartMs;
+        std::vector<double> buffer;
+
+        //! Closed panes of the windows still open, oldest first
+        std::deque<Pane> panes;
+    };
+
+    static bool IsValid(const Config& config);
+    static std::string Key(const std::string& path, const std::string& name);
+    static void Aggregate(const double* values, size_t count, Pane& pane);
+
+    Channel& GetChannel(const std::string& path, const std::string& name);
+
+    size_t Add(Channel& ch, uint64_t timeMs, double value, std::vector<IOT_WriteData>& out);
+    size_t ClosePane(Channel& ch, std::vector<IOT_WriteData>& out);
+    size_t Emit(Channel& ch, uint64_t endMs, std::vector<IOT_WriteData>& out);
+
+    Config m_default;
+    std::map<std::string, Config> m_configs;
+    std::map<std::string, Channel> m_channels;
+};
+
+#endif // IOT_AGGREGATOR_H
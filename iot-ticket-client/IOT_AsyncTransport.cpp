@@ -0,0 +1,363 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_AsyncTransport.h"
+
+#include <stdint.h>
+#include <memory>
+
+//! Max time to block in Run() between checks of pending requests
+static const int RUN_WAIT_MS = 1000;
+
+
+IOT_AsyncTransport::IOT_AsyncTransport(size_t timeout_s, size_t maxConnections):
+    m_pending(0), m_eventLoop(false), m_used(false)
+{
+    m_config.SetRequestTimeout(timeout_s);
+
+    m_multi = curl_multi_init();
+    if(m_multi != NULL && maxConnections > 0) {
+        curl_multi_setopt(m_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(maxConnections));
+    }
+}
+
+IOT_AsyncTransport::~IOT_AsyncTransport()
+{
+    // Event loop is not told about sockets closed here
+    m_watch = SocketWatch();
+    m_timer = TimerChange();
+
+    for(std::unordered_set<Request*>::iterator it = m_running.begin(); it != m_running.end(); ++it) {
+        curl_multi_remove_handle(m_multi, (*it)->handle);
+        curl_easy_cleanup((*it)->handle);
+        delete *it;
+    }
+    m_running.clear();
+
+    for(size_t i = 0; i < m_submitted.size(); ++i) {
+        delete m_submitted[i];
+    }
+    m_submitted.clear();
+
+    for(size_t i = 0; i < m_idle.size(); ++i) {
+        curl_easy_cleanup(m_idle[i]);
+    }
+    m_idle.clear();
+
+    if(m_multi != NULL) {
+        curl_multi_cleanup(m_multi);
+        m_multi = NULL;
+    }
+}
+
+void IOT_AsyncTransport::Get(const std::string& url, const std::string& user, const std::string& pw, Callback done)
+{
+    Request* request = new Request();
+    request->url = url;
+    request->user = user;
+    request->pw = pw;
+    request->post = false;
+    request->done.swap(done);
+    request->handle = NULL;
+    Submit(request);
+}
+
+void IOT_AsyncTransport::Post(const std::string& url, const std::string& user, const std::string& pw,
+                              std::string data, Callback done)
+{
+    Request* request = new Request();
+    request->url = url;
+    request->user = user;
+    request->pw = pw;
+    request->post = true;
+    request->payload.swap(data);
+    request->done.swap(done);
+    request->handle = NULL;
+    Submit(request);
+}
+
+size_t IOT_AsyncTransport::Poll(int timeoutMs)
+{
+    if(m_multi == NULL || m_eventLoop) {
+        return 0;
+    }
+
+    StartSubmitted();
+
+    int running = 0;
+    curl_multi_perform(m_multi, &running);
+    size_t completed = CompleteFinished();
+    if(completed > 0) {
+        return completed;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x074400
+    // Unlike curl_multi_wait(), returns early on Wakeup() and waits even without transfers
+    curl_multi_poll(m_multi, NULL, 0, timeoutMs, NULL);
+#else
+    curl_multi_wait(m_multi, NULL, 0, timeoutMs, NULL);
+#endif
+
+    StartSubmitted();
+    curl_multi_perform(m_multi, &running);
+    return CompleteFinished();
+}
+
+void IOT_AsyncTransport::Run()
+{
+    while(GetPending() > 0) {
+        Poll(RUN_WAIT_MS);
+    }
+}
+
+void IOT_AsyncTransport::Wakeup()
+{
+#if LIBCURL_VERSION_NUM >= 0x074400
+    if(m_multi != NULL) {
+        curl_multi_wakeup(m_multi);
+    }
+#endif
+}
+
+IOTAPI::IOTAPI_err IOT_AsyncTransport::SetEventLoop(SocketWatch watch, TimerChange timer)
+{
+    if(m_multi == NULL) {
+        return IOTAPI::IOT_ERR_CURL_CALL;
+    }
+    if(m_used) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+
+    m_watch.swap(watch);
+    m_timer.swap(timer);
+    m_eventLoop = true;
+
+    curl_multi_setopt(m_multi, CURLMOPT_SOCKETFUNCTION, SocketCallback);
+    curl_multi_setopt(m_multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(m_multi, CURLMOPT_TIMERFUNCTION, TimerCallback);
+    curl_multi_setopt(m_multi, CURLMOPT_TIMERDATA, this);
+    return IOTAPI::IOT_ERR_OK;
+}
+
+size_t IOT_AsyncTransport::OnSocketEvent(curl_socket_t fd, int events)
+{
+    int mask = 0;
+    if(events & IO_IN) {
+        mask |= CURL_CSELECT_IN;
+    }
+    if(events & IO_OUT) {
+        mask |= CURL_CSELECT_OUT;
+    }
+    if(events & IO_ERROR) {
+        mask |= CURL_CSELECT_ERR;
+    }
+
+    int running = 0;
+    curl_multi_socket_action(m_multi, fd, mask, &running);
+    return CompleteFinished();
+}
+
+size_t IOT_AsyncTransport::OnTimeout()
+{
+    int running = 0;
+    curl_multi_socket_action(m_multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    return CompleteFinished();
+}
+
+int IOT_AsyncTransport::SocketCallback(CURL* /*handle*/, curl_socket_t fd, int what, void* userp, void* /*socketp*/)
+{
+    IOT_AsyncTransport* transport = static_cast<IOT_AsyncTransport*>(userp);
+    if(!transport->m_watch) {
+        return 0;
+    }
+
+    int events = 0;
+    if(what == CURL_POLL_IN || what == CURL_POLL_INOUT) {
+        events |= IO_IN;
+    }
+    if(what == CURL_POLL_OUT || what == CURL_POLL_INOUT) {
+        events |= IO_OUT;
+    }
+
+    transport->m_watch(fd, events);
+    return 0;
+}
+
+int IOT_AsyncTransport::TimerCallback(CURLM* /*multi*/, long timeoutMs, void* userp)
+{
+    IOT_AsyncTransport* transport = static_cast<IOT_AsyncTransport*>(userp);
+    if(transport->m_timer) {
+        transport->m_timer(timeoutMs);
+    }
+    return 0;
+}
+
+size_t IOT_AsyncTransport::GetPending() const
+{
+    return m_pending.load();
+}
+
+IOTAPI::IOTAPI_err IOT_AsyncTransport::SetHttpVersion(IOTAPI::IOT_HttpVersion version)
+{
+    if(m_multi == NULL) {
+        return IOTAPI::IOT_ERR_CURL_CALL;
+    }
+    if(m_used) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+
+    IOTAPI::IOTAPI_err ret = m_config.SetHttpVersion(version);
+    if(ret == IOTAPI::IOT_ERR_OK) {
+        curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, static_cast<long>(CURLPIPE_MULTIPLEX));
+    }
+    return ret;
+}
+
+IOTAPI::IOTAPI_err IOT_AsyncTransport::SetKeepAlive(const IOT_KeepAlive& policy)
+{
+    if(m_used) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+
+    m_config.SetKeepAlive(policy);
+    return IOTAPI::IOT_ERR_OK;
+}
+
+void IOT_AsyncTransport::SetMaxResponseSize(size_t size)
+{
+    m_config.SetMaxResponseSize(size);
+}
+
+void IOT_AsyncTransport::Submit(Request* request)
+{
+    m_used = true;
+    ++m_pending;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_submitted.push_back(request);
+    }
+
+    if(m_eventLoop) {
+        // Adding the handle sets the timer that lets the event loop start the request
+        StartSubmitted();
+    } else {
+        Wakeup();
+    }
+}
+
+void IOT_AsyncTransport::StartSubmitted()
+{
+    std::vector<Request*> submitted;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        submitted.swap(m_submitted);
+    }
+
+    for(size_t i = 0; i < submitted.size(); ++i) {
+        Request* request = submitted[i];
+        CURL* handle = TakeHandle();
+        if(handle == NULL) {
+            IOT_RequestTiming timing;
+            Callback done;
+            done.swap(request->done);
+            delete request;
+            --m_pending;
+            if(done) {
+                done(IOTAPI::IOT_ERR_CURL_CALL, std::string(), timing);
+            }
+            continue;
+        }
+
+        request->handle = handle;
+        m_config.CreateCurlCall(handle, request->url, request->post, request->user, request->pw);
+        if(request->post) {
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(request->payload.size()));
+            curl_easy_setopt(handle, CURLOPT_POSTFIELDS, request->payload.data());
+        } else {
+            // Clears POSTFIELDS left from an earlier request on the handle
+            curl_easy_setopt(handle, CURLOPT_HTTPGET, 1L);
+        }
+
+        request->read.data = &request->response;
+        request->read.maxSize = m_config.m_maxRequestSize;
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, IOT_RestClient::ReadServerResponse);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &request->read);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, request);
+
+        m_running.insert(request);
+        curl_multi_add_handle(m_multi, handle);
+    }
+}
+
+size_t IOT_AsyncTransport::CompleteFinished()
+{
+    size_t completed = 0;
+    int left = 0;
+    CURLMsg* msg = NULL;
+    while((msg = curl_multi_info_read(m_multi, &left)) != NULL) {
+        if(msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        CURL* handle = msg->easy_handle;
+        CURLcode code = msg->data.result;
+
+        char* priv = NULL;
+        curl_easy_getinfo(handle, CURLINFO_PRIVATE, &priv);
+        Request* request = reinterpret_cast<Request*>(priv);
+
+        long http_code = 0;
+        IOT_RequestTiming timing;
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &http_code);
+        m_config.FetchTiming(handle, http_code, &timing);
+        IOTAPI::IOTAPI_err ret = m_config.GetReturnCode(handle, http_code, code);
+
+        curl_multi_remove_handle(m_multi, handle);
+        m_idle.push_back(handle);
+        m_running.erase(request);
+        --m_pending;
+        ++completed;
+
+        // Callback may start new requests, request is freed even if it throws
+        std::unique_ptr<Request> owned(request);
+        if(owned->done) {
+            owned->done(ret, owned->response, timing);
+        }
+    }
+
+    return completed;
+}
+
+CURL* IOT_AsyncTransport::TakeHandle()
+{
+    if(!m_idle.empty()) {
+        CURL* handle = m_idle.back();
+        m_idle.pop_back();
+        return handle;
+    }
+
+    CURL* handle = curl_easy_init();
+    if(handle != NULL) {
+        m_config.InitHandle(handle);
+    }
+    return handle;
+}
@@ -0,0 +1,210 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_ASYNCTRANSPORT_H
+#define IOT_ASYNCTRANSPORT_H
+
+#include <curl/curl.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "IOT_defines.h"
+#include "IOT_RequestTiming.h"
+#include "IOT_RestClient.h"
+
+//! \brief Non-blocking HTTP transport on a libcurl multi handle
+//! \note Requests are started from any thread and run concurrently on the
+//!       thread that calls Poll(), which also calls their completion
+//!       callbacks. Thousands of requests can be in progress on one thread.
+//!       Requests use the same headers and options as IOT_RestClient.
+//!       Alternatively an application event loop can drive the transport,
+//!       see SetEventLoop().
+//!       The transport must not be destroyed while requests are pending,
+//!       their callbacks would not be called.
+class IOT_AsyncTransport
+{
+public:
+    //! Socket events of SetEventLoop() handlers and OnSocketEvent()
+    enum
+    {
+        IO_IN    = 1,
+        IO_OUT   = 2,
+        IO_ERROR = 4
+    };
+
+    //! \brief Change of events the event loop has to watch on a socket
+    //! \param [in] fd     - Socket
+    //! \param [in] events - IO_IN and/or IO_OUT, 0 to stop watching the socket
+    typedef std::function<void(curl_socket_t fd, int events)> SocketWatch;
+
+    //! \brief Change of the timer the event loop has to run
+    //! \param [in] timeoutMs - Call OnTimeout() after this, -1 to cancel the timer
+    typedef std::function<void(long timeoutMs)> TimerChange;
+
+    //! \brief Completion callback of a request
+    //! \param [in] ret      - IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    //! \param [in] response - Response returned by remote server
+    //! \param [in] timing   - Timing breakdown of the request
+    typedef std::function<void(IOTAPI::IOTAPI_err ret, const std::string& response,
+                               const IOT_RequestTiming& timing)> Callback;
+
+    //! \brief Constructor
+    //! \param [in] timeout_s      - Timeout of single request, 0 for libcurl defaults
+    //! \param [in] maxConnections - Max number of open connections, 0 for no limit.
+    //!                              Requests beyond the limit wait in libcurl.
+    explicit IOT_AsyncTransport(size_t timeout_s = 0, size_t maxConnections = 0);
+    ~IOT_AsyncTransport();
+
+    //! \brief Start a GET request
+    //! \param [in] url  - Target address
+    //! \param [in] user - Username for HTTP AUTH. Use empty string to disable AUTH
+    //! \param [in] pw   - Password for HTTP AUTH
+    //! \param [in] done - Called from Poll() when the request completes
+    void Get(const std::string& url, const std::string& user, const std::string& pw, Callback done);
+
+    //! \brief Start a POST request
+    //! \param [in] url  - Target address
+    //! \param [in] user - Username for HTTP AUTH. Use empty string to disable AUTH
+    //! \param [in] pw   - Password for HTTP AUTH
+    //! \param [in] data - POST payload which is sent to server
+    //! \param [in] done - Called from Poll() when the request completes
+    void Post(const std::string& url, const std::string& user, const std::string& pw, std::string data,
+              Callback done);
+
+    //! \brief Run the requests and call callbacks of the completed ones
+    //! \note Only one thread may poll at a time.
+    //! \param [in] timeoutMs - Max time to wait for activity if nothing completed right away
+    //! \return Number of completed requests
+    size_t Poll(int timeoutMs);
+
+    //! \brief Poll until no requests are pending
+    void Run();
+
+    //! \brief Make a thread waiting in Poll() return early
+    void Wakeup();
+
+    //! \brief Let an application event loop (epoll, libuv...) drive the transport
+    //! \note Replaces Poll() and Run(). The handlers tell which sockets and
+    //!       timeout to watch and the loop reports them back to OnSocketEvent()
+    //!       and OnTimeout(), which call callbacks of completed requests.
+    //!       Requests must be started on the loop thread, and the handlers
+    //!       are called from Get(), Post(), OnSocketEvent() and OnTimeout().
+    //!       Must be set before the first request.
+    //! \param [in] watch - Called when the events to watch on a socket change
+    //! \param [in] timer - Called when the timeout changes
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if requests have been made
+    IOTAPI::IOTAPI_err SetEventLoop(SocketWatch watch, TimerChange timer);
+
+    //! \brief Report events of a watched socket
+    //! \param [in] fd     - Socket
+    //! \param [in] events - IO_IN, IO_OUT and IO_ERROR flags that occurred
+    //! \return Number of completed requests
+    size_t OnSocketEvent(curl_socket_t fd, int events);
+
+    //! \brief Report that the timer set by the TimerChange handler has expired
+    //! \return Number of completed requests
+    size_t OnTimeout();
+
+    //! \brief Number of started requests that have not completed
+    size_t GetPending() const;
+
+    //! \brief Set HTTP version of requests
+    //! \note With HTTP/2 requests to a server are multiplexed on its first
+    //!       connection, up to the number of streams the server allows, so
+    //!       maxConnections can be small. Must be set before the first request.
+    //! \param [in] version - HTTP version
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if requests have been made,
+    //!         IOTAPI::IOT_ERR_PARAM if libcurl does not support the version
+    IOTAPI::IOTAPI_err SetHttpVersion(IOTAPI::IOT_HttpVersion version);
+
+    //! \brief Set how idle connections are kept usable between requests
+    //! \note Must be set before the first request.
+    //! \param [in] policy - Keepalive probes and max idle time
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if requests have been made
+    IOTAPI::IOTAPI_err SetKeepAlive(const IOT_KeepAlive& policy);
+
+    //! \brief Set maximum response size that is accepted from server
+    void SetMaxResponseSize(size_t size);
+
+private:
+    IOT_AsyncTransport(const IOT_AsyncTransport&);
+    IOT_AsyncTransport& operator=(const IOT_AsyncTransport&);
+
+    struct Request
+    {
+        std::string url;
+        std::string user;
+        std::string pw;
+        bool post;
+        std::string payload;
+        std::string response;
+        IOT_RestClient::ReadData read;
+        Callback done;
+        CURL* handle;
+    };
+
+    //! Queue a request to be started by the polling thread
+    void Submit(Request* request);
+
+    //! Add queued requests to the multi handle
+    void StartSubmitted();
+
+    //! Call callbacks of completed requests
+    size_t CompleteFinished();
+
+    //! Get an idle easy handle or create a new one
+    CURL* TakeHandle();
+
+    //! libcurl callback for changes of watched sockets
+    static int SocketCallback(CURL* handle, curl_socket_t fd, int what, void* userp, void* socketp);
+
+    //! libcurl callback for changes of the timeout
+    static int TimerCallback(CURLM* multi, long timeoutMs, void* userp);
+
+    CURLM* m_multi;
+
+    //! Provides options, callbacks and error mapping shared with blocking requests
+    IOT_RestClient m_config;
+
+    //! Requests started from other threads, waiting for Poll()
+    std::mutex m_lock;
+    std::vector<Request*> m_submitted;
+
+    //! Requests added to the multi handle
+    std::unordered_set<Request*> m_running;
+
+    //! Easy handles kept for reuse
+    std::vector<CURL*> m_idle;
+
+    std::atomic<size_t> m_pending;
+
+    //! Handlers of SetEventLoop(), empty when Poll() is used
+    SocketWatch m_watch;
+    TimerChange m_timer;
+    bool m_eventLoop;
+    std::atomic<bool> m_used;
+};
+
+#endif // IOT_ASYNCTRANSPORT_H
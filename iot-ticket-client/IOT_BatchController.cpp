@@ -0,0 +1,213 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_BatchController.h"
+
+//! Weight of the newest observation in the moving averages
+static const double EWMA_ALPHA = 0.2;
+
+//! Batch is grown only if latency is below this fraction of the target
+static const double INCREASE_HEADROOM = 0.8;
+
+//! Factor applied to the batch size on decrease
+static const double DECREASE_FACTOR = 0.5;
+
+//! Error rate above which the flush interval backs off to its maximum
+static const double ERROR_BACKOFF_RATE = 0.5;
+
+static const uint32_t DEFAULT_LATENCY_TARGET_MS = 1000;
+static const size_t   DEFAULT_MIN_BATCH         = 1;
+static const size_t   DEFAULT_MAX_BATCH         = 5000;
+static const size_t   DEFAULT_START_BATCH       = 100;
+static const uint32_t DEFAULT_MIN_FLUSH_MS      = 50;
+static const uint32_t DEFAULT_MAX_FLUSH_MS      = 10000;
+static const size_t   DEFAULT_INCREASE_STEP     = 10;
+static const size_t   DEFAULT_MAX_PAYLOAD_BYTES = 512 * 1024;
+
+IOT_BatchController::IOT_BatchController():
+    m_latencyTargetMs(DEFAULT_LATENCY_TARGET_MS),
+    m_minBatch(DEFAULT_MIN_BATCH), m_maxBatch(DEFAULT_MAX_BATCH),
+    m_minFlushMs(DEFAULT_MIN_FLUSH_MS), m_maxFlushMs(DEFAULT_MAX_FLUSH_MS),
+    m_increaseStep(DEFAULT_INCREASE_STEP), m_maxPayloadBytes(DEFAULT_MAX_PAYLOAD_BYTES),
+    m_observed(false)
+{
+    m_state.batchSize = DEFAULT_START_BATCH;
+    m_state.flushIntervalMs = DEFAULT_LATENCY_TARGET_MS / 2;
+    m_state.avgLatencyMs = 0.0;
+    m_state.avgBytesPerSample = 0.0;
+    m_state.errorRate = 0.0;
+    m_state.increases = 0;
+    m_state.decreases = 0;
+    m_state.lastDecision = DECISION_NONE;
+}
+
+bool IOT_BatchController::SetLatencyTarget(uint32_t targetMs)
+{
+    if(targetMs == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_latencyTargetMs = targetMs;
+    UpdateFlushInterval();
+    return true;
+}
+
+bool IOT_BatchController::SetBatchLimits(size_t minSamples, size_t maxSamples)
+{
+    if(minSamples == 0 || minSamples > maxSamples) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_minBatch = minSamples;
+    m_maxBatch = maxSamples;
+
+    if(m_state.batchSize < m_minBatch) {
+        m_state.batchSize = m_minBatch;
+    }
+    if(m_state.batchSize > m_maxBatch) {
+        m_state.batchSize = m_maxBatch;
+    }
+    return true;
+}
+
+bool IOT_BatchController::SetFlushIntervalLimits(uint32_t minMs, uint32_t maxMs)
+{
+    if(minMs > maxMs) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_minFlushMs = minMs;
+    m_maxFlushMs = maxMs;
+    UpdateFlushInterval();
+    return true;
+}
+
+void IOT_BatchController::SetIncreaseStep(size_t samples)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_increaseStep = (samples > 0) ? samples : 1;
+}
+
+void IOT_BatchController::SetMaxPayloadBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_maxPayloadBytes = bytes;
+}
+
+void IOT_BatchController::OnRequestComplete(size_t samples, size_t bytes, double latencyMs, bool success)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    double alpha = m_observed ? EWMA_ALPHA : 1.0;
+    m_state.errorRate += alpha * ((success ? 0.0 : 1.0) - m_state.errorRate);
+
+    if(success) {
+        m_state.avgLatencyMs += alpha * (latencyMs - m_state.avgLatencyMs);
+        if(samples > 0) {
+            double perSample = static_cast<double>(bytes) / static_cast<double>(samples);
+            m_state.avgBytesPerSample += alpha * (perSample - m_state.avgBytesPerSample);
+        }
+        m_observed = true;
+    }
+
+    size_t batch = m_state.batchSize;
+
+    if(!success) {
+        batch = static_cast<size_t>(batch * DECREASE_FACTOR);
+        m_state.lastDecision = DECISION_DECREASE_ERROR;
+    }
+    else if(latencyMs > m_latencyTargetMs) {
+        batch = static_cast<size_t>(batch * DECREASE_FACTOR);
+        m_state.lastDecision = DECISION_DECREASE_LATENCY;
+    }
+    else if(samples >= batch && latencyMs < m_latencyTargetMs * INCREASE_HEADROOM) {
+        // Only full batches tell that the link could take more
+        batch += m_increaseStep;
+        m_state.lastDecision = DECISION_INCREASE;
+    }
+    else {
+        m_state.lastDecision = DECISION_HOLD;
+    }
+
+    if(m_maxPayloadBytes > 0 && m_state.avgBytesPerSample > 0.0) {
+        size_t payloadCap = static_cast<size_t>(m_maxPayloadBytes / m_state.avgBytesPerSample);
+        if(batch > payloadCap) {
+            batch = payloadCap;
+            m_state.lastDecision = DECISION_PAYLOAD_CAP;
+        }
+    }
+
+    if(batch < m_minBatch) {
+        batch = m_minBatch;
+    }
+    if(batch > m_maxBatch) {
+        batch = m_maxBatch;
+    }
+
+    if(batch > m_state.batchSize) {
+        m_state.increases++;
+    } else if(batch < m_state.batchSize) {
+        m_state.decreases++;
+    }
+
+    m_state.batchSize = batch;
+    UpdateFlushInterval();
+}
+
+size_t IOT_BatchController::GetBatchSize() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_state.batchSize;
+}
+
+uint32_t IOT_BatchController::GetFlushIntervalMs() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_state.flushIntervalMs;
+}
+
+IOT_BatchController::State IOT_BatchController::GetState() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_state;
+}
+
+void IOT_BatchController::UpdateFlushInterval()
+{
+    double interval = m_latencyTargetMs - m_state.avgLatencyMs;
+
+    if(m_state.errorRate > ERROR_BACKOFF_RATE) {
+        interval = m_maxFlushMs;
+    }
+
+    if(interval < m_minFlushMs) {
+        interval = m_minFlushMs;
+    }
+    if(interval > m_maxFlushMs) {
+        interval = m_maxFlushMs;
+    }
+
+    m_state.flushIntervalMs = static_cast<uint32_t>(interval);
+}
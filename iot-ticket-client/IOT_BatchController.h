@@ -0,0 +1,121 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_BATCHCONTROLLER_H
+#define IOT_BATCHCONTROLLER_H
+
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+//! \brief Adaptive (AIMD) controller for upload batch size and flush interval
+//! \note Batch size grows additively while full batches complete within the
+//!       latency target and is cut multiplicatively when a request fails or
+//!       exceeds the target. The batch is also capped so that the estimated
+//!       payload stays below the configured maximum. Flush interval is the part
+//!       of the latency target not consumed by the request itself, so that queueing
+//!       plus sending stays within the target.
+class IOT_BatchController
+{
+public:
+    //! Reason for the latest batch size decision
+    typedef enum
+    {
+        DECISION_NONE,            //! No requests observed yet
+        DECISION_HOLD,            //! Batch size kept
+        DECISION_INCREASE,        //! Batch size increased additively
+        DECISION_DECREASE_LATENCY,//! Batch size decreased, latency above target
+        DECISION_DECREASE_ERROR,  //! Batch size decreased, request failed
+        DECISION_PAYLOAD_CAP      //! Batch size limited by maximum payload size
+    } Decision;
+
+    //! Snapshot of the controller state for introspection
+    struct State
+    {
+        size_t batchSize;
+        uint32_t flushIntervalMs;
+        double avgLatencyMs;
+        double avgBytesPerSample;
+        double errorRate;
+        uint64_t increases;
+        uint64_t decreases;
+        Decision lastDecision;
+    };
+
+    IOT_BatchController();
+
+    //! \brief Set the request latency target
+    //! \param [in] targetMs - Target for queueing + request latency in milliseconds
+    //! \return false if the target is zero
+    bool SetLatencyTarget(uint32_t targetMs);
+
+    //! \brief Set limits for the batch size
+    //! \param [in] minSamples - Smallest batch size the controller may choose (>= 1)
+    //! \param [in] maxSamples - Largest batch size the controller may choose
+    //! \return false if the limits are invalid
+    bool SetBatchLimits(size_t minSamples, size_t maxSamples);
+
+    //! \brief Set limits for the flush interval
+    //! \return false if the limits are invalid
+    bool SetFlushIntervalLimits(uint32_t minMs, uint32_t maxMs);
+
+    //! \brief Set the number of samples added to the batch size on increase
+    void SetIncreaseStep(size_t samples);
+
+    //! \brief Set upper limit for the payload size of one request
+    void SetMaxPayloadBytes(size_t bytes);
+
+    //! \brief Feed result of a completed upload request to the controller
+    //! \param [in] samples   - Number of samples sent in the request
+    //! \param [in] bytes     - Payload size of the request
+    //! \param [in] latencyMs - Duration of the request
+    //! \param [in] success   - false if the request failed
+    void OnRequestComplete(size_t samples, size_t bytes, double latencyMs, bool success);
+
+    //! \brief Current number of samples to send in one request
+    size_t GetBatchSize() const;
+
+    //! \brief Current max time to wait for a batch to fill up
+    uint32_t GetFlushIntervalMs() const;
+
+    //! \brief Current state of the controller and its latest decision
+    State GetState() const;
+
+private:
+    //! Recalculate the flush interval from the latency estimate
+    void UpdateFlushInterval();
+
+    mutable std::mutex m_lock;
+
+    uint32_t m_latencyTargetMs;
+    size_t m_minBatch;
+    size_t m_maxBatch;
+    uint32_t m_minFlushMs;
+    uint32_t m_maxFlushMs;
+    size_t m_increaseStep;
+    size_t m_maxPayloadBytes;
+
+    State m_state;
+    bool m_observed;
+};
+
+#endif // IOT_BATCHCONTROLLER_H
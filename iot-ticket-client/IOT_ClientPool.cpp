@@ -0,0 +1,220 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_ClientPool.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//! Slot the thread leased last, where it starts looking for a free one
+static thread_local size_t t_lastSlot = static_cast<size_t>(-1);
+
+IOT_ClientPool::IOT_ClientPool(size_t size, size_t timeout_s):
+    m_size(size), m_timeout_s(timeout_s), m_httpVersion(IOTAPI::IOT_HTTP_DEFAULT), m_slots(NULL), m_created(0), m_overflows(0), m_extra(0)
+{
+    if(m_size == 0) {
+        m_size = std::thread::hardware_concurrency();
+        if(m_size == 0) {
+            m_size = 1;
+        }
+    }
+
+    m_slots = new Slot[m_size];
+}
+
+IOT_ClientPool::~IOT_ClientPool()
+{
+    for(size_t i = 0; i < m_size; ++i) {
+        delete m_slots[i].client;
+    }
+    delete[] m_slots;
+
+    for(size_t i = 0; i < m_spare.size(); ++i) {
+        delete m_spare[i];
+    }
+}
+
+IOTAPI::IOTAPI_err IOT_ClientPool::SetHttpVersion(IOTAPI::IOT_HttpVersion version)
+{
+    if(m_created.load(std::memory_order_relaxed) > 0 || m_overflows.load(std::memory_order_relaxed) > 0) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+    if(!IOT_RestClient::IsHttpVersionSupported(version)) {
+        return IOTAPI::IOT_ERR_PARAM;
+    }
+
+    m_httpVersion = version;
+    return IOTAPI::IOT_ERR_OK;
+}
+
+IOTAPI::IOTAPI_err IOT_ClientPool::SetKeepAlive(const IOT_KeepAlive& policy)
+{
+    if(m_created.load(std::memory_order_relaxed) > 0 || m_overflows.load(std::memory_order_relaxed) > 0) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+
+    m_keepAlive = policy;
+    return IOTAPI::IOT_ERR_OK;
+}
+
+IOTAPI::IOTAPI_err IOT_ClientPool::SetSessionFile(const std::string& path)
+{
+    if(m_created.load(std::memory_order_relaxed) > 0 || m_overflows.load(std::memory_order_relaxed) > 0) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+    if(!IOT_RestClient::IsSessionFileSupported() || path.empty()) {
+        return IOTAPI::IOT_ERR_PARAM;
+    }
+
+    m_sessionFile = path;
+    return IOTAPI::IOT_ERR_OK;
+}
+
+IOTAPI::IOTAPI_err IOT_ClientPool::Warmup(const std::string& url, size_t count)
+{
+    // Leases are held together so that each gets a slot of its own
+    std::vector<std::unique_ptr<Lease> > leases;
+    IOTAPI::IOTAPI_err ret = IOTAPI::IOT_ERR_OK;
+    for(size_t i = 0; i < std::min(count, m_size); ++i) {
+        leases.push_back(std::unique_ptr<Lease>(new Lease(*this)));
+        IOTAPI::IOTAPI_err err = (*leases.back())->Warmup(url);
+        if(ret == IOTAPI::IOT_ERR_OK) {
+            ret = err;
+        }
+    }
+    return ret;
+}
+
+size_t IOT_ClientPool::GetSize() const
+{
+    return m_size;
+}
+
+size_t IOT_ClientPool::GetCreated() const
+{
+    return m_created.load(std::memory_order_relaxed);
+}
+
+uint64_t IOT_ClientPool::GetOverflows() const
+{
+    return m_overflows.load(std::memory_order_relaxed);
+}
+
+size_t IOT_ClientPool::GetExtra() const
+{
+    return m_extra.load(std::memory_order_relaxed);
+}
+
+IOT_RestClient* IOT_ClientPool::Acquire(size_t& slot)
+{
+    size_t start = t_lastSlot;
+    if(start >= m_size) {
+        // Spread threads over the slots on their first lease
+        start = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_size;
+    }
+
+    for(size_t i = 0; i < m_size; ++i)
+    {
+        size_t index = (start + i) % m_size;
+        Slot& candidate = m_slots[index];
+        if(candidate.busy.load(std::memory_order_relaxed) ||
+           candidate.busy.exchange(true, std::memory_order_acquire)) {
+            continue;
+        }
+
+        if(candidate.client == NULL) {
+            candidate.client = CreateClient();
+            m_created.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        t_lastSlot = index;
+        slot = index;
+        return candidate.client;
+    }
+
+    m_overflows.fetch_add(1, std::memory_order_relaxed);
+    slot = m_size;
+
+    {
+        std::lock_guard<std::mutex> lock(m_spareLock);
+        if(!m_spare.empty()) {
+            IOT_RestClient* client = m_spare.back();
+            m_spare.pop_back();
+            return client;
+        }
+    }
+
+    m_extra.fetch_add(1, std::memory_order_relaxed);
+    return CreateClient();
+}
+
+void IOT_ClientPool::Release(IOT_RestClient* client, size_t slot)
+{
+    if(slot >= m_size) {
+        std::lock_guard<std::mutex> lock(m_spareLock);
+        m_spare.push_back(client);
+        return;
+    }
+
+    m_slots[slot].busy.store(false, std::memory_order_release);
+}
+
+IOT_RestClient* IOT_ClientPool::CreateClient() const
+{
+    IOT_RestClient* client = new IOT_RestClient();
+    Configure(*client);
+    return client;
+}
+
+void IOT_ClientPool::Configure(IOT_RestClient& client) const
+{
+    client.SetRequestTimeout(m_timeout_s);
+    client.SetHttpVersion(m_httpVersion);
+    client.SetKeepAlive(m_keepAlive);
+    if(!m_sessionFile.empty()) {
+        client.SetSessionFile(m_sessionFile);
+    }
+}
+
+
+IOT_ClientPool::Lease::Lease(IOT_ClientPool& pool):
+    m_pool(pool), m_client(NULL), m_slot(0)
+{
+    m_client = m_pool.Acquire(m_slot);
+}
+
+IOT_ClientPool::Lease::~Lease()
+{
+    m_pool.Release(m_client, m_slot);
+}
+
+IOT_RestClient& IOT_ClientPool::Lease::operator*() const
+{
+    return *m_client;
+}
+
+IOT_RestClient* IOT_ClientPool::Lease::operator->() const
+{
+    return m_client;
+}
@@ -0,0 +1,151 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_CLIENTPOOL_H
+#define IOT_CLIENTPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include "IOT_RestClient.h"
+
+//! \brief Pool of HTTP clients shared by threads
+//! \note A thread leases a client for the duration of a request. Leasing is
+//!       lock free: each slot has a busy flag that is claimed with an atomic
+//!       exchange, starting from the slot the thread used last so that it
+//!       tends to get the same connection again. Clients are created on first
+//!       use. If every slot is busy, the pool grows: an extra client is taken
+//!       from a spare list under a lock, or created, and put back to the list
+//!       afterwards, so an overloaded process keeps its connections instead of
+//!       paying a new one per request.
+class IOT_ClientPool
+{
+public:
+    //! \brief Constructor
+    //! \param [in] size      - Number of pooled clients, 0 for the number of CPU threads
+    //! \param [in] timeout_s - Timeout of single request, 0 for libcurl defaults
+    explicit IOT_ClientPool(size_t size = 0, size_t timeout_s = 0);
+    ~IOT_ClientPool();
+
+    //! \brief Client leased from the pool, returned when the lease is destroyed
+    class Lease
+    {
+    public:
+        explicit Lease(IOT_ClientPool& pool);
+        ~Lease();
+
+        IOT_RestClient& operator*() const;
+        IOT_RestClient* operator->() const;
+
+    private:
+        Lease(const Lease&);
+        Lease& operator=(const Lease&);
+
+        IOT_ClientPool& m_pool;
+        IOT_RestClient* m_client;
+        size_t m_slot;
+    };
+
+    //! \brief Set HTTP version of the clients
+    //! \note Must be set before the first lease.
+    //! \param [in] version - HTTP version
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if clients have been created,
+    //!         IOTAPI::IOT_ERR_PARAM if libcurl does not support the version
+    IOTAPI::IOTAPI_err SetHttpVersion(IOTAPI::IOT_HttpVersion version);
+
+    //! \brief Set keepalive policy of the clients
+    //! \note Must be set before the first lease.
+    //! \param [in] policy - Keepalive probes and max idle time
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if clients have been created
+    IOTAPI::IOTAPI_err SetKeepAlive(const IOT_KeepAlive& policy);
+
+    //! \brief Keep TLS sessions of the clients in a file, see IOT_RestClient::SetSessionFile()
+    //! \note Must be set before the first lease.
+    //! \param [in] path - Session file
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if clients have been created,
+    //!         IOTAPI::IOT_ERR_PARAM if libcurl cannot export sessions
+    IOTAPI::IOTAPI_err SetSessionFile(const std::string& path);
+
+    //! \brief Create clients and connect them to a server
+    //! \param [in] url   - Server address
+    //! \param [in] count - Number of clients to connect, at most the pool size
+    //! \return IOTAPI::IOT_ERR_OK if all connected, error of the first failure otherwise
+    IOTAPI::IOTAPI_err Warmup(const std::string& url, size_t count);
+
+    //! \brief Apply timeout, HTTP version, keepalive policy and session file of the pool to a client
+    //! \param [in,out] client - Client not taken from the pool
+    void Configure(IOT_RestClient& client) const;
+
+    //! \brief Number of pooled clients
+    size_t GetSize() const;
+
+    //! \brief Number of pooled clients created so far
+    size_t GetCreated() const;
+
+    //! \brief Number of leases that got an extra client because all slots were busy
+    uint64_t GetOverflows() const;
+
+    //! \brief Number of extra clients created beyond the pool size
+    size_t GetExtra() const;
+
+private:
+    IOT_ClientPool(const IOT_ClientPool&);
+    IOT_ClientPool& operator=(const IOT_ClientPool&);
+
+    struct Slot
+    {
+        Slot(): busy(false), client(NULL) {}
+
+        std::atomic<bool> busy;
+
+        //! Only accessed by the thread holding the slot
+        IOT_RestClient* client;
+    };
+
+    //! Lease a client, slot is set to GetSize() for an extra client
+    IOT_RestClient* Acquire(size_t& slot);
+
+    //! Return a client leased with Acquire()
+    void Release(IOT_RestClient* client, size_t slot);
+
+    //! Create and configure a new client
+    IOT_RestClient* CreateClient() const;
+
+    size_t m_size;
+    size_t m_timeout_s;
+    IOTAPI::IOT_HttpVersion m_httpVersion;
+    IOT_KeepAlive m_keepAlive;
+    std::string m_sessionFile;
+    Slot* m_slots;
+    std::atomic<size_t> m_created;
+    std::atomic<uint64_t> m_overflows;
+
+    //! Protects m_spare
+    std::mutex m_spareLock;
+
+    //! Extra clients not leased at the moment
+    std::vector<IOT_RestClient*> m_spare;
+    std::atomic<size_t> m_extra;
+};
+
+#endif // IOT_CLIENTPOOL_H
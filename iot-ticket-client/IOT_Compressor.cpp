@@ -0,0 +1,268 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_Compressor.h"
+#include <limits>
+#include <math.h>
+
+IOT_Compressor::Config::Config() :
+    method(COMPRESS_NONE),
+    deviation(0.0),
+    percent(0.0),
+    maxGapMs(0)
+{
+}
+
+double IOT_Compressor::Stats::GetRatio() const
+{
+    return (passed == 0) ? 0.0 : static_cast<double>(received) / passed;
+}
+
+IOT_Compressor::Channel::Channel() :
+    hasPassed(false),
+    passedTimeMs(0),
+    passedValue(0.0),
+    hasHeld(false),
+    heldValue(0.0),
+    minSlope(-std::numeric_limits<double>::infinity()),
+    maxSlope(std::numeric_limits<double>::infinity())
+{
+    stats.received = 0;
+    stats.passed = 0;
+    stats.errorBound = 0.0;
+}
+
+IOT_Compressor::IOT_Compressor()
+{
+}
+
+bool IOT_Compressor::SetDefaultConfig(const Config& config)
+{
+    if(!IsValid(config)) {
+        return false;
+    }
+
+    m_default = config;
+    return true;
+}
+
+bool IOT_Compressor::SetConfig(const std::string& path, const std::string& name, const Config& config)
+{
+    if(!IsValid(config)) {
+        return false;
+    }
+
+    std::string key = Key(path, name);
+    m_configs[key] = config;
+
+    std::map<std::string, Channel>::iterator it = m_channels.find(key);
+    if(it != m_channels.end()) {
+        it->second.config = config;
+    }
+    return true;
+}
+
+size_t IOT_Compressor::Process(const IOT_WriteData& sample, std::vector<IOT_WriteData>& out)
+{
+    Channel& ch = GetChannel(sample);
+    ch.stats.received++;
+
+    size_t count = 0;
+    double value = 0.0;
+    bool numeric = sample.GetNumericValue(value);
+
+    // Method changed or non-numeric sample: end the open segment first
+    if(ch.hasHeld && (!numeric || ch.config.method != COMPRESS_SWINGING_DOOR)) {
+        Pass(ch, ch.held, ch.heldValue, out);
+        ch.hasHeld = false;
+        ++count;
+    }
+
+    if(!numeric || ch.config.method == COMPRESS_NONE) {
+        Pass(ch, sample, value, out);
+        ch.hasPassed = numeric;
+        return count + 1;
+    }
+
+    if(ch.config.method == COMPRESS_DEADBAND) {
+        return count + Deadband(ch, sample, value, out);
+    }
+    return count + SwingingDoor(ch, sample, value, out);
+}
+
+size_t IOT_Compressor::Flush(std::vector<IOT_WriteData>& out)
+{
+    size_t count = 0;
+    for(std::map<std::string, Channel>::iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    {
+        Channel& ch = it->second;
+        if(ch.hasHeld) {
+            Pass(ch, ch.held, ch.heldValue, out);
+            ch.hasHeld = false;
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool IOT_Compressor::GetStats(const std::string& path, const std::string& name, Stats& stats) const
+{
+    std::map<std::string, Channel>::const_iterator it = m_channels.find(Key(path, name));
+    if(it == m_channels.end()) {
+        return false;
+    }
+
+    stats = it->second.stats;
+    return true;
+}
+
+void IOT_Compressor::GetTotalStats(Stats& stats) const
+{
+    stats.received = 0;
+    stats.passed = 0;
+    stats.errorBound = 0.0;
+
+    for(std::map<std::string, Channel>::const_iterator it = m_channels.begin(); it != m_channels.end(); ++it)
+    {
+        stats.received += it->second.stats.received;
+        stats.passed += it->second.stats.passed;
+        if(it->second.stats.errorBound > stats.errorBound) {
+            stats.errorBound = it->second.stats.errorBound;
+        }
+    }
+}
+
+bool IOT_Compressor::IsValid(const Config& config)
+{
+    return config.deviation >= 0.0 && config.percent >= 0.0 &&
+           (config.method != COMPRESS_SWINGING_DOOR || config.percent == 0.0);
+}
+
+std::string IOT_Compressor::Key(const std::string& path, const std::string& name)
+{
+    return path + "/" + name;
+}
+
+IOT_Compressor::Channel& IOT_Compressor::GetChannel(const IOT_WriteData& sample)
+{
+    std::string key = Key(sample.GetPath(), sample.GetName());
+
+    std::map<std::string, Channel>::iterator it = m_channels.find(key);
+    if(it != m_channels.end()) {
+        return it->second;
+    }
+
+    Channel& ch = m_channels[key];
+    std::map<std::string, Config>::const_iterator config = m_configs.find(key);
+    ch.config = (config != m_configs.end()) ? config->second : m_default;
+    return ch;
+}
+
+void IOT_Compressor::Pass(Channel& ch, const IOT_WriteData& sample, double value, std::vector<IOT_WriteData>& out)
+{
+    out.push_back(sample);
+    ch.stats.passed++;
+
+    ch.hasPassed = true;
+    ch.passedTimeMs = sample.GetTimeMs();
+    ch.passedValue = value;
+    ch.minSlope = -std::numeric_limits<double>::infinity();
+    ch.maxSlope = std::numeric_limits<double>::infinity();
+}
+
+size_t IOT_Compressor::Deadband(Channel& ch, const IOT_WriteData& sample, double value, std::vector<IOT_WriteData>& out)
+{
+    double band = ch.config.percent / 100.0 * fabs(ch.passedValue);
+    if(ch.config.deviation > band) {
+        band = ch.config.deviation;
+    }
+
+    bool gap = ch.config.maxGapMs != 0 && sample.GetTimeMs() - ch.passedTimeMs >= ch.config.maxGapMs;
+    if(!ch.hasPassed || gap || fabs(value - ch.passedValue) > band) {
+        Pass(ch, sample, value, out);
+        return 1;
+    }
+
+    if(band > ch.stats.errorBound) {
+        ch.stats.errorBound = band;
+    }
+    return 0;
+}
+
+size_t IOT_Compressor::SwingingDoor(Channel& ch, const IOT_WriteData& sample, double value, std::vector<IOT_WriteData>& out)
+{
+    const uint64_t timeMs = sample.GetTimeMs();
+    const uint64_t lastMs = ch.hasHeld ? ch.held.GetTimeMs() : ch.passedTimeMs;
+    size_t count = 0;
+
+    // Nothing to interpolate from, or timestamps not increasing: start a new segment
+    if(!ch.hasPassed || timeMs <= lastMs) {
+        if(ch.hasHeld) {
+            Pass(ch, ch.held, ch.heldValue, out);
+            ch.hasHeld = false;
+            ++count;
+        }
+        Pass(ch, sample, value, out);
+        return count + 1;
+    }
+
+    if(ch.config.maxGapMs != 0 && timeMs - ch.passedTimeMs > ch.config.maxGapMs) {
+        if(ch.hasHeld) {
+            Pass(ch, ch.held, ch.heldValue, out);
+            ch.hasHeld = false;
+            ++count;
+        }
+        if(timeMs - ch.passedTimeMs > ch.config.maxGapMs) {
+            Pass(ch, sample, value, out);
+            return count + 1;
+        }
+    }
+
+    // The sample can end the segment if the line to it stays within the
+    // deviation of every sample after the previously passed one. Otherwise
+    // the door closes and the held sample ends the segment instead; it was
+    // checked to be a valid end point when it arrived.
+    double dt = static_cast<double>(timeMs - ch.passedTimeMs);
+    double slope = (value - ch.passedValue) / dt;
+    if(slope < ch.minSlope || slope > ch.maxSlope) {
+        Pass(ch, ch.held, ch.heldValue, out);
+        ch.hasHeld = false;
+        ++count;
+    } else if(ch.hasHeld && ch.config.deviation > ch.stats.errorBound) {
+        ch.stats.errorBound = ch.config.deviation;
+    }
+
+    dt = static_cast<double>(timeMs - ch.passedTimeMs);
+    double low = (value - ch.config.deviation - ch.passedValue) / dt;
+    double high = (value + ch.config.deviation - ch.passedValue) / dt;
+    if(low > ch.minSlope) {
+        ch.minSlope = low;
+    }
+    if(high < ch.maxSlope) {
+        ch.maxSlope = high;
+    }
+
+    ch.held = sample;
+    ch.heldValue = value;
+    ch.hasHeld = true;
+    return count;
+}
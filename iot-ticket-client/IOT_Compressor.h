@@ -0,0 +1,155 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_COMPRESSOR_H
+#define IOT_COMPRESSOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "IOT_WriteData.h"
+
+//! \brief Per-datanode compression of numeric samples before upload
+//! \note Deadband passes a sample when it differs from the previously passed
+//!       sample by more than the deadband, so holding the previous passed value
+//!       reconstructs every dropped sample within the deadband.
+//!       Swinging door passes the end points of linear segments, so linear
+//!       interpolation between passed samples reconstructs every dropped sample
+//!       within the deviation. The end point of a segment is known only when the
+//!       next sample arrives, so swinging door holds back one sample until
+//!       Flush().
+//!       Samples without a numeric value and samples of unconfigured datanodes
+//!       are passed as is. The class is not thread safe.
+class IOT_Compressor
+{
+public:
+    //! Compression method of a datanode
+    typedef enum
+    {
+        COMPRESS_NONE,          //! All samples are passed
+        COMPRESS_DEADBAND,      //! Absolute and/or percent deadband
+        COMPRESS_SWINGING_DOOR  //! Swinging door trending
+    } Method;
+
+    //! Compression settings of a datanode
+    struct Config
+    {
+        Config();
+
+        Method method;
+
+        //! Allowed absolute reconstruction error
+        double deviation;
+
+        //! Allowed reconstruction error in percent of the previously passed
+        //! value, deadband only. The larger of the two limits is used.
+        double percent;
+
+        //! Max time between passed samples in milliseconds, 0 for no limit
+        uint64_t maxGapMs;
+    };
+
+    //! Compression statistics of a datanode
+    struct Stats
+    {
+        uint64_t received;
+        uint64_t passed;
+
+        //! Largest reconstruction error allowed for a dropped sample
+        double errorBound;
+
+        //! Number of received samples per passed sample
+        double GetRatio() const;
+    };
+
+    IOT_Compressor();
+
+    //! \brief Set compression for samples without datanode specific settings
+    //! \return false if the settings are invalid
+    bool SetDefaultConfig(const Config& config);
+
+    //! \brief Set compression of a single datanode
+    //! \param [in] path   - Path of the datanode
+    //! \param [in] name   - Name of the datanode
+    //! \param [in] config - Compression settings
+    //! \return false if the settings are invalid
+    bool SetConfig(const std::string& path, const std::string& name, const Config& config);
+
+    //! \brief Compress a sample
+    //! \param [in]  sample - New sample, timestamps of a datanode must increase
+    //! \param [out] out    - Samples to upload are appended here
+    //! \return Number of samples appended
+    size_t Process(const IOT_WriteData& sample, std::vector<IOT_WriteData>& out);
+
+    //! \brief Pass samples held back by swinging door
+    //! \param [out] out - Samples to upload are appended here
+    //! \return Number of samples appended
+    size_t Flush(std::vector<IOT_WriteData>& out);
+
+    //! \brief Get compression statistics of a datanode
+    //! \return false if no samples of the datanode have been processed
+    bool GetStats(const std::string& path, const std::string& name, Stats& stats) const;
+
+    //! \brief Get compression statistics of all datanodes combined
+    void GetTotalStats(Stats& stats) const;
+
+private:
+    //! State of a single datanode
+    struct Channel
+    {
+        Channel();
+
+        Config config;
+        Stats stats;
+
+        //! Latest passed sample
+        bool hasPassed;
+        uint64_t passedTimeMs;
+        double passedValue;
+
+        //! Latest received sample, held back by swinging door
+        bool hasHeld;
+        IOT_WriteData held;
+        double heldValue;
+
+        //! Slope limits of the swinging door, set by the samples after the
+        //! passed one
+        double minSlope;
+        double maxSlope;
+    };
+
+    static bool IsValid(const Config& config);
+    static std::string Key(const std::string& path, const std::string& name);
+
+    Channel& GetChannel(const IOT_WriteData& sample);
+
+    void Pass(Channel& ch, const IOT_WriteData& sample, double value, std::vector<IOT_WriteData>& out);
+    size_t Deadband(Channel& ch, const IOT_WriteData& sample, double value, std::vector<IOT_WriteData>& out);
+    size_t SwingingDoor(Channel& ch, const IOT_WriteData& sample, double value, std::vector<IOT_WriteData>& out);
+
+    Config m_default;
+    std::map<std::string, Config> m_configs;
+    std::map<std::string, Channel> m_channels;
+};
+
+#endif // IOT_COMPRESSOR_H
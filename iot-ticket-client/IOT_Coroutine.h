@@ -0,0 +1,160 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_COROUTINE_H
+#define IOT_COROUTINE_H
+
+#include "IOT_API.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && defined(__has_include)
+#if __has_include(<coroutine>)
+#define IOT_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef IOT_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+
+//! \brief Awaitable asynchronous IOT_API operation
+//! \note co_await starts the operation and yields IOTAPI::IOTAPI_err of it.
+//!       The coroutine is resumed on the thread that polls the transport, or
+//!       not suspended at all if the operation completes right away.
+class IOT_Awaitable
+{
+public:
+    //! Starts the operation with the completion that resumes the coroutine
+    typedef std::function<void(IOT_API::Completion done)> Start;
+
+    explicit IOT_Awaitable(Start start):
+        m_start(std::move(start)), m_ret(IOTAPI::IOT_ERR_GENERAL), m_state(STARTING)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        m_handle = handle;
+        m_start([this](IOTAPI::IOTAPI_err ret) {
+            m_ret = ret;
+            if(m_state.exchange(DONE) == SUSPENDED) {
+                m_handle.resume();
+            }
+        });
+
+        // Completion may already have run, then the coroutine continues without suspending
+        int expected = STARTING;
+        return m_state.compare_exchange_strong(expected, SUSPENDED);
+    }
+
+    IOTAPI::IOTAPI_err await_resume() const noexcept
+    {
+        return m_ret;
+    }
+
+private:
+    enum { STARTING, SUSPENDED, DONE };
+
+    Start m_start;
+    IOTAPI::IOTAPI_err m_ret;
+    std::atomic<int> m_state;
+    std::coroutine_handle<> m_handle;
+};
+
+//! \brief Awaitable versions of IOT_API operations
+//! \note Arguments are passed by reference and must stay valid until the
+//!       co_await completes, e.g. locals of the awaiting coroutine.
+class IOT_Await
+{
+public:
+    static IOT_Awaitable GetDevices(const IOT_API& api, IOT_AsyncTransport& transport,
+                                    std::vector<IOT_GetDevice>& devices)
+    {
+        return IOT_Awaitable([&api, &transport, &devices](IOT_API::Completion done) {
+            api.GetDevicesAsync(transport, devices, done);
+        });
+    }
+
+    static IOT_Awaitable GetDevice(const IOT_API& api, IOT_AsyncTransport& transport, const std::string& devId,
+                                   IOT_GetDevice& device)
+    {
+        return IOT_Awaitable([&api, &transport, &devId, &device](IOT_API::Completion done) {
+            api.GetDeviceAsync(transport, devId, device, done);
+        });
+    }
+
+    static IOT_Awaitable RegisterDevice(const IOT_API& api, IOT_AsyncTransport& transport,
+                                        const IOT_RegDevice& device, std::string& devID)
+    {
+        return IOT_Awaitable([&api, &transport, &device, &devID](IOT_API::Completion done) {
+            api.RegisterDeviceAsync(transport, device, devID, done);
+        });
+    }
+
+    static IOT_Awaitable SendData(const IOT_API& api, IOT_AsyncTransport& transport, const std::string& devId,
+                                  const std::vector<IOT_WriteData>& data, IOT_WriteResult& result)
+    {
+        return IOT_Awaitable([&api, &transport, &devId, &data, &result](IOT_API::Completion done) {
+            api.SendDataAsync(transport, devId, data, result, done);
+        });
+    }
+
+    static IOT_Awaitable ReadData(const IOT_API& api, IOT_AsyncTransport& transport, const std::string& devId,
+                                  const IOT_ReadDataFilter& filter, std::vector<IOT_ReadData>& data)
+    {
+        return IOT_Awaitable([&api, &transport, &devId, &filter, &data](IOT_API::Completion done) {
+            api.ReadDataAsync(transport, devId, filter, data, done);
+        });
+    }
+
+    static IOT_Awaitable GetDatanodes(const IOT_API& api, IOT_AsyncTransport& transport, const std::string& devId,
+                                      std::vector<IOT_ReadData>& data)
+    {
+        return IOT_Awaitable([&api, &transport, &devId, &data](IOT_API::Completion done) {
+            api.GetDatanodesAsync(transport, devId, data, done);
+        });
+    }
+
+    static IOT_Awaitable GetQuota(const IOT_API& api, IOT_AsyncTransport& transport, IOT_Quota& quota)
+    {
+        return IOT_Awaitable([&api, &transport, &quota](IOT_API::Completion done) {
+            api.GetQuotaAsync(transport, quota, done);
+        });
+    }
+
+    static IOT_Awaitable GetQuota(const IOT_API& api, IOT_AsyncTransport& transport, const std::string& devId,
+                                  IOT_QuotaDevice& quota)
+    {
+        return IOT_Awaitable([&api, &transport, &devId, &quota](IOT_API::Completion done) {
+            api.GetQuotaAsync(transport, devId, quota, done);
+        });
+    }
+};
+
+#endif // IOT_HAS_COROUTINES
+
+#endif // IOT_COROUTINE_H
@@ -0,0 +1,402 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_DoubleFormat.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+//! Normalized powers of ten 10^-348, 10^-340, ..., 10^340 as f * 2^e
+const uint64_t CACHED_POWERS_F[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+const int16_t CACHED_POWERS_E[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066
+};
+
+const uint64_t POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+const uint64_t DP_HIDDEN_BIT = 0x0010000000000000ULL;
+const uint64_t DP_SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+const int DP_SIGNIFICAND_SIZE = 52;
+const int DP_EXPONENT_BIAS = 0x3FF + DP_SIGNIFICAND_SIZE;
+const int DP_MIN_EXPONENT = -DP_EXPONENT_BIAS;
+const int DIY_SIGNIFICAND_SIZE = 64;
+
+//! Decimal exponents up to this are written without exponent notation
+const int MAX_FIXED_EXPONENT = 21;
+
+//! Floating point number f * 2^e with 64-bit significand
+struct DiyFp
+{
+    DiyFp() : f(0), e(0) {}
+    DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+    explicit DiyFp(double d)
+    {
+        uint64_t u;
+        memcpy(&u, &d, sizeof(u));
+
+        int biased = static_cast<int>((u >> DP_SIGNIFICAND_SIZE) & 0x7FF);
+        uint64_t significand = u & DP_SIGNIFICAND_MASK;
+        if(biased != 0) {
+            f = significand + DP_HIDDEN_BIT;
+            e = biased - DP_EXPONENT_BIAS;
+        } else {
+            f = significand;
+            e = DP_MIN_EXPONENT + 1;
+        }
+    }
+
+    DiyFp operator-(const DiyFp& rhs) const
+    {
+        return DiyFp(f - rhs.f, e);
+    }
+
+    //! Product rounded to 64 bits
+    DiyFp operator*(const DiyFp& rhs) const
+    {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 p = static_cast<unsigned __int128>(f) * rhs.f;
+        uint64_t h = static_cast<uint64_t>(p >> 64);
+        uint64_t l = static_cast<uint64_t>(p);
+        if(l & (1ULL << 63)) {
+            h++;
+        }
+        return DiyFp(h, e + rhs.e + 64);
+#else
+        const uint64_t M32 = 0xFFFFFFFFULL;
+        const uint64_t a = f >> 32;
+        const uint64_t b = f & M32;
+        const uint64_t c = rhs.f >> 32;
+        const uint64_t d = rhs.f & M32;
+        const uint64_t ac = a * c;
+        const uint64_t bc = b * c;
+        const uint64_t ad = a * d;
+        const uint64_t bd = b * d;
+        uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+        tmp += 1ULL << 31;
+        return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+#endif
+    }
+
+    DiyFp Normalize() const
+    {
+        DiyFp res = *this;
+        while(!(res.f & (1ULL << 63))) {
+            res.f <<= 1;
+            res.e--;
+        }
+        return res;
+    }
+
+    DiyFp NormalizeBoundary() const
+    {
+        DiyFp res = *this;
+        while(!(res.f & (DP_HIDDEN_BIT << 1))) {
+            res.f <<= 1;
+            res.e--;
+        }
+        res.f <<= (DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2);
+        res.e = res.e - (DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2);
+        return res;
+    }
+
+    //! Boundaries m- and m+ halfway to the neighbouring doubles, with the exponent of m+
+    void NormalizedBoundaries(DiyFp* minus, DiyFp* plus) const
+    {
+        DiyFp pl = DiyFp((f << 1) + 1, e - 1).NormalizeBoundary();
+        DiyFp mi = (f == DP_HIDDEN_BIT) ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1);
+        mi.f <<= mi.e - pl.e;
+        mi.e = pl.e;
+        *plus = pl;
+        *minus = mi;
+    }
+
+    uint64_t f;
+    int e;
+};
+
+//! Cached power of ten c = 10^-K such that the product with a DiyFp of
+//! exponent e has its exponent in [-60, -32]
+DiyFp GetCachedPower(int e, int* K)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = static_cast<int>(dk);
+    if(dk - k > 0.0) {
+        k++;
+    }
+
+    unsigned index = static_cast<unsigned>((k >> 3) + 1);
+    *K = -(-348 + static_cast<int>(index << 3));
+    return DiyFp(CACHED_POWERS_F[index], CACHED_POWERS_E[index]);
+}
+
+void GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+    // Move the last digit down while it brings the result closer to the exact value
+    while(rest < wpw && delta - rest >= tenKappa &&
+          (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+int CountDecimalDigit32(uint32_t n)
+{
+    int digits = 1;
+    while(n >= 10 && digits < 10) {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+//! Generate the shortest digits of W within [Mp - delta, Mp]
+void DigitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int* len, int* K)
+{
+    const DiyFp one(1ULL << -Mp.e, Mp.e);
+    const DiyFp wpw = Mp - W;
+    uint32_t p1 = static_cast<uint32_t>(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = CountDecimalDigit32(p1);
+    *len = 0;
+
+    while(kappa > 0) {
+        uint32_t d = static_cast<uint32_t>(p1 / POW10[kappa - 1]);
+        p1 = static_cast<uint32_t>(p1 % POW10[kappa - 1]);
+        if(d || *len) {
+            buffer[(*len)++] = static_cast<char>('0' + d);
+        }
+        kappa--;
+
+        uint64_t rest = (static_cast<uint64_t>(p1) << -one.e) + p2;
+        if(rest <= delta) {
+            *K += kappa;
+            GrisuRound(buffer, *len, delta, rest, POW10[kappa] << -one.e, wpw.f);
+            return;
+        }
+    }
+
+    while(true) {
+        p2 *= 10;
+        delta *= 10;
+        char d = static_cast<char>(p2 >> -one.e);
+        if(d || *len) {
+            buffer[(*len)++] = static_cast<char>('0' + d);
+        }
+        p2 &= one.f - 1;
+        kappa--;
+
+        if(p2 < delta) {
+            *K += kappa;
+            int index = -kappa;
+            GrisuRound(buffer, *len, delta, p2, one.f, wpw.f * (index < 20 ? POW10[index] : 0));
+            return;
+        }
+    }
+}
+
+//! Shortest digits and decimal exponent of a positive value: value = digits * 10^K
+void Grisu2(double value, char* buffer, int* length, int* K)
+{
+    const DiyFp v(value);
+    DiyFp wm, wp;
+    v.NormalizedBoundaries(&wm, &wp);
+
+    const DiyFp cmk = GetCachedPower(wp.e, K);
+    const DiyFp W = v.Normalize() * cmk;
+    DiyFp Wp = wp * cmk;
+    DiyFp Wm = wm * cmk;
+    Wm.f++;
+    Wp.f--;
+    DigitGen(W, Wp, Wp.f - Wm.f, buffer, length, K);
+}
+
+char* WriteExponent(int K, char* buffer)
+{
+    if(K < 0) {
+        *buffer++ = '-';
+        K = -K;
+    }
+
+    if(K >= 100) {
+        *buffer++ = static_cast<char>('0' + K / 100);
+        K %= 100;
+        *buffer++ = static_cast<char>('0' + K / 10);
+        *buffer++ = static_cast<char>('0' + K % 10);
+    } else if(K >= 10) {
+        *buffer++ = static_cast<char>('0' + K / 10);
+        *buffer++ = static_cast<char>('0' + K % 10);
+    } else {
+        *buffer++ = static_cast<char>('0' + K);
+    }
+
+    *buffer = '\0';
+    return buffer;
+}
+
+//! Lay out digits * 10^k as JSON number, returns end of output
+char* Prettify(char* buffer, int length, int k)
+{
+    const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+
+    if(k >= 0 && kk <= MAX_FIXED_EXPONENT) {
+        // 1234e7 -> 12340000000.0
+        for(int i = length; i < kk; i++) {
+            buffer[i] = '0';
+        }
+        buffer[kk] = '.';
+        buffer[kk + 1] = '0';
+        buffer[kk + 2] = '\0';
+        return &buffer[kk + 2];
+    }
+
+    if(kk > 0 && kk <= MAX_FIXED_EXPONENT) {
+        // 1234e-2 -> 12.34
+        memmove(&buffer[kk + 1], &buffer[kk], length - kk);
+        buffer[kk] = '.';
+        buffer[length + 1] = '\0';
+        return &buffer[length + 1];
+    }
+
+    if(kk > -6 && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - kk;
+        memmove(&buffer[offset], &buffer[0], length);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        for(int i = 2; i < offset; i++) {
+            buffer[i] = '0';
+        }
+        buffer[length + offset] = '\0';
+        return &buffer[length + offset];
+    }
+
+    if(length == 1) {
+        // 1e30
+        buffer[1] = 'e';
+        return WriteExponent(kk - 1, &buffer[2]);
+    }
+
+    // 1234e30 -> 1.234e33
+    memmove(&buffer[2], &buffer[1], length - 1);
+    buffer[1] = '.';
+    buffer[length + 1] = 'e';
+    return WriteExponent(kk - 1, &buffer[length + 2]);
+}
+
+} // namespace
+
+const size_t IOT_DoubleFormat::BUFFER_SIZE;
+const int IOT_DoubleFormat::MAX_DECIMALS;
+
+size_t IOT_DoubleFormat::Format(double value, char* buffer)
+{
+    if(!isfinite(value)) {
+        buffer[0] = '\0';
+        return 0;
+    }
+
+    char* start = buffer;
+    if(signbit(value)) {
+        *buffer++ = '-';
+        value = -value;
+    }
+
+    if(value == 0.0) {
+        memcpy(buffer, "0.0", 4);
+        return (buffer - start) + 3;
+    }
+
+    int length = 0;
+    int K = 0;
+    Grisu2(value, buffer, &length, &K);
+    return Prettify(buffer, length, K) - start;
+}
+
+std::string IOT_DoubleFormat::ToString(double value)
+{
+    char buffer[BUFFER_SIZE];
+    size_t length = Format(value, buffer);
+    return std::string(buffer, length);
+}
+
+double IOT_DoubleFormat::Quantize(double value, int decimals)
+{
+    if(decimals < 0 || decimals > MAX_DECIMALS || !isfinite(value)) {
+        return value;
+    }
+
+    // Scaled value beyond 2^53 has no fractional part left to round
+    const double scale = static_cast<double>(POW10[decimals]);
+    const double scaled = value * scale;
+    if(fabs(scaled) >= 9007199254740992.0) {
+        return value;
+    }
+
+    // Dividing by an exact power of ten gives the double nearest to the decimal
+    return round(scaled) / scale;
+}
@@ -0,0 +1,62 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_DOUBLEFORMAT_H
+#define IOT_DOUBLEFORMAT_H
+
+#include <string>
+#include <stddef.h>
+
+//! \brief Fast shortest round-trip formatting of doubles for JSON output
+//! \note Uses the Grisu2 algorithm (Loitsch, "Printing Floating-Point Numbers
+//!       Quickly and Accurately with Integers"). The output always parses back
+//!       to the same double and is the shortest such string for nearly all
+//!       values. Finite values always contain a decimal point or an exponent so
+//!       that they are read back as doubles, e.g. "0.1", "100.0", "1.5e-7".
+class IOT_DoubleFormat
+{
+public:
+    //! Buffer size needed by Format()
+    static const size_t BUFFER_SIZE = 32;
+
+    //! Largest number of decimals accepted by Quantize()
+    static const int MAX_DECIMALS = 15;
+
+    //! \brief Format a finite double
+    //! \param [in]  value  - Value to format
+    //! \param [out] buffer - At least BUFFER_SIZE bytes, output is null terminated
+    //! \return Length of the output, 0 if value is not finite
+    static size_t Format(double value, char* buffer);
+
+    //! \brief Format a finite double to string
+    //! \return Formatted value, empty if value is not finite
+    static std::string ToString(double value);
+
+    //! \brief Round value to given number of decimals
+    //! \param [in] value    - Value to round
+    //! \param [in] decimals - Number of decimals, 0...MAX_DECIMALS
+    //! \return The double nearest to the rounded decimal value, value as is if
+    //!         decimals is out of range or the value has no more decimals
+    static double Quantize(double value, int decimals);
+};
+
+#endif // IOT_DOUBLEFORMAT_H
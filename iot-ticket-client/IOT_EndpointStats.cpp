@@ -0,0 +1,184 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_EndpointStats.h"
+
+//! Duration between two cumulative curl timestamps, clamped to zero
+static double PhaseDuration(double endMs, double startMs)
+{
+    return (endMs > startMs) ? (endMs - startMs) : 0.0;
+}
+
+IOT_EndpointStats::IOT_EndpointStats(): m_requests(0), m_failed(0), m_reused(0), m_unconnected(0),
+    m_bytesUp(0), m_bytesDown(0)
+{
+}
+
+template<class Stats>
+void IOT_EndpointStats::Record(Stats& stats, const IOT_RequestTiming& timing, bool success)
+{
+    stats.m_requests++;
+    if(!success) {
+        stats.m_failed++;
+    }
+
+    stats.m_bytesUp += timing.bytesUp;
+    stats.m_bytesDown += timing.bytesDown;
+
+    // Same check as the connection reuse detection: a transfer that got
+    // no reply and never reached sending made no connection to time
+    bool connected = (timing.httpCode != 0) || (timing.preTransferMs > 0.0);
+
+    if(!connected) {
+        stats.m_unconnected++;
+    } else if(timing.connectionReused) {
+        stats.m_reused++;
+    } else {
+        stats.m_dns.Record(timing.nameLookupMs);
+        stats.m_connect.Record(PhaseDuration(timing.connectMs, timing.nameLookupMs));
+
+        if(timing.appConnectMs > 0.0) {
+            stats.m_tls.Record(PhaseDuration(timing.appConnectMs, timing.connectMs));
+        }
+    }
+
+    if(timing.startTransferMs > 0.0) {
+        stats.m_server.Record(PhaseDuration(timing.startTransferMs, timing.preTransferMs));
+        stats.m_transfer.Record(PhaseDuration(timing.totalMs, timing.startTransferMs));
+    }
+
+    stats.m_total.Record(timing.totalMs);
+}
+
+void IOT_EndpointStats::Record(const IOT_RequestTiming& timing, bool success)
+{
+    Record(*this, timing, success);
+}
+
+void IOT_EndpointStats::Clear()
+{
+    *this = IOT_EndpointStats();
+}
+
+uint64_t IOT_EndpointStats::GetRequests() const
+{
+    return m_requests;
+}
+
+uint64_t IOT_EndpointStats::GetFailedRequests() const
+{
+    return m_failed;
+}
+
+uint64_t IOT_EndpointStats::GetReusedConnections() const
+{
+    return m_reused;
+}
+
+uint64_t IOT_EndpointStats::GetUnconnectedRequests() const
+{
+    return m_unconnected;
+}
+
+uint64_t IOT_EndpointStats::GetBytesUp() const
+{
+    return m_bytesUp;
+}
+
+uint64_t IOT_EndpointStats::GetBytesDown() const
+{
+    return m_bytesDown;
+}
+
+const IOT_Histogram& IOT_EndpointStats::GetDnsHistogram() const
+{
+    return m_dns;
+}
+
+const IOT_Histogram& IOT_EndpointStats::GetConnectHistogram() const
+{
+    return m_connect;
+}
+
+const IOT_Histogram& IOT_EndpointStats::GetTlsHistogram() const
+{
+    return m_tls;
+}
+
+const IOT_Histogram& IOT_EndpointStats::GetServerHistogram() const
+{
+    return m_server;
+}
+
+const IOT_Histogram& IOT_EndpointStats::GetTransferHistogram() const
+{
+    return m_transfer;
+}
+
+const IOT_Histogram& IOT_EndpointStats::GetTotalHistogram() const
+{
+    return m_total;
+}
+
+IOT_SharedEndpointStats::IOT_SharedEndpointStats(): m_requests(0), m_failed(0), m_reused(0), m_unconnected(0),
+    m_bytesUp(0), m_bytesDown(0)
+{
+}
+
+void IOT_SharedEndpointStats::Record(const IOT_RequestTiming& timing, bool success)
+{
+    IOT_EndpointStats::Record(*this, timing, success);
+}
+
+void IOT_SharedEndpointStats::MergeTo(IOT_EndpointStats& stats) const
+{
+    stats.m_requests += m_requests.load(std::memory_order_relaxed);
+    stats.m_failed += m_failed.load(std::memory_order_relaxed);
+    stats.m_reused += m_reused.load(std::memory_order_relaxed);
+    stats.m_unconnected += m_unconnected.load(std::memory_order_relaxed);
+    stats.m_bytesUp += m_bytesUp.load(std::memory_order_relaxed);
+    stats.m_bytesDown += m_bytesDown.load(std::memory_order_relaxed);
+
+    m_dns.MergeTo(stats.m_dns);
+    m_connect.MergeTo(stats.m_connect);
+    m_tls.MergeTo(stats.m_tls);
+    m_server.MergeTo(stats.m_server);
+    m_transfer.MergeTo(stats.m_transfer);
+    m_total.MergeTo(stats.m_total);
+}
+
+void IOT_SharedEndpointStats::Clear()
+{
+    m_requests.store(0, std::memory_order_relaxed);
+    m_failed.store(0, std::memory_order_relaxed);
+    m_reused.store(0, std::memory_order_relaxed);
+    m_unconnected.store(0, std::memory_order_relaxed);
+    m_bytesUp.store(0, std::memory_order_relaxed);
+    m_bytesDown.store(0, std::memory_order_relaxed);
+
+    m_dns.Clear();
+    m_connect.Clear();
+    m_tls.Clear();
+    m_server.Clear();
+    m_transfer.Clear();
+    m_total.Clear();
+}
@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_ENDPOINTSTATS_H
+#define IOT_ENDPOINTSTATS_H
+
+#include <atomic>
+#include <stdint.h>
+#include "IOT_Histogram.h"
+#include "IOT_RequestTiming.h"
+
+//! \brief Aggregated request statistics of single server endpoint
+//! \note Phase histograms contain the duration of each phase on its own
+//!       (e.g. TLS = appconnect - connect) so the slow phase can be spotted
+//!       directly. Requests that never got connected (name resolving or
+//!       connect failed) only count in the request totals, not in the phases.
+class IOT_EndpointStats
+{
+public:
+    IOT_EndpointStats();
+
+    //! \brief Add timing of a completed request to the statistics
+    //! \param [in] timing  - Timing information of the request
+    //! \param [in] success - false if the request failed
+    void Record(const IOT_RequestTiming& timing, bool success);
+
+    //! \brief Remove all recorded data
+    void Clear();
+
+    uint64_t GetRequests() const;
+    uint64_t GetFailedRequests() const;
+    uint64_t GetReusedConnections() const;
+
+    //! Requests that failed before a connection to the server was made
+    uint64_t GetUnconnectedRequests() const;
+
+    uint64_t GetBytesUp() const;
+    uint64_t GetBytesDown() const;
+
+    //! Name resolving time
+    const IOT_Histogram& GetDnsHistogram() const;
+
+    //! TCP connect time (excluding name resolving)
+    const IOT_Histogram& GetConnectHistogram() const;
+
+    //! TLS handshake time (only recorded for requests that made a handshake)
+    const IOT_Histogram& GetTlsHistogram() const;
+
+    //! Time from sending the request to the first response byte
+    const IOT_Histogram& GetServerHistogram() const;
+
+    //! Time to receive the response after the first byte
+    const IOT_Histogram& GetTransferHistogram() const;
+
+    //! Total request time
+    const IOT_Histogram& GetTotalHistogram() const;
+
+private:
+    friend class IOT_SharedEndpointStats;
+
+    //! Record timing to plain or shared statistics (both have the same members)
+    template<class Stats>
+    static void Record(Stats& stats, const IOT_RequestTiming& timing, bool success);
+
+    uint64_t m_requests;
+    uint64_t m_failed;
+    uint64_t m_reused;
+    uint64_t m_unconnected;
+    uint64_t m_bytesUp;
+    uint64_t m_bytesDown;
+
+    IOT_Histogram m_dns;
+    IOT_Histogram m_connect;
+    IOT_Histogram m_tls;
+    IOT_Histogram m_server;
+    IOT_Histogram m_transfer;
+    IOT_Histogram m_total;
+};
+
+//! \brief Request statistics of single endpoint that several threads can
+//!        record to without locking
+class IOT_SharedEndpointStats
+{
+public:
+    IOT_SharedEndpointStats();
+
+    //! \brief Add timing of a completed request to the statistics
+    //! \param [in] timing  - Timing information of the request
+    //! \param [in] success - false if the request failed
+    void Record(const IOT_RequestTiming& timing, bool success);
+
+    //! \brief Add all recorded data to plain statistics
+    void MergeTo(IOT_EndpointStats& stats) const;
+
+    //! \brief Remove all recorded data
+    void Clear();
+
+private:
+    friend class IOT_EndpointStats;
+
+    std::atomic<uint64_t> m_requests;
+    std::atomic<uint64_t> m_failed;
+    std::atomic<uint64_t> m_reused;
+    std::atomic<uint64_t> m_unconnected;
+    std::atomic<uint64_t> m_bytesUp;
+    std::atomic<uint64_t> m_bytesDown;
+
+    IOT_SharedHistogram m_dns;
+    IOT_SharedHistogram m_connect;
+    IOT_SharedHistogram m_tls;
+    IOT_SharedHistogram m_server;
+    IOT_SharedHistogram m_transfer;
+    IOT_SharedHistogram m_total;
+};
+
+#endif // IOT_ENDPOINTSTATS_H
@@ -0,0 +1,328 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_Gateway.h"
+#include "IOT_Metrics.h"
+
+using namespace IOTAPI;
+
+const size_t IOT_Gateway::DEFAULT_BATCH_SIZE;
+const uint32_t IOT_Gateway::DEFAULT_FLUSH_MS;
+const size_t IOT_Gateway::DEFAULT_MAX_IN_FLIGHT;
+const size_t IOT_Gateway::DEFAULT_MAX_QUEUED;
+
+struct IOT_Gateway::Send
+{
+    Device* device;
+    std::vector<IOT_WriteData> batch;
+    clock_t::time_point oldest;
+    IOT_WriteResult result;
+};
+
+IOT_Gateway::Stats::Stats():
+    enqueued(0), written(0), dropped(0), batches(0), failed(0), queued(0)
+{
+}
+
+IOT_Gateway::Device::Device():
+    ready(false), sending(false)
+{
+}
+
+IOT_Gateway::IOT_Gateway(const IOT_API& api, IOT_AsyncTransport& transport, size_t maxInFlight):
+    m_api(api), m_transport(transport), m_maxInFlight((maxInFlight > 0) ? maxInFlight : 1),
+    m_batchSize(DEFAULT_BATCH_SIZE), m_flushMs(DEFAULT_FLUSH_MS), m_maxQueued(DEFAULT_MAX_QUEUED),
+    m_inFlight(0), m_queued(0), m_alive(new bool(true))
+{
+}
+
+IOT_Gateway::~IOT_Gateway()
+{
+    *m_alive = false;
+
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    metrics.samplesDropped.Add(m_queued);
+    metrics.queueDepth.Add(-static_cast<int64_t>(m_queued));
+
+    for(std::map<std::string, Device*>::iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        // Device of a request in progress is freed when the request completes
+        if(it->second->sending) {
+            it->second->queue.clear();
+        } else {
+            delete it->second;
+        }
+    }
+    m_devices.clear();
+}
+
+bool IOT_Gateway::SetBatching(size_t batchSize, uint32_t flushMs)
+{
+    if(batchSize == 0) {
+        return false;
+    }
+
+    m_batchSize = batchSize;
+    m_flushMs = flushMs;
+    return true;
+}
+
+void IOT_Gateway::SetMaxQueued(size_t maxQueued)
+{
+    m_maxQueued = maxQueued;
+}
+
+bool IOT_Gateway::Enqueue(const std::string& devId, const IOT_WriteData& data)
+{
+    std::vector<IOT_WriteData> vec(1, data);
+    return Enqueue(devId, vec) == 1;
+}
+
+size_t IOT_Gateway::Enqueue(const std::string& devId, const std::vector<IOT_WriteData>& data)
+{
+    Device*& device = m_devices[devId];
+    if(device == NULL) {
+        device = new Device();
+        device->devId = devId;
+    }
+
+    clock_t::time_point now = clock_t::now();
+    bool wasEmpty = device->queue.empty();
+
+    size_t queued = 0;
+    while(queued < data.size() && device->queue.size() < m_maxQueued) {
+        Queued entry;
+        entry.data = data[queued];
+        entry.queuedAt = now;
+        device->queue.push_back(entry);
+        ++queued;
+    }
+
+    size_t dropped = data.size() - queued;
+    device->stats.enqueued += queued;
+    device->stats.dropped += dropped;
+    m_queued += queued;
+
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    metrics.samplesEnqueued.Add(queued);
+    metrics.samplesDropped.Add(dropped);
+    metrics.queueDepth.Add(queued);
+
+    if(wasEmpty && queued > 0 && !device->sending) {
+        StartDeadline(device, now + std::chrono::milliseconds(m_flushMs));
+    }
+    if(device->queue.size() >= m_batchSize) {
+        MarkReady(device);
+        Dispatch();
+    }
+
+    return queued;
+}
+
+size_t IOT_Gateway::Dispatch()
+{
+    clock_t::time_point now = clock_t::now();
+    while(!m_waiting.empty() && m_waiting.top().first <= now)
+    {
+        Device* device = m_waiting.top().second;
+        m_waiting.pop();
+
+        // Entry is stale if the queue has been sent and refilled meanwhile
+        if(!device->queue.empty() && device->deadline <= now) {
+            MarkReady(device);
+        }
+    }
+
+    size_t started = 0;
+    while(m_inFlight < m_maxInFlight && !m_ready.empty())
+    {
+        Device* device = m_ready.front();
+        m_ready.pop_front();
+        device->ready = false;
+
+        if(!device->queue.empty() && !device->sending) {
+            StartSend(device);
+            ++started;
+        }
+    }
+
+    return started;
+}
+
+size_t IOT_Gateway::Flush()
+{
+    for(std::map<std::string, Device*>::iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        if(!it->second->queue.empty()) {
+            it->second->deadline = clock_t::now();
+            MarkReady(it->second);
+        }
+    }
+
+    return Dispatch();
+}
+
+long IOT_Gateway::GetNextTimeoutMs() const
+{
+    if(!m_ready.empty() && m_inFlight < m_maxInFlight) {
+        return 0;
+    }
+    if(m_waiting.empty()) {
+        return -1;
+    }
+
+    clock_t::duration left = m_waiting.top().first - clock_t::now();
+    if(left <= clock_t::duration::zero()) {
+        return 0;
+    }
+
+    // Round up so that the deadline has passed when Dispatch() is called
+    return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(left).count()) + 1;
+}
+
+size_t IOT_Gateway::GetDevices() const
+{
+    return m_devices.size();
+}
+
+size_t IOT_Gateway::GetInFlight() const
+{
+    return m_inFlight;
+}
+
+size_t IOT_Gateway::GetQueued() const
+{
+    return m_queued;
+}
+
+bool IOT_Gateway::GetStats(const std::string& devId, Stats& stats) const
+{
+    std::map<std::string, Device*>::const_iterator it = m_devices.find(devId);
+    if(it == m_devices.end()) {
+        return false;
+    }
+
+    stats = it->second->stats;
+    stats.queued = it->second->queue.size();
+    return true;
+}
+
+void IOT_Gateway::GetStats(Stats& stats) const
+{
+    stats = Stats();
+    for(std::map<std::string, Device*>::const_iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        const Stats& device = it->second->stats;
+        stats.enqueued += device.enqueued;
+        stats.written += device.written;
+        stats.dropped += device.dropped;
+        stats.batches += device.batches;
+        stats.failed += device.failed;
+        stats.latency.Merge(device.latency);
+    }
+    stats.queued = m_queued;
+}
+
+void IOT_Gateway::MarkReady(Device* device)
+{
+    if(!device->ready && !device->sending) {
+        device->ready = true;
+        m_ready.push_back(device);
+    }
+}
+
+void IOT_Gateway::StartDeadline(Device* device, clock_t::time_point deadline)
+{
+    device->deadline = deadline;
+    m_waiting.push(std::make_pair(deadline, device));
+}
+
+void IOT_Gateway::StartSend(Device* device)
+{
+    std::shared_ptr<Send> send = std::make_shared<Send>();
+    send->device = device;
+
+    size_t count = std::min(m_batchSize, device->queue.size());
+    send->oldest = device->queue.front().queuedAt;
+    send->batch.reserve(count);
+    for(size_t i = 0; i < count; ++i) {
+        send->batch.push_back(device->queue[i].data);
+    }
+    device->queue.erase(device->queue.begin(), device->queue.begin() + count);
+    m_queued -= count;
+    IOT_Metrics::Instance().queueDepth.Add(-static_cast<int64_t>(count));
+
+    device->sending = true;
+    device->stats.batches++;
+    ++m_inFlight;
+
+    std::shared_ptr<bool> alive = m_alive;
+    m_api.SendDataAsync(m_transport, device->devId, send->batch, send->result,
+        [this, alive, send](IOTAPI_err ret) {
+            if(*alive) {
+                FinishSend(send.get(), ret);
+            } else {
+                delete send->device;
+            }
+        });
+}
+
+void IOT_Gateway::FinishSend(Send* send, IOTAPI::IOTAPI_err ret)
+{
+    Device* device = send->device;
+    clock_t::time_point now = clock_t::now();
+
+    device->sending = false;
+    --m_inFlight;
+
+    device->stats.written += send->result.GetAccepted();
+    device->stats.latency.Record(std::chrono::duration<double, std::milli>(now - send->oldest).count());
+    if(ret != IOT_ERR_OK) {
+        device->stats.failed++;
+    }
+
+    clock_t::time_point oldest = send->oldest;
+    size_t requeued = send->result.Requeue(send->batch, true, device->queue, m_maxQueued,
+        [oldest](const IOT_WriteData& data) {
+            Queued entry;
+            entry.data = data;
+            entry.queuedAt = oldest;
+            return entry;
+        });
+
+    bool retry = (requeued > 0);
+    m_queued += requeued;
+    device->stats.dropped += send->result.GetSubmitted() - send->result.GetAccepted() - requeued;
+
+    if(retry) {
+        // Wait a flush interval before retrying
+        StartDeadline(device, now + std::chrono::milliseconds(m_flushMs));
+    } else if(!device->queue.empty()) {
+        // Rest of the queue waits for the next turn, behind the other ready devices
+        clock_t::time_point deadline = device->queue.front().queuedAt + std::chrono::milliseconds(m_flushMs);
+        if(device->queue.size() >= m_batchSize || deadline <= now) {
+            device->deadline = deadline;
+            MarkReady(device);
+        } else {
+            StartDeadline(device, deadline);
+        }
+    }
+
+    Dispatch();
+}
@@ -0,0 +1,200 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_GATEWAY_H
+#define IOT_GATEWAY_H
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include "IOT_API.h"
+#include "IOT_AsyncTransport.h"
+#include "IOT_Histogram.h"
+
+//! \brief Upload queues of many devices sent over one asynchronous transport
+//! \note Each device has its own queue, which is sent in batches when it has
+//!       a full batch or its oldest sample has waited the flush interval.
+//!       Devices ready to send are served round robin, one batch per turn,
+//!       and at most one batch of a device is in progress so its samples are
+//!       written in order. All devices share the connections of the transport.
+//!       The gateway is used from the thread that polls the transport, and
+//!       Dispatch() must be called at the latest after GetNextTimeoutMs().
+//!       Samples not written because of a transient error are retried,
+//!       samples rejected by the server are dropped.
+class IOT_Gateway
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+    //! Default max number of samples in one request
+    static const size_t DEFAULT_BATCH_SIZE = 100;
+
+    //! Default max time a sample waits for others to batch with in milliseconds
+    static const uint32_t DEFAULT_FLUSH_MS = 1000;
+
+    //! Default max number of requests in progress
+    static const size_t DEFAULT_MAX_IN_FLIGHT = 8;
+
+    //! Default max number of samples waiting in the queue of a device
+    static const size_t DEFAULT_MAX_QUEUED = 10000;
+
+    //! \brief Statistics of single device or the whole gateway
+    struct Stats
+    {
+        Stats();
+
+        uint64_t enqueued;  //! Samples accepted to the queue
+        uint64_t written;   //! Samples written to the server
+        uint64_t dropped;   //! Samples dropped for a full queue or a rejected write
+        uint64_t batches;   //! Requests sent
+        uint64_t failed;    //! Requests that did not write all samples
+        size_t queued;      //! Samples waiting now
+
+        //! Time from queuing the oldest sample of a batch to the end of its request
+        IOT_Histogram latency;
+    };
+
+    //! \brief Constructor
+    //! \param [in] api         - API instance used for sending. Must outlive the gateway.
+    //! \param [in] transport   - Transport the requests are made on. Must outlive the gateway.
+    //! \param [in] maxInFlight - Max number of requests in progress
+    IOT_Gateway(const IOT_API& api, IOT_AsyncTransport& transport, size_t maxInFlight = DEFAULT_MAX_IN_FLIGHT);
+    ~IOT_Gateway();
+
+    //! \brief Set batching of the device queues
+    //! \param [in] batchSize - Max number of samples in one request
+    //! \param [in] flushMs   - Max time a sample waits for others to batch with
+    //! \return false if batchSize is zero
+    bool SetBatching(size_t batchSize, uint32_t flushMs);
+
+    //! \brief Set max number of samples waiting in the queue of a device
+    void SetMaxQueued(size_t maxQueued);
+
+    //! \brief Add sample to the queue of a device, the device is added on first use
+    //! \return false if the queue is full and the sample was dropped
+    bool Enqueue(const std::string& devId, const IOT_WriteData& data);
+
+    //! \brief Add samples to the queue of a device, the device is added on first use
+    //! \return Number of samples queued, the rest were dropped because the queue is full
+    size_t Enqueue(const std::string& devId, const std::vector<IOT_WriteData>& data);
+
+    //! \brief Start requests of devices whose batch is full or flush interval has passed
+    //! \return Number of requests started
+    size_t Dispatch();
+
+    //! \brief Send all queued samples without waiting for the flush interval
+    //! \return Number of requests started
+    size_t Flush();
+
+    //! \brief Time until Dispatch() has work to do
+    //! \return Milliseconds, 0 if now, -1 if nothing is waiting for the flush interval
+    long GetNextTimeoutMs() const;
+
+    //! \brief Number of devices known to the gateway
+    size_t GetDevices() const;
+
+    //! \brief Number of requests in progress
+    size_t GetInFlight() const;
+
+    //! \brief Number of samples waiting in all queues
+    size_t GetQueued() const;
+
+    //! \brief Get statistics of single device
+    //! \return false if the device is not known
+    bool GetStats(const std::string& devId, Stats& stats) const;
+
+    //! \brief Get statistics of all devices together
+    void GetStats(Stats& stats) const;
+
+private:
+    IOT_Gateway(const IOT_Gateway&);
+    IOT_Gateway& operator=(const IOT_Gateway&);
+
+    struct Queued
+    {
+        IOT_WriteData data;
+        clock_t::time_point queuedAt;
+    };
+
+    struct Device
+    {
+        Device();
+
+        std::string devId;
+        std::deque<Queued> queue;
+
+        //! Time when the queue must be sent at the latest
+        clock_t::time_point deadline;
+
+        //! Device is in the ready list
+        bool ready;
+
+        //! Batch of the device is in progress
+        bool sending;
+
+        Stats stats;
+    };
+
+    //! Request of a batch of one device
+    struct Send;
+
+    //! Add device to the end of the ready list unless it is already there or sending
+    void MarkReady(Device* device);
+
+    //! Make a device ready to send at the given time
+    void StartDeadline(Device* device, clock_t::time_point deadline);
+
+    //! Send the next batch of a device
+    void StartSend(Device* device);
+
+    //! Handle completion of a batch request
+    void FinishSend(Send* send, IOTAPI::IOTAPI_err ret);
+
+    const IOT_API& m_api;
+    IOT_AsyncTransport& m_transport;
+    size_t m_maxInFlight;
+    size_t m_batchSize;
+    uint32_t m_flushMs;
+    size_t m_maxQueued;
+
+    std::map<std::string, Device*> m_devices;
+
+    //! Devices ready to send, served from the front
+    std::deque<Device*> m_ready;
+
+    typedef std::pair<clock_t::time_point, Device*> Deadline;
+
+    //! Devices waiting for the flush interval, earliest deadline on top
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline> > m_waiting;
+
+    size_t m_inFlight;
+    size_t m_queued;
+
+    //! Cleared by the destructor so completions after it are ignored
+    std::shared_ptr<bool> m_alive;
+};
+
+#endif // IOT_GATEWAY_H
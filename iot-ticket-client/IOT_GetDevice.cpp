@@ -22,6 +22,7 @@
 
 #include "IOT_GetDevice.h"
 #include "IOT_defines.h"
+#include "IOT_ResponseDecoder.h"
 #include <stdio.h>
 
 IOT_GetDevice::IOT_GetDevice(): IOT_RegDevice(), m_deviceID(""), m_href(""), m_createdAt("") {}
@@ -106,17 +107,7 @@ bool IOT_GetDevice::ToJSON(Json::Value &json) const
 
 bool IOT_GetDevice::FromJSON(const std::string &json)
 {
-    Json::Value answer;
-    Json::Reader json_reader;
-
-    if(json_reader.parse(json, answer, false))
-    {
-        if(IOT_GetDevice::FromJSON(answer)) {
-            return true;
-        }
-    }
-
-    return false;
+    return IOT_ResponseDecoder::DecodeDevice(json, *this) == IOT_ResponseDecoder::DECODE_OK;
 }
 
 bool IOT_GetDevice::FromJSON(const Json::Value &json)
@@ -43,6 +43,8 @@ public:
     virtual bool FromJSON(const Json::Value& json);
 
 private:
+    friend class IOT_ResponseDecoder;
+
     bool SetDeviceID(const std::string& devID);
     bool SetHref(const std::string& href);
     bool SetCreated(const std::string& created);
@@ -0,0 +1,189 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include "IOT_Histogram.h"
+
+static const double BUCKET_BOUNDS_MS[IOT_Histogram::BUCKETS - 1] = {
+    1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0, 200.0, 500.0,
+    1000.0, 2000.0, 5000.0, 10000.0, 20000.0
+};
+
+//! Bucket of an observed value
+static size_t BucketOf(double valueMs)
+{
+    size_t bucket = 0;
+    while(bucket < IOT_Histogram::BUCKETS - 1 && valueMs > BUCKET_BOUNDS_MS[bucket]) {
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+IOT_Histogram::IOT_Histogram()
+{
+    Clear();
+}
+
+void IOT_Histogram::Record(double valueMs)
+{
+    m_buckets[BucketOf(valueMs)]++;
+    m_count++;
+    m_sum += valueMs;
+
+    if(valueMs > m_max) {
+        m_max = valueMs;
+    }
+}
+
+void IOT_Histogram::Merge(const IOT_Histogram& other)
+{
+    for(size_t i = 0; i < BUCKETS; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+
+    if(other.m_max > m_max) {
+        m_max = other.m_max;
+    }
+}
+
+void IOT_Histogram::Clear()
+{
+    for(size_t i = 0; i < BUCKETS; ++i) {
+        m_buckets[i] = 0;
+    }
+
+    m_count = 0;
+    m_sum = 0.0;
+    m_max = 0.0;
+}
+
+uint64_t IOT_Histogram::GetCount() const
+{
+    return m_count;
+}
+
+double IOT_Histogram::GetSum() const
+{
+    return m_sum;
+}
+
+double IOT_Histogram::GetMax() const
+{
+    return m_max;
+}
+
+double IOT_Histogram::GetMean() const
+{
+    if(m_count == 0) {
+        return 0.0;
+    }
+
+    return m_sum / static_cast<double>(m_count);
+}
+
+uint64_t IOT_Histogram::GetBucketCount(size_t bucket) const
+{
+    if(bucket >= BUCKETS) {
+        return 0;
+    }
+
+    return m_buckets[bucket];
+}
+
+double IOT_Histogram::GetBucketBound(size_t bucket)
+{
+    if(bucket >= BUCKETS - 1) {
+        return -1.0;
+    }
+
+    return BUCKET_BOUNDS_MS[bucket];
+}
+
+double IOT_Histogram::GetPercentile(double quantile) const
+{
+    if(m_count == 0) {
+        return 0.0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(m_count) + 0.5);
+    if(rank < 1) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS - 1; ++i) {
+        seen += m_buckets[i];
+        if(seen >= rank) {
+            return BUCKET_BOUNDS_MS[i] < m_max ? BUCKET_BOUNDS_MS[i] : m_max;
+        }
+    }
+
+    return m_max;
+}
+
+IOT_SharedHistogram::IOT_SharedHistogram()
+{
+    Clear();
+}
+
+void IOT_SharedHistogram::Record(double valueMs)
+{
+    uint64_t valueUs = (valueMs > 0.0) ? static_cast<uint64_t>(llround(valueMs * 1000.0)) : 0;
+
+    m_buckets[BucketOf(valueMs)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(valueUs, std::memory_order_relaxed);
+
+    uint64_t max = m_maxUs.load(std::memory_order_relaxed);
+    while(valueUs > max && !m_maxUs.compare_exchange_weak(max, valueUs, std::memory_order_relaxed)) {
+    }
+}
+
+void IOT_SharedHistogram::MergeTo(IOT_Histogram& histogram) const
+{
+    for(size_t i = 0; i < IOT_Histogram::BUCKETS; ++i) {
+        histogram.m_buckets[i] += m_buckets[i].load(std::memory_order_relaxed);
+    }
+
+    histogram.m_count += m_count.load(std::memory_order_relaxed);
+    histogram.m_sum += static_cast<double>(m_sumUs.load(std::memory_order_relaxed)) / 1000.0;
+
+    double max = static_cast<double>(m_maxUs.load(std::memory_order_relaxed)) / 1000.0;
+    if(max > histogram.m_max) {
+        histogram.m_max = max;
+    }
+}
+
+void IOT_SharedHistogram::Clear()
+{
+    for(size_t i = 0; i < IOT_Histogram::BUCKETS; ++i) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+
+    m_count.store(0, std::memory_order_relaxed);
+    m_sumUs.store(0, std::memory_order_relaxed);
+    m_maxUs.store(0, std::memory_order_relaxed);
+}
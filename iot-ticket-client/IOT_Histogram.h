@@ -0,0 +1,112 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_HISTOGRAM_H
+#define IOT_HISTOGRAM_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+//! \brief Fixed bucket histogram for latency values in milliseconds
+//! \note Bucket upper bounds follow the 1-2-5 series from 1 ms to 20 s. Values
+//!       larger than the last bound are counted in an overflow bucket.
+class IOT_Histogram
+{
+public:
+    //! Number of buckets including the overflow bucket
+    static const size_t BUCKETS = 15;
+
+    IOT_Histogram();
+
+    //! \brief Add single observation to the histogram
+    //! \param [in] valueMs - Observed value in milliseconds
+    void Record(double valueMs);
+
+    //! \brief Add all observations of other histogram to this one
+    void Merge(const IOT_Histogram& other);
+
+    //! \brief Remove all observations
+    void Clear();
+
+    //! \brief Number of observations recorded
+    uint64_t GetCount() const;
+
+    //! \brief Sum of all observed values in milliseconds
+    double GetSum() const;
+
+    //! \brief Largest observed value in milliseconds
+    double GetMax() const;
+
+    //! \brief Average of observed values, 0 if nothing has been recorded
+    double GetMean() const;
+
+    //! \brief Number of observations in single bucket (not cumulative)
+    //! \param [in] bucket - Bucket index [0...BUCKETS-1]
+    uint64_t GetBucketCount(size_t bucket) const;
+
+    //! \brief Upper bound of a bucket in milliseconds
+    //! \param [in] bucket - Bucket index [0...BUCKETS-1]
+    //! \return Upper bound, or negative value for the overflow bucket
+    static double GetBucketBound(size_t bucket);
+
+    //! \brief Estimate percentile from the bucket counts
+    //! \param [in] quantile - Quantile in range [0.0...1.0], e.g. 0.99
+    //! \return Upper bound of the bucket containing the quantile (GetMax() for overflow)
+    double GetPercentile(double quantile) const;
+
+private:
+    friend class IOT_SharedHistogram;
+
+    uint64_t m_buckets[BUCKETS];
+    uint64_t m_count;
+    double m_sum;
+    double m_max;
+};
+
+//! \brief Histogram with the buckets of IOT_Histogram that several threads
+//!        can record to without locking
+class IOT_SharedHistogram
+{
+public:
+    IOT_SharedHistogram();
+
+    //! \brief Add single observation to the histogram
+    //! \param [in] valueMs - Observed value in milliseconds
+    void Record(double valueMs);
+
+    //! \brief Add all observations to a plain histogram
+    void MergeTo(IOT_Histogram& histogram) const;
+
+    //! \brief Remove all observations
+    void Clear();
+
+private:
+    std::atomic<uint64_t> m_buckets[IOT_Histogram::BUCKETS];
+    std::atomic<uint64_t> m_count;
+    //! Sum of observed values in microseconds
+    std::atomic<uint64_t> m_sumUs;
+    //! Largest observed value in microseconds
+    std::atomic<uint64_t> m_maxUs;
+};
+
+#endif // IOT_HISTOGRAM_H
@@ -0,0 +1,96 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_InternedString.h"
+#include "IOT_Metrics.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <json/json.h>
+
+typedef std::unordered_map<std::string, std::shared_ptr<const IOT_InternedString> > EntryMap;
+
+//! Part of the string table with a lock of its own
+struct alignas(64) TableShard
+{
+    std::mutex lock;
+    EntryMap entries;
+};
+
+//! Process wide string table, created on first use
+struct StringTable
+{
+    StringTable(): count(0) {}
+
+    TableShard shards[IOT_Metrics::SHARDS];
+    std::atomic<size_t> count;
+};
+
+static StringTable& Table()
+{
+    static StringTable table;
+    return table;
+}
+
+std::shared_ptr<const IOT_InternedString> IOT_InternedString::Get(const std::string& value)
+{
+    if(value.empty()) {
+        return std::shared_ptr<const IOT_InternedString>();
+    }
+
+    StringTable& table = Table();
+    TableShard& shard = table.shards[std::hash<std::string>()(value) % IOT_Metrics::SHARDS];
+    std::lock_guard<std::mutex> lock(shard.lock);
+
+    EntryMap::const_iterator it = shard.entries.find(value);
+    if(it != shard.entries.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<const IOT_InternedString> entry = std::make_shared<IOT_InternedString>(value);
+    if(table.count.load(std::memory_order_relaxed) < MAX_ENTRIES) {
+        shard.entries[value] = entry;
+        table.count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return entry;
+}
+
+size_t IOT_InternedString::GetCount()
+{
+    return Table().count.load(std::memory_order_relaxed);
+}
+
+IOT_InternedString::IOT_InternedString(const std::string& value):
+    m_value(value), m_quoted(Json::valueToQuotedString(value.c_str()))
+{
+}
+
+const std::string& IOT_InternedString::GetValue() const
+{
+    return m_value;
+}
+
+const std::string& IOT_InternedString::GetQuoted() const
+{
+    return m_quoted;
+}
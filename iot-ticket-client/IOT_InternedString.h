@@ -0,0 +1,66 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_INTERNEDSTRING_H
+#define IOT_INTERNEDSTRING_H
+
+#include <memory>
+#include <string>
+#include <stddef.h>
+
+//! \brief String shared by all samples that use the same value, with its JSON form
+//! \note Names, paths and units repeat for every sample of a datanode. Each
+//!       distinct string is escaped once when it is first interned, and copies
+//!       of a sample share it through a pointer. The table of interned strings
+//!       is process wide and sharded like IOT_Metrics. Once it holds
+//!       MAX_ENTRIES strings, further strings get an entry that is not shared.
+class IOT_InternedString
+{
+public:
+    //! Max number of strings kept in the table
+    static const size_t MAX_ENTRIES = 65536;
+
+    //! \brief Get the shared entry of a string
+    //! \param [in] value - String to intern
+    //! \return Entry of the string, NULL for an empty string
+    static std::shared_ptr<const IOT_InternedString> Get(const std::string& value);
+
+    //! \brief Number of strings in the table
+    static size_t GetCount();
+
+    explicit IOT_InternedString(const std::string& value);
+
+    //! \brief The string itself
+    const std::string& GetValue() const;
+
+    //! \brief The string as a JSON string literal, quoted and escaped
+    const std::string& GetQuoted() const;
+
+private:
+    IOT_InternedString(const IOT_InternedString&);
+    IOT_InternedString& operator=(const IOT_InternedString&);
+
+    std::string m_value;
+    std::string m_quoted;
+};
+
+#endif // IOT_INTERNEDSTRING_H
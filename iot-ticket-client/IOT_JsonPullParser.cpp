@@ -0,0 +1,472 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_JsonPullParser.h"
+#include "IOT_JsonScan.h"
+#include "IOT_NumberParse.h"
+#include <string.h>
+
+static bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+//! Read four hex digits of a \u escape
+static bool ReadHex4(const char*& pos, const char* end, unsigned int& value)
+{
+    if(end - pos < 4) {
+        return false;
+    }
+
+    value = 0;
+    for(int i = 0; i < 4; ++i) {
+        char c = *pos++;
+        value <<= 4;
+        if(c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if(c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if(c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void AppendUtf8(std::string& str, unsigned int cp)
+{
+    if(cp < 0x80) {
+        str += static_cast<char>(cp);
+    } else if(cp < 0x800) {
+        str += static_cast<char>(0xC0 | (cp >> 6));
+        str += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if(cp < 0x10000) {
+        str += static_cast<char>(0xE0 | (cp >> 12));
+        str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        str += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        str += static_cast<char>(0xF0 | (cp >> 18));
+        str += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        str += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        str += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+
+IOT_JsonPullParser::IOT_JsonPullParser(const char* begin, const char* end):
+    m_pos(begin), m_end(end), m_token(TOKEN_NULL), m_expect(EXPECT_VALUE),
+    m_numberBegin(NULL), m_numberEnd(NULL), m_numberInteger(false), m_decode(true)
+{
+}
+
+IOT_JsonPullParser::IOT_JsonPullParser(const char* json):
+    m_pos(json), m_end(json + strlen(json)), m_token(TOKEN_NULL), m_expect(EXPECT_VALUE),
+    m_numberBegin(NULL), m_numberEnd(NULL), m_numberInteger(false), m_decode(true)
+{
+}
+
+IOT_JsonPullParser::IOT_JsonPullParser(const std::string& json):
+    m_pos(json.data()), m_end(json.data() + json.size()), m_token(TOKEN_NULL), m_expect(EXPECT_VALUE),
+    m_numberBegin(NULL), m_numberEnd(NULL), m_numberInteger(false), m_decode(true)
+{
+}
+
+IOT_JsonPullParser::Token IOT_JsonPullParser::Next()
+{
+    if(m_token == TOKEN_ERROR) {
+        return TOKEN_ERROR;
+    }
+
+    SkipWhitespace();
+
+    switch(m_expect) {
+    case EXPECT_EOF:
+        if(m_pos != m_end) {
+            return Fail();
+        }
+        m_token = TOKEN_END;
+        return m_token;
+
+    case EXPECT_COMMA_OR_END:
+        if(m_pos == m_end) {
+            return Fail();
+        }
+        if(*m_pos != ',') {
+            return CloseContainer(*m_pos);
+        }
+        ++m_pos;
+        SkipWhitespace();
+        if(m_stack.back() == '[') {
+            return ReadValue();
+        }
+        break;
+
+    case EXPECT_KEY_OR_END:
+        if(m_pos != m_end && *m_pos == '}') {
+            return CloseContainer('}');
+        }
+        break;
+
+    case EXPECT_VALUE_OR_END:
+        if(m_pos != m_end && *m_pos == ']') {
+            return CloseContainer(']');
+        }
+        return ReadValue();
+
+    case EXPECT_VALUE:
+        return ReadValue();
+    }
+
+    // Object member name followed by a colon
+    if(m_pos == m_end || *m_pos != '"') {
+        return Fail();
+    }
+    ++m_pos;
+    if(!ReadString(m_decode)) {
+        return Fail();
+    }
+
+    SkipWhitespace();
+    if(m_pos == m_end || *m_pos != ':') {
+        return Fail();
+    }
+    ++m_pos;
+
+    m_expect = EXPECT_VALUE;
+    m_token = TOKEN_KEY;
+    return m_token;
+}
+
+IOT_JsonPullParser::Token IOT_JsonPullParser::GetToken() const
+{
+    return m_token;
+}
+
+size_t IOT_JsonPullParser::GetDepth() const
+{
+    return m_stack.size();
+}
+
+const std::string& IOT_JsonPullParser::GetString() const
+{
+    return m_string;
+}
+
+bool IOT_JsonPullParser::IsKey(const char* key) const
+{
+    return m_token == TOKEN_KEY && m_string.compare(key) == 0;
+}
+
+bool IOT_JsonPullParser::IsInteger() const
+{
+    return m_token == TOKEN_NUMBER && m_numberInteger;
+}
+
+bool IOT_JsonPullParser::GetInt64(int64_t& value) const
+{
+    return IsInteger() && IOT_NumberParse::ParseInt64(m_numberBegin, m_numberEnd, value) == m_numberEnd;
+}
+
+bool IOT_JsonPullParser::GetUInt64(uint64_t& value) const
+{
+    return IsInteger() && IOT_NumberParse::ParseUInt64(m_numberBegin, m_numberEnd, value) == m_numberEnd;
+}
+
+bool IOT_JsonPullParser::GetDouble(double& value) const
+{
+    return m_token == TOKEN_NUMBER && IOT_NumberParse::ParseDouble(m_numberBegin, m_numberEnd, value) == m_numberEnd;
+}
+
+bool IOT_JsonPullParser::SkipValue()
+{
+    bool decode = m_decode;
+    m_decode = false;
+
+    if(m_token == TOKEN_KEY) {
+        Next();
+    }
+
+    if(m_token == TOKEN_OBJECT_BEGIN || m_token == TOKEN_ARRAY_BEGIN) {
+        // Jump to the matching bracket instead of reading every token
+        const char* end = IOT_JsonScan::SkipContainer(m_pos, m_end);
+        if(end == NULL) {
+            Fail();
+        } else {
+            m_pos = end - 1;
+            CloseContainer(*m_pos);
+        }
+    }
+
+    m_decode = decode;
+    return m_token != TOKEN_ERROR;
+}
+
+bool IOT_JsonPullParser::SkipToEnd()
+{
+    bool decode = m_decode;
+    m_decode = false;
+
+    while(m_token != TOKEN_END && m_token != TOKEN_ERROR) {
+        Next();
+    }
+
+    m_decode = decode;
+    return m_token == TOKEN_END;
+}
+
+IOT_JsonPullParser::Token IOT_JsonPullParser::Fail()
+{
+    m_token = TOKEN_ERROR;
+    return m_token;
+}
+
+IOT_JsonPullParser::Token IOT_JsonPullParser::ReadValue()
+{
+    if(m_pos == m_end) {
+        return Fail();
+    }
+
+    switch(*m_pos) {
+    case '{':
+        ++m_pos;
+        m_stack.push_back('{');
+        m_expect = EXPECT_KEY_OR_END;
+        m_token = TOKEN_OBJECT_BEGIN;
+        return m_token;
+    case '[':
+        ++m_pos;
+        m_stack.push_back('[');
+        m_expect = EXPECT_VALUE_OR_END;
+        m_token = TOKEN_ARRAY_BEGIN;
+        return m_token;
+    case '"':
+        ++m_pos;
+        if(!ReadString(m_decode)) {
+            return Fail();
+        }
+        m_token = TOKEN_STRING;
+        break;
+    case 't':
+        if(!ReadLiteral("true", 4)) {
+            return Fail();
+        }
+        m_token = TOKEN_TRUE;
+        break;
+    case 'f':
+        if(!ReadLiteral("false", 5)) {
+            return Fail();
+        }
+        m_token = TOKEN_FALSE;
+        break;
+    case 'n':
+        if(!ReadLiteral("null", 4)) {
+            return Fail();
+        }
+        m_token = TOKEN_NULL;
+        break;
+    default:
+        if(!ReadNumber()) {
+            return Fail();
+        }
+        m_token = TOKEN_NUMBER;
+        break;
+    }
+
+    m_expect = m_stack.empty() ? EXPECT_EOF : EXPECT_COMMA_OR_END;
+    return m_token;
+}
+
+IOT_JsonPullParser::Token IOT_JsonPullParser::CloseContainer(char close)
+{
+    if(m_stack.empty() || close != (m_stack.back() == '{' ? '}' : ']')) {
+        return Fail();
+    }
+
+    ++m_pos;
+    m_stack.pop_back();
+    m_expect = m_stack.empty() ? EXPECT_EOF : EXPECT_COMMA_OR_END;
+    m_token = (close == '}') ? TOKEN_OBJECT_END : TOKEN_ARRAY_END;
+    return m_token;
+}
+
+bool IOT_JsonPullParser::ReadString(bool decode)
+{
+    if(decode) {
+        m_string.clear();
+    }
+
+    const char* pos = m_pos;
+    for(;;) {
+        // Copy runs of plain characters at once
+        const char* run = pos;
+        pos = IOT_JsonScan::FindQuoteOrEscape(pos, m_end);
+        if(pos == m_end) {
+            return false;
+        }
+        if(decode) {
+            m_string.append(run, pos);
+        }
+
+        if(*pos == '"') {
+            m_pos = pos + 1;
+            return true;
+        }
+
+        ++pos;
+        if(!ReadEscape(pos, decode)) {
+            return false;
+        }
+    }
+}
+
+bool IOT_JsonPullParser::ReadEscape(const char*& pos, bool decode)
+{
+    if(pos == m_end) {
+        return false;
+    }
+
+    char c = *pos++;
+    switch(c) {
+    case '"':
+    case '\\':
+    case '/':
+        break;
+    case 'b':
+        c = '\b';
+        break;
+    case 'f':
+        c = '\f';
+        break;
+    case 'n':
+        c = '\n';
+        break;
+    case 'r':
+        c = '\r';
+        break;
+    case 't':
+        c = '\t';
+        break;
+    case 'u': {
+        unsigned int cp;
+        if(!ReadHex4(pos, m_end, cp)) {
+            return false;
+        }
+
+        // Characters outside the basic plane are escaped as a surrogate pair
+        if(cp >= 0xD800 && cp <= 0xDBFF) {
+            unsigned int low;
+            if(m_end - pos < 2 || pos[0] != '\\' || pos[1] != 'u') {
+                return false;
+            }
+            pos += 2;
+            if(!ReadHex4(pos, m_end, low) || low < 0xDC00 || low > 0xDFFF) {
+                return false;
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        if(decode) {
+            AppendUtf8(m_string, cp);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    if(decode) {
+        m_string += c;
+    }
+    return true;
+}
+
+bool IOT_JsonPullParser::ReadNumber()
+{
+    const char* pos = m_pos;
+    bool integer = true;
+
+    if(pos != m_end && *pos == '-') {
+        ++pos;
+    }
+
+    if(pos == m_end || !IsDigit(*pos)) {
+        return false;
+    }
+    if(*pos == '0') {
+        ++pos;
+    } else {
+        while(pos != m_end && IsDigit(*pos)) {
+            ++pos;
+        }
+    }
+
+    if(pos != m_end && *pos == '.') {
+        integer = false;
+        ++pos;
+        if(pos == m_end || !IsDigit(*pos)) {
+            return false;
+        }
+        while(pos != m_end && IsDigit(*pos)) {
+            ++pos;
+        }
+    }
+
+    if(pos != m_end && (*pos == 'e' || *pos == 'E')) {
+        integer = false;
+        ++pos;
+        if(pos != m_end && (*pos == '+' || *pos == '-')) {
+            ++pos;
+        }
+        if(pos == m_end || !IsDigit(*pos)) {
+            return false;
+        }
+        while(pos != m_end && IsDigit(*pos)) {
+            ++pos;
+        }
+    }
+
+    m_numberBegin = m_pos;
+    m_numberEnd = pos;
+    m_numberInteger = integer;
+    m_pos = pos;
+    return true;
+}
+
+bool IOT_JsonPullParser::ReadLiteral(const char* literal, size_t length)
+{
+    if(static_cast<size_t>(m_end - m_pos) < length || memcmp(m_pos, literal, length) != 0) {
+        return false;
+    }
+
+    m_pos += length;
+    return true;
+}
+
+void IOT_JsonPullParser::SkipWhitespace()
+{
+    while(m_pos != m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t')) {
+        ++m_pos;
+    }
+}
@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_JSONPULLPARSER_H
+#define IOT_JSONPULLPARSER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//! \brief Pull parser that reads a JSON document one token at a time
+//! \note Unlike Json::Reader no document tree is built. The caller asks for
+//!       the next token and reads the current key or value from the parser,
+//!       so response decoders can fill result objects directly. Syntax
+//!       errors are sticky: after an error Next() always returns TOKEN_ERROR.
+//!       The parsed text must stay valid while the parser is used.
+class IOT_JsonPullParser
+{
+public:
+    typedef enum
+    {
+        TOKEN_ERROR,
+        TOKEN_END,          //!< End of the document
+        TOKEN_OBJECT_BEGIN,
+        TOKEN_OBJECT_END,
+        TOKEN_ARRAY_BEGIN,
+        TOKEN_ARRAY_END,
+        TOKEN_KEY,          //!< Object member name, the value follows
+        TOKEN_STRING,
+        TOKEN_NUMBER,
+        TOKEN_TRUE,
+        TOKEN_FALSE,
+        TOKEN_NULL
+    } Token;
+
+    IOT_JsonPullParser(const char* begin, const char* end);
+    explicit IOT_JsonPullParser(const char* json);
+    explicit IOT_JsonPullParser(const std::string& json);
+
+    //! The parser keeps pointers to the text, so it cannot parse a temporary
+    explicit IOT_JsonPullParser(std::string&& json) = delete;
+
+    //! \brief Read the next token
+    Token Next();
+
+    //! \brief Get the token returned by the last call to Next()
+    Token GetToken() const;
+
+    //! \brief Nesting depth of the current position, 1 inside the top level container
+    size_t GetDepth() const;
+
+    //! \brief Get unescaped text of the current TOKEN_KEY or TOKEN_STRING
+    const std::string& GetString() const;
+
+    //! \brief Check if the current token is TOKEN_KEY with the given name
+    bool IsKey(const char* key) const;
+
+    //! \brief Check if the current TOKEN_NUMBER has no fraction or exponent
+    bool IsInteger() const;
+
+    //! \brief Convert the current TOKEN_NUMBER to an integer
+    //! \return false if the number is not an integer or does not fit the type
+    bool GetInt64(int64_t& value) const;
+    bool GetUInt64(uint64_t& value) const;
+
+    //! \brief Convert the current TOKEN_NUMBER to double
+    bool GetDouble(double& value) const;
+
+    //! \brief Skip the value that starts at the current token
+    //! \note For TOKEN_KEY the member value is skipped. Objects and arrays
+    //!       are skipped with IOT_JsonScan, which only checks that brackets
+    //!       are balanced and strings terminated.
+    //! \return false on syntax error
+    bool SkipValue();
+
+    //! \brief Skip the rest of the document
+    //! \return true if the whole document was valid JSON
+    bool SkipToEnd();
+
+private:
+    typedef enum
+    {
+        EXPECT_VALUE,
+        EXPECT_VALUE_OR_END,
+        EXPECT_KEY_OR_END,
+        EXPECT_COMMA_OR_END,
+        EXPECT_EOF
+    } Expect;
+
+    Token Fail();
+    Token ReadValue();
+    Token CloseContainer(char close);
+    bool ReadString(bool decode);
+    bool ReadEscape(const char*& pos, bool decode);
+    bool ReadNumber();
+    bool ReadLiteral(const char* literal, size_t length);
+    void SkipWhitespace();
+
+    const char* m_pos;
+    const char* m_end;
+    Token m_token;
+    Expect m_expect;
+
+    //! Open containers, '{' or '['
+    std::vector<char> m_stack;
+
+    //! Unescaped key or string value, reused between tokens
+    std::string m_string;
+
+    //! Text of the current number
+    const char* m_numberBegin;
+    const char* m_numberEnd;
+    bool m_numberInteger;
+
+    //! Strings are scanned but not unescaped while skipping
+    bool m_decode;
+};
+
+#endif // IOT_JSONPULLPARSER_H
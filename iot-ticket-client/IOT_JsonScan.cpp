@@ -0,0 +1,488 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_JsonScan.h"
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IOT_SCAN_X86
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IOT_SCAN_NEON
+#endif
+
+namespace {
+
+//! Characters of interest in a block of 64 bytes, one bit per byte
+struct BlockMasks
+{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t open;      //!< '{' or '['
+    uint64_t close;     //!< '}' or ']'
+};
+
+const size_t BLOCK_SIZE = 64;
+
+typedef void (*ClassifyFunc)(const char* block, BlockMasks& masks);
+typedef const char* (*FindFunc)(const char* first, const char* last);
+
+struct Implementation
+{
+    const char* name;
+    ClassifyFunc classify;
+    FindFunc find;
+    FindFunc findEscape;
+};
+
+// Setting bit 5 maps '[' to '{' and ']' to '}' and no other character to them
+const char OPEN_FOLDED = '{';
+const char CLOSE_FOLDED = '}';
+const char CASE_BIT = 0x20;
+
+inline bool IsQuoteOrEscape(char c)
+{
+    return c == '"' || c == '\\';
+}
+
+inline bool NeedsEscape(char c)
+{
+    return IsQuoteOrEscape(c) || static_cast<unsigned char>(c) < 0x20;
+}
+
+const char* FindScalarTail(const char* first, const char* last)
+{
+    while(first != last && !IsQuoteOrEscape(*first)) {
+        ++first;
+    }
+    return first;
+}
+
+const char* FindEscapeScalarTail(const char* first, const char* last)
+{
+    while(first != last && !NeedsEscape(*first)) {
+        ++first;
+    }
+    return first;
+}
+
+void ClassifyScalar(const char* block, BlockMasks& masks)
+{
+    masks.quote = masks.backslash = masks.open = masks.close = 0;
+    for(size_t i = 0; i < BLOCK_SIZE; ++i) {
+        char c = block[i];
+        char folded = c | CASE_BIT;
+        uint64_t bit = 1ULL << i;
+        if(c == '"') {
+            masks.quote |= bit;
+        } else if(c == '\\') {
+            masks.backslash |= bit;
+        } else if(folded == OPEN_FOLDED) {
+            masks.open |= bit;
+        } else if(folded == CLOSE_FOLDED) {
+            masks.close |= bit;
+        }
+    }
+}
+
+const Implementation SCALAR = { "scalar", ClassifyScalar, FindScalarTail, FindEscapeScalarTail };
+
+#if defined(IOT_SCAN_X86) && defined(__SSE2__)
+
+void ClassifySse2(const char* block, BlockMasks& masks)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open = _mm_set1_epi8(OPEN_FOLDED);
+    const __m128i close = _mm_set1_epi8(CLOSE_FOLDED);
+    const __m128i caseBit = _mm_set1_epi8(CASE_BIT);
+
+    masks.quote = masks.backslash = masks.open = masks.close = 0;
+    for(int i = 0; i < 4; ++i) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        __m128i folded = _mm_or_si128(chunk, caseBit);
+        int shift = 16 * i;
+        masks.quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)))) << shift;
+        masks.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)))) << shift;
+        masks.open |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(folded, open)))) << shift;
+        masks.close |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(folded, close)))) << shift;
+    }
+}
+
+const char* FindSse2(const char* first, const char* last)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    while(last - first >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if(mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 16;
+    }
+    return FindScalarTail(first, last);
+}
+
+const char* FindEscapeSse2(const char* first, const char* last)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i maxControl = _mm_set1_epi8(0x1F);
+
+    while(last - first >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        // Unsigned chunk <= 0x1F, there is no unsigned byte compare in SSE2
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, maxControl), chunk);
+        __m128i match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), control);
+        int mask = _mm_movemask_epi8(match);
+        if(mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 16;
+    }
+    return FindEscapeScalarTail(first, last);
+}
+
+const Implementation SSE2 = { "sse2", ClassifySse2, FindSse2, FindEscapeSse2 };
+
+#endif
+
+#if defined(IOT_SCAN_X86) && defined(__GNUC__)
+#define IOT_SCAN_AVX2
+
+__attribute__((target("avx2")))
+void ClassifyAvx2(const char* block, BlockMasks& masks)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i open = _mm256_set1_epi8(OPEN_FOLDED);
+    const __m256i close = _mm256_set1_epi8(CLOSE_FOLDED);
+    const __m256i caseBit = _mm256_set1_epi8(CASE_BIT);
+
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    __m256i loFolded = _mm256_or_si256(lo, caseBit);
+    __m256i hiFolded = _mm256_or_si256(hi, caseBit);
+
+#define IOT_SCAN_MASK64(a, b, value) \
+    (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, value))) | \
+     static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, value)))) << 32)
+
+    masks.quote = IOT_SCAN_MASK64(lo, hi, quote);
+    masks.backslash = IOT_SCAN_MASK64(lo, hi, backslash);
+    masks.open = IOT_SCAN_MASK64(loFolded, hiFolded, open);
+    masks.close = IOT_SCAN_MASK64(loFolded, hiFolded, close);
+
+#undef IOT_SCAN_MASK64
+}
+
+__attribute__((target("avx2")))
+const char* FindAvx2(const char* first, const char* last)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    while(last - first >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        if(mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 32;
+    }
+    return FindScalarTail(first, last);
+}
+
+__attribute__((target("avx2")))
+const char* FindEscapeAvx2(const char* first, const char* last)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i maxControl = _mm256_set1_epi8(0x1F);
+
+    while(last - first >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, maxControl), chunk);
+        __m256i match = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)), control);
+        uint32_t mask = _mm256_movemask_epi8(match);
+        if(mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+        first += 32;
+    }
+    return FindEscapeScalarTail(first, last);
+}
+
+const Implementation AVX2 = { "avx2", ClassifyAvx2, FindAvx2, FindEscapeAvx2 };
+
+#endif
+
+#if defined(IOT_SCAN_NEON)
+
+//! Collect the top bit of each byte of four compare results into 64 bits
+inline uint64_t MoveMask64(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d)
+{
+    const uint8x16_t bits = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                              0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(a, bits), vandq_u8(b, bits));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(c, bits), vandq_u8(d, bits));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+void ClassifyNeon(const char* block, BlockMasks& masks)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(block);
+    uint8x16_t chunk[4];
+    uint8x16_t folded[4];
+    for(int i = 0; i < 4; ++i) {
+        chunk[i] = vld1q_u8(p + 16 * i);
+        folded[i] = vorrq_u8(chunk[i], vdupq_n_u8(CASE_BIT));
+    }
+
+#define IOT_SCAN_MASK64(v, c) \
+    MoveMask64(vceqq_u8(v[0], vdupq_n_u8(c)), vceqq_u8(v[1], vdupq_n_u8(c)), \
+               vceqq_u8(v[2], vdupq_n_u8(c)), vceqq_u8(v[3], vdupq_n_u8(c)))
+
+    masks.quote = IOT_SCAN_MASK64(chunk, '"');
+    masks.backslash = IOT_SCAN_MASK64(chunk, '\\');
+    masks.open = IOT_SCAN_MASK64(folded, OPEN_FOLDED);
+    masks.close = IOT_SCAN_MASK64(folded, CLOSE_FOLDED);
+
+#undef IOT_SCAN_MASK64
+}
+
+//! Offset of the first matching byte in a compare result, 16 if none
+inline int FirstMatch(uint8x16_t match)
+{
+    // Narrow each byte to four bits so the 16 results fit 64 bits
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+    return mask != 0 ? __builtin_ctzll(mask) >> 2 : 16;
+}
+
+const char* FindNeon(const char* first, const char* last)
+{
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+
+    while(last - first >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(first));
+        int match = FirstMatch(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)));
+        if(match != 16) {
+            return first + match;
+        }
+        first += 16;
+    }
+    return FindScalarTail(first, last);
+}
+
+const char* FindEscapeNeon(const char* first, const char* last)
+{
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(0x20);
+
+    while(last - first >= 16) {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(first));
+        uint8x16_t match = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)), vcltq_u8(chunk, space));
+        int offset = FirstMatch(match);
+        if(offset != 16) {
+            return first + offset;
+        }
+        first += 16;
+    }
+    return FindEscapeScalarTail(first, last);
+}
+
+const Implementation NEON = { "neon", ClassifyNeon, FindNeon, FindEscapeNeon };
+
+#endif
+
+const Implementation* const IMPLEMENTATIONS[] = {
+#if defined(IOT_SCAN_AVX2)
+    &AVX2,
+#endif
+#if defined(IOT_SCAN_X86) && defined(__SSE2__)
+    &SSE2,
+#endif
+#if defined(IOT_SCAN_NEON)
+    &NEON,
+#endif
+    &SCALAR
+};
+
+bool IsSupported(const Implementation* impl)
+{
+#if defined(IOT_SCAN_AVX2)
+    if(impl == &AVX2) {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    (void)impl;
+    return true;
+}
+
+std::atomic<const Implementation*> s_selected(NULL);
+
+//! Pick the first supported implementation on first use
+const Implementation* Selected()
+{
+    const Implementation* impl = s_selected.load(std::memory_order_relaxed);
+    if(impl == NULL) {
+        for(size_t i = 0; i < sizeof(IMPLEMENTATIONS) / sizeof(IMPLEMENTATIONS[0]); ++i) {
+            if(IsSupported(IMPLEMENTATIONS[i])) {
+                impl = IMPLEMENTATIONS[i];
+                break;
+            }
+        }
+        s_selected.store(impl, std::memory_order_relaxed);
+    }
+    return impl;
+}
+
+//! Mark the characters that follow an odd number of backslashes
+//! \note Same approach as in simdjson. Runs of backslashes that start on an
+//!       odd position are found with a carrying addition, prevEscaped carries
+//!       an escape over to the next block.
+inline uint64_t FindEscaped(uint64_t backslash, uint64_t& prevEscaped)
+{
+    backslash &= ~prevEscaped;
+    uint64_t followsEscape = (backslash << 1) | prevEscaped;
+
+    const uint64_t EVEN_BITS = 0x5555555555555555ULL;
+    uint64_t oddStarts = backslash & ~EVEN_BITS & ~followsEscape;
+    uint64_t evenStarts = oddStarts + backslash;
+    prevEscaped = evenStarts < oddStarts ? 1 : 0;
+
+    uint64_t invert = evenStarts << 1;
+    return (EVEN_BITS ^ invert) & followsEscape;
+}
+
+//! Each bit becomes the XOR of itself and all lower bits
+inline uint64_t PrefixXor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+} // namespace
+
+
+const char* IOT_JsonScan::FindQuoteOrEscape(const char* first, const char* last)
+{
+    return Selected()->find(first, last);
+}
+
+const char* IOT_JsonScan::FindEscapeNeeded(const char* first, const char* last)
+{
+    return Selected()->findEscape(first, last);
+}
+
+const char* IOT_JsonScan::SkipContainer(const char* first, const char* last)
+{
+    ClassifyFunc classify = Selected()->classify;
+
+    uint64_t prevEscaped = 0;
+    uint64_t inString = 0;
+    int64_t depth = 1;
+
+    size_t length = last - first;
+    char tail[BLOCK_SIZE];
+    for(size_t offset = 0; offset < length; offset += BLOCK_SIZE) {
+        const char* block = first + offset;
+        BlockMasks masks;
+        if(length - offset >= BLOCK_SIZE) {
+            classify(block, masks);
+        } else {
+            // Pad the last partial block with whitespace
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, block, length - offset);
+            classify(tail, masks);
+        }
+
+        uint64_t escaped = FindEscaped(masks.backslash, prevEscaped);
+        uint64_t quotes = masks.quote & ~escaped;
+
+        // Bits inside strings, including the opening quote
+        uint64_t stringMask = PrefixXor(quotes) ^ inString;
+        inString = static_cast<uint64_t>(static_cast<int64_t>(stringMask) >> 63);
+
+        uint64_t open = masks.open & ~stringMask;
+        uint64_t close = masks.close & ~stringMask;
+
+        int closeCount = __builtin_popcountll(close);
+        if(closeCount < depth) {
+            // The container can not end within this block
+            depth += __builtin_popcountll(open) - closeCount;
+            continue;
+        }
+
+        uint64_t brackets = open | close;
+        while(brackets != 0) {
+            uint64_t bit = brackets & (0 - brackets);
+            if(open & bit) {
+                ++depth;
+            } else if(--depth == 0) {
+                return block + __builtin_ctzll(bit) + 1;
+            }
+            brackets ^= bit;
+        }
+    }
+
+    return NULL;
+}
+
+const char* IOT_JsonScan::GetImplementation()
+{
+    return Selected()->name;
+}
+
+bool IOT_JsonScan::SetImplementation(const char* name)
+{
+    if(name == NULL) {
+        s_selected.store(NULL, std::memory_order_relaxed);
+        return true;
+    }
+
+    for(size_t i = 0; i < sizeof(IMPLEMENTATIONS) / sizeof(IMPLEMENTATIONS[0]); ++i) {
+        if(strcmp(IMPLEMENTATIONS[i]->name, name) == 0) {
+            if(!IsSupported(IMPLEMENTATIONS[i])) {
+                return false;
+            }
+            s_selected.store(IMPLEMENTATIONS[i], std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,62 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_JSONSCAN_H
+#define IOT_JSONSCAN_H
+
+#include <stddef.h>
+
+//! \brief Vectorized scanning of JSON text
+//! \note Bytes are classified 16, 32 or 64 at a time with SSE2, AVX2 or NEON
+//!       into bitmasks of quotes, backslashes and brackets. The fastest
+//!       implementation supported by the CPU is selected at run time, a
+//!       portable scalar version is used elsewhere.
+class IOT_JsonScan
+{
+public:
+    //! \brief Find the first '"' or '\\' in [first, last)
+    //! \return Pointer to the character, or last if there is none
+    static const char* FindQuoteOrEscape(const char* first, const char* last);
+
+    //! \brief Find the first character in [first, last) that must be escaped
+    //!        in a JSON string: '"', '\\' or a control character
+    //! \return Pointer to the character, or last if there is none
+    static const char* FindEscapeNeeded(const char* first, const char* last);
+
+    //! \brief Find the end of an object or array
+    //! \note Only the nesting of brackets outside of strings is followed, the
+    //!       contents are not otherwise validated.
+    //! \param [in] first - Position just after the opening '{' or '['
+    //! \return Position just after the matching closing bracket, or NULL if
+    //!         the text ends before it
+    static const char* SkipContainer(const char* first, const char* last);
+
+    //! \brief Name of the implementation in use: "avx2", "sse2", "neon" or "scalar"
+    static const char* GetImplementation();
+
+    //! \brief Select implementation by name, mostly for testing and benchmarks
+    //! \param [in] name - Implementation name, NULL selects the fastest one again
+    //! \return false if the CPU does not support it
+    static bool SetImplementation(const char* name);
+};
+
+#endif // IOT_JSONSCAN_H
@@ -0,0 +1,64 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef IOT_KEEPALIVE_H
+#define IOT_KEEPALIVE_H
+
+#include <stdint.h>
+
+//! \brief Policy for keeping idle connections usable between sparse requests
+//! \note Default values keep the libcurl defaults: no TCP keepalive, idle
+//!       connections reused for up to 118 seconds and host names cached for
+//!       60 seconds. A device sending less often than that pays name lookup,
+//!       TCP connect and TLS handshake on each send.
+struct IOT_KeepAlive
+{
+    IOT_KeepAlive()
+    {
+        tcpKeepAlive = false;
+        probeIdleS = 60;
+        probeIntervalS = 60;
+        maxIdleS = 0;
+        dnsCacheS = 0;
+    }
+
+    //! Send TCP keepalive probes on idle connections, which keeps NAT and
+    //! firewall state alive and detects dead connections
+    bool tcpKeepAlive;
+
+    //! Idle time before the first keepalive probe in seconds
+    uint32_t probeIdleS;
+
+    //! Interval of keepalive probes in seconds
+    uint32_t probeIntervalS;
+
+    //! Max time a connection may be idle and still be reused in seconds,
+    //! 0 for the libcurl default
+    uint32_t maxIdleS;
+
+    //! How long resolved host names are cached in seconds, 0 for the libcurl
+    //! default. Only lookups for new connections use the cache.
+    uint32_t dnsCacheS;
+};
+
+#endif // IOT_KEEPALIVE_H
@@ -0,0 +1,474 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_Metrics.h"
+#include "IOT_Histogram.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace IOTAPI;
+
+//! Label values for IOTAPI_err codes, indexed by the error code
+static const char* ERROR_NAMES[IOTAPI_ERR_COUNT] = {
+    "ok", "register_fail", "again", "param", "initialized", "auth", "access",
+    "quota", "server", "write_failed", "conn", "ssl", "curl_call", "general", "throttled",
+    "timeout"
+};
+
+//! Label values for IOT_Endpoint, indexed by the endpoint
+static const char* ENDPOINT_NAMES[IOT_EP_COUNT] = {
+    "devices", "datanodes", "write", "read", "quota"
+};
+
+//! Bucket bounds for number of samples in a write batch
+static const double BATCH_SIZE_BOUNDS[] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000
+};
+
+//! Poll interval of the socket exporter to notice stop requests
+static const int EXPORTER_POLL_MS = 200;
+
+//! Time to wait for a HTTP request line from a socket client
+static const int EXPORTER_REQUEST_WAIT_MS = 50;
+
+
+IOT_Metrics::Counter::Counter()
+{
+    for(size_t i = 0; i < SHARDS; ++i) {
+        m_shards[i].value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void IOT_Metrics::Counter::Add(uint64_t value)
+{
+    m_shards[GetShard()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t IOT_Metrics::Counter::Get() const
+{
+    uint64_t sum = 0;
+    for(size_t i = 0; i < SHARDS; ++i) {
+        sum += m_shards[i].value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+
+IOT_Metrics::Gauge::Gauge(): m_value(0)
+{
+}
+
+void IOT_Metrics::Gauge::Set(int64_t value)
+{
+    m_value.store(value, std::memory_order_relaxed);
+}
+
+void IOT_Metrics::Gauge::Add(int64_t value)
+{
+    m_value.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t IOT_Metrics::Gauge::Get() const
+{
+    return m_value.load(std::memory_order_relaxed);
+}
+
+
+IOT_Metrics::Histogram::Histogram()
+{
+    double bounds[IOT_Histogram::BUCKETS - 1];
+    for(size_t i = 0; i < IOT_Histogram::BUCKETS - 1; ++i) {
+        bounds[i] = IOT_Histogram::GetBucketBound(i) / 1000.0;
+    }
+
+    Init(bounds, IOT_Histogram::BUCKETS - 1);
+}
+
+IOT_Metrics::Histogram::Histogram(const double* bounds, size_t count)
+{
+    Init(bounds, count);
+}
+
+void IOT_Metrics::Histogram::Init(const double* bounds, size_t count)
+{
+    m_boundCount = (count < MAX_BUCKETS) ? count : (MAX_BUCKETS - 1);
+    for(size_t i = 0; i < m_boundCount; ++i) {
+        m_bounds[i] = bounds[i];
+    }
+
+    for(size_t s = 0; s < SHARDS; ++s) {
+        for(size_t i = 0; i < MAX_BUCKETS; ++i) {
+            m_shards[s].buckets[i].store(0, std::memory_order_relaxed);
+        }
+        m_shards[s].count.store(0, std::memory_order_relaxed);
+        m_shards[s].sumMicro.store(0, std::memory_order_relaxed);
+    }
+}
+
+void IOT_Metrics::Histogram::Record(double value)
+{
+    size_t bucket = 0;
+    while(bucket < m_boundCount && value > m_bounds[bucket]) {
+        ++bucket;
+    }
+
+    Shard& shard = m_shards[GetShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+
+    if(value > 0.0) {
+        shard.sumMicro.fetch_add(static_cast<uint64_t>(llround(value * 1000000.0)), std::memory_order_relaxed);
+    }
+}
+
+size_t IOT_Metrics::Histogram::GetBounds() const
+{
+    return m_boundCount;
+}
+
+double IOT_Metrics::Histogram::GetBound(size_t bucket) const
+{
+    return (bucket < m_boundCount) ? m_bounds[bucket] : -1.0;
+}
+
+uint64_t IOT_Metrics::Histogram::GetBucketCount(size_t bucket) const
+{
+    if(bucket > m_boundCount) {
+        return 0;
+    }
+
+    uint64_t sum = 0;
+    for(size_t s = 0; s < SHARDS; ++s) {
+        sum += m_shards[s].buckets[bucket].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t IOT_Metrics::Histogram::GetCount() const
+{
+    uint64_t sum = 0;
+    for(size_t s = 0; s < SHARDS; ++s) {
+        sum += m_shards[s].count.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+double IOT_Metrics::Histogram::GetSum() const
+{
+    uint64_t sum = 0;
+    for(size_t s = 0; s < SHARDS; ++s) {
+        sum += m_shards[s].sumMicro.load(std::memory_order_relaxed);
+    }
+    return static_cast<double>(sum) / 1000000.0;
+}
+
+
+IOT_Metrics& IOT_Metrics::Instance()
+{
+    static IOT_Metrics metrics;
+    return metrics;
+}
+
+size_t IOT_Metrics::GetShard()
+{
+    static std::atomic<size_t> nextShard(0);
+    static thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+}
+
+IOT_Metrics::IOT_Metrics():
+    batchSize(BATCH_SIZE_BOUNDS, sizeof(BATCH_SIZE_BOUNDS) / sizeof(BATCH_SIZE_BOUNDS[0])),
+    m_exporterStop(false)
+{
+}
+
+IOT_Metrics::~IOT_Metrics()
+{
+    StopSocketExporter();
+}
+
+void IOT_Metrics::RecordRequest(IOTAPI::IOT_Endpoint endpoint, IOTAPI::IOTAPI_err ret, const IOT_RequestTiming& timing)
+{
+    if(endpoint < 0 || endpoint >= IOT_EP_COUNT || ret < 0 || static_cast<uint32_t>(ret) >= IOTAPI_ERR_COUNT) {
+        return;
+    }
+
+    requests[endpoint][ret].Add();
+    requestDuration[endpoint].Record(timing.totalMs / 1000.0);
+    bytesSent.Add(timing.bytesUp);
+    bytesReceived.Add(timing.bytesDown);
+}
+
+void IOT_Metrics::RecordWriteBatch(size_t samples, size_t accepted)
+{
+    batchSize.Record(static_cast<double>(samples));
+    samplesSent.Add(accepted);
+
+    if(samples > accepted) {
+        samplesRejected.Add(samples - accepted);
+    }
+}
+
+//! Append metric metadata lines
+static void AppendHeader(std::string& text, const char* name, const char* type, const char* help)
+{
+    text += "# HELP ";
+    text += name;
+    text += " ";
+    text += help;
+    text += "\n# TYPE ";
+    text += name;
+    text += " ";
+    text += type;
+    text += "\n";
+}
+
+//! Append single sample line. Labels are given without braces, e.g. a="b"
+static void AppendSample(std::string& text, const char* name, const std::string& labels, double value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.17g", value);
+
+    text += name;
+    if(!labels.empty()) {
+        text += "{" + labels + "}";
+    }
+    text += " ";
+    text += buf;
+    text += "\n";
+}
+
+//! Append histogram series (cumulative buckets, sum and count)
+static void AppendHistogram(std::string& text, const char* name, const std::string& labels,
+                            const IOT_Metrics::Histogram& hist)
+{
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    std::string bucketName = std::string(name) + "_bucket";
+    uint64_t cumulative = 0;
+    char le[32];
+
+    for(size_t i = 0; i < hist.GetBounds(); ++i) {
+        cumulative += hist.GetBucketCount(i);
+        snprintf(le, sizeof(le), "%g", hist.GetBound(i));
+        AppendSample(text, bucketName.c_str(), prefix + "le=\"" + le + "\"", static_cast<double>(cumulative));
+    }
+
+    cumulative += hist.GetBucketCount(hist.GetBounds());
+    AppendSample(text, bucketName.c_str(), prefix + "le=\"+Inf\"", static_cast<double>(cumulative));
+    AppendSample(text, (std::string(name) + "_sum").c_str(), labels, hist.GetSum());
+    AppendSample(text, (std::string(name) + "_count").c_str(), labels, static_cast<double>(hist.GetCount()));
+}
+
+void IOT_Metrics::ToPrometheus(std::string& text) const
+{
+    text.clear();
+
+    AppendHeader(text, "iot_samples_enqueued_total", "counter", "Samples added to upload queues.");
+    AppendSample(text, "iot_samples_enqueued_total", "", static_cast<double>(samplesEnqueued.Get()));
+
+    AppendHeader(text, "iot_samples_dropped_total", "counter", "Samples dropped from upload queues.");
+    AppendSample(text, "iot_samples_dropped_total", "", static_cast<double>(samplesDropped.Get()));
+
+    AppendHeader(text, "iot_queue_depth", "gauge", "Samples waiting in upload queues.");
+    AppendSample(text, "iot_queue_depth", "", static_cast<double>(queueDepth.Get()));
+
+    AppendHeader(text, "iot_samples_sent_total", "counter", "Samples accepted by the server.");
+    AppendSample(text, "iot_samples_sent_total", "", static_cast<double>(samplesSent.Get()));
+
+    AppendHeader(text, "iot_samples_rejected_total", "counter", "Samples sent but not accepted by the server.");
+    AppendSample(text, "iot_samples_rejected_total", "", static_cast<double>(samplesRejected.Get()));
+
+    AppendHeader(text, "iot_bytes_sent_total", "counter", "Payload bytes sent to the server.");
+    AppendSample(text, "iot_bytes_sent_total", "", static_cast<double>(bytesSent.Get()));
+
+    AppendHeader(text, "iot_bytes_received_total", "counter", "Payload bytes received from the server.");
+    AppendSample(text, "iot_bytes_received_total", "", static_cast<double>(bytesReceived.Get()));
+
+    AppendHeader(text, "iot_requests_total", "counter", "Requests by endpoint and result code.");
+    for(int ep = 0; ep < IOT_EP_COUNT; ++ep) {
+        for(uint32_t err = 0; err < IOTAPI_ERR_COUNT; ++err) {
+            uint64_t count = requests[ep][err].Get();
+            if(count == 0) {
+                continue;
+            }
+
+            std::string labels = std::string("endpoint=\"") + ENDPOINT_NAMES[ep] +
+                    "\",result=\"" + ERROR_NAMES[err] + "\"";
+            AppendSample(text, "iot_requests_total", labels, static_cast<double>(count));
+        }
+    }
+
+    AppendHeader(text, "iot_request_duration_seconds", "histogram", "Request latency by endpoint.");
+    for(int ep = 0; ep < IOT_EP_COUNT; ++ep) {
+        AppendHistogram(text, "iot_request_duration_seconds",
+                        std::string("endpoint=\"") + ENDPOINT_NAMES[ep] + "\"", requestDuration[ep]);
+    }
+
+    AppendHeader(text, "iot_write_batch_samples", "histogram", "Number of samples per write request.");
+    AppendHistogram(text, "iot_write_batch_samples", "", batchSize);
+
+    AppendHeader(text, "iot_requests_throttled_total", "counter", "Requests held back by the rate limiter.");
+    AppendSample(text, "iot_requests_throttled_total", "", static_cast<double>(requestsThrottled.Get()));
+
+    AppendHeader(text, "iot_throttle_wait_seconds_total", "counter", "Time requests waited for the rate limiter.");
+    AppendSample(text, "iot_throttle_wait_seconds_total", "", static_cast<double>(throttleWaitMicros.Get()) / 1000000.0);
+
+    AppendHeader(text, "iot_throttle_pause_seconds_total", "counter", "Time lanes were paused after 429 and 503 replies.");
+    AppendSample(text, "iot_throttle_pause_seconds_total", "", static_cast<double>(throttlePauseMicros.Get()) / 1000000.0);
+}
+
+IOTAPI::IOTAPI_err IOT_Metrics::ExportToFile(const std::string& path) const
+{
+    if(path.empty()) {
+        return IOT_ERR_PARAM;
+    }
+
+    std::string text;
+    ToPrometheus(text);
+
+    std::string tmpPath = path + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "w");
+    if(file == NULL) {
+        return IOT_ERR_PARAM;
+    }
+
+    bool written = (fwrite(text.data(), 1, text.size(), file) == text.size());
+    written = (fclose(file) == 0) && written;
+
+    if(!written || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return IOT_ERR_GENERAL;
+    }
+
+    return IOT_ERR_OK;
+}
+
+IOTAPI::IOTAPI_err IOT_Metrics::StartSocketExporter(const std::string& path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+
+    if(path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        return IOT_ERR_PARAM;
+    }
+
+    std::lock_guard<std::mutex> lock(m_exporterLock);
+    if(m_exporter.joinable()) {
+        return IOT_ERR_INITIALIZED;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        return IOT_ERR_GENERAL;
+    }
+
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+        close(fd);
+        return IOT_ERR_PARAM;
+    }
+
+    m_socketPath = path;
+    m_exporterStop = false;
+    m_exporter = std::thread(&IOT_Metrics::SocketExporterThread, this, fd);
+    return IOT_ERR_OK;
+}
+
+void IOT_Metrics::StopSocketExporter()
+{
+    std::lock_guard<std::mutex> lock(m_exporterLock);
+    if(!m_exporter.joinable()) {
+        return;
+    }
+
+    m_exporterStop = true;
+    m_exporter.join();
+    unlink(m_socketPath.c_str());
+    m_socketPath.clear();
+}
+
+void IOT_Metrics::SocketExporterThread(int listenFd)
+{
+    while(!m_exporterStop) {
+        struct pollfd pfd;
+        pfd.fd = listenFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if(poll(&pfd, 1, EXPORTER_POLL_MS) <= 0) {
+            continue;
+        }
+
+        int client = accept(listenFd, NULL, NULL);
+        if(client < 0) {
+            continue;
+        }
+
+        // Clients speaking HTTP (e.g. curl --unix-socket) get a HTTP response,
+        // others receive the plain text
+        bool http = false;
+        pfd.fd = client;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd, 1, EXPORTER_REQUEST_WAIT_MS) > 0) {
+            char request[512];
+            ssize_t len = recv(client, request, sizeof(request), 0);
+            http = (len >= 4 && memcmp(request, "GET ", 4) == 0);
+        }
+
+        std::string text;
+        ToPrometheus(text);
+
+        if(http) {
+            char header[128];
+            snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                     "Content-Length: %lu\r\n\r\n", static_cast<unsigned long>(text.size()));
+            text.insert(0, header);
+        }
+
+        size_t sent = 0;
+        while(sent < text.size()) {
+            ssize_t ret = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if(ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if(ret <= 0) {
+                break;
+            }
+            sent += ret;
+        }
+
+        close(client);
+    }
+
+    close(listenFd);
+}
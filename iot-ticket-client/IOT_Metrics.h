@@ -0,0 +1,184 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_METRICS_H
+#define IOT_METRICS_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include "IOT_defines.h"
+#include "IOT_RequestTiming.h"
+
+//! \brief Process wide counters and histograms of the IoT-Ticket client
+//! \note Counters and histograms are sharded per thread so updates from the
+//!       hot path do not contend on the same cache line. Reading the values
+//!       sums the shards and is meant for (infrequent) export only.
+class IOT_Metrics
+{
+public:
+    //! Number of shards used by counters and histograms
+    static const size_t SHARDS = 16;
+
+    //! Max number of buckets in a histogram (including overflow)
+    static const size_t MAX_BUCKETS = 16;
+
+    //! \brief Monotonic counter
+    class Counter
+    {
+    public:
+        Counter();
+        void Add(uint64_t value = 1);
+        uint64_t Get() const;
+
+    private:
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> value;
+        };
+        Shard m_shards[SHARDS];
+    };
+
+    //! \brief Value that can go up and down
+    class Gauge
+    {
+    public:
+        Gauge();
+        void Set(int64_t value);
+        void Add(int64_t value);
+        int64_t Get() const;
+
+    private:
+        std::atomic<int64_t> m_value;
+    };
+
+    //! \brief Histogram with fixed bucket upper bounds
+    class Histogram
+    {
+    public:
+        //! \brief Histogram with request latency buckets from 1 ms to 20 s (in seconds)
+        Histogram();
+
+        //! \param [in] bounds - Ascending bucket upper bounds (at most MAX_BUCKETS-1)
+        //! \param [in] count  - Number of bounds
+        Histogram(const double* bounds, size_t count);
+        void Record(double value);
+
+        size_t GetBounds() const;
+        double GetBound(size_t bucket) const;
+
+        //! Number of observations in bucket (not cumulative), bucket GetBounds() is overflow
+        uint64_t GetBucketCount(size_t bucket) const;
+        uint64_t GetCount() const;
+        double GetSum() const;
+
+    private:
+        void Init(const double* bounds, size_t count);
+
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> buckets[MAX_BUCKETS];
+            std::atomic<uint64_t> count;
+            //! Sum of observations in millionths
+            std::atomic<uint64_t> sumMicro;
+        };
+
+        double m_bounds[MAX_BUCKETS];
+        size_t m_boundCount;
+        Shard m_shards[SHARDS];
+    };
+
+    //! \brief Metrics instance shared by all IOT_API objects in the process
+    static IOT_Metrics& Instance();
+
+    //! \brief Shard used by the calling thread [0...SHARDS-1]
+    //! \note Threads are assigned round robin on their first call.
+    static size_t GetShard();
+
+    IOT_Metrics();
+    ~IOT_Metrics();
+
+    //! \brief Record completed request
+    //! \param [in] endpoint - Endpoint the request was made to
+    //! \param [in] ret      - Result of the request
+    //! \param [in] timing   - Timing information of the request
+    void RecordRequest(IOTAPI::IOT_Endpoint endpoint, IOTAPI::IOTAPI_err ret, const IOT_RequestTiming& timing);
+
+    //! \brief Record write batch that was passed to the server
+    //! \param [in] samples  - Number of samples in the batch
+    //! \param [in] accepted - Number of samples the server accepted
+    void RecordWriteBatch(size_t samples, size_t accepted);
+
+    //! \brief Format all metrics in Prometheus text exposition format
+    //! \param [out] text - Formatted metrics
+    void ToPrometheus(std::string& text) const;
+
+    //! \brief Write metrics to a file in Prometheus text format
+    //! \note The file is written to a temporary file first and renamed over
+    //!       the target, so a scraper never sees partial content.
+    //! \param [in] path - Target file (e.g. node exporter textfile collector directory)
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err ExportToFile(const std::string& path) const;
+
+    //! \brief Serve metrics from a Unix domain socket
+    //! \note Every client connecting to the socket receives the metrics in Prometheus
+    //!       text format after which the connection is closed. A background thread
+    //!       serves the socket until StopSocketExporter() is called.
+    //! \param [in] path - Filesystem path of the socket. Existing socket file is replaced.
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err StartSocketExporter(const std::string& path);
+
+    //! \brief Stop serving metrics from Unix domain socket
+    void StopSocketExporter();
+
+    Counter samplesEnqueued;
+    Counter samplesDropped;
+    Gauge queueDepth;
+    Counter samplesSent;
+    Counter samplesRejected;
+    Counter bytesSent;
+    Counter bytesReceived;
+    Counter requests[IOTAPI::IOT_EP_COUNT][IOTAPI::IOTAPI_ERR_COUNT];
+    Histogram requestDuration[IOTAPI::IOT_EP_COUNT];
+    Histogram batchSize;
+    Counter requestsThrottled;
+    Counter throttleWaitMicros;
+    Counter throttlePauseMicros;
+
+private:
+    IOT_Metrics(const IOT_Metrics&);
+    IOT_Metrics& operator=(const IOT_Metrics&);
+
+    //! Accept loop of the Unix socket exporter
+    void SocketExporterThread(int listenFd);
+
+    std::mutex m_exporterLock;
+    std::thread m_exporter;
+    std::atomic<bool> m_exporterStop;
+    std::string m_socketPath;
+};
+
+#endif // IOT_METRICS_H
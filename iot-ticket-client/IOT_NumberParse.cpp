@@ -0,0 +1,229 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_NumberParse.h"
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#define IOT_HAVE_STRTOD_L
+#endif
+
+namespace {
+
+//! Powers of ten that are exact doubles
+const double EXACT_POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const int MAX_EXACT_POW10 = 22;
+
+//! Integers up to 2^53 are exact doubles
+const uint64_t MAX_EXACT_INT = 1ULL << 53;
+
+//! Significant digits that always fit uint64_t
+const int MAX_MANTISSA_DIGITS = 19;
+
+inline bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+//! Precise conversion for the cases the fast path can not handle
+double SlowParse(const char* first, const char* last)
+{
+    char local[64];
+    std::string heap;
+    const char* str = local;
+
+    size_t length = last - first;
+    if(length < sizeof(local)) {
+        memcpy(local, first, length);
+        local[length] = '\0';
+    } else {
+        heap.assign(first, last);
+        str = heap.c_str();
+    }
+
+#if defined(IOT_HAVE_STRTOD_L)
+    static locale_t cLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+    return strtod_l(str, NULL, cLocale);
+#else
+    return strtod(str, NULL);
+#endif
+}
+
+} // namespace
+
+const char* IOT_NumberParse::ParseUInt64(const char* first, const char* last, uint64_t& value)
+{
+    const char* p = first;
+    if(p != last && *p == '+') {
+        ++p;
+    }
+    if(p == last || !IsDigit(*p)) {
+        return NULL;
+    }
+
+    uint64_t result = 0;
+    while(p != last && IsDigit(*p)) {
+        uint64_t digit = *p - '0';
+        if(result > (UINT64_MAX - digit) / 10) {
+            return NULL;
+        }
+        result = result * 10 + digit;
+        ++p;
+    }
+
+    value = result;
+    return p;
+}
+
+const char* IOT_NumberParse::ParseInt64(const char* first, const char* last, int64_t& value)
+{
+    bool negative = (first != last && *first == '-');
+    uint64_t magnitude;
+    const char* end = ParseUInt64(negative ? first + 1 : first, last, magnitude);
+    if(end == NULL || (negative && first + 1 != last && first[1] == '+')) {
+        return NULL;
+    }
+
+    const uint64_t limit = negative ? (1ULL << 63) : (1ULL << 63) - 1;
+    if(magnitude > limit) {
+        return NULL;
+    }
+
+    value = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+    return end;
+}
+
+const char* IOT_NumberParse::ParseDouble(const char* first, const char* last, double& value)
+{
+    const char* p = first;
+    bool negative = false;
+    if(p != last && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool truncated = false;
+    bool anyDigits = false;
+
+    for(; p != last && IsDigit(*p); ++p) {
+        anyDigits = true;
+        if(digits < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += (mantissa != 0);
+        } else {
+            truncated |= (*p != '0');
+            exp10++;
+        }
+    }
+
+    if(p != last && *p == '.') {
+        ++p;
+        for(; p != last && IsDigit(*p); ++p) {
+            anyDigits = true;
+            if(digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += (mantissa != 0);
+                exp10--;
+            } else {
+                truncated |= (*p != '0');
+            }
+        }
+    }
+
+    if(!anyDigits) {
+        return NULL;
+    }
+
+    if(p != last && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool expNegative = false;
+        if(q != last && (*q == '-' || *q == '+')) {
+            expNegative = (*q == '-');
+            ++q;
+        }
+
+        // Exponent without digits is not part of the number
+        if(q != last && IsDigit(*q)) {
+            int exponent = 0;
+            for(; q != last && IsDigit(*q); ++q) {
+                if(exponent < 100000) {
+                    exponent = exponent * 10 + (*q - '0');
+                }
+            }
+            exp10 += expNegative ? -exponent : exponent;
+            p = q;
+        }
+    }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if(mantissa == 0 && !truncated) {
+        value = negative ? -0.0 : 0.0;
+        return p;
+    }
+
+    if(!truncated && mantissa <= MAX_EXACT_INT) {
+        // Both operands are exact, so the single rounding gives the correct result
+        double result = static_cast<double>(mantissa);
+        bool exact = true;
+
+        if(exp10 < 0 && exp10 >= -MAX_EXACT_POW10) {
+            result /= EXACT_POW10[-exp10];
+        } else if(exp10 >= 0 && exp10 <= MAX_EXACT_POW10) {
+            result *= EXACT_POW10[exp10];
+        } else if(exp10 > MAX_EXACT_POW10 && exp10 <= MAX_EXACT_POW10 + 15) {
+            // Move part of the exponent to the mantissa while it stays exact
+            uint64_t shifted = mantissa;
+            int moved = 0;
+            while(moved < exp10 - MAX_EXACT_POW10 && shifted <= MAX_EXACT_INT / 10) {
+                shifted *= 10;
+                moved++;
+            }
+            exact = (moved == exp10 - MAX_EXACT_POW10);
+            result = static_cast<double>(shifted) * EXACT_POW10[MAX_EXACT_POW10];
+        } else {
+            exact = false;
+        }
+
+        if(exact) {
+            value = negative ? -result : result;
+            return p;
+        }
+    }
+#endif
+
+    value = SlowParse(first, p);
+    return p;
+}
@@ -0,0 +1,49 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_NUMBERPARSE_H
+#define IOT_NUMBERPARSE_H
+
+#include <stdint.h>
+
+//! \brief Fast locale independent parsing of integers and doubles
+//! \note Functions parse the longest number at the start of [first, last) like
+//!       std::from_chars, and return a pointer to the first character not
+//!       parsed, or NULL if there is no number or it does not fit the type.
+//!       Doubles are exact: decimal values with up to 19 significant digits
+//!       and a small exponent are converted with a single floating point
+//!       operation (Clinger's fast path), other values fall back to strtod in
+//!       the C locale.
+class IOT_NumberParse
+{
+public:
+    //! \brief Parse signed decimal integer with optional sign
+    static const char* ParseInt64(const char* first, const char* last, int64_t& value);
+
+    //! \brief Parse unsigned decimal integer with optional '+' sign
+    static const char* ParseUInt64(const char* first, const char* last, uint64_t& value);
+
+    //! \brief Parse decimal floating point number, e.g. "-12.5e3"
+    static const char* ParseDouble(const char* first, const char* last, double& value);
+};
+
+#endif // IOT_NUMBERPARSE_H
@@ -0,0 +1,127 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_PreparedWriter.h"
+#include <chrono>
+
+using namespace IOTAPI;
+
+IOT_PreparedWriter::IOT_PreparedWriter(const IOT_API& api, const std::string& devId):
+    m_api(api), m_devId(devId), m_status(IOT_ERR_PARAM)
+{
+    if(!m_devId.empty()) {
+        m_api.m_clients.Configure(m_client);
+        m_status = m_client.PreparePost(m_api.WriteUrl(m_devId), m_api.m_authName, m_api.m_password);
+    }
+}
+
+IOTAPI_err IOT_PreparedWriter::GetStatus() const
+{
+    return m_status;
+}
+
+const std::string& IOT_PreparedWriter::GetDeviceId() const
+{
+    return m_devId;
+}
+
+IOTAPI_err IOT_PreparedWriter::Send(const std::vector<IOT_WriteData>& data)
+{
+    return Send(data, m_result);
+}
+
+IOTAPI_err IOT_PreparedWriter::Send(const IOT_WriteData& data)
+{
+    // Assigning over the previous sample reuses its buffers
+    m_single.resize(1);
+    m_single[0] = data;
+    return Send(m_single, m_result);
+}
+
+IOTAPI_err IOT_PreparedWriter::Send(const std::vector<IOT_WriteData>& data, IOT_WriteResult& result)
+{
+    result.Clear();
+    result.m_submitted = data.size();
+    result.m_status = IOT_ERR_PARAM;
+
+    if(data.empty()) {
+        return IOT_ERR_PARAM;
+    }
+
+    if(m_status != IOT_ERR_OK) {
+        result.m_status = m_status;
+        return m_status;
+    }
+
+    if(data.size() > m_api.m_chunkMaxSamples) {
+        return m_api.SendData(m_devId, data, result);
+    }
+
+    m_chunks.resize(1);
+    std::string& payload = m_chunks[0].payload;
+    payload.clear();
+    payload += '[';
+    IOT_API::PrecisionCursor cursor;
+    for(size_t i = 0; i < data.size(); ++i)
+    {
+        if(i != 0) {
+            payload += ',';
+        }
+        if(!m_api.AppendSample(data[i], cursor, payload)) {
+            return IOT_ERR_PARAM;
+        }
+    }
+    payload += ']';
+
+    // Too large for one request, let the API split it
+    if(data.size() > 1 && payload.size() > m_api.m_chunkMaxBytes) {
+        return m_api.SendData(m_devId, data, result);
+    }
+
+    m_chunks[0].begin = 0;
+    m_chunks[0].end = data.size();
+    result.m_chunks = 1;
+    result.m_acceptedSamples.assign(data.size(), false);
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point throttleDeadline = started + std::chrono::seconds(m_api.m_timeout_s);
+
+    IOTAPI_err ret = IOT_ERR_GENERAL;
+    for(uint32_t attempt = 0; attempt <= m_api.m_writeRetries; ++attempt)
+    {
+        ret = m_api.Throttle(m_devId, throttleDeadline);
+        if(ret != IOT_ERR_OK) {
+            break;
+        }
+
+        IOT_RequestTiming timing;
+        ret = m_client.PostPrepared(payload, m_response, &timing);
+        result.m_payloadBytes += payload.size();
+        ret = m_api.FinishChunk(m_devId, m_chunks[0], ret, m_response, timing, data, result);
+
+        if(!IOT_API::IsRetryableError(ret)) {
+            break;
+        }
+    }
+
+    m_chunkStatus.assign(1, ret);
+    return m_api.FinishWrite(m_chunks, m_chunkStatus, started, result);
+}
@@ -0,0 +1,92 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_PREPAREDWRITER_H
+#define IOT_PREPAREDWRITER_H
+
+#include <string>
+#include <vector>
+#include "IOT_API.h"
+#include "IOT_RestClient.h"
+#include "IOT_WriteResult.h"
+
+//! \brief Process data writer for single device with the request prepared in advance
+//! \note The write URL, authorization header and connection options are set up
+//!       once, and the payload and response buffers are reused, so a send only
+//!       serializes the samples and makes the request. The writer has its own
+//!       connection, configured with the timeout, HTTP version, keepalive policy
+//!       and session file the API instance has when the writer is created.
+//!       Writes that do not fit the chunk limits of the API instance are passed
+//!       to IOT_API::SendData().
+//!       The writer is not thread safe, use one writer per thread.
+class IOT_PreparedWriter
+{
+public:
+    //! \brief Constructor
+    //! \param [in] api   - API instance whose server, credentials and write settings
+    //!                     are used. Must outlive the writer.
+    //! \param [in] devId - Device ID the data is written to
+    IOT_PreparedWriter(const IOT_API& api, const std::string& devId);
+
+    //! \brief Check if the request could be prepared
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err GetStatus() const;
+
+    //! \brief Device ID the writer sends to
+    const std::string& GetDeviceId() const;
+
+    //! \brief Send measurement data, same as IOT_API::SendData()
+    //! \param [in] data - Vector that contains the data to be written
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err Send(const std::vector<IOT_WriteData>& data);
+
+    //! \brief Send measurement data and report details of the write
+    //! \param [in] data    - Vector that contains the data to be written
+    //! \param [out] result - Number of accepted samples, payload size and latency of the write
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err Send(const std::vector<IOT_WriteData>& data, IOT_WriteResult& result);
+
+    //! \brief Send single measurement
+    //! \param [in] data - Data to be written
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err Send(const IOT_WriteData& data);
+
+private:
+    IOT_PreparedWriter(const IOT_PreparedWriter&);
+    IOT_PreparedWriter& operator=(const IOT_PreparedWriter&);
+
+    const IOT_API& m_api;
+    std::string m_devId;
+    IOTAPI::IOTAPI_err m_status;
+
+    //! Connection with the write request prepared
+    IOT_RestClient m_client;
+
+    //! Buffers reused between sends, the single chunk holds the payload of a send
+    std::vector<IOT_API::WriteChunk> m_chunks;
+    std::vector<IOTAPI::IOTAPI_err> m_chunkStatus;
+    std::string m_response;
+    IOT_WriteResult m_result;
+    std::vector<IOT_WriteData> m_single;
+};
+
+#endif // IOT_PREPAREDWRITER_H
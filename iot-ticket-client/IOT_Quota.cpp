@@ -22,6 +22,7 @@
 
 
 #include "IOT_Quota.h"
+#include "IOT_ResponseDecoder.h"
 
 IOT_Quota::IOT_Quota(): m_totalDevices(0), m_maxDevicesAllowed(0), m_maxNodesPerDevice(0),
     m_usedStorage(0), m_maxStorage(0)
@@ -43,27 +44,19 @@ int IOT_Quota::GetMaxNodesPerDevice() const
     return m_maxNodesPerDevice;
 }
 
-int IOT_Quota::GetUsedStorage() const
+unsigned long IOT_Quota::GetUsedStorage() const
 {
     return m_usedStorage;
 }
 
-int IOT_Quota::GetMaxStorage() const
+unsigned long IOT_Quota::GetMaxStorage() const
 {
     return m_maxStorage;
 }
 
 bool IOT_Quota::FromJSON(const std::string& json)
 {
-    Json::Value answer;
-    Json::Reader json_reader;
-
-    if(json_reader.parse(json, answer, false))
-    {
-        return FromJSON(answer);
-    }
-
-    return false;
+    return IOT_ResponseDecoder::DecodeQuota(json, *this) == IOT_ResponseDecoder::DECODE_OK;
 }
 
 bool IOT_Quota::FromJSON(const Json::Value& json)
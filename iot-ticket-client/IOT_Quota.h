@@ -36,13 +36,15 @@ public:
     int GetTotalDevices() const;
     int GetMaxDevicesAllowed() const;
     int GetMaxNodesPerDevice() const;
-    int GetUsedStorage() const;
-    int GetMaxStorage() const;
+    unsigned long GetUsedStorage() const;
+    unsigned long GetMaxStorage() const;
 
     bool FromJSON(const std::string& json);
     bool FromJSON(const Json::Value& json);
 
 private:
+    friend class IOT_ResponseDecoder;
+
     int m_totalDevices;
     int m_maxDevicesAllowed;
     int m_maxNodesPerDevice;
@@ -22,6 +22,7 @@
 
 
 #include "IOT_QuotaDevice.h"
+#include "IOT_ResponseDecoder.h"
 
 
 IOT_QuotaDevice::IOT_QuotaDevice(): m_requestsToday(0), m_maxRequestsPerDay(0),
@@ -56,15 +57,7 @@ std::string IOT_QuotaDevice::GetDeviceId() const
 
 bool IOT_QuotaDevice::FromJSON(const std::string& json)
 {
-    Json::Value answer;
-    Json::Reader json_reader;
-
-    if(json_reader.parse(json, answer, false))
-    {
-        return FromJSON(answer);
-    }
-
-    return false;
+    return IOT_ResponseDecoder::DecodeQuotaDevice(json, *this) == IOT_ResponseDecoder::DECODE_OK;
 }
 
 bool IOT_QuotaDevice::FromJSON(const Json::Value& json)
@@ -43,6 +43,8 @@ public:
     bool FromJSON(const Json::Value& json);
 
 private:
+    friend class IOT_ResponseDecoder;
+
     int m_requestsToday;
     int m_maxRequestsPerDay;
     int m_dataNodes;
@@ -0,0 +1,530 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_QuotaGovernor.h"
+#include <algorithm>
+
+using namespace IOTAPI;
+
+const uint32_t IOT_QuotaGovernor::DEFAULT_REFRESH_MS;
+const uint32_t IOT_QuotaGovernor::MIN_REFRESH_MS;
+
+//! Weight of the newest observation in the moving averages
+static const double EWMA_ALPHA = 0.3;
+
+//! Default usage thresholds in percent of max storage
+static const double DEFAULT_THROTTLE_PERCENT = 80.0;
+static const double DEFAULT_CRITICAL_PERCENT = 95.0;
+
+//! Default downsampling, keep one of this many samples
+static const uint32_t DEFAULT_DOWNSAMPLE = 10;
+
+IOT_QuotaGovernor::IOT_QuotaGovernor(const IOT_API& api) :
+    m_api(api),
+    m_running(false),
+    m_stop(false),
+    m_refreshNow(false),
+    m_refreshMs(DEFAULT_REFRESH_MS),
+    m_throttlePercent(DEFAULT_THROTTLE_PERCENT),
+    m_criticalPercent(DEFAULT_CRITICAL_PERCENT),
+    m_horizonSec(0.0),
+    m_downsample(DEFAULT_DOWNSAMPLE),
+    m_exhausted(false),
+    m_bytesSinceRefresh(0)
+{
+    m_state.level = LEVEL_NORMAL;
+    m_state.quotaKnown = false;
+    m_state.usedStorage = 0;
+    m_state.estimatedStorage = 0;
+    m_state.maxStorage = 0;
+    m_state.samplesSinceRefresh = 0;
+    m_state.bytesPerSample = 0.0;
+    m_state.growthBytesPerSec = 0.0;
+    m_state.secondsToExhaustion = -1.0;
+    m_state.refreshes = 0;
+    m_state.failedRefreshes = 0;
+    m_state.dropped = 0;
+
+    m_refreshTime = clock_t::now();
+    m_lastForcedRefresh = m_refreshTime - std::chrono::milliseconds(MIN_REFRESH_MS);
+}
+
+IOT_QuotaGovernor::~IOT_QuotaGovernor()
+{
+    Stop();
+}
+
+IOTAPI::IOTAPI_err IOT_QuotaGovernor::Start(uint32_t refreshMs)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if(m_running) {
+        return IOT_ERR_INITIALIZED;
+    }
+    if(refreshMs == 0) {
+        return IOT_ERR_PARAM;
+    }
+
+    m_refreshMs = refreshMs;
+    m_stop = false;
+    m_refreshNow = true;
+    m_running = true;
+    m_thread = std::thread(&IOT_QuotaGovernor::RefreshThread, this);
+    return IOT_ERR_OK;
+}
+
+void IOT_QuotaGovernor::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if(!m_running) {
+            return;
+        }
+        m_stop = true;
+    }
+
+    m_cond.notify_all();
+    m_thread.join();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_running = false;
+}
+
+IOTAPI::IOTAPI_err IOT_QuotaGovernor::Refresh()
+{
+    IOT_Quota quota;
+    IOTAPI_err ret = m_api.GetQuota(quota);
+
+    if(ret == IOT_ERR_OK) {
+        OnQuota(quota);
+    }
+
+    std::vector<std::string> devIds;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        for(std::map<std::string, Device>::const_iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+            devIds.push_back(it->first);
+        }
+    }
+
+    for(size_t i = 0; i < devIds.size(); ++i) {
+        IOT_QuotaDevice deviceQuota;
+        IOTAPI_err deviceRet = m_api.GetQuota(devIds[i], deviceQuota);
+
+        if(deviceRet == IOT_ERR_OK) {
+            OnDeviceQuota(devIds[i], deviceQuota);
+        } else if(ret == IOT_ERR_OK) {
+            ret = deviceRet;
+        }
+    }
+
+    if(ret != IOT_ERR_OK) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_state.failedRefreshes++;
+    }
+
+    return ret;
+}
+
+void IOT_QuotaGovernor::OnQuota(const IOT_Quota& quota)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    clock_t::time_point now = clock_t::now();
+    uint64_t used = quota.GetUsedStorage();
+
+    if(m_state.quotaKnown && used > m_state.usedStorage) {
+        // Calibrate storage growth against what was written since the last refresh
+        uint64_t growth = used - m_state.usedStorage;
+        double elapsed = std::chrono::duration<double>(now - m_refreshTime).count();
+
+        if(elapsed > 0.0) {
+            double rate = growth / elapsed;
+            m_state.growthBytesPerSec = (m_state.growthBytesPerSec == 0.0) ? rate :
+                EWMA_ALPHA * rate + (1.0 - EWMA_ALPHA) * m_state.growthBytesPerSec;
+        }
+        if(m_state.samplesSinceRefresh > 0) {
+            double perSample = static_cast<double>(growth) / m_state.samplesSinceRefresh;
+            m_state.bytesPerSample = (m_state.bytesPerSample == 0.0) ? perSample :
+                EWMA_ALPHA * perSample + (1.0 - EWMA_ALPHA) * m_state.bytesPerSample;
+        }
+    }
+
+    m_state.quotaKnown = true;
+    m_state.usedStorage = used;
+    m_state.maxStorage = quota.GetMaxStorage();
+    m_state.samplesSinceRefresh = 0;
+    m_state.refreshes++;
+    m_bytesSinceRefresh = 0;
+    m_refreshTime = now;
+
+    if(m_exhausted && used < m_state.maxStorage) {
+        m_exhausted = false;
+    }
+
+    UpdateLocked();
+}
+
+void IOT_QuotaGovernor::OnDeviceQuota(const std::string& devId, const IOT_QuotaDevice& quota)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    std::map<std::string, Device>::iterator it = m_devices.find(devId);
+    if(it == m_devices.end()) {
+        return;
+    }
+
+    Device& device = it->second;
+    device.state.quotaKnown = true;
+    device.state.usedStorage = quota.GetStorageSize();
+    device.state.dataNodes = quota.GetDataNodesCount();
+    device.state.samplesSinceRefresh = 0;
+    device.bytesSinceRefresh = 0;
+    UpdateDeviceLocked(device);
+}
+
+void IOT_QuotaGovernor::OnWrite(const std::string& devId, size_t samples, size_t bytes, IOTAPI::IOTAPI_err ret)
+{
+    if(ret != IOT_ERR_QUOTA) {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        std::map<std::string, Device>::iterator it = m_devices.find(devId);
+        if(it != m_devices.end()) {
+            it->second.state.samplesSinceRefresh += samples;
+            it->second.bytesSinceRefresh += bytes;
+            UpdateDeviceLocked(it->second);
+        }
+    }
+
+    OnWrite(samples, bytes, ret);
+}
+
+void IOT_QuotaGovernor::AddDevice(const std::string& devId)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if(m_devices.find(devId) != m_devices.end()) {
+        return;
+    }
+
+    Device& device = m_devices[devId];
+    device.state.level = LEVEL_NORMAL;
+    device.state.quotaKnown = false;
+    device.state.usedStorage = 0;
+    device.state.estimatedStorage = 0;
+    device.state.maxStorage = 0;
+    device.state.samplesSinceRefresh = 0;
+    device.state.dataNodes = 0;
+    device.bytesSinceRefresh = 0;
+}
+
+void IOT_QuotaGovernor::SetDeviceBudget(const std::string& devId, uint64_t maxStorage)
+{
+    AddDevice(devId);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    Device& device = m_devices[devId];
+    device.state.maxStorage = maxStorage;
+    UpdateDeviceLocked(device);
+}
+
+void IOT_QuotaGovernor::OnWrite(size_t samples, size_t bytes, IOTAPI::IOTAPI_err ret)
+{
+    bool refresh = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if(ret == IOT_ERR_QUOTA) {
+            m_exhausted = true;
+
+            clock_t::time_point now = clock_t::now();
+            if(m_running && now - m_lastForcedRefresh >= std::chrono::milliseconds(MIN_REFRESH_MS)) {
+                m_lastForcedRefresh = now;
+                m_refreshNow = true;
+                refresh = true;
+            }
+        } else {
+            m_state.samplesSinceRefresh += samples;
+            m_bytesSinceRefresh += bytes;
+        }
+
+        UpdateLocked();
+    }
+
+    if(refresh) {
+        m_cond.notify_all();
+    }
+}
+
+void IOT_QuotaGovernor::SetPriority(const std::string& path, const std::string& name, Priority priority)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_priorities[Key(path, name)] = priority;
+}
+
+bool IOT_QuotaGovernor::SetThresholds(double throttlePercent, double criticalPercent)
+{
+    if(throttlePercent <= 0.0 || throttlePercent > criticalPercent || criticalPercent > 100.0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_throttlePercent = throttlePercent;
+    m_criticalPercent = criticalPercent;
+    UpdateLocked();
+    return true;
+}
+
+void IOT_QuotaGovernor::SetForecastHorizon(double seconds)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_horizonSec = (seconds > 0.0) ? seconds : 0.0;
+    UpdateLocked();
+}
+
+bool IOT_QuotaGovernor::SetDownsampleFactor(uint32_t factor)
+{
+    if(factor == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_downsample = factor;
+    return true;
+}
+
+bool IOT_QuotaGovernor::Admit(const IOT_WriteData& sample)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return AdmitLocked(sample, m_state.level);
+}
+
+size_t IOT_QuotaGovernor::Filter(std::vector<IOT_WriteData>& data)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return FilterLocked(data, m_state.level);
+}
+
+bool IOT_QuotaGovernor::Admit(const std::string& devId, const IOT_WriteData& sample)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return AdmitLocked(sample, LevelLocked(devId));
+}
+
+size_t IOT_QuotaGovernor::Filter(const std::string& devId, std::vector<IOT_WriteData>& data)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return FilterLocked(data, LevelLocked(devId));
+}
+
+size_t IOT_QuotaGovernor::FilterLocked(std::vector<IOT_WriteData>& data, Level level)
+{
+    if(level == LEVEL_NORMAL) {
+        return 0;
+    }
+
+    size_t kept = 0;
+    for(size_t i = 0; i < data.size(); ++i) {
+        if(AdmitLocked(data[i], level)) {
+            if(kept != i) {
+                data[kept] = data[i];
+            }
+            ++kept;
+        }
+    }
+
+    size_t removed = data.size() - kept;
+    data.resize(kept);
+    return removed;
+}
+
+IOT_QuotaGovernor::Level IOT_QuotaGovernor::GetLevel() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_state.level;
+}
+
+IOT_QuotaGovernor::State IOT_QuotaGovernor::GetState() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_state;
+}
+
+IOT_QuotaGovernor::Level IOT_QuotaGovernor::GetLevel(const std::string& devId) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return LevelLocked(devId);
+}
+
+bool IOT_QuotaGovernor::GetDeviceState(const std::string& devId, DeviceState& state) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    std::map<std::string, Device>::const_iterator it = m_devices.find(devId);
+    if(it == m_devices.end()) {
+        return false;
+    }
+
+    state = it->second.state;
+    return true;
+}
+
+std::string IOT_QuotaGovernor::Key(const std::string& path, const std::string& name)
+{
+    return path + "/" + name;
+}
+
+void IOT_QuotaGovernor::UpdateLocked()
+{
+    // Payload size overestimates storage use, which errs on the safe side until calibrated
+    double perSample = m_state.bytesPerSample;
+    if(perSample == 0.0 && m_state.samplesSinceRefresh > 0) {
+        perSample = static_cast<double>(m_bytesSinceRefresh) / m_state.samplesSinceRefresh;
+    }
+
+    double written = perSample * m_state.samplesSinceRefresh;
+    m_state.estimatedStorage = m_state.usedStorage + static_cast<uint64_t>(written);
+
+    double rate = m_state.growthBytesPerSec;
+    if(rate == 0.0) {
+        double elapsed = std::chrono::duration<double>(clock_t::now() - m_refreshTime).count();
+        if(elapsed >= 1.0) {
+            rate = written / elapsed;
+        }
+    }
+
+    if(rate > 0.0 && m_state.maxStorage > 0) {
+        m_state.secondsToExhaustion = (m_state.estimatedStorage < m_state.maxStorage) ?
+            (m_state.maxStorage - m_state.estimatedStorage) / rate : 0.0;
+    } else {
+        m_state.secondsToExhaustion = -1.0;
+    }
+
+    if(m_exhausted) {
+        m_state.level = LEVEL_EXHAUSTED;
+    } else if(!m_state.quotaKnown) {
+        m_state.level = LEVEL_NORMAL;
+    } else {
+        bool forecast = m_horizonSec > 0.0 && m_state.secondsToExhaustion >= 0.0 &&
+                        m_state.secondsToExhaustion < m_horizonSec;
+
+        m_state.level = LevelOf(m_state.estimatedStorage, m_state.maxStorage);
+        if(forecast && m_state.level == LEVEL_NORMAL) {
+            m_state.level = LEVEL_THROTTLE;
+        }
+    }
+
+    // Thresholds and the calibration are shared with the devices
+    for(std::map<std::string, Device>::iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        UpdateDeviceLocked(it->second);
+    }
+}
+
+void IOT_QuotaGovernor::UpdateDeviceLocked(Device& device) const
+{
+    DeviceState& state = device.state;
+
+    double perSample = m_state.bytesPerSample;
+    if(perSample == 0.0 && state.samplesSinceRefresh > 0) {
+        perSample = static_cast<double>(device.bytesSinceRefresh) / state.samplesSinceRefresh;
+    }
+
+    state.estimatedStorage = state.usedStorage + static_cast<uint64_t>(perSample * state.samplesSinceRefresh);
+    state.level = state.quotaKnown ? LevelOf(state.estimatedStorage, state.maxStorage) : LEVEL_NORMAL;
+}
+
+IOT_QuotaGovernor::Level IOT_QuotaGovernor::LevelOf(uint64_t used, uint64_t max) const
+{
+    if(max == 0) {
+        return LEVEL_NORMAL;
+    }
+
+    double percent = 100.0 * used / max;
+    if(percent >= m_criticalPercent) {
+        return LEVEL_CRITICAL;
+    }
+    return (percent >= m_throttlePercent) ? LEVEL_THROTTLE : LEVEL_NORMAL;
+}
+
+IOT_QuotaGovernor::Level IOT_QuotaGovernor::LevelLocked(const std::string& devId) const
+{
+    std::map<std::string, Device>::const_iterator it = m_devices.find(devId);
+    if(it == m_devices.end()) {
+        return m_state.level;
+    }
+    return std::max(m_state.level, it->second.state.level);
+}
+
+bool IOT_QuotaGovernor::AdmitLocked(const IOT_WriteData& sample, Level level)
+{
+    if(level == LEVEL_NORMAL) {
+        return true;
+    }
+
+    std::string key = Key(sample.GetPath(), sample.GetName());
+    std::map<std::string, Priority>::const_iterator it = m_priorities.find(key);
+    Priority priority = (it != m_priorities.end()) ? it->second : PRIORITY_NORMAL;
+
+    bool downsample = false;
+    if(priority != PRIORITY_HIGH) {
+        switch(level)
+        {
+        case LEVEL_THROTTLE:
+            downsample = (priority == PRIORITY_LOW);
+            break;
+        case LEVEL_CRITICAL:
+            if(priority == PRIORITY_LOW) {
+                m_state.dropped++;
+                return false;
+            }
+            downsample = true;
+            break;
+        default:
+            m_state.dropped++;
+            return false;
+        }
+    }
+
+    if(downsample && (m_sampleCounts[key]++ % m_downsample) != 0) {
+        m_state.dropped++;
+        return false;
+    }
+
+    return true;
+}
+
+void IOT_QuotaGovernor::RefreshThread()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while(true) {
+        m_cond.wait_for(lock, std::chrono::milliseconds(m_refreshMs),
+                        [this](){ return m_stop || m_refreshNow; });
+        if(m_stop) {
+            break;
+        }
+        m_refreshNow = false;
+
+        lock.unlock();
+        Refresh();
+        lock.lock();
+    }
+}
@@ -0,0 +1,248 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_QUOTAGOVERNOR_H
+#define IOT_QUOTAGOVERNOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "IOT_API.h"
+
+//! \brief Keeps writes within the storage quota of the account
+//! \note The quota is refreshed from the server periodically in a background
+//!       thread, never per write. Between refreshes the storage use is estimated
+//!       from the samples written since, using the storage bytes per sample
+//!       observed between earlier refreshes. When the estimate crosses the
+//!       throttle threshold, or exhaustion is forecast within the horizon,
+//!       low priority datanodes are downsampled. At the critical threshold low
+//!       priority datanodes are dropped and normal ones downsampled. After the
+//!       server reports IOTAPI::IOT_ERR_QUOTA only high priority datanodes pass
+//!       until a refresh shows free storage again.
+//!       Devices added with AddDevice() get their IOT_QuotaDevice refreshed too.
+//!       A device with a storage budget has its own level by the same thresholds,
+//!       and its samples are filtered by the more restrictive of the two levels.
+class IOT_QuotaGovernor
+{
+public:
+    //! Priority of a datanode
+    typedef enum
+    {
+        PRIORITY_LOW,
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH
+    } Priority;
+
+    //! Throttling level, from least to most restrictive
+    typedef enum
+    {
+        LEVEL_NORMAL,    //! All samples pass
+        LEVEL_THROTTLE,  //! Low priority downsampled
+        LEVEL_CRITICAL,  //! Low priority dropped, normal downsampled
+        LEVEL_EXHAUSTED  //! Only high priority passes
+    } Level;
+
+    //! Snapshot of the governor state for introspection
+    struct State
+    {
+        Level level;
+        bool quotaKnown;
+        uint64_t usedStorage;        //! As reported by the latest refresh
+        uint64_t estimatedStorage;   //! Including the writes since the refresh
+        uint64_t maxStorage;
+        uint64_t samplesSinceRefresh;
+        double bytesPerSample;
+        double growthBytesPerSec;
+        double secondsToExhaustion;  //! Negative if no growth observed
+        uint64_t refreshes;
+        uint64_t failedRefreshes;
+        uint64_t dropped;
+    };
+
+    //! Snapshot of the state of a device added with AddDevice()
+    struct DeviceState
+    {
+        Level level;                 //! Of the device budget alone
+        bool quotaKnown;
+        uint64_t usedStorage;        //! As reported by the latest refresh
+        uint64_t estimatedStorage;   //! Including the writes since the refresh
+        uint64_t maxStorage;         //! Budget of the device, 0 for none
+        uint64_t samplesSinceRefresh;
+        int dataNodes;
+    };
+
+    //! Default interval between quota refreshes in milliseconds
+    static const uint32_t DEFAULT_REFRESH_MS = 10 * 60 * 1000;
+
+    //! \brief Constructor
+    //! \param [in] api - API instance used for quota queries. Must outlive the governor.
+    IOT_QuotaGovernor(const IOT_API& api);
+    ~IOT_QuotaGovernor();
+
+    //! \brief Start refreshing the quota in the background
+    //! \param [in] refreshMs - Interval between refreshes in milliseconds
+    //! \return IOTAPI::IOT_ERR_OK if successful, IOTAPI::IOT_ERR_INITIALIZED if already started,
+    //!         IOTAPI::IOT_ERR_PARAM if the interval is zero
+    IOTAPI::IOTAPI_err Start(uint32_t refreshMs = DEFAULT_REFRESH_MS);
+
+    //! \brief Stop the background refresh
+    void Stop();
+
+    //! \brief Refresh the quota now
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err Refresh();
+
+    //! \brief Update the state with quota information, called by Refresh()
+    void OnQuota(const IOT_Quota& quota);
+
+    //! \brief Update the state of a device with its quota information, called by Refresh()
+    //! \note Ignored if the device was not added
+    void OnDeviceQuota(const std::string& devId, const IOT_QuotaDevice& quota);
+
+    //! \brief Account samples written to the server
+    //! \param [in] samples - Number of samples written
+    //! \param [in] bytes   - Payload size of the written samples
+    //! \param [in] ret     - Result of the write
+    void OnWrite(size_t samples, size_t bytes, IOTAPI::IOTAPI_err ret);
+
+    //! \brief Account samples written to the server for a device
+    //! \note Counted in the account as well
+    void OnWrite(const std::string& devId, size_t samples, size_t bytes, IOTAPI::IOTAPI_err ret);
+
+    //! \brief Refresh the quota of a device along with the account quota
+    //! \note Adding a device again keeps its budget
+    void AddDevice(const std::string& devId);
+
+    //! \brief Set storage budget of a device, adding it if needed
+    //! \param [in] maxStorage - Storage the device may use in bytes, 0 to follow only the account quota
+    void SetDeviceBudget(const std::string& devId, uint64_t maxStorage);
+
+    //! \brief Set priority of a datanode, NORMAL by default
+    void SetPriority(const std::string& path, const std::string& name, Priority priority);
+
+    //! \brief Set usage thresholds in percent of the max storage
+    //! \return false if the thresholds are invalid
+    bool SetThresholds(double throttlePercent, double criticalPercent);
+
+    //! \brief Throttle if exhaustion is forecast within the horizon
+    //! \param [in] seconds - Forecast horizon, 0 to disable forecast based throttling
+    void SetForecastHorizon(double seconds);
+
+    //! \brief Keep one sample of every factor samples of a downsampled datanode
+    //! \return false if factor is zero
+    bool SetDownsampleFactor(uint32_t factor);
+
+    //! \brief Check whether a sample should be written at the current level
+    //! \note Updates the downsampling state of the datanode
+    bool Admit(const IOT_WriteData& sample);
+
+    //! \brief Remove samples that should not be written at the current level
+    //! \return Number of samples removed
+    size_t Filter(std::vector<IOT_WriteData>& data);
+
+    //! \brief Check whether a sample of a device should be written
+    //! \note Devices not added are admitted by the account level
+    bool Admit(const std::string& devId, const IOT_WriteData& sample);
+
+    //! \brief Remove samples of a device that should not be written
+    //! \return Number of samples removed
+    size_t Filter(const std::string& devId, std::vector<IOT_WriteData>& data);
+
+    Level GetLevel() const;
+    State GetState() const;
+
+    //! \brief More restrictive of the account level and the level of a device
+    Level GetLevel(const std::string& devId) const;
+
+    //! \brief Get state of a device
+    //! \return false if the device was not added
+    bool GetDeviceState(const std::string& devId, DeviceState& state) const;
+
+private:
+    IOT_QuotaGovernor(const IOT_QuotaGovernor&);
+    IOT_QuotaGovernor& operator=(const IOT_QuotaGovernor&);
+
+    typedef std::chrono::steady_clock clock_t;
+
+    //! Minimum time between refreshes triggered by IOTAPI::IOT_ERR_QUOTA
+    static const uint32_t MIN_REFRESH_MS = 10 * 1000;
+
+    static std::string Key(const std::string& path, const std::string& name);
+
+    //! Device state with the payload written since its refresh
+    struct Device
+    {
+        DeviceState state;
+        uint64_t bytesSinceRefresh;
+    };
+
+    //! Recalculate estimate, forecast and level, caller holds m_lock
+    void UpdateLocked();
+
+    //! Recalculate estimate and level of a device, caller holds m_lock
+    void UpdateDeviceLocked(Device& device) const;
+
+    //! Level of storage use by the thresholds
+    Level LevelOf(uint64_t used, uint64_t max) const;
+
+    //! Level for samples of a device, caller holds m_lock
+    Level LevelLocked(const std::string& devId) const;
+
+    //! Admit a sample at a level, caller holds m_lock
+    bool AdmitLocked(const IOT_WriteData& sample, Level level);
+
+    size_t FilterLocked(std::vector<IOT_WriteData>& data, Level level);
+
+    void RefreshThread();
+
+    const IOT_API& m_api;
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+    bool m_running;
+    bool m_stop;
+    bool m_refreshNow;
+    uint32_t m_refreshMs;
+
+    double m_throttlePercent;
+    double m_criticalPercent;
+    double m_horizonSec;
+    uint32_t m_downsample;
+
+    std::map<std::string, Priority> m_priorities;
+    std::map<std::string, uint32_t> m_sampleCounts;
+    std::map<std::string, Device> m_devices;
+
+    State m_state;
+    bool m_exhausted;
+    clock_t::time_point m_refreshTime;
+    clock_t::time_point m_lastForcedRefresh;
+    uint64_t m_bytesSinceRefresh;
+};
+
+#endif // IOT_QUOTAGOVERNOR_H
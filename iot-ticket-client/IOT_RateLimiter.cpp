@@ -0,0 +1,306 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_RateLimiter.h"
+#include "IOT_Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+//! HTTP status codes that throttle the lane of a request
+static const long HTTP_STATUS_TOO_MANY_REQUESTS   = 429;
+static const long HTTP_STATUS_SERVICE_UNAVAILABLE = 503;
+
+
+IOT_RateLimiter::Stats::Stats():
+    admitted(0), delayed(0), refused(0), throttled(0), waitedMs(0.0), pausedMs(0.0)
+{
+}
+
+IOT_RateLimiter::Lane::Lane():
+    rate(0.0), burst(1.0), tokens(1.0), backoffMs(0), custom(false)
+{
+}
+
+IOT_RateLimiter::IOT_RateLimiter():
+    m_deviceRate(0.0), m_deviceBurst(1.0), m_pauseMs(DEFAULT_PAUSE_MS), m_maxPauseMs(DEFAULT_MAX_PAUSE_MS)
+{
+}
+
+bool IOT_RateLimiter::ValidRate(double perSecond, double burst)
+{
+    return perSecond == 0.0 || (perSecond > 0.0 && burst >= 1.0);
+}
+
+void IOT_RateLimiter::SetRate(Lane& lane, double perSecond, double burst, clock_t::time_point now)
+{
+    lane.rate = perSecond;
+    lane.burst = (perSecond > 0.0) ? burst : 1.0;
+    lane.tokens = lane.burst;
+    lane.refilled = now;
+}
+
+bool IOT_RateLimiter::SetAccountRate(double perSecond, double burst)
+{
+    if(!ValidRate(perSecond, burst)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    SetRate(m_account, perSecond, burst, clock_t::now());
+    return true;
+}
+
+bool IOT_RateLimiter::SetDeviceRate(double perSecond, double burst)
+{
+    if(!ValidRate(perSecond, burst)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_deviceRate = perSecond;
+    m_deviceBurst = (perSecond > 0.0) ? burst : 1.0;
+
+    clock_t::time_point now = clock_t::now();
+    for(std::map<std::string, Lane>::iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        if(!it->second.custom) {
+            SetRate(it->second, m_deviceRate, m_deviceBurst, now);
+        }
+    }
+    return true;
+}
+
+bool IOT_RateLimiter::SetDeviceRate(const std::string& devId, double perSecond, double burst)
+{
+    if(devId.empty() || !ValidRate(perSecond, burst)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    Lane& lane = m_devices[devId];
+    SetRate(lane, perSecond, burst, clock_t::now());
+    lane.custom = true;
+    return true;
+}
+
+bool IOT_RateLimiter::SetPause(uint32_t initialMs, uint32_t maxMs)
+{
+    if(initialMs == 0 || initialMs > maxMs) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pauseMs = initialMs;
+    m_maxPauseMs = maxMs;
+    return true;
+}
+
+long IOT_RateLimiter::TryAcquire(const std::string& devId)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    Lane* device = NULL;
+    double wait = WaitLocked(devId, clock_t::now(), device);
+    if(wait > 0.0) {
+        return std::max(1L, static_cast<long>(std::ceil(wait)));
+    }
+
+    TakeLocked(device);
+    return 0;
+}
+
+bool IOT_RateLimiter::Acquire(const std::string& devId, uint32_t maxWaitMs)
+{
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    clock_t::time_point started = clock_t::now();
+    std::unique_lock<std::mutex> lock(m_lock);
+    bool slept = false;
+
+    while(true) {
+        clock_t::time_point now = clock_t::now();
+        double waited = slept ? std::chrono::duration<double, std::milli>(now - started).count() : 0.0;
+
+        Lane* device = NULL;
+        double wait = WaitLocked(devId, now, device);
+        if(wait <= 0.0) {
+            TakeLocked(device);
+            if(slept) {
+                m_stats.delayed++;
+                m_stats.waitedMs += waited;
+                metrics.throttleWaitMicros.Add(static_cast<uint64_t>(waited * 1000.0));
+            }
+            return true;
+        }
+
+        // Lanes paused for longer than the caller can wait fail at once
+        if(waited + wait > maxWaitMs) {
+            m_stats.refused++;
+            m_stats.waitedMs += waited;
+            metrics.requestsThrottled.Add();
+            metrics.throttleWaitMicros.Add(static_cast<uint64_t>(waited * 1000.0));
+            return false;
+        }
+
+        // Another thread may take the tokens meanwhile, so check again after the wait
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(wait));
+        lock.lock();
+        slept = true;
+    }
+}
+
+void IOT_RateLimiter::OnReply(const std::string& devId, long httpCode, long retryAfterS)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    clock_t::time_point now = clock_t::now();
+
+    if(httpCode == HTTP_STATUS_TOO_MANY_REQUESTS || httpCode == HTTP_STATUS_SERVICE_UNAVAILABLE) {
+        m_stats.throttled++;
+
+        Lane* device = (httpCode == HTTP_STATUS_TOO_MANY_REQUESTS) ? FindDevice(devId, true, now) : NULL;
+        PauseLocked((device != NULL) ? *device : m_account, retryAfterS, now);
+        return;
+    }
+
+    if(httpCode >= 200 && httpCode < 300) {
+        m_account.backoffMs = 0;
+        Lane* device = FindDevice(devId, false, now);
+        if(device != NULL) {
+            device->backoffMs = 0;
+        }
+    }
+}
+
+long IOT_RateLimiter::GetDelayMs(const std::string& devId) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    clock_t::time_point now = clock_t::now();
+
+    Lane account = m_account;
+    Refill(account, now);
+    double wait = WaitMs(account, now);
+
+    std::map<std::string, Lane>::const_iterator it = devId.empty() ? m_devices.end() : m_devices.find(devId);
+    if(it != m_devices.end()) {
+        Lane device = it->second;
+        Refill(device, now);
+        wait = std::max(wait, WaitMs(device, now));
+    }
+
+    return (wait > 0.0) ? std::max(1L, static_cast<long>(std::ceil(wait))) : 0;
+}
+
+IOT_RateLimiter::Stats IOT_RateLimiter::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_stats;
+}
+
+void IOT_RateLimiter::Refill(Lane& lane, clock_t::time_point now)
+{
+    if(lane.rate > 0.0 && now > lane.refilled) {
+        double elapsed = std::chrono::duration<double>(now - lane.refilled).count();
+        lane.tokens = std::min(lane.burst, lane.tokens + elapsed * lane.rate);
+    }
+    lane.refilled = now;
+}
+
+double IOT_RateLimiter::WaitMs(const Lane& lane, clock_t::time_point now)
+{
+    double wait = 0.0;
+    if(lane.pausedUntil > now) {
+        wait = std::chrono::duration<double, std::milli>(lane.pausedUntil - now).count();
+    }
+    if(lane.rate > 0.0 && lane.tokens < 1.0) {
+        wait = std::max(wait, (1.0 - lane.tokens) * 1000.0 / lane.rate);
+    }
+    return wait;
+}
+
+IOT_RateLimiter::Lane* IOT_RateLimiter::FindDevice(const std::string& devId, bool create, clock_t::time_point now)
+{
+    if(devId.empty()) {
+        return NULL;
+    }
+
+    std::map<std::string, Lane>::iterator it = m_devices.find(devId);
+    if(it != m_devices.end()) {
+        return &it->second;
+    }
+
+    // Devices without a rate get a lane only when they are paused
+    if(!create && m_deviceRate == 0.0) {
+        return NULL;
+    }
+
+    Lane& lane = m_devices[devId];
+    SetRate(lane, m_deviceRate, m_deviceBurst, now);
+    return &lane;
+}
+
+double IOT_RateLimiter::WaitLocked(const std::string& devId, clock_t::time_point now, Lane*& device)
+{
+    Refill(m_account, now);
+    double wait = WaitMs(m_account, now);
+
+    device = FindDevice(devId, false, now);
+    if(device != NULL) {
+        Refill(*device, now);
+        wait = std::max(wait, WaitMs(*device, now));
+    }
+
+    return wait;
+}
+
+void IOT_RateLimiter::TakeLocked(Lane* device)
+{
+    m_stats.admitted++;
+
+    if(m_account.rate > 0.0) {
+        m_account.tokens -= 1.0;
+    }
+    if(device != NULL && device->rate > 0.0) {
+        device->tokens -= 1.0;
+    }
+}
+
+void IOT_RateLimiter::PauseLocked(Lane& lane, long retryAfterS, clock_t::time_point now)
+{
+    uint32_t pauseMs = 0;
+    if(retryAfterS > 0) {
+        pauseMs = static_cast<uint32_t>(std::min<int64_t>(static_cast<int64_t>(retryAfterS) * 1000, m_maxPauseMs));
+    } else {
+        pauseMs = (lane.backoffMs > 0) ? lane.backoffMs : m_pauseMs;
+        lane.backoffMs = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(pauseMs) * 2, m_maxPauseMs));
+    }
+
+    // Only the part of the pause beyond an earlier one adds to the paused time
+    clock_t::time_point until = now + std::chrono::milliseconds(pauseMs);
+    if(until > lane.pausedUntil) {
+        clock_t::time_point from = std::max(now, lane.pausedUntil);
+        double pausedMs = std::chrono::duration<double, std::milli>(until - from).count();
+        m_stats.pausedMs += pausedMs;
+        IOT_Metrics::Instance().throttlePauseMicros.Add(static_cast<uint64_t>(pausedMs * 1000.0));
+        lane.pausedUntil = until;
+    }
+}
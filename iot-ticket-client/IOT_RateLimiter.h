@@ -0,0 +1,178 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_RATELIMITER_H
+#define IOT_RATELIMITER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include "IOT_defines.h"
+
+//! \brief Token bucket rate limits for requests to one server account and its devices
+//! \note Every request takes a token from the account bucket, and a request
+//!       for a device also takes one from the bucket of that device. Buckets
+//!       refill at their rate up to the burst size.
+//!       When the server answers 429 Too Many Requests, the lane of the
+//!       request is paused: the device for device requests, otherwise the
+//!       account. 503 Service Unavailable pauses the account. The pause lasts
+//!       as long as the Retry-After header says, or without one doubles from
+//!       the initial pause on each throttled reply in a row. A successful
+//!       reply ends the doubling. The account lane holds back all requests.
+//!       One limiter can be shared by the IOT_API instances of an account.
+class IOT_RateLimiter
+{
+public:
+    typedef std::chrono::steady_clock clock_t;
+
+    //! \brief Counters of the limiter
+    struct Stats
+    {
+        Stats();
+
+        uint64_t admitted;   //! Requests let out
+        uint64_t delayed;    //! Requests let out after waiting
+        uint64_t refused;    //! Requests held back for longer than they could wait
+        uint64_t throttled;  //! Replies with 429 or 503
+        double waitedMs;     //! Time requests waited for tokens or pauses
+        double pausedMs;     //! Time lanes were paused by throttled replies
+    };
+
+    //! Default pause after a throttled reply without Retry-After in milliseconds
+    static const uint32_t DEFAULT_PAUSE_MS = 1000;
+
+    //! Default max pause in milliseconds, also caps Retry-After
+    static const uint32_t DEFAULT_MAX_PAUSE_MS = 5 * 60 * 1000;
+
+    //! \brief Constructor, no rate limits until they are set
+    IOT_RateLimiter();
+
+    //! \brief Set rate of all requests to the account
+    //! \param [in] perSecond - Requests per second, 0 for no limit
+    //! \param [in] burst     - Max number of requests let out at once after an idle period
+    //! \return false if the rate is negative or burst is less than 1 for a limited rate
+    bool SetAccountRate(double perSecond, double burst);
+
+    //! \brief Set rate of requests for each device
+    //! \note Devices whose rate is set by name keep their own rate.
+    //! \param [in] perSecond - Requests per second, 0 for no limit
+    //! \param [in] burst     - Max number of requests let out at once after an idle period
+    //! \return false if the rate is negative or burst is less than 1 for a limited rate
+    bool SetDeviceRate(double perSecond, double burst);
+
+    //! \brief Set rate of requests for single device
+    //! \param [in] devId     - Device ID
+    //! \param [in] perSecond - Requests per second, 0 for no limit
+    //! \param [in] burst     - Max number of requests let out at once after an idle period
+    //! \return false if devId is empty, the rate is negative or burst is less than 1 for a limited rate
+    bool SetDeviceRate(const std::string& devId, double perSecond, double burst);
+
+    //! \brief Set pause after throttled replies without Retry-After
+    //! \param [in] initialMs - Pause after the first throttled reply
+    //! \param [in] maxMs     - Max pause, also caps Retry-After
+    //! \return false if initialMs is zero or greater than maxMs
+    bool SetPause(uint32_t initialMs, uint32_t maxMs);
+
+    //! \brief Take tokens for a request if it may go out now
+    //! \param [in] devId - Device of the request, empty for account requests
+    //! \return 0 if the request may go out, otherwise milliseconds until it may
+    long TryAcquire(const std::string& devId);
+
+    //! \brief Wait until a request may go out and take its tokens
+    //! \param [in] devId     - Device of the request, empty for account requests
+    //! \param [in] maxWaitMs - Max time to wait
+    //! \return false if the request would have to wait longer, nothing is taken then
+    bool Acquire(const std::string& devId, uint32_t maxWaitMs);
+
+    //! \brief Pause the lane of a request if the server throttled it
+    //! \param [in] devId       - Device of the request, empty for account requests
+    //! \param [in] httpCode    - HTTP status of the reply
+    //! \param [in] retryAfterS - Retry-After of the reply in seconds, 0 if none
+    void OnReply(const std::string& devId, long httpCode, long retryAfterS);
+
+    //! \brief Time until a request may go out, without taking tokens
+    //! \param [in] devId - Device of the request, empty for account requests
+    //! \return Milliseconds, 0 if now
+    long GetDelayMs(const std::string& devId) const;
+
+    //! \brief Get counters of the limiter
+    Stats GetStats() const;
+
+private:
+    IOT_RateLimiter(const IOT_RateLimiter&);
+    IOT_RateLimiter& operator=(const IOT_RateLimiter&);
+
+    //! Token bucket and pause of the account or a device
+    struct Lane
+    {
+        Lane();
+
+        //! Tokens per second, 0 for no limit
+        double rate;
+        double burst;
+        double tokens;
+        clock_t::time_point refilled;
+
+        //! Requests are held back until this
+        clock_t::time_point pausedUntil;
+
+        //! Pause of the next throttled reply without Retry-After, 0 for the initial pause
+        uint32_t backoffMs;
+
+        //! Rate set by SetDeviceRate() for this device
+        bool custom;
+    };
+
+    static bool ValidRate(double perSecond, double burst);
+    static void SetRate(Lane& lane, double perSecond, double burst, clock_t::time_point now);
+
+    //! Add tokens for the time since the last refill
+    static void Refill(Lane& lane, clock_t::time_point now);
+
+    //! Milliseconds until the lane lets a request out
+    static double WaitMs(const Lane& lane, clock_t::time_point now);
+
+    //! Lane of a device, NULL if the device has no limit or pause
+    Lane* FindDevice(const std::string& devId, bool create, clock_t::time_point now);
+
+    //! Refill the lanes of a request and return milliseconds until it may go out, caller holds m_lock
+    double WaitLocked(const std::string& devId, clock_t::time_point now, Lane*& device);
+
+    //! Take tokens of a request, caller holds m_lock
+    void TakeLocked(Lane* device);
+
+    //! Pause a lane after a throttled reply, caller holds m_lock
+    void PauseLocked(Lane& lane, long retryAfterS, clock_t::time_point now);
+
+    mutable std::mutex m_lock;
+    Lane m_account;
+    std::map<std::string, Lane> m_devices;
+    double m_deviceRate;
+    double m_deviceBurst;
+    uint32_t m_pauseMs;
+    uint32_t m_maxPauseMs;
+    Stats m_stats;
+};
+
+#endif // IOT_RATELIMITER_H
@@ -23,9 +23,10 @@
 
 #include "IOT_ReadData.h"
 #include "IOT_Base64.h"
+#include "IOT_NumberParse.h"
 
 #include <iostream>
-#include <sstream>
+#include <limits>
 
 IOT_ReadData::IOT_ReadData(): m_dataType(IOTAPI::IOT_no_type)
 {
@@ -75,10 +76,7 @@ bool IOT_ReadData::GetConvertedValue(size_t index, long& value) const
     if(index >= m_processData.size() || m_dataType != IOTAPI::IOT_long)
         return false;
 
-    std::stringstream ss(m_processData.at(index).second);
-    ss >> value;
-
-    return (bool)ss;
+    return ParseLong(m_processData[index].second, value);
 }
 
 bool IOT_ReadData::GetConvertedValue(size_t index, double& value) const
@@ -86,10 +84,58 @@ bool IOT_ReadData::GetConvertedValue(size_t index, double& value) const
     if(index >= m_processData.size() || m_dataType != IOTAPI::IOT_double)
         return false;
 
-    std::stringstream ss(m_processData.at(index).second);
-    ss >> value;
+    const std::string& str = m_processData[index].second;
+    return IOT_NumberParse::ParseDouble(str.data(), str.data() + str.size(), value) != NULL;
+}
+
+bool IOT_ReadData::GetConvertedValues(std::vector<long>& values) const
+{
+    values.clear();
+    if(m_dataType != IOTAPI::IOT_long)
+        return false;
+
+    values.resize(m_processData.size());
+    for(size_t i = 0; i < m_processData.size(); ++i) {
+        if(!ParseLong(m_processData[i].second, values[i])) {
+            values.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool IOT_ReadData::GetConvertedValues(std::vector<double>& values) const
+{
+    values.clear();
+    if(m_dataType != IOTAPI::IOT_double)
+        return false;
+
+    values.resize(m_processData.size());
+    for(size_t i = 0; i < m_processData.size(); ++i) {
+        const std::string& str = m_processData[i].second;
+        if(IOT_NumberParse::ParseDouble(str.data(), str.data() + str.size(), values[i]) == NULL) {
+            values.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool IOT_ReadData::ParseLong(const std::string& str, long& value)
+{
+    int64_t parsed;
+    if(IOT_NumberParse::ParseInt64(str.data(), str.data() + str.size(), parsed) == NULL) {
+        return false;
+    }
+
+    if(parsed < std::numeric_limits<long>::min() || parsed > std::numeric_limits<long>::max()) {
+        return false;
+    }
 
-    return (bool)ss;
+    value = static_cast<long>(parsed);
+    return true;
 }
 
 bool IOT_ReadData::GetConvertedValue(size_t index, bool& value) const
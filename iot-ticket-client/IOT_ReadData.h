@@ -66,6 +66,18 @@ public:
     //! \return true if index was valid and value was set successfully, false otherwise
     bool GetConvertedValue(size_t index, double& value) const;
 
+    //! \brief Convert all process data values to long
+    //! \pre GetDatatype() == IOTAPI::IOT_long
+    //! \param [out] values - Values in the same order as the indexes
+    //! \return true if all values were converted successfully, false otherwise
+    bool GetConvertedValues(std::vector<long>& values) const;
+
+    //! \brief Convert all process data values to double
+    //! \pre GetDatatype() == IOTAPI::IOT_double
+    //! \param [out] values - Values in the same order as the indexes
+    //! \return true if all values were converted successfully, false otherwise
+    bool GetConvertedValues(std::vector<double>& values) const;
+
     //! \brief Convert process data value to bool
     //! \pre GetDatatype() == IOTAPI::IOT_bool
     //! \param [in] index  - Index of process value [0...ProcessValues()-1]
@@ -90,9 +102,14 @@ public:
     bool FromJSON(const Json::Value& json);
 
 private:
+    friend class IOT_ResponseDecoder;
+
     //! Convert string type name to IOT_DataType enumeration
     IOTAPI::IOT_DataType ConvertToDatatype(const std::string& type);
 
+    //! Parse decimal integer to long
+    static bool ParseLong(const std::string& str, long& value);
+
     std::string m_name;
     std::string m_path;
     std::string m_unit;
@@ -196,10 +196,11 @@ bool IOT_RegDevice::ToJSON(Json::Value &json) const
 
 bool IOT_RegDevice::FromJSON(const std::string& json)
 {
+    Json::ValueArena arena;
     Json::Value answer;
     Json::Reader json_reader;
 
-    if(json_reader.parse(json, answer, false))
+    if(json_reader.parse(json, answer, arena, false))
     {
         if(IOT_RegDevice::FromJSON(answer)) {
             return true;
@@ -0,0 +1,82 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_REQUESTTIMING_H
+#define IOT_REQUESTTIMING_H
+
+#include <stdint.h>
+
+//! \brief Timing breakdown of a single HTTP request as reported by libcurl
+//! \note All times are cumulative from the start of the request, in
+//!       milliseconds, like the corresponding CURLINFO_*_TIME values.
+struct IOT_RequestTiming
+{
+    IOT_RequestTiming()
+    {
+        nameLookupMs = 0.0;
+        connectMs = 0.0;
+        appConnectMs = 0.0;
+        preTransferMs = 0.0;
+        startTransferMs = 0.0;
+        totalMs = 0.0;
+        bytesUp = 0;
+        bytesDown = 0;
+        connectionReused = false;
+        httpCode = 0;
+        retryAfterS = 0;
+    }
+
+    //! Time until name resolving was completed
+    double nameLookupMs;
+
+    //! Time until TCP connection to the server was established
+    double connectMs;
+
+    //! Time until TLS handshake was completed (0 for plain HTTP)
+    double appConnectMs;
+
+    //! Time until the request was about to be sent
+    double preTransferMs;
+
+    //! Time until the first response byte was received
+    double startTransferMs;
+
+    //! Total time of the request
+    double totalMs;
+
+    //! Number of payload bytes sent to the server
+    uint64_t bytesUp;
+
+    //! Number of payload bytes received from the server
+    uint64_t bytesDown;
+
+    //! True if an existing connection was reused for the request
+    bool connectionReused;
+
+    //! HTTP status code returned by the server (0 if none)
+    long httpCode;
+
+    //! Delay the server asked for in a Retry-After header, in seconds (0 if none)
+    long retryAfterS;
+};
+
+#endif // IOT_REQUESTTIMING_H
@@ -0,0 +1,510 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_ResponseDecoder.h"
+#include <limits>
+
+typedef IOT_JsonPullParser Parser;
+
+static const int64_t INT_MIN_VALUE   = std::numeric_limits<int>::min();
+static const int64_t INT_MAX_VALUE   = std::numeric_limits<int>::max();
+static const int64_t INT64_MIN_VALUE = std::numeric_limits<int64_t>::min();
+static const int64_t INT64_MAX_VALUE = std::numeric_limits<int64_t>::max();
+
+//! Mandatory members of a device object
+static const unsigned int DEVICE_ID           = 1 << 0;
+static const unsigned int DEVICE_HREF         = 1 << 1;
+static const unsigned int DEVICE_CREATED      = 1 << 2;
+static const unsigned int DEVICE_NAME         = 1 << 3;
+static const unsigned int DEVICE_MANUFACTURER = 1 << 4;
+static const unsigned int DEVICE_MANDATORY    = (1 << 5) - 1;
+
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeDevices(const std::string& json, std::vector<IOT_GetDevice>& devices)
+{
+    size_t first = devices.size();
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_OK);
+    }
+
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("items") && parser.Next() == Parser::TOKEN_ARRAY_BEGIN) {
+            while(parser.Next() != Parser::TOKEN_ARRAY_END && parser.GetToken() != Parser::TOKEN_ERROR)
+            {
+                if(parser.GetToken() == Parser::TOKEN_OBJECT_BEGIN) {
+                    devices.push_back(IOT_GetDevice());
+                    if(!DecodeDeviceObject(parser, devices.back())) {
+                        devices.pop_back();
+                    }
+                } else {
+                    parser.SkipValue();
+                }
+            }
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    Result result = Finish(parser, DECODE_OK);
+    if(result == DECODE_MALFORMED) {
+        devices.erase(devices.begin() + first, devices.end());
+    }
+    return result;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeDevice(const std::string& json, IOT_GetDevice& device)
+{
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_INVALID);
+    }
+
+    IOT_GetDevice decoded;
+    Result result = Finish(parser, DecodeDeviceObject(parser, decoded) ? DECODE_OK : DECODE_INVALID);
+    if(result == DECODE_OK) {
+        device = decoded;
+    }
+    return result;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeDeviceId(const std::string& json, std::string& devId)
+{
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_INVALID);
+    }
+
+    std::string decoded;
+    bool found = false;
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("deviceId")) {
+            found = ReadString(parser, decoded);
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    Result result = Finish(parser, found ? DECODE_OK : DECODE_INVALID);
+    if(result == DECODE_OK) {
+        devId = decoded;
+    }
+    return result;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeDatanodes(const std::string& json, const char* listKey,
+                                                                 std::vector<IOT_ReadData>& data)
+{
+    size_t first = data.size();
+    bool valid = true;
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_OK);
+    }
+
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey(listKey) && parser.Next() == Parser::TOKEN_ARRAY_BEGIN) {
+            while(parser.Next() != Parser::TOKEN_ARRAY_END && parser.GetToken() != Parser::TOKEN_ERROR)
+            {
+                // Datanodes are decoded in place to avoid copying their values
+                if(valid && parser.GetToken() == Parser::TOKEN_OBJECT_BEGIN) {
+                    data.push_back(IOT_ReadData());
+                    if(!DecodeDatanodeObject(parser, data.back())) {
+                        data.pop_back();
+                        valid = false;
+                    }
+                } else {
+                    valid = false;
+                    parser.SkipValue();
+                }
+            }
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    Result result = Finish(parser, valid ? DECODE_OK : DECODE_INVALID);
+    if(result == DECODE_MALFORMED) {
+        data.erase(data.begin() + first, data.end());
+    }
+    return result;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeQuota(const std::string& json, IOT_Quota& quota)
+{
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_INVALID);
+    }
+
+    IOT_Quota decoded;
+    bool valid = true;
+    int64_t value = 0;
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("totalDevices")) {
+            valid = ReadAsInt(parser, INT_MIN_VALUE, INT_MAX_VALUE, value) && valid;
+            decoded.m_totalDevices = static_cast<int>(value);
+        } else if(parser.IsKey("maxNumberOfDevices")) {
+            valid = ReadAsInt(parser, INT_MIN_VALUE, INT_MAX_VALUE, value) && valid;
+            decoded.m_maxDevicesAllowed = static_cast<int>(value);
+        } else if(parser.IsKey("maxDataNodePerDevice")) {
+            valid = ReadAsInt(parser, INT_MIN_VALUE, INT_MAX_VALUE, value) && valid;
+            decoded.m_maxNodesPerDevice = static_cast<int>(value);
+        } else if(parser.IsKey("usedStorageSize")) {
+            valid = ReadAsInt(parser, INT64_MIN_VALUE, INT64_MAX_VALUE, value) && valid;
+            decoded.m_usedStorage = static_cast<unsigned long>(value);
+        } else if(parser.IsKey("maxStorageSize")) {
+            valid = ReadAsInt(parser, INT64_MIN_VALUE, INT64_MAX_VALUE, value) && valid;
+            decoded.m_maxStorage = static_cast<unsigned long>(value);
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    Result result = Finish(parser, valid ? DECODE_OK : DECODE_INVALID);
+    if(result == DECODE_OK) {
+        quota = decoded;
+    }
+    return result;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeQuotaDevice(const std::string& json, IOT_QuotaDevice& quota)
+{
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_INVALID);
+    }
+
+    IOT_QuotaDevice decoded;
+    bool valid = true;
+    int64_t value = 0;
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("totalRequestToday")) {
+            valid = ReadAsInt(parser, INT_MIN_VALUE, INT_MAX_VALUE, value) && valid;
+            decoded.m_requestsToday = static_cast<int>(value);
+        } else if(parser.IsKey("maxReadRequestPerDay")) {
+            valid = ReadAsInt(parser, INT_MIN_VALUE, INT_MAX_VALUE, value) && valid;
+            decoded.m_maxRequestsPerDay = static_cast<int>(value);
+        } else if(parser.IsKey("numberOfDataNodes")) {
+            valid = ReadAsInt(parser, INT_MIN_VALUE, INT_MAX_VALUE, value) && valid;
+            decoded.m_dataNodes = static_cast<int>(value);
+        } else if(parser.IsKey("storageSize")) {
+            valid = ReadAsInt(parser, 0, INT64_MAX_VALUE, value) && valid;
+            decoded.m_storageSize = static_cast<long>(value);
+        } else if(parser.IsKey("deviceId")) {
+            valid = ReadAsString(parser, decoded.m_devId) && valid;
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    Result result = Finish(parser, valid ? DECODE_OK : DECODE_INVALID);
+    if(result == DECODE_OK) {
+        quota = decoded;
+    }
+    return result;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeWriteReply(const std::string& json, WriteReply& reply)
+{
+    reply = WriteReply();
+
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_INVALID);
+    }
+
+    int64_t value = 0;
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("totalWritten")) {
+            reply.hasTotal = ReadIntegral(parser, value) && value >= 0;
+            reply.totalWritten = static_cast<uint64_t>(value);
+        } else if(parser.IsKey("responses") && parser.Next() == Parser::TOKEN_ARRAY_BEGIN) {
+            reply.hasResponses = true;
+            reply.written.clear();
+            while(parser.Next() != Parser::TOKEN_ARRAY_END && parser.GetToken() != Parser::TOKEN_ERROR)
+            {
+                if(parser.GetToken() != Parser::TOKEN_OBJECT_BEGIN) {
+                    parser.SkipValue();
+                    continue;
+                }
+
+                std::pair<std::string, uint64_t> node;
+                bool hasHref = false;
+                bool hasWritten = false;
+                while(parser.Next() == Parser::TOKEN_KEY)
+                {
+                    if(parser.IsKey("href")) {
+                        hasHref = ReadString(parser, node.first);
+                    } else if(parser.IsKey("written")) {
+                        hasWritten = ReadIntegral(parser, value) && value >= 0;
+                        node.second = static_cast<uint64_t>(value);
+                    } else {
+                        parser.SkipValue();
+                    }
+                }
+
+                if(hasHref && hasWritten) {
+                    reply.written.push_back(node);
+                }
+            }
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    return Finish(parser, DECODE_OK);
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::DecodeErrorCode(const std::string& json, int& code)
+{
+    code = 0;
+
+    Parser parser(json);
+    if(!BeginObject(parser)) {
+        return Finish(parser, DECODE_INVALID);
+    }
+
+    int64_t value = 0;
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("code")) {
+            bool integral = ReadIntegral(parser, value) && value >= INT_MIN_VALUE && value <= INT_MAX_VALUE;
+            code = integral ? static_cast<int>(value) : 0;
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    return Finish(parser, DECODE_OK);
+}
+
+bool IOT_ResponseDecoder::DecodeDeviceObject(IOT_JsonPullParser& parser, IOT_GetDevice& device)
+{
+    unsigned int found = 0;
+    bool valid = true;
+    std::string value;
+
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("deviceId")) {
+            valid = ReadString(parser, value) && device.SetDeviceID(value) && valid;
+            found |= DEVICE_ID;
+        } else if(parser.IsKey("href")) {
+            valid = ReadString(parser, value) && device.SetHref(value) && valid;
+            found |= DEVICE_HREF;
+        } else if(parser.IsKey("createdAt")) {
+            valid = ReadString(parser, value) && device.SetCreated(value) && valid;
+            found |= DEVICE_CREATED;
+        } else if(parser.IsKey("name")) {
+            valid = ReadString(parser, value) && device.SetName(value) && valid;
+            found |= DEVICE_NAME;
+        } else if(parser.IsKey("manufacturer")) {
+            valid = ReadString(parser, value) && device.SetManufacturer(value) && valid;
+            found |= DEVICE_MANUFACTURER;
+        } else if(parser.IsKey("type")) {
+            if(ReadString(parser, value)) {
+                valid = device.SetType(value) && valid;
+            }
+        } else if(parser.IsKey("description")) {
+            if(ReadString(parser, value)) {
+                valid = device.SetDescription(value) && valid;
+            }
+        } else if(parser.IsKey("attributes") && parser.Next() == Parser::TOKEN_ARRAY_BEGIN) {
+            while(parser.Next() != Parser::TOKEN_ARRAY_END && parser.GetToken() != Parser::TOKEN_ERROR)
+            {
+                if(parser.GetToken() != Parser::TOKEN_OBJECT_BEGIN) {
+                    parser.SkipValue();
+                    continue;
+                }
+
+                // Attributes without a string key and value are ignored
+                std::string key;
+                bool hasKey = false;
+                bool hasValue = false;
+                while(parser.Next() == Parser::TOKEN_KEY)
+                {
+                    if(parser.IsKey("key")) {
+                        hasKey = ReadString(parser, key);
+                    } else if(parser.IsKey("value")) {
+                        hasValue = ReadString(parser, value);
+                    } else {
+                        parser.SkipValue();
+                    }
+                }
+
+                if(hasKey && hasValue) {
+                    valid = device.AppendAttribute(key, value) && valid;
+                }
+            }
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    return valid && found == DEVICE_MANDATORY && parser.GetToken() == Parser::TOKEN_OBJECT_END;
+}
+
+bool IOT_ResponseDecoder::DecodeDatanodeObject(IOT_JsonPullParser& parser, IOT_ReadData& data)
+{
+    bool valid = true;
+    std::string value;
+    int64_t ts = 0;
+
+    while(parser.Next() == Parser::TOKEN_KEY)
+    {
+        if(parser.IsKey("name")) {
+            valid = ReadAsString(parser, data.m_name) && valid;
+        } else if(parser.IsKey("dataType")) {
+            valid = ReadAsString(parser, value) && valid;
+            data.m_dataType = data.ConvertToDatatype(value);
+        } else if(parser.IsKey("path")) {
+            if(!ReadString(parser, data.m_path)) {
+                data.m_path.clear();
+            }
+        } else if(parser.IsKey("unit")) {
+            if(!ReadString(parser, data.m_unit)) {
+                data.m_unit.clear();
+            }
+        } else if(parser.IsKey("values") && parser.Next() == Parser::TOKEN_ARRAY_BEGIN) {
+            while(parser.Next() != Parser::TOKEN_ARRAY_END && parser.GetToken() != Parser::TOKEN_ERROR)
+            {
+                if(parser.GetToken() != Parser::TOKEN_OBJECT_BEGIN) {
+                    valid = false;
+                    parser.SkipValue();
+                    continue;
+                }
+
+                IOT_ReadData::process_value_t sample(0, std::string());
+                while(parser.Next() == Parser::TOKEN_KEY)
+                {
+                    if(parser.IsKey("ts")) {
+                        valid = ReadAsInt(parser, 0, INT64_MAX_VALUE, ts) && valid;
+                        sample.first = static_cast<unsigned long>(ts);
+                    } else if(parser.IsKey("v")) {
+                        valid = ReadAsString(parser, sample.second) && valid;
+                    } else {
+                        parser.SkipValue();
+                    }
+                }
+                data.m_processData.push_back(std::move(sample));
+            }
+        } else {
+            parser.SkipValue();
+        }
+    }
+
+    return valid && parser.GetToken() == Parser::TOKEN_OBJECT_END;
+}
+
+bool IOT_ResponseDecoder::ReadString(IOT_JsonPullParser& parser, std::string& value)
+{
+    if(parser.Next() == Parser::TOKEN_STRING) {
+        value = parser.GetString();
+        return true;
+    }
+
+    parser.SkipValue();
+    return false;
+}
+
+bool IOT_ResponseDecoder::ReadAsString(IOT_JsonPullParser& parser, std::string& value)
+{
+    switch(parser.Next()) {
+    case Parser::TOKEN_STRING:
+        value = parser.GetString();
+        return true;
+    case Parser::TOKEN_NULL:
+        value.clear();
+        return true;
+    case Parser::TOKEN_TRUE:
+        value = "true";
+        return true;
+    case Parser::TOKEN_FALSE:
+        value = "false";
+        return true;
+    default:
+        parser.SkipValue();
+        return false;
+    }
+}
+
+bool IOT_ResponseDecoder::ReadIntegral(IOT_JsonPullParser& parser, int64_t& value)
+{
+    switch(parser.Next()) {
+    case Parser::TOKEN_NUMBER:
+        return parser.GetInt64(value);
+    case Parser::TOKEN_TRUE:
+        value = 1;
+        return true;
+    case Parser::TOKEN_FALSE:
+        value = 0;
+        return true;
+    default:
+        parser.SkipValue();
+        return false;
+    }
+}
+
+bool IOT_ResponseDecoder::ReadAsInt(IOT_JsonPullParser& parser, int64_t min, int64_t max, int64_t& value)
+{
+    double real = 0.0;
+
+    switch(parser.Next()) {
+    case Parser::TOKEN_NUMBER:
+        if(parser.GetInt64(value)) {
+            return value >= min && value <= max;
+        }
+        // Fractions are truncated, values out of range are rejected
+        if(!parser.GetDouble(real) || real < static_cast<double>(min) || real >= static_cast<double>(max) + 1.0) {
+            return false;
+        }
+        value = static_cast<int64_t>(real);
+        return true;
+    case Parser::TOKEN_NULL:
+    case Parser::TOKEN_FALSE:
+        value = 0;
+        return value >= min && value <= max;
+    case Parser::TOKEN_TRUE:
+        value = 1;
+        return value >= min && value <= max;
+    default:
+        parser.SkipValue();
+        return false;
+    }
+}
+
+bool IOT_ResponseDecoder::BeginObject(IOT_JsonPullParser& parser)
+{
+    return parser.Next() == Parser::TOKEN_OBJECT_BEGIN;
+}
+
+IOT_ResponseDecoder::Result IOT_ResponseDecoder::Finish(IOT_JsonPullParser& parser, Result result)
+{
+    return parser.SkipToEnd() ? result : DECODE_MALFORMED;
+}
@@ -0,0 +1,121 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_RESPONSEDECODER_H
+#define IOT_RESPONSEDECODER_H
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IOT_GetDevice.h"
+#include "IOT_ReadData.h"
+#include "IOT_Quota.h"
+#include "IOT_QuotaDevice.h"
+#include "IOT_JsonPullParser.h"
+
+//! \brief Decoders for IoT-Ticket server replies
+//! \note Each decoder reads one reply shape with IOT_JsonPullParser and fills
+//!       the result objects while parsing, without building a Json::Value
+//!       tree. Field conversions follow the FromJSON() functions of the
+//!       result types.
+class IOT_ResponseDecoder
+{
+public:
+    typedef enum
+    {
+        DECODE_OK,          //!< Reply was decoded
+        DECODE_INVALID,     //!< Reply is valid JSON but its content is not
+        DECODE_MALFORMED    //!< Reply is not valid JSON
+    } Result;
+
+    //! Reply of a write request
+    struct WriteReply
+    {
+        WriteReply(): hasTotal(false), totalWritten(0), hasResponses(false) {}
+
+        bool hasTotal;
+        uint64_t totalWritten;
+
+        //! True if the reply contained the per datanode results
+        bool hasResponses;
+
+        //! Href and written sample count of each datanode
+        std::vector<std::pair<std::string, uint64_t> > written;
+    };
+
+    //! \brief Decode device list, invalid devices are left out
+    static Result DecodeDevices(const std::string& json, std::vector<IOT_GetDevice>& devices);
+
+    //! \brief Decode single device
+    //! \note device is changed only if DECODE_OK is returned
+    static Result DecodeDevice(const std::string& json, IOT_GetDevice& device);
+
+    //! \brief Decode device id of a device registration reply
+    //! \note devId is changed only if DECODE_OK is returned
+    static Result DecodeDeviceId(const std::string& json, std::string& devId);
+
+    //! \brief Decode datanodes from the array member listKey and append them to data
+    //! \note Decoding stops at the first invalid datanode with DECODE_INVALID. On
+    //!       DECODE_MALFORMED nothing is appended.
+    //! \param [in] listKey - "datanodeReads" for process reads, "items" for datanode lists
+    static Result DecodeDatanodes(const std::string& json, const char* listKey, std::vector<IOT_ReadData>& data);
+
+    //! \note quota is changed only if DECODE_OK is returned
+    static Result DecodeQuota(const std::string& json, IOT_Quota& quota);
+
+    //! \note quota is changed only if DECODE_OK is returned
+    static Result DecodeQuotaDevice(const std::string& json, IOT_QuotaDevice& quota);
+
+    static Result DecodeWriteReply(const std::string& json, WriteReply& reply);
+
+    //! \brief Decode IoT-Ticket error code of an error reply, 0 if there is none
+    static Result DecodeErrorCode(const std::string& json, int& code);
+
+private:
+    //! Decode device object, parser is at its TOKEN_OBJECT_BEGIN
+    static bool DecodeDeviceObject(IOT_JsonPullParser& parser, IOT_GetDevice& device);
+
+    //! Decode datanode object, parser is at its TOKEN_OBJECT_BEGIN
+    static bool DecodeDatanodeObject(IOT_JsonPullParser& parser, IOT_ReadData& data);
+
+    //! Read member value as string, accepting only JSON strings
+    static bool ReadString(IOT_JsonPullParser& parser, std::string& value);
+
+    //! Read member value converted to string like Json::Value::asString()
+    static bool ReadAsString(IOT_JsonPullParser& parser, std::string& value);
+
+    //! Read member value that must be an integer or boolean like Json::Value::isIntegral()
+    static bool ReadIntegral(IOT_JsonPullParser& parser, int64_t& value);
+
+    //! Read member value converted to integer in [min, max] like Json::Value::asInt64()
+    static bool ReadAsInt(IOT_JsonPullParser& parser, int64_t min, int64_t max, int64_t& value);
+
+    //! Read the first token and check that the document is an object
+    static bool BeginObject(IOT_JsonPullParser& parser);
+
+    //! Check rest of the document, a syntax error overrides the result
+    static Result Finish(IOT_JsonPullParser& parser, Result result);
+};
+
+#endif // IOT_RESPONSEDECODER_H
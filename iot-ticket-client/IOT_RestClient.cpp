@@ -21,19 +21,32 @@
  */
 
 #include "IOT_RestClient.h"
+#include "IOT_Base64.h"
+#include "IOT_SessionFile.h"
 
 #include <string.h>
 #include <algorithm>
 #include <iostream>
+#include <stdint.h>
+#include <time.h>
 
 const size_t IOT_RestClient::REST_DEFAULT_REQ_MAX_SIZE = 50000;
 
-bool IOT_RestClient::m_globalInit = false;
+//! Max time to block in curl_multi_wait() when waiting for parallel requests
+static const int MULTI_WAIT_MS = 1000;
 
-static const long unsigned int HTTP_STATUS_OK           = 200;
-static const long unsigned int HTTP_STATUS_CREATED      = 201;
-static const long unsigned int HTTP_STATUS_ACCEPTED     = 202;
-static const long unsigned int HTTP_STATUS_UNAUTHORIZED = 401;
+//! libcurl defaults for name cache lifetime and max idle age of reused connections
+static const long DEFAULT_DNS_CACHE_S = 60;
+static const long DEFAULT_MAX_IDLE_S  = 118;
+
+std::once_flag IOT_RestClient::m_globalInit;
+
+static const long unsigned int HTTP_STATUS_OK                    = 200;
+static const long unsigned int HTTP_STATUS_CREATED               = 201;
+static const long unsigned int HTTP_STATUS_ACCEPTED              = 202;
+static const long unsigned int HTTP_STATUS_UNAUTHORIZED          = 401;
+static const long unsigned int HTTP_STATUS_TOO_MANY_REQUESTS     = 429;
+static const long unsigned int HTTP_STATUS_SERVICE_UNAVAILABLE   = 503;
 
 
 int IOT_RestClient::ReadServerResponse(char* data, size_t size, size_t nmemb, void* buffer_in)
@@ -88,11 +101,15 @@ size_t IOT_RestClient::WriteToServer(void *ptr, size_t size, size_t nmemb, void
 
 
 IOT_RestClient::IOT_RestClient():
-    m_maxRequestSize(REST_DEFAULT_REQ_MAX_SIZE)
+    m_maxRequestSize(REST_DEFAULT_REQ_MAX_SIZE), m_timeout_s(0), m_httpVersion(IOTAPI::IOT_HTTP_DEFAULT),
+    m_share(NULL), m_prepared(NULL), m_preparedHeaders(NULL), m_multi(NULL)
 {
-    if(!m_globalInit) {
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        m_globalInit = true;
+    std::call_once(m_globalInit, curl_global_init, CURL_GLOBAL_DEFAULT);
+
+    // Connections of parallel and prepared requests resume sessions of the others
+    m_share = curl_share_init();
+    if(m_share != NULL) {
+        curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
     }
 
     m_curl = curl_easy_init();
@@ -102,14 +119,39 @@ IOT_RestClient::IOT_RestClient():
     m_headers = curl_slist_append(m_headers, "Expect: ");
     m_headers = curl_slist_append(m_headers, "charsets: utf-8");
 
-    curl_easy_setopt(m_curl, CURLOPT_NOSIGNAL, 1);
+    InitHandle(m_curl);
 }
 
 
 IOT_RestClient::~IOT_RestClient()
 {
+    for(size_t i = 0; i < m_parallel.size(); ++i) {
+        curl_easy_cleanup(m_parallel[i]);
+    }
+    m_parallel.clear();
+
+    if(m_multi != NULL) {
+        curl_multi_cleanup(m_multi);
+        m_multi = NULL;
+    }
+
     curl_easy_cleanup(m_curl);
     m_curl = NULL;
+
+    if(m_prepared != NULL) {
+        curl_easy_cleanup(m_prepared);
+        m_prepared = NULL;
+    }
+    curl_slist_free_all(m_preparedHeaders);
+    m_preparedHeaders = NULL;
+
+    curl_slist_free_all(m_headers);
+    m_headers = NULL;
+
+    if(m_share != NULL) {
+        curl_share_cleanup(m_share);
+        m_share = NULL;
+    }
 }
 
 
@@ -120,15 +162,124 @@ void IOT_RestClient::SetMaxResponseSize(size_t size)
 
 void IOT_RestClient::SetRequestTimeout(size_t timeout_s)
 {
-    curl_easy_setopt(m_curl, CURLOPT_TIMEOUT, timeout_s);
-    curl_easy_setopt(m_curl, CURLOPT_CONNECTTIMEOUT, timeout_s);
+    m_timeout_s = timeout_s;
+    InitHandle(m_curl);
+
+    if(m_prepared != NULL) {
+        InitHandle(m_prepared);
+    }
+
+    for(size_t i = 0; i < m_parallel.size(); ++i) {
+        InitHandle(m_parallel[i]);
+    }
 }
 
 
-IOTAPI::IOTAPI_err IOT_RestClient::GetResource(const std::string& url, const std::string& user, const std::string& pw, std::string& response) const
+IOTAPI::IOTAPI_err IOT_RestClient::SetHttpVersion(IOTAPI::IOT_HttpVersion version)
+{
+    if(!IsHttpVersionSupported(version)) {
+        return IOTAPI::IOT_ERR_PARAM;
+    }
+
+    m_httpVersion = version;
+    InitHandle(m_curl);
+
+    if(m_prepared != NULL) {
+        InitHandle(m_prepared);
+    }
+
+    for(size_t i = 0; i < m_parallel.size(); ++i) {
+        InitHandle(m_parallel[i]);
+    }
+
+    return IOTAPI::IOT_ERR_OK;
+}
+
+void IOT_RestClient::SetKeepAlive(const IOT_KeepAlive& policy)
+{
+    m_keepAlive = policy;
+    InitHandle(m_curl);
+
+    if(m_prepared != NULL) {
+        InitHandle(m_prepared);
+    }
+
+    for(size_t i = 0; i < m_parallel.size(); ++i) {
+        InitHandle(m_parallel[i]);
+    }
+}
+
+IOTAPI::IOTAPI_err IOT_RestClient::Warmup(const std::string& url, IOT_RequestTiming* timing) const
+{
+    CreateCurlCall(m_curl, url, false, "", "");
+
+    CURLcode res = PerformCurlCall(NULL, NULL);
+    long http_code = 0;
+    curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &http_code);
+    FetchTiming(m_curl, http_code, timing);
+    SaveSessions(m_curl);
+
+    return (res == CURLE_OK) ? IOTAPI::IOT_ERR_OK : GetReturnCode(m_curl, 0, res);
+}
+
+IOTAPI::IOTAPI_err IOT_RestClient::SetSessionFile(const std::string& path)
+{
+    if(!IsSessionFileSupported() || path.empty() || m_share == NULL) {
+        return IOTAPI::IOT_ERR_PARAM;
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    m_sessionFile = path;
+
+    std::vector<IOT_SessionFile::Entry> entries;
+    IOT_SessionFile::Read(path, static_cast<int64_t>(time(NULL)), entries);
+    for(size_t i = 0; i < entries.size(); ++i) {
+        const IOT_SessionFile::Entry& entry = entries[i];
+        curl_easy_ssls_import(m_curl, entry.key.empty() ? NULL : entry.key.c_str(),
+                              entry.shmac.empty() ? NULL : entry.shmac.data(), entry.shmac.size(),
+                              entry.data.data(), entry.data.size());
+    }
+#endif
+    return IOTAPI::IOT_ERR_OK;
+}
+
+bool IOT_RestClient::IsSessionFileSupported()
+{
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    // Session export and import are available since libcurl 8.12.0, if it is built with them
+    const curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+    if(info->version_num < 0x080c00 || info->feature_names == NULL) {
+        return false;
+    }
+    for(const char* const* name = info->feature_names; *name != NULL; ++name) {
+        if(strcmp(*name, "SSLS-EXPORT") == 0) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+bool IOT_RestClient::IsHttpVersionSupported(IOTAPI::IOT_HttpVersion version)
+{
+    switch(version)
+    {
+    case IOTAPI::IOT_HTTP_DEFAULT:
+    case IOTAPI::IOT_HTTP_1_1:
+        return true;
+    case IOTAPI::IOT_HTTP_2:
+    case IOTAPI::IOT_HTTP_2_PRIOR_KNOWLEDGE:
+        return (curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2) != 0;
+    }
+    return false;
+}
+
+
+IOTAPI::IOTAPI_err IOT_RestClient::GetResource(const std::string& url, const std::string& user, const std::string& pw, std::string& response,
+                                               IOT_RequestTiming* timing) const
 {
     response.clear();
-    CreateCurlCall(url, false, user, pw);
+    CreateCurlCall(m_curl, url, false, user, pw);
 
     CURLcode res;
     ReadData rdata;
@@ -138,15 +289,17 @@ IOTAPI::IOTAPI_err IOT_RestClient::GetResource(const std::string& url, const std
 
     res = PerformCurlCall(&rdata, NULL);
     curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &http_code);
+    FetchTiming(m_curl, http_code, timing);
+    SaveSessions(m_curl);
 
-    return GetReturnCode(http_code, res);
+    return GetReturnCode(m_curl, http_code, res);
 }
 
 
 IOTAPI::IOTAPI_err IOT_RestClient::PostAndReadResponse(const std::string& url, const std::string& user, const std::string& pw,
-                                     const std::string& data, std::string& response) const
+                                     const std::string& data, std::string& response, IOT_RequestTiming* timing) const
 {
-    CreateCurlCall(url, true, user, pw);
+    CreateCurlCall(m_curl, url, true, user, pw);
     response.clear();
 
     CURLcode res;
@@ -162,33 +315,91 @@ IOTAPI::IOTAPI_err IOT_RestClient::PostAndReadResponse(const std::string& url, c
 
     res = PerformCurlCall(&rdata, &wdata);
     curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &http_code);
+    FetchTiming(m_curl, http_code, timing);
+    SaveSessions(m_curl);
 
-    return GetReturnCode(http_code, res);
+    return GetReturnCode(m_curl, http_code, res);
 }
 
 
 
-void IOT_RestClient::CreateCurlCall(std::string url, bool postCall, std::string user, std::string pw) const
+IOTAPI::IOTAPI_err IOT_RestClient::PreparePost(const std::string& url, const std::string& user, const std::string& pw)
+{
+    if(m_prepared == NULL) {
+        m_prepared = curl_easy_init();
+        if(m_prepared == NULL) {
+            return IOTAPI::IOT_ERR_CURL_CALL;
+        }
+        InitHandle(m_prepared);
+    }
+
+    // Same headers as other requests, with basic authorization encoded once
+    curl_slist_free_all(m_preparedHeaders);
+    m_preparedHeaders = NULL;
+    for(curl_slist* header = m_headers; header != NULL; header = header->next) {
+        m_preparedHeaders = curl_slist_append(m_preparedHeaders, header->data);
+    }
+    if(!user.empty()) {
+        std::string credentials = user + ":" + pw;
+        std::string authorization = "Authorization: Basic " +
+            IOT_Base64::encode(reinterpret_cast<const uint8_t*>(credentials.data()), credentials.size());
+        m_preparedHeaders = curl_slist_append(m_preparedHeaders, authorization.c_str());
+    }
+
+    // Options not changed by CreateCurlCall() stay as set here
+    CreateCurlCall(m_prepared, url, true, std::string(), std::string());
+    curl_easy_setopt(m_prepared, CURLOPT_HTTPHEADER, m_preparedHeaders);
+    curl_easy_setopt(m_prepared, CURLOPT_WRITEFUNCTION, ReadServerResponse);
+    curl_easy_setopt(m_prepared, CURLOPT_WRITEDATA, &m_preparedRead);
+
+    return IOTAPI::IOT_ERR_OK;
+}
+
+IOTAPI::IOTAPI_err IOT_RestClient::PostPrepared(const std::string& data, std::string& response,
+                                                IOT_RequestTiming* timing) const
+{
+    if(m_prepared == NULL) {
+        return IOTAPI::IOT_ERR_INITIALIZED;
+    }
+
+    response.clear();
+    m_preparedRead.data = &response;
+    m_preparedRead.maxSize = m_maxRequestSize;
+
+    curl_easy_setopt(m_prepared, CURLOPT_POSTFIELDSIZE, static_cast<long>(data.size()));
+    curl_easy_setopt(m_prepared, CURLOPT_POSTFIELDS, data.data());
+
+    long http_code = 0;
+    CURLcode res = curl_easy_perform(m_prepared);
+    curl_easy_getinfo(m_prepared, CURLINFO_RESPONSE_CODE, &http_code);
+    FetchTiming(m_prepared, http_code, timing);
+    SaveSessions(m_prepared);
+
+    return GetReturnCode(m_prepared, http_code, res);
+}
+
+
+void IOT_RestClient::CreateCurlCall(CURL* curl, std::string url, bool postCall, std::string user, std::string pw) const
 {
     //curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
-    curl_easy_setopt(m_curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
     if(!user.empty()) {
-        curl_easy_setopt(m_curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+        curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
         std::string basicAuth = user + ":" + pw;
-        curl_easy_setopt(m_curl, CURLOPT_USERPWD, basicAuth.c_str());
+        curl_easy_setopt(curl, CURLOPT_USERPWD, basicAuth.c_str());
     }
     else {
-        curl_easy_setopt(m_curl, CURLOPT_HTTPAUTH, 0);
+        curl_easy_setopt(curl, CURLOPT_HTTPAUTH, 0);
     }
 
-    curl_easy_setopt(m_curl, CURLOPT_HTTPHEADER, m_headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_headers);
 
     if(postCall) {
-        curl_easy_setopt(m_curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
     } else {
-        curl_easy_setopt(m_curl, CURLOPT_POST, 0L);
+        curl_easy_setopt(curl, CURLOPT_POST, 0L);
     }
 
 #define SKIP_PEER_VERIFICATION
@@ -205,7 +416,7 @@ void IOT_RestClient::CreateCurlCall(std::string url, bool postCall, std::string
      * default bundle, then the CURLOPT_CAPATH option might come handy for
      * you.
      */
-    curl_easy_setopt(m_curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
 #endif
 
 #ifdef SKIP_HOSTNAME_VERIFICATION
@@ -215,32 +426,307 @@ void IOT_RestClient::CreateCurlCall(std::string url, bool postCall, std::string
      * subjectAltName) fields, libcurl will refuse to connect. You can skip
      * this check, but this will make the connection less secure.
      */
-    curl_easy_setopt(m_curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
 #endif
 }
 
 CURLcode IOT_RestClient::PerformCurlCall(ReadData* readPtr, WriteData* writePtr) const
+{
+    SetTransferData(m_curl, readPtr, writePtr);
+    return curl_easy_perform(m_curl);
+}
+
+void IOT_RestClient::SetTransferData(CURL* curl, ReadData* readPtr, WriteData* writePtr) const
 {
     if(writePtr != NULL) {
-        curl_easy_setopt(m_curl, CURLOPT_READFUNCTION, WriteToServer);
-        curl_easy_setopt(m_curl, CURLOPT_READDATA, writePtr);
-        curl_easy_setopt(m_curl, CURLOPT_POSTFIELDSIZE, writePtr->data->size());
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, WriteToServer);
+        curl_easy_setopt(curl, CURLOPT_READDATA, writePtr);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, writePtr->data->size());
     }
     else {
-        curl_easy_setopt(m_curl, CURLOPT_POSTFIELDSIZE, 0);
-        curl_easy_setopt(m_curl, CURLOPT_READDATA, NULL);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0);
+        curl_easy_setopt(curl, CURLOPT_READDATA, NULL);
     }
 
     if(readPtr != NULL) {
-        curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, ReadServerResponse);
-        curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, readPtr);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ReadServerResponse);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, readPtr);
     }
     else {
-        curl_easy_setopt(m_curl, CURLOPT_WRITEFUNCTION, DiscardServerResponse);
-        curl_easy_setopt(m_curl, CURLOPT_WRITEDATA, NULL);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardServerResponse);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
     }
+}
 
-    return curl_easy_perform(m_curl);
+IOTAPI::IOTAPI_err IOT_RestClient::PostMultiple(const std::string& url, const std::string& user, const std::string& pw,
+                                                const std::vector<const std::string*>& payloads, size_t maxParallel,
+                                                std::vector<std::string>& responses, std::vector<IOTAPI::IOTAPI_err>& results,
+                                                std::vector<IOT_RequestTiming>* timings) const
+{
+    size_t count = payloads.size();
+    responses.assign(count, std::string());
+    results.assign(count, IOTAPI::IOT_ERR_GENERAL);
+    if(timings != NULL) {
+        timings->assign(count, IOT_RequestTiming());
+    }
+
+    if(count == 0) {
+        return IOTAPI::IOT_ERR_OK;
+    }
+
+    maxParallel = std::max<size_t>(1, std::min(maxParallel, count));
+
+    if(m_multi == NULL) {
+        m_multi = curl_multi_init();
+        if(m_multi == NULL) {
+            return IOTAPI::IOT_ERR_CURL_CALL;
+        }
+    }
+    curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(maxParallel));
+    curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, static_cast<long>(CURLPIPE_MULTIPLEX));
+
+    while(m_parallel.size() < maxParallel) {
+        CURL* handle = curl_easy_init();
+        if(handle == NULL) {
+            break;
+        }
+        InitHandle(handle);
+        m_parallel.push_back(handle);
+    }
+
+    if(m_parallel.empty()) {
+        return IOTAPI::IOT_ERR_CURL_CALL;
+    }
+    maxParallel = std::min(maxParallel, m_parallel.size());
+
+    std::vector<ReadData> rdata(count);
+    std::vector<WriteData> wdata(count);
+    size_t next = 0;
+    size_t inFlight = 0;
+
+    for(size_t i = 0; i < maxParallel; ++i) {
+        StartParallelCall(m_parallel[i], next, url, user, pw, payloads, responses, rdata, wdata);
+        ++next;
+        ++inFlight;
+    }
+
+    while(inFlight > 0) {
+        int running = 0;
+        curl_multi_perform(m_multi, &running);
+
+        int left = 0;
+        CURLMsg* msg = NULL;
+        while((msg = curl_multi_info_read(m_multi, &left)) != NULL) {
+            if(msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            CURL* handle = msg->easy_handle;
+            CURLcode code = msg->data.result;
+
+            char* priv = NULL;
+            curl_easy_getinfo(handle, CURLINFO_PRIVATE, &priv);
+            size_t index = static_cast<size_t>(reinterpret_cast<uintptr_t>(priv));
+
+            long http_code = 0;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &http_code);
+            FetchTiming(handle, http_code, (timings != NULL) ? &timings->at(index) : NULL);
+            SaveSessions(handle);
+            results[index] = GetReturnCode(handle, http_code, code);
+
+            curl_multi_remove_handle(m_multi, handle);
+            --inFlight;
+
+            if(next < count) {
+                StartParallelCall(handle, next, url, user, pw, payloads, responses, rdata, wdata);
+                ++next;
+                ++inFlight;
+            }
+        }
+
+        if(inFlight > 0) {
+            curl_multi_wait(m_multi, NULL, 0, MULTI_WAIT_MS, NULL);
+        }
+    }
+
+    for(size_t i = 0; i < count; ++i) {
+        if(results[i] != IOTAPI::IOT_ERR_OK) {
+            return results[i];
+        }
+    }
+
+    return IOTAPI::IOT_ERR_OK;
+}
+
+void IOT_RestClient::StartParallelCall(CURL* handle, size_t index, const std::string& url, const std::string& user,
+                                       const std::string& pw, const std::vector<const std::string*>& payloads,
+                                       std::vector<std::string>& responses, std::vector<ReadData>& rdata,
+                                       std::vector<WriteData>& wdata) const
+{
+    CreateCurlCall(handle, url, true, user, pw);
+
+    wdata[index].data = payloads[index];
+    wdata[index].pos = 0;
+    rdata[index].data = &responses[index];
+    rdata[index].maxSize = m_maxRequestSize;
+
+    SetTransferData(handle, &rdata[index], &wdata[index]);
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, reinterpret_cast<void*>(static_cast<uintptr_t>(index)));
+    curl_multi_add_handle(m_multi, handle);
+}
+
+void IOT_RestClient::InitHandle(CURL* handle) const
+{
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1);
+    curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+
+    long version = CURL_HTTP_VERSION_NONE;
+    switch(m_httpVersion)
+    {
+    case IOTAPI::IOT_HTTP_DEFAULT:           version = CURL_HTTP_VERSION_NONE; break;
+    case IOTAPI::IOT_HTTP_1_1:               version = CURL_HTTP_VERSION_1_1; break;
+    case IOTAPI::IOT_HTTP_2:                 version = CURL_HTTP_VERSION_2TLS; break;
+    case IOTAPI::IOT_HTTP_2_PRIOR_KNOWLEDGE: version = CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE; break;
+    }
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, version);
+
+    // Concurrent requests wait for a connection they can multiplex on instead of opening new ones
+    bool multiplex = (m_httpVersion == IOTAPI::IOT_HTTP_2 || m_httpVersion == IOTAPI::IOT_HTTP_2_PRIOR_KNOWLEDGE);
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, multiplex ? 1L : 0L);
+
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, m_keepAlive.tcpKeepAlive ? 1L : 0L);
+    if(m_keepAlive.tcpKeepAlive) {
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, static_cast<long>(m_keepAlive.probeIdleS));
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, static_cast<long>(m_keepAlive.probeIntervalS));
+    }
+
+    // 0 restores the libcurl defaults
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT,
+                     static_cast<long>((m_keepAlive.dnsCacheS > 0) ? m_keepAlive.dnsCacheS : DEFAULT_DNS_CACHE_S));
+#if LIBCURL_VERSION_NUM >= 0x074100
+    // Max idle age of reused connections is available since libcurl 7.65.0
+    curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN,
+                     static_cast<long>((m_keepAlive.maxIdleS > 0) ? m_keepAlive.maxIdleS : DEFAULT_MAX_IDLE_S));
+#endif
+
+    if(m_timeout_s > 0) {
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT, m_timeout_s);
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, m_timeout_s);
+    }
+}
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+//! libcurl callback collecting exported sessions
+static CURLcode CollectSession(CURL* /*handle*/, void* userptr, const char* session_key,
+                               const unsigned char* shmac, size_t shmac_len,
+                               const unsigned char* sdata, size_t sdata_len, curl_off_t valid_until,
+                               int /*ietf_tls_id*/, const char* /*alpn*/, size_t /*earlydata_max*/)
+{
+    IOT_SessionFile::Entry entry;
+    if(session_key != NULL) {
+        entry.key = session_key;
+    }
+    if(shmac != NULL) {
+        entry.shmac.assign(shmac, shmac + shmac_len);
+    }
+    entry.data.assign(sdata, sdata + sdata_len);
+    entry.validUntil = static_cast<int64_t>(valid_until);
+    static_cast<std::vector<IOT_SessionFile::Entry>*>(userptr)->push_back(entry);
+    return CURLE_OK;
+}
+#endif
+
+void IOT_RestClient::SaveSessions(CURL* handle) const
+{
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    if(m_sessionFile.empty()) {
+        return;
+    }
+
+    // Only a new TLS connection can bring a new session
+    long connects = 0;
+    curl_off_t appConnect = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appConnect);
+    if(connects == 0 || appConnect == 0) {
+        return;
+    }
+
+    std::vector<IOT_SessionFile::Entry> entries;
+    if(curl_easy_ssls_export(handle, CollectSession, &entries) == CURLE_OK && !entries.empty()) {
+        IOT_SessionFile::Merge(m_sessionFile, static_cast<int64_t>(time(NULL)), entries);
+    }
+#else
+    (void)handle;
+#endif
+}
+
+void IOT_RestClient::FetchTiming(CURL* curl, long httpCode, IOT_RequestTiming* timing) const
+{
+    if(timing == NULL) {
+        return;
+    }
+
+    *timing = IOT_RequestTiming();
+    timing->httpCode = httpCode;
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+    // Microsecond resolution variants are available since libcurl 7.61.0
+    curl_off_t us = 0;
+    if(curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &us) == CURLE_OK)
+        timing->nameLookupMs = us / 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &us) == CURLE_OK)
+        timing->connectMs = us / 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &us) == CURLE_OK)
+        timing->appConnectMs = us / 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &us) == CURLE_OK)
+        timing->preTransferMs = us / 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &us) == CURLE_OK)
+        timing->startTransferMs = us / 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &us) == CURLE_OK)
+        timing->totalMs = us / 1000.0;
+
+    curl_off_t bytes = 0;
+    if(curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &bytes) == CURLE_OK)
+        timing->bytesUp = static_cast<uint64_t>(bytes);
+    if(curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytes) == CURLE_OK)
+        timing->bytesDown = static_cast<uint64_t>(bytes);
+#else
+    double s = 0.0;
+    if(curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &s) == CURLE_OK)
+        timing->nameLookupMs = s * 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &s) == CURLE_OK)
+        timing->connectMs = s * 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &s) == CURLE_OK)
+        timing->appConnectMs = s * 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME, &s) == CURLE_OK)
+        timing->preTransferMs = s * 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &s) == CURLE_OK)
+        timing->startTransferMs = s * 1000.0;
+    if(curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &s) == CURLE_OK)
+        timing->totalMs = s * 1000.0;
+
+    double bytes = 0.0;
+    if(curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &bytes) == CURLE_OK)
+        timing->bytesUp = static_cast<uint64_t>(bytes);
+    if(curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &bytes) == CURLE_OK)
+        timing->bytesDown = static_cast<uint64_t>(bytes);
+#endif
+
+#if LIBCURL_VERSION_NUM >= 0x074200
+    // Retry-After is parsed by libcurl since 7.66.0
+    curl_off_t retryAfter = 0;
+    if(curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter) == CURLE_OK)
+        timing->retryAfterS = static_cast<long>(retryAfter);
+#endif
+
+    // No new connections were needed if an existing one was reused. A
+    // transfer that failed to resolve or connect made no connection either,
+    // so only count it when the request got as far as being sent.
+    bool connected = (httpCode != 0) || (timing->preTransferMs > 0.0);
+    long connects = 0;
+    if(connected && curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects) == CURLE_OK)
+        timing->connectionReused = (connects == 0);
 }
 
 bool IOT_RestClient::HttpStatusSuccess(unsigned long status) const
@@ -249,7 +735,7 @@ bool IOT_RestClient::HttpStatusSuccess(unsigned long status) const
             (status == HTTP_STATUS_ACCEPTED);
 }
 
-IOTAPI::IOTAPI_err IOT_RestClient::GetReturnCode(long httpCode, CURLcode code) const
+IOTAPI::IOTAPI_err IOT_RestClient::GetReturnCode(CURL* handle, long httpCode, CURLcode code) const
 {
     if(HttpStatusSuccess(httpCode) && code == CURLE_OK)
         return IOTAPI::IOT_ERR_OK;
@@ -257,6 +743,12 @@ IOTAPI::IOTAPI_err IOT_RestClient::GetReturnCode(long httpCode, CURLcode code) c
     if(httpCode == HTTP_STATUS_UNAUTHORIZED)
         return IOTAPI::IOT_ERR_AUTH;
 
+    if(httpCode == HTTP_STATUS_TOO_MANY_REQUESTS)
+        return IOTAPI::IOT_ERR_THROTTLED;
+
+    if(httpCode == HTTP_STATUS_SERVICE_UNAVAILABLE)
+        return IOTAPI::IOT_ERR_SERVER;
+
     switch(code) {
     case CURLE_URL_MALFORMAT:
         return IOTAPI::IOT_ERR_PARAM;
@@ -269,9 +761,22 @@ IOTAPI::IOTAPI_err IOT_RestClient::GetReturnCode(long httpCode, CURLcode code) c
 
     case CURLE_COULDNT_RESOLVE_HOST:
     case CURLE_COULDNT_CONNECT:
-    case CURLE_OPERATION_TIMEDOUT:
         return IOTAPI::IOT_ERR_CONN;
 
+    case CURLE_OPERATION_TIMEDOUT:
+    {
+        // A timeout while connecting left the request unsent, a later one may
+        // have let the server process it
+#if LIBCURL_VERSION_NUM >= 0x073d00
+        curl_off_t preTransfer = 0;
+        curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &preTransfer);
+#else
+        double preTransfer = 0.0;
+        curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME, &preTransfer);
+#endif
+        return (preTransfer == 0) ? IOTAPI::IOT_ERR_CONN : IOTAPI::IOT_ERR_TIMEOUT;
+    }
+
     case CURLE_SSL_CONNECT_ERROR:
     case CURLE_SSL_ENGINE_NOTFOUND:
     case CURLE_SSL_ENGINE_SETFAILED:
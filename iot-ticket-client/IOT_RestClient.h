@@ -24,12 +24,19 @@
 #define IOT_RESTCLIENT_H
 
 #include <curl/curl.h>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "IOT_defines.h"
+#include "IOT_KeepAlive.h"
+#include "IOT_RequestTiming.h"
 
 //! \brief HTTP communication implemented using cUrl
 class IOT_RestClient
 {
+    //! Shares options, callbacks and error mapping with blocking requests
+    friend class IOT_AsyncTransport;
+
 public:
 
     IOT_RestClient();
@@ -43,13 +50,51 @@ public:
     //! \param [in] timeout_s - Set timeout for connect and GET/POST operations
     void SetRequestTimeout(size_t timeout_s);
 
+    //! \brief Set HTTP version of requests
+    //! \note With HTTP/2 concurrent requests to a server are multiplexed on one
+    //!       connection instead of opening a connection each.
+    //! \param [in] version - HTTP version
+    //! \return IOTAPI::IOT_ERR_PARAM if libcurl does not support the version
+    IOTAPI::IOTAPI_err SetHttpVersion(IOTAPI::IOT_HttpVersion version);
+
+    //! \brief Check if libcurl supports an HTTP version
+    static bool IsHttpVersionSupported(IOTAPI::IOT_HttpVersion version);
+
+    //! \brief Set how idle connections are kept usable between requests
+    //! \param [in] policy - Keepalive probes and max idle time
+    void SetKeepAlive(const IOT_KeepAlive& policy);
+
+    //! \brief Resolve the server name and open a connection before the first request
+    //! \note Makes a GET request without authorization and discards the response,
+    //!       so the connection, TLS session and resolved name are ready for the
+    //!       following GetResource() and PostAndReadResponse() calls.
+    //! \param [in] url     - Server address
+    //! \param [out] timing - Optional timing breakdown, shows the cost saved later
+    //! \return IOTAPI::IOT_ERR_OK if connected, whatever the HTTP status, error code otherwise
+    IOTAPI::IOTAPI_err Warmup(const std::string& url, IOT_RequestTiming* timing = NULL) const;
+
+    //! \brief Keep TLS sessions in a file so that a restarted process resumes them
+    //! \note Sessions in the file are loaded now, and the sessions of the
+    //!       client are added to it whenever a request opens a new TLS
+    //!       connection. Several clients may share the file. A resumed session
+    //!       skips the full handshake on the first connection after a restart.
+    //!       Requires libcurl 8.12.0 or newer built with SSLS-EXPORT.
+    //! \param [in] path - Session file, created if it does not exist
+    //! \return IOTAPI::IOT_ERR_PARAM if libcurl cannot export sessions
+    IOTAPI::IOTAPI_err SetSessionFile(const std::string& path);
+
+    //! \brief Check if libcurl can export and import TLS sessions for SetSessionFile()
+    static bool IsSessionFileSupported();
+
     //! \brief Perform a GET request to specific URL
     //! \param [in] url       - Target address
     //! \param [in] user      - Username for HTTP AUTH. Use empty string to disable AUTH
     //! \param [in] pw        - Password for HTTP AUTH
     //! \param [out] response - Response returned by remote server
+    //! \param [out] timing   - Optional timing breakdown of the request
     IOTAPI::IOTAPI_err GetResource(const std::string& url, const std::string& user,
-                     const std::string& pw, std::string& response) const;
+                     const std::string& pw, std::string& response,
+                     IOT_RequestTiming* timing = NULL) const;
 
     //! \brief Perform a POST call to specific URL
     //! \param [in] url       - Target address
@@ -57,9 +102,46 @@ public:
     //! \param [in] pw        - Password for HTTP AUTH
     //! \param [in] data      - POST payload which is sent to server
     //! \param [out] response - Response returned by remote server
+    //! \param [out] timing   - Optional timing breakdown of the request
     IOTAPI::IOTAPI_err PostAndReadResponse(const std::string& url, const std::string& user,
                              const std::string& pw, const std::string& data,
-                             std::string& response) const;
+                             std::string& response, IOT_RequestTiming* timing = NULL) const;
+
+    //! \brief Perform several POST calls to the same URL concurrently
+    //! \note Each concurrent request uses its own connection, which is kept
+    //!       open for subsequent calls. With HTTP/2 the requests share one
+    //!       connection.
+    //! \param [in] url          - Target address
+    //! \param [in] user         - Username for HTTP AUTH. Use empty string to disable AUTH
+    //! \param [in] pw           - Password for HTTP AUTH
+    //! \param [in] payloads     - POST payloads, one request is made per payload. They must stay valid until the call returns.
+    //! \param [in] maxParallel  - Max number of requests in flight at the same time
+    //! \param [out] responses   - Responses returned by remote server, in the order of payloads
+    //! \param [out] results     - Result of each request, in the order of payloads
+    //! \param [out] timings     - Optional timing breakdown of each request
+    //! \return IOTAPI::IOT_ERR_OK if all requests succeeded, error of the first failed request otherwise
+    IOTAPI::IOTAPI_err PostMultiple(const std::string& url, const std::string& user, const std::string& pw,
+                                    const std::vector<const std::string*>& payloads, size_t maxParallel,
+                                    std::vector<std::string>& responses, std::vector<IOTAPI::IOTAPI_err>& results,
+                                    std::vector<IOT_RequestTiming>* timings = NULL) const;
+
+    //! \brief Prepare POST requests to a fixed URL for PostPrepared()
+    //! \note URL, authorization header and the other options are set once on a
+    //!       handle of its own, so a prepared POST only passes the payload.
+    //! \param [in] url  - Target address
+    //! \param [in] user - Username for HTTP AUTH. Use empty string to disable AUTH
+    //! \param [in] pw   - Password for HTTP AUTH
+    //! \return IOTAPI::IOT_ERR_OK if successful, error code otherwise
+    IOTAPI::IOTAPI_err PreparePost(const std::string& url, const std::string& user, const std::string& pw);
+
+    //! \brief Perform a POST call to the URL set by PreparePost()
+    //! \note The payload is sent from the caller's buffer without copying.
+    //! \param [in] data      - POST payload which is sent to server
+    //! \param [out] response - Response returned by remote server
+    //! \param [out] timing   - Optional timing breakdown of the request
+    //! \return IOTAPI::IOT_ERR_INITIALIZED if PreparePost() has not succeeded
+    IOTAPI::IOTAPI_err PostPrepared(const std::string& data, std::string& response,
+                                    IOT_RequestTiming* timing = NULL) const;
 
 private:
     //! Bookeeping structure for data sending in libcurl callback function
@@ -87,7 +169,8 @@ private:
     };
 
     static const size_t REST_DEFAULT_REQ_MAX_SIZE;
-    static bool m_globalInit;
+    //! libcurl global initialization is done once by the first client
+    static std::once_flag m_globalInit;
 
     //! libcurl callback to read server response
     static int ReadServerResponse(char *data, size_t size, size_t nmemb, void *buffer_in);
@@ -99,16 +182,34 @@ private:
     static size_t WriteToServer(void *ptr, size_t size, size_t nmemb, void *userp);
 
     //! Set libcurl parameters based on query
-    void CreateCurlCall(std::string url, bool postCall, std::string user, std::string pw) const;
+    void CreateCurlCall(CURL* curl, std::string url, bool postCall, std::string user, std::string pw) const;
 
     //! Perform the query previsouly prepared by CreateCurlCall
     CURLcode PerformCurlCall(ReadData* readPtr, WriteData* writePtr) const;
 
+    //! Set libcurl callbacks for payload and response
+    void SetTransferData(CURL* curl, ReadData* readPtr, WriteData* writePtr) const;
+
+    //! Prepare POST of one payload on a parallel handle and add it to the multi handle
+    void StartParallelCall(CURL* handle, size_t index, const std::string& url, const std::string& user,
+                           const std::string& pw, const std::vector<const std::string*>& payloads,
+                           std::vector<std::string>& responses, std::vector<ReadData>& rdata,
+                           std::vector<WriteData>& wdata) const;
+
+    //! Apply options common to all requests (timeouts, signals, HTTP version, keepalive) to a handle
+    void InitHandle(CURL* handle) const;
+
+    //! Read timing information of the last performed query from libcurl
+    void FetchTiming(CURL* curl, long httpCode, IOT_RequestTiming* timing) const;
+
+    //! Write the sessions of the cache to the session file if the last request on handle opened a TLS connection
+    void SaveSessions(CURL* handle) const;
+
     //! Check if HTTP status code indicates success
     bool HttpStatusSuccess(long unsigned int status) const;
 
-    //! Convert libcurl specific error code to IOT_API error code
-    IOTAPI::IOTAPI_err GetReturnCode(long httpCode, CURLcode code) const;
+    //! Convert libcurl specific error code of the last request on handle to IOT_API error code
+    IOTAPI::IOTAPI_err GetReturnCode(CURL* handle, long httpCode, CURLcode code) const;
 
     //! Max number of bytes allowed for server response
     size_t m_maxRequestSize;
@@ -116,8 +217,38 @@ private:
     //! HTTP header fields added to queries
     curl_slist* m_headers;
 
+    //! Timeout for connect and requests, 0 for libcurl defaults
+    size_t m_timeout_s;
+
+    //! HTTP version of requests
+    IOTAPI::IOT_HttpVersion m_httpVersion;
+
+    //! Keepalive policy of connections
+    IOT_KeepAlive m_keepAlive;
+
+    //! TLS session cache shared by all handles of the client
+    CURLSH* m_share;
+
+    //! File where TLS sessions are kept, empty if not kept
+    std::string m_sessionFile;
+
     //! Handle to libcurl library
     CURL* m_curl;
+
+    //! Handle with options of PreparePost() applied, NULL if not prepared
+    CURL* m_prepared;
+
+    //! Header fields of prepared requests, including authorization
+    curl_slist* m_preparedHeaders;
+
+    //! Response buffer of prepared requests
+    mutable ReadData m_preparedRead;
+
+    //! Multi handle for concurrent requests, created on first use
+    mutable CURLM* m_multi;
+
+    //! Handles used for concurrent requests, created on first use
+    mutable std::vector<CURL*> m_parallel;
 };
 
 #endif // IOT_RESTCLIENT_H
@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_SessionFile.h"
+#include "IOT_Base64.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+//! First line of a session file
+static const std::string SESSION_FILE_HEADER = "IOT_TLS_SESSIONS 1";
+
+//! Field written for empty binary data
+static const std::string EMPTY_FIELD = "-";
+
+static std::string EncodeField(const uint8_t* data, size_t len)
+{
+    return (len == 0) ? EMPTY_FIELD : IOT_Base64::encode(data, static_cast<uint32_t>(len));
+}
+
+static bool DecodeField(const std::string& field, std::vector<uint8_t>& data)
+{
+    data.clear();
+    return (field == EMPTY_FIELD) || IOT_Base64::decode(field, data);
+}
+
+//! Host a session is for, the hash stands in when the key is not known
+static std::string SessionId(const IOT_SessionFile::Entry& entry)
+{
+    return entry.key.empty() ? "#" + std::string(entry.shmac.begin(), entry.shmac.end()) : entry.key;
+}
+
+bool IOT_SessionFile::Write(const std::string& path, const std::vector<Entry>& entries)
+{
+    // Unique temporary name, as several clients may save at the same time
+    static std::atomic<uint64_t> counter(0);
+    std::string tmpPath = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(counter.fetch_add(1));
+
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(fd < 0) {
+        return false;
+    }
+
+    std::string content = SESSION_FILE_HEADER + "\n";
+    for(size_t i = 0; i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        content += std::to_string(entry.validUntil) + " " +
+                   EncodeField(reinterpret_cast<const uint8_t*>(entry.key.data()), entry.key.size()) + " " +
+                   EncodeField(entry.shmac.data(), entry.shmac.size()) + " " +
+                   EncodeField(entry.data.data(), entry.data.size()) + "\n";
+    }
+
+    size_t written = 0;
+    while(written < content.size()) {
+        ssize_t ret = write(fd, content.data() + written, content.size() - written);
+        if(ret <= 0) {
+            break;
+        }
+        written += ret;
+    }
+
+    bool closed = (close(fd) == 0);
+    if(written != content.size() || !closed || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool IOT_SessionFile::Merge(const std::string& path, int64_t now, const std::vector<Entry>& entries)
+{
+    // The lock is on a separate file, as the session file itself is replaced
+    std::string lockPath = path + ".lock";
+    int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0600);
+    if(lockFd < 0) {
+        return false;
+    }
+    while(flock(lockFd, LOCK_EX) != 0 && errno == EINTR) {
+    }
+
+    std::set<std::string> replaced;
+    for(size_t i = 0; i < entries.size(); ++i) {
+        replaced.insert(SessionId(entries[i]));
+    }
+
+    std::vector<Entry> merged;
+    Read(path, now, merged);
+    merged.erase(std::remove_if(merged.begin(), merged.end(), [&replaced](const Entry& entry) {
+        return replaced.count(SessionId(entry)) != 0;
+    }), merged.end());
+    merged.insert(merged.end(), entries.begin(), entries.end());
+
+    bool ok = Write(path, merged);
+    close(lockFd);
+    return ok;
+}
+
+bool IOT_SessionFile::Read(const std::string& path, int64_t now, std::vector<Entry>& entries)
+{
+    entries.clear();
+
+    std::ifstream file(path.c_str());
+    std::string line;
+    if(!std::getline(file, line) || line != SESSION_FILE_HEADER) {
+        return false;
+    }
+
+    while(std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        std::string shmac;
+        std::string data;
+        Entry entry;
+        if(!(fields >> entry.validUntil >> key >> shmac >> data)) {
+            continue;
+        }
+
+        std::vector<uint8_t> keyBytes;
+        if(!DecodeField(key, keyBytes) || !DecodeField(shmac, entry.shmac) ||
+           !DecodeField(data, entry.data) || entry.data.empty()) {
+            continue;
+        }
+        if(entry.validUntil != 0 && entry.validUntil <= now) {
+            continue;
+        }
+
+        entry.key.assign(keyBytes.begin(), keyBytes.end());
+        entries.push_back(entry);
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_SESSIONFILE_H
+#define IOT_SESSIONFILE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//! \brief File of TLS sessions kept over process restarts
+//! \note Sessions are stored as Base64 lines. The file is written to a
+//!       temporary file first and renamed over the old one, so a reader or
+//!       a crash never sees a partial file. As session data lets anyone
+//!       resume the session, only the owner can read the file.
+class IOT_SessionFile
+{
+public:
+    //! \brief Single exported TLS session
+    struct Entry
+    {
+        Entry(): validUntil(0) {}
+
+        //! Key of the session in the libcurl cache, may be empty if only the hash is known
+        std::string key;
+
+        //! Salted hash of the key
+        std::vector<uint8_t> shmac;
+
+        //! Session data
+        std::vector<uint8_t> data;
+
+        //! Expiry time in seconds since the epoch, 0 if not known
+        int64_t validUntil;
+    };
+
+    //! \brief Write sessions to a file, replacing its content
+    //! \param [in] path    - File name
+    //! \param [in] entries - Sessions to write
+    //! \return false if the file could not be written
+    static bool Write(const std::string& path, const std::vector<Entry>& entries);
+
+    //! \brief Add sessions to a file, keeping the other sessions in it
+    //! \note Sessions in the file with the same key as a new one are replaced
+    //!       and expired ones are dropped. Clients and processes saving to the
+    //!       same file take turns on a lock file next to it, so none of them
+    //!       overwrites the sessions saved by another.
+    //! \param [in] path    - File name
+    //! \param [in] now     - Current time in seconds since the epoch
+    //! \param [in] entries - New sessions
+    //! \return false if the file could not be written
+    static bool Merge(const std::string& path, int64_t now, const std::vector<Entry>& entries);
+
+    //! \brief Read sessions from a file
+    //! \param [in] path     - File name
+    //! \param [in] now      - Current time in seconds since the epoch, expired sessions are skipped
+    //! \param [out] entries - Sessions that have not expired
+    //! \return false if the file does not exist or is not a session file
+    static bool Read(const std::string& path, int64_t now, std::vector<Entry>& entries);
+};
+
+#endif // IOT_SESSIONFILE_H
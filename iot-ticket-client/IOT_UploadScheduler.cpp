@@ -0,0 +1,351 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_UploadScheduler.h"
+#include "IOT_Metrics.h"
+
+using namespace IOTAPI;
+
+const size_t IOT_UploadScheduler::DEFAULT_BATCH_SIZE;
+const size_t IOT_UploadScheduler::DEFAULT_MAX_QUEUED;
+const uint32_t IOT_UploadScheduler::DEFAULT_RETRY_MS;
+
+IOT_UploadScheduler::IOT_UploadScheduler(const IOT_API& api, size_t threads):
+    m_api(api), m_batchSize(DEFAULT_BATCH_SIZE), m_retryMs(DEFAULT_RETRY_MS), m_maxQueued(DEFAULT_MAX_QUEUED),
+    m_scheduled(0), m_queued(0), m_steals(0), m_running(false), m_stop(false), m_drainOnStop(false)
+{
+    if(threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if(threads == 0) {
+            threads = 1;
+        }
+    }
+
+    for(size_t i = 0; i < threads; ++i) {
+        m_workers.push_back(new Worker());
+    }
+}
+
+IOT_UploadScheduler::~IOT_UploadScheduler()
+{
+    Stop(false);
+
+    size_t queued = m_queued.load();
+    IOT_Metrics::Instance().samplesDropped.Add(queued);
+    IOT_Metrics::Instance().queueDepth.Add(-static_cast<int64_t>(queued));
+
+    for(std::map<std::string, Device*>::iterator it = m_devices.begin(); it != m_devices.end(); ++it) {
+        delete it->second;
+    }
+    for(size_t i = 0; i < m_workers.size(); ++i) {
+        delete m_workers[i];
+    }
+}
+
+IOTAPI::IOTAPI_err IOT_UploadScheduler::Start()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if(m_running) {
+        return IOT_ERR_INITIALIZED;
+    }
+
+    m_stop = false;
+    m_running = true;
+    for(size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->thread = std::thread(&IOT_UploadScheduler::WorkerThread, this, i);
+    }
+    return IOT_ERR_OK;
+}
+
+void IOT_UploadScheduler::Stop(bool flush)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if(!m_running) {
+            return;
+        }
+        m_stop = true;
+        m_drainOnStop = flush;
+    }
+
+    m_cond.notify_all();
+    for(size_t i = 0; i < m_workers.size(); ++i) {
+        m_workers[i]->thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_running = false;
+}
+
+bool IOT_UploadScheduler::SetBatching(size_t batchSize, uint32_t retryMs)
+{
+    if(batchSize == 0) {
+        return false;
+    }
+
+    m_batchSize = batchSize;
+    m_retryMs = retryMs;
+    return true;
+}
+
+void IOT_UploadScheduler::SetMaxQueued(size_t maxQueued)
+{
+    m_maxQueued = maxQueued;
+}
+
+bool IOT_UploadScheduler::Enqueue(const std::string& devId, const IOT_WriteData& data)
+{
+    std::vector<IOT_WriteData> vec(1, data);
+    return Enqueue(devId, vec) == 1;
+}
+
+size_t IOT_UploadScheduler::Enqueue(const std::string& devId, const std::vector<IOT_WriteData>& data)
+{
+    Device* device;
+    {
+        std::lock_guard<std::mutex> lock(m_devicesLock);
+        Device*& entry = m_devices[devId];
+        if(entry == NULL) {
+            entry = new Device();
+            entry->devId = devId;
+            entry->home = (m_devices.size() - 1) % m_workers.size();
+        }
+        device = entry;
+    }
+
+    size_t queued = 0;
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(device->lock);
+        while(queued < data.size() && device->queue.size() < m_maxQueued) {
+            device->queue.push_back(data[queued]);
+            ++queued;
+        }
+
+        if(!device->scheduled && !device->queue.empty()) {
+            device->scheduled = true;
+            schedule = true;
+        }
+    }
+
+    m_queued += queued;
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    metrics.samplesEnqueued.Add(queued);
+    metrics.samplesDropped.Add(data.size() - queued);
+    metrics.queueDepth.Add(queued);
+
+    if(schedule) {
+        ++m_scheduled;
+        PushWork(device, device->home);
+        Wake();
+    }
+
+    return queued;
+}
+
+size_t IOT_UploadScheduler::GetThreads() const
+{
+    return m_workers.size();
+}
+
+size_t IOT_UploadScheduler::GetQueued(const std::string& devId) const
+{
+    std::lock_guard<std::mutex> lock(m_devicesLock);
+    std::map<std::string, Device*>::const_iterator it = m_devices.find(devId);
+    if(it == m_devices.end()) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> deviceLock(it->second->lock);
+    return it->second->queue.size();
+}
+
+size_t IOT_UploadScheduler::GetQueued() const
+{
+    return m_queued.load();
+}
+
+uint64_t IOT_UploadScheduler::GetSteals() const
+{
+    return m_steals.load();
+}
+
+void IOT_UploadScheduler::WorkerThread(size_t index)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while(true) {
+        if(m_stop && !m_drainOnStop) {
+            break;
+        }
+
+        // Retries that are due go to this thread, all of them when stopping
+        clock_t::time_point now = clock_t::now();
+        while(!m_retries.empty() && (m_stop || m_retries.top().first <= now)) {
+            PushWork(m_retries.top().second, index);
+            m_retries.pop();
+        }
+
+        bool more = false;
+        Device* device = TakeWork(index, more);
+        if(device == NULL) {
+            if(m_stop && m_scheduled.load() == 0) {
+                break;
+            }
+
+            if(m_retries.empty()) {
+                m_cond.wait(lock);
+            } else {
+                m_cond.wait_until(lock, m_retries.top().first);
+            }
+            continue;
+        }
+
+        // Let an idle thread steal the rest of the list
+        if(more) {
+            m_cond.notify_one();
+        }
+
+        lock.unlock();
+        Send(device, index);
+        lock.lock();
+    }
+}
+
+IOT_UploadScheduler::Device* IOT_UploadScheduler::TakeWork(size_t index, bool& more)
+{
+    {
+        Worker& own = *m_workers[index];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if(!own.work.empty()) {
+            Device* device = own.work.front();
+            own.work.pop_front();
+            more = !own.work.empty();
+            return device;
+        }
+    }
+
+    for(size_t i = 1; i < m_workers.size(); ++i) {
+        Worker& victim = *m_workers[(index + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if(!victim.work.empty()) {
+            Device* device = victim.work.back();
+            victim.work.pop_back();
+            ++m_steals;
+            return device;
+        }
+    }
+
+    return NULL;
+}
+
+void IOT_UploadScheduler::PushWork(Device* device, size_t index)
+{
+    Worker& worker = *m_workers[index];
+    std::lock_guard<std::mutex> lock(worker.lock);
+    worker.work.push_back(device);
+}
+
+void IOT_UploadScheduler::Wake()
+{
+    // Taking the lock orders the wake up after the checks of a thread going to sleep
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+    }
+    m_cond.notify_one();
+}
+
+void IOT_UploadScheduler::Send(Device* device, size_t index)
+{
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+
+    // A device held back by the rate limiter waits with the retries instead of blocking the thread
+    long delayMs = m_api.GetThrottleDelayMs(device->devId);
+    if(delayMs > 0) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if(!m_stop) {
+            m_retries.push(std::make_pair(clock_t::now() + std::chrono::milliseconds(delayMs), device));
+            lock.unlock();
+            m_cond.notify_one();
+            return;
+        }
+    }
+
+    std::vector<IOT_WriteData> batch;
+    {
+        std::lock_guard<std::mutex> lock(device->lock);
+        size_t count = std::min(m_batchSize, device->queue.size());
+        batch.assign(device->queue.begin(), device->queue.begin() + count);
+        device->queue.erase(device->queue.begin(), device->queue.begin() + count);
+    }
+    m_queued -= batch.size();
+    metrics.queueDepth.Add(-static_cast<int64_t>(batch.size()));
+
+    IOT_WriteResult result;
+    IOTAPI_err ret = batch.empty() ? IOT_ERR_OK : m_api.SendData(device->devId, batch, result);
+
+    bool retry = IOT_API::IsRetryableError(ret);
+    if(retry) {
+        std::lock_guard<std::mutex> lock(m_lock);
+        retry = !m_stop;
+    }
+
+    size_t requeued = 0;
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(device->lock);
+        requeued = result.Requeue(batch, retry, device->queue, m_maxQueued);
+        if(requeued == 0) {
+            more = !device->queue.empty();
+            device->scheduled = more;
+        }
+    }
+
+    if(requeued > 0) {
+        m_queued += requeued;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            // Not before the rate limiter lets the device out, e.g. after Retry-After
+            long retryMs = std::max<long>(m_retryMs, m_api.GetThrottleDelayMs(device->devId));
+            m_retries.push(std::make_pair(clock_t::now() + std::chrono::milliseconds(retryMs), device));
+        }
+        m_cond.notify_one();
+        return;
+    }
+
+    if(more) {
+        PushWork(device, index);
+    } else {
+        Unschedule();
+    }
+}
+
+void IOT_UploadScheduler::Unschedule()
+{
+    if(--m_scheduled == 0) {
+        // Threads stopping with flush wait for the last device
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+        }
+        m_cond.notify_all();
+    }
+}
@@ -0,0 +1,185 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_UPLOADSCHEDULER_H
+#define IOT_UPLOADSCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IOT_API.h"
+
+//! \brief Upload queues of many devices sent by a work-stealing pool of threads
+//! \note Each device has its own queue. A device with queued samples is put
+//!       on the work list of a sender thread, and a thread whose own list is
+//!       empty steals devices from the lists of the others, so busy devices
+//!       do not leave threads idle. Only one thread works on a device at a
+//!       time, which keeps the samples of a device in order. Samples queued
+//!       while a batch of the device is sent go out in its next batch.
+//!       Each thread tends to lease the same pooled connection of the API
+//!       instance, so size the pool to at least the number of threads.
+//!       Samples not written because of a transient error are retried after
+//!       a delay, samples rejected by the server are dropped. A device the
+//!       rate limiter of the API instance holds back, e.g. after a 429 reply,
+//!       waits with the retries without keeping a thread busy.
+class IOT_UploadScheduler
+{
+public:
+    //! Default max number of samples in one request
+    static const size_t DEFAULT_BATCH_SIZE = 1000;
+
+    //! Default max number of samples waiting in the queue of a device
+    static const size_t DEFAULT_MAX_QUEUED = 100000;
+
+    //! Default delay before samples of a failed request are retried in milliseconds
+    static const uint32_t DEFAULT_RETRY_MS = 1000;
+
+    //! \brief Constructor
+    //! \param [in] api     - API instance used for sending. Must outlive the scheduler.
+    //! \param [in] threads - Number of sender threads, 0 for the number of CPU threads
+    explicit IOT_UploadScheduler(const IOT_API& api, size_t threads = 0);
+    ~IOT_UploadScheduler();
+
+    //! \brief Start the sender threads
+    //! \return IOTAPI::IOT_ERR_OK if successful, IOTAPI::IOT_ERR_INITIALIZED if already started
+    IOTAPI::IOTAPI_err Start();
+
+    //! \brief Stop the sender threads
+    //! \param [in] flush - Try to send queued samples once before stopping
+    void Stop(bool flush = true);
+
+    //! \brief Set batching and retry delay, call before Start()
+    //! \param [in] batchSize - Max number of samples in one request
+    //! \param [in] retryMs   - Delay before samples of a failed request are retried
+    //! \return false if batchSize is zero
+    bool SetBatching(size_t batchSize, uint32_t retryMs);
+
+    //! \brief Set max number of samples waiting in the queue of a device, call before Start()
+    void SetMaxQueued(size_t maxQueued);
+
+    //! \brief Add sample to the queue of a device, the device is added on first use
+    //! \return false if the queue is full and the sample was dropped
+    bool Enqueue(const std::string& devId, const IOT_WriteData& data);
+
+    //! \brief Add samples to the queue of a device, the device is added on first use
+    //! \return Number of samples queued, the rest were dropped because the queue is full
+    size_t Enqueue(const std::string& devId, const std::vector<IOT_WriteData>& data);
+
+    //! \brief Number of sender threads
+    size_t GetThreads() const;
+
+    //! \brief Number of samples waiting in the queue of a device
+    size_t GetQueued(const std::string& devId) const;
+
+    //! \brief Number of samples waiting in all queues
+    size_t GetQueued() const;
+
+    //! \brief Number of devices a thread has taken from the list of another thread
+    uint64_t GetSteals() const;
+
+private:
+    IOT_UploadScheduler(const IOT_UploadScheduler&);
+    IOT_UploadScheduler& operator=(const IOT_UploadScheduler&);
+
+    typedef std::chrono::steady_clock clock_t;
+
+    struct Device
+    {
+        Device(): scheduled(false), home(0) {}
+
+        std::string devId;
+
+        //! Protects queue and scheduled
+        std::mutex lock;
+        std::deque<IOT_WriteData> queue;
+
+        //! Device is on a work list, being sent or waiting for retry
+        bool scheduled;
+
+        //! Sender thread whose list the device is put on when samples are queued
+        size_t home;
+    };
+
+    struct Worker
+    {
+        std::mutex lock;
+
+        //! Devices to send, the owner takes from the front and thieves from the back
+        std::deque<Device*> work;
+
+        std::thread thread;
+    };
+
+    typedef std::pair<clock_t::time_point, Device*> Retry;
+
+    //! Sender thread
+    void WorkerThread(size_t index);
+
+    //! Take a device from own list or steal one from another thread
+    //! \param [out] more - Own list has more devices
+    Device* TakeWork(size_t index, bool& more);
+
+    //! Put device on the work list of a thread
+    void PushWork(Device* device, size_t index);
+
+    //! Wake up an idle thread, caller must not hold m_lock
+    void Wake();
+
+    //! Send one batch of a device
+    void Send(Device* device, size_t index);
+
+    //! Device has nothing more to send
+    void Unschedule();
+
+    const IOT_API& m_api;
+    size_t m_batchSize;
+    uint32_t m_retryMs;
+    size_t m_maxQueued;
+
+    mutable std::mutex m_devicesLock;
+    std::map<std::string, Device*> m_devices;
+
+    std::vector<Worker*> m_workers;
+
+    //! Protects m_retries and the sleeping of idle threads
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::priority_queue<Retry, std::vector<Retry>, std::greater<Retry> > m_retries;
+
+    //! Devices that are scheduled
+    std::atomic<size_t> m_scheduled;
+    std::atomic<size_t> m_queued;
+    std::atomic<uint64_t> m_steals;
+
+    bool m_running;
+    bool m_stop;
+    bool m_drainOnStop;
+};
+
+#endif // IOT_UPLOADSCHEDULER_H
@@ -0,0 +1,354 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_Uploader.h"
+#include "IOT_Metrics.h"
+
+using namespace IOTAPI;
+
+const uint32_t IOT_Uploader::DEFAULT_PRIORITY_FLUSH_MS;
+
+//! Delay before retrying high priority samples after a transient error
+static const uint32_t PRIORITY_RETRY_MS = 200;
+
+//! Number of times in a row a failed high priority batch is retried before it is dropped
+static const uint32_t PRIORITY_MAX_RETRIES = 5;
+
+IOT_Uploader::IOT_Uploader(const IOT_API& api, const std::string& devId, size_t maxQueued):
+    m_api(api), m_priorityApi(api), m_devId(devId), m_maxQueued(maxQueued),
+    m_compressor(NULL), m_governor(NULL), m_bulkSending(false),
+    m_priorityFlushMs(DEFAULT_PRIORITY_FLUSH_MS), m_prioritySending(false), m_priorityRetries(0),
+    m_running(false), m_stop(false), m_drainOnStop(false), m_flush(false)
+{
+}
+
+IOT_Uploader::IOT_Uploader(const IOT_API& api, const IOT_API& priorityApi, const std::string& devId, size_t maxQueued):
+    m_api(api), m_priorityApi(priorityApi), m_devId(devId), m_maxQueued(maxQueued),
+    m_compressor(NULL), m_governor(NULL), m_bulkSending(false),
+    m_priorityFlushMs(DEFAULT_PRIORITY_FLUSH_MS), m_prioritySending(false), m_priorityRetries(0),
+    m_running(false), m_stop(false), m_drainOnStop(false), m_flush(false)
+{
+}
+
+IOT_Uploader::~IOT_Uploader()
+{
+    Stop(false);
+
+    size_t queued = m_queue.size() + m_priorityQueue.size();
+    IOT_Metrics::Instance().samplesDropped.Add(queued);
+    IOT_Metrics::Instance().queueDepth.Add(-static_cast<int64_t>(queued));
+}
+
+IOTAPI::IOTAPI_err IOT_Uploader::Start()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if(m_running) {
+        return IOT_ERR_INITIALIZED;
+    }
+
+    m_stop = false;
+    m_running = true;
+    m_thread = std::thread(&IOT_Uploader::SenderThread, this);
+    m_priorityThread = std::thread(&IOT_Uploader::PriorityThread, this);
+    return IOT_ERR_OK;
+}
+
+void IOT_Uploader::Stop(bool flush)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if(!m_running) {
+            return;
+        }
+        m_stop = true;
+        m_drainOnStop = flush;
+
+        if(flush && m_compressor != NULL) {
+            std::vector<IOT_WriteData> held;
+            m_compressor->Flush(held);
+            QueueLocked(held);
+        }
+    }
+
+    m_cond.notify_all();
+    m_priorityCond.notify_all();
+    m_thread.join();
+    m_priorityThread.join();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_running = false;
+}
+
+bool IOT_Uploader::Enqueue(const IOT_WriteData& data, Lane lane)
+{
+    std::vector<IOT_WriteData> vec(1, data);
+    return Enqueue(vec, lane) == 1;
+}
+
+size_t IOT_Uploader::Enqueue(const std::vector<IOT_WriteData>& data, Lane lane)
+{
+    if(lane == LANE_HIGH) {
+        size_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if(m_priorityQueue.empty() && !data.empty()) {
+                m_priorityDeadline = clock_t::now() + std::chrono::milliseconds(m_priorityFlushMs);
+            }
+
+            while(queued < data.size() && m_priorityQueue.size() < m_maxQueued) {
+                m_priorityQueue.push_back(data[queued]);
+                ++queued;
+            }
+        }
+
+        IOT_Metrics& metrics = IOT_Metrics::Instance();
+        metrics.samplesEnqueued.Add(queued);
+        metrics.samplesDropped.Add(data.size() - queued);
+        metrics.queueDepth.Add(queued);
+
+        m_priorityCond.notify_one();
+        return queued;
+    }
+
+    size_t dropped = 0;
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        std::vector<IOT_WriteData> staged;
+        const std::vector<IOT_WriteData>* samples = &data;
+
+        if(m_compressor != NULL) {
+            for(size_t i = 0; i < data.size(); ++i) {
+                m_compressor->Process(data[i], staged);
+            }
+            samples = &staged;
+        }
+        if(m_governor != NULL && m_governor->GetLevel(m_devId) != IOT_QuotaGovernor::LEVEL_NORMAL) {
+            if(samples != &staged) {
+                staged = data;
+                samples = &staged;
+            }
+            m_governor->Filter(m_devId, staged);
+        }
+
+        dropped = samples->size() - QueueLocked(*samples);
+
+        notify = (m_queue.size() >= m_controller.GetBatchSize());
+    }
+
+    if(notify) {
+        m_cond.notify_one();
+    }
+
+    return data.size() - dropped;
+}
+
+void IOT_Uploader::SetCompressor(IOT_Compressor* compressor)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_compressor = compressor;
+}
+
+void IOT_Uploader::SetQuotaGovernor(IOT_QuotaGovernor* governor)
+{
+    if(governor != NULL) {
+        governor->AddDevice(m_devId);
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_governor = governor;
+}
+
+size_t IOT_Uploader::QueueLocked(const std::vector<IOT_WriteData>& data)
+{
+    if(m_queue.empty() && !data.empty()) {
+        m_flushDeadline = clock_t::now() + std::chrono::milliseconds(m_controller.GetFlushIntervalMs());
+    }
+
+    size_t queued = 0;
+    while(queued < data.size() && m_queue.size() < m_maxQueued) {
+        m_queue.push_back(data[queued]);
+        ++queued;
+    }
+
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    metrics.samplesEnqueued.Add(queued);
+    metrics.samplesDropped.Add(data.size() - queued);
+    metrics.queueDepth.Add(queued);
+    return queued;
+}
+
+void IOT_Uploader::Flush()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_flush = true;
+    }
+    m_cond.notify_one();
+}
+
+void IOT_Uploader::SetPriorityFlushInterval(uint32_t intervalMs)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_priorityFlushMs = intervalMs;
+}
+
+size_t IOT_Uploader::GetQueued(Lane lane) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return (lane == LANE_HIGH) ? m_priorityQueue.size() : m_queue.size();
+}
+
+IOT_BatchController& IOT_Uploader::GetController()
+{
+    return m_controller;
+}
+
+void IOT_Uploader::SenderThread()
+{
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while(true) {
+        size_t batchSize = m_controller.GetBatchSize();
+
+        while(!m_stop && !m_flush && m_queue.size() < batchSize &&
+              (m_queue.empty() || clock_t::now() < m_flushDeadline)) {
+            if(m_queue.empty()) {
+                m_cond.wait(lock);
+            } else {
+                m_cond.wait_until(lock, m_flushDeadline);
+            }
+            batchSize = m_controller.GetBatchSize();
+        }
+
+        if(m_queue.empty()) {
+            m_flush = false;
+            if(m_stop) {
+                break;
+            }
+            continue;
+        }
+
+        if(m_stop && !m_drainOnStop) {
+            break;
+        }
+
+        // Give way to high priority samples, unless they wait for a retry
+        if(m_prioritySending || (!m_priorityQueue.empty() &&
+                                 (m_priorityRetries == 0 || clock_t::now() >= m_priorityDeadline))) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        size_t count = std::min(batchSize, m_queue.size());
+        std::vector<IOT_WriteData> batch(m_queue.begin(), m_queue.begin() + count);
+        m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+        metrics.queueDepth.Add(-static_cast<int64_t>(count));
+
+        IOT_QuotaGovernor* governor = m_governor;
+        m_bulkSending = true;
+        lock.unlock();
+        IOT_WriteResult result;
+        IOTAPI_err ret = m_api.SendData(m_devId, batch, result);
+        m_controller.OnRequestComplete(count, result.GetPayloadBytes(), result.GetLatencyMs(), ret == IOT_ERR_OK);
+        if(governor != NULL) {
+            governor->OnWrite(m_devId, result.GetAccepted(), result.GetPayloadBytes(), ret);
+        }
+        lock.lock();
+        m_bulkSending = false;
+        m_priorityCond.notify_one();
+
+        clock_t::time_point next = clock_t::now() + std::chrono::milliseconds(m_controller.GetFlushIntervalMs());
+
+        if(result.Requeue(batch, !m_stop, m_queue, m_maxQueued) > 0) {
+            // Wait a flush interval before retrying
+            m_flushDeadline = next;
+            m_flush = false;
+            m_cond.wait_until(lock, next, [this](){ return m_stop; });
+            continue;
+        }
+
+        if(!m_queue.empty()) {
+            m_flushDeadline = next;
+        }
+    }
+}
+
+void IOT_Uploader::PriorityThread()
+{
+    IOT_Metrics& metrics = IOT_Metrics::Instance();
+    // Lanes take turns only if they share an API instance with a single connection
+    const bool singleConnection = (&m_api == &m_priorityApi) && (m_api.GetMaxConnections() == 1);
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while(true) {
+        while(!m_stop && (m_priorityQueue.empty() || clock_t::now() < m_priorityDeadline ||
+                          (singleConnection && m_bulkSending))) {
+            if(m_priorityQueue.empty() || (singleConnection && m_bulkSending)) {
+                m_priorityCond.wait(lock);
+            } else {
+                m_priorityCond.wait_until(lock, m_priorityDeadline);
+            }
+        }
+
+        if(m_priorityQueue.empty()) {
+            if(m_stop) {
+                break;
+            }
+            continue;
+        }
+
+        if(m_stop && !m_drainOnStop) {
+            break;
+        }
+        if(singleConnection && m_bulkSending) {
+            m_priorityCond.wait(lock);
+            continue;
+        }
+
+        std::vector<IOT_WriteData> batch(m_priorityQueue.begin(), m_priorityQueue.end());
+        m_priorityQueue.clear();
+        metrics.queueDepth.Add(-static_cast<int64_t>(batch.size()));
+        m_prioritySending = true;
+        IOT_QuotaGovernor* governor = m_governor;
+        lock.unlock();
+        IOT_WriteResult result;
+        IOTAPI_err ret = m_priorityApi.SendData(m_devId, batch, result);
+        if(governor != NULL) {
+            governor->OnWrite(m_devId, result.GetAccepted(), result.GetPayloadBytes(), ret);
+        }
+        lock.lock();
+        m_prioritySending = false;
+
+        if(result.Requeue(batch, !m_stop && m_priorityRetries < PRIORITY_MAX_RETRIES, m_priorityQueue, m_maxQueued) > 0) {
+            m_priorityRetries++;
+            m_priorityDeadline = clock_t::now() + std::chrono::milliseconds(PRIORITY_RETRY_MS);
+        } else {
+            m_priorityRetries = 0;
+        }
+
+        m_cond.notify_all();
+    }
+
+    m_cond.notify_all();
+}
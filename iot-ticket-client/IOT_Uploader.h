@@ -0,0 +1,174 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_UPLOADER_H
+#define IOT_UPLOADER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IOT_API.h"
+#include "IOT_BatchController.h"
+#include "IOT_Compressor.h"
+#include "IOT_QuotaGovernor.h"
+
+//! \brief Background upload queue for process data of single device
+//! \note Samples are queued by Enqueue() and sent by a background thread in
+//!       batches whose size and flush interval are chosen by IOT_BatchController.
+//!       Samples not written because of a transient error are retried, samples
+//!       rejected by the server are dropped.
+//!       High priority samples, e.g. alarms, have their own queue and sender
+//!       thread with a short fixed flush interval. Bulk batches are not started
+//!       while high priority samples are waiting or being sent, except while a
+//!       failed high priority batch waits to be retried. A batch is retried a
+//!       few times in a row after a short delay and dropped after that.
+class IOT_Uploader
+{
+public:
+    //! Priority class of queued samples
+    typedef enum
+    {
+        LANE_BULK,  //! Telemetry, batched by IOT_BatchController
+        LANE_HIGH   //! Alarms and events, sent ahead of bulk data
+    } Lane;
+
+    //! Default maximum number of samples waiting in a queue
+    static const size_t DEFAULT_MAX_QUEUED = 100000;
+
+    //! Default flush interval of the high priority lane in milliseconds
+    static const uint32_t DEFAULT_PRIORITY_FLUSH_MS = 20;
+
+    //! \brief Constructor
+    //! \param [in] api       - API instance used for sending. Must outlive the uploader.
+    //! \param [in] devId     - Device ID the data is written to
+    //! \param [in] maxQueued - Max number of samples waiting in a queue
+    IOT_Uploader(const IOT_API& api, const std::string& devId, size_t maxQueued = DEFAULT_MAX_QUEUED);
+
+    //! \brief Constructor with separate connection for the high priority lane
+    //! \note With a single API instance both lanes lease connections from its
+    //!       pool, and high priority samples wait for a bulk request in progress
+    //!       only if the pool has a single connection.
+    //! \param [in] api         - API instance used for bulk data. Must outlive the uploader.
+    //! \param [in] priorityApi - API instance used for high priority data. Must outlive the uploader.
+    //! \param [in] devId       - Device ID the data is written to
+    //! \param [in] maxQueued   - Max number of samples waiting in a queue
+    IOT_Uploader(const IOT_API& api, const IOT_API& priorityApi, const std::string& devId,
+                 size_t maxQueued = DEFAULT_MAX_QUEUED);
+    ~IOT_Uploader();
+
+    //! \brief Start the background sender threads
+    //! \return IOTAPI::IOT_ERR_OK if successful, IOTAPI::IOT_ERR_INITIALIZED if already started
+    IOTAPI::IOTAPI_err Start();
+
+    //! \brief Stop the background sender threads
+    //! \param [in] flush - Try to send queued samples once before stopping
+    void Stop(bool flush = true);
+
+    //! \brief Add sample to the upload queue
+    //! \note High priority samples bypass the compressor and the quota governor.
+    //! \return false if the queue is full and the sample was dropped
+    bool Enqueue(const IOT_WriteData& data, Lane lane = LANE_BULK);
+
+    //! \brief Add samples to the upload queue
+    //! \return Number of samples queued, the rest were dropped because the queue is full
+    size_t Enqueue(const std::vector<IOT_WriteData>& data, Lane lane = LANE_BULK);
+
+    //! \brief Set flush interval of the high priority lane
+    //! \param [in] intervalMs - Max time a high priority sample waits for others to batch with
+    void SetPriorityFlushInterval(uint32_t intervalMs);
+
+    //! \brief Compress samples before they are queued
+    //! \param [in] compressor - Compressor to use, NULL to disable. Must outlive the
+    //!                          uploader, and must not be used elsewhere while set.
+    //!                          Samples held back by it are queued by Stop(true).
+    void SetCompressor(IOT_Compressor* compressor);
+
+    //! \brief Filter samples by storage quota before they are queued
+    //! \param [in] governor - Governor to use, NULL to disable. Must outlive the uploader.
+    //!                        The device is added to it, and written samples are reported to it.
+    void SetQuotaGovernor(IOT_QuotaGovernor* governor);
+
+    //! \brief Send queued samples without waiting for the flush interval
+    void Flush();
+
+    //! \brief Number of samples waiting in the queue of a lane
+    size_t GetQueued(Lane lane = LANE_BULK) const;
+
+    //! \brief Batch size controller used by the uploader, for configuration and introspection
+    IOT_BatchController& GetController();
+
+private:
+    IOT_Uploader(const IOT_Uploader&);
+    IOT_Uploader& operator=(const IOT_Uploader&);
+
+    typedef std::chrono::steady_clock clock_t;
+
+    //! Add samples to the queue, caller holds m_lock
+    //! \return Number of samples queued
+    size_t QueueLocked(const std::vector<IOT_WriteData>& data);
+
+    //! Background thread sending the bulk batches
+    void SenderThread();
+
+    //! Background thread sending the high priority samples
+    void PriorityThread();
+
+    const IOT_API& m_api;
+    const IOT_API& m_priorityApi;
+    std::string m_devId;
+    size_t m_maxQueued;
+
+    IOT_BatchController m_controller;
+    IOT_Compressor* m_compressor;
+    IOT_QuotaGovernor* m_governor;
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_cond;
+    std::deque<IOT_WriteData> m_queue;
+
+    //! Time when the oldest sample in the queue must be sent at the latest
+    clock_t::time_point m_flushDeadline;
+
+    std::thread m_thread;
+    bool m_bulkSending;
+
+    std::condition_variable m_priorityCond;
+    std::deque<IOT_WriteData> m_priorityQueue;
+    clock_t::time_point m_priorityDeadline;
+    uint32_t m_priorityFlushMs;
+    std::thread m_priorityThread;
+    bool m_prioritySending;
+
+    //! Number of times in a row the high priority queue has been put back after a failure
+    uint32_t m_priorityRetries;
+
+    bool m_running;
+    bool m_stop;
+    bool m_drainOnStop;
+    bool m_flush;
+};
+
+#endif // IOT_UPLOADER_H
@@ -23,6 +23,8 @@
 #include "IOT_WriteData.h"
 #include "IOT_defines.h"
 #include "IOT_Base64.h"
+#include "IOT_DoubleFormat.h"
+#include <algorithm>
 #include <string.h>
 #include <sstream>
 #include <time.h>
@@ -31,8 +33,7 @@ using namespace IOTAPI;
 
 const uint32_t IOT_WriteData::MAX_STATIC_SIZE = 8;
 
-IOT_WriteData::IOT_WriteData(): m_name(""), m_path(""), m_unit(""),
-    m_dataType(IOT_no_type), m_dynValue(NULL), m_valSize(0), m_timeStampMs(0)
+IOT_WriteData::IOT_WriteData(): m_dataType(IOT_no_type), m_dynValue(NULL), m_valSize(0), m_timeStampMs(0)
 {}
 
 IOT_WriteData::~IOT_WriteData()
@@ -46,7 +47,7 @@ bool IOT_WriteData::SetName(const std::string &name)
         return false;
     }
 
-    m_name = name;
+    m_name = IOT_InternedString::Get(name);
     return true;
 }
 
@@ -73,7 +74,7 @@ bool IOT_WriteData::SetPath(const std::string& path)
         return false;
     }
 
-    m_path = path;
+    m_path = IOT_InternedString::Get(path);
     return true;
 }
 
@@ -83,10 +84,59 @@ bool IOT_WriteData::SetUnit(const std::string& unit)
         return false;
     }
 
-    m_unit = unit;
+    m_unit = IOT_InternedString::Get(unit);
     return true;
 }
 
+const std::string& IOT_WriteData::GetName() const
+{
+    return ValueOf(m_name);
+}
+
+const std::string& IOT_WriteData::GetPath() const
+{
+    return ValueOf(m_path);
+}
+
+const std::string& IOT_WriteData::GetUnit() const
+{
+    return ValueOf(m_unit);
+}
+
+const std::string& IOT_WriteData::ValueOf(const std::shared_ptr<const IOT_InternedString>& str)
+{
+    static const std::string empty;
+    return (str != NULL) ? str->GetValue() : empty;
+}
+
+IOTAPI::IOT_DataType IOT_WriteData::GetDataType() const
+{
+    return m_dataType;
+}
+
+uint64_t IOT_WriteData::GetTimeMs() const
+{
+    return m_timeStampMs;
+}
+
+bool IOT_WriteData::GetNumericValue(double& value) const
+{
+    switch(m_dataType)
+    {
+    case IOT_double:
+        value = *(const double*)m_value;
+        return true;
+    case IOT_long:
+        value = static_cast<double>(*(const int64_t*)m_value);
+        return true;
+    case IOT_bool:
+        value = *(const bool*)m_value ? 1.0 : 0.0;
+        return true;
+    default:
+        return false;
+    }
+}
+
 void IOT_WriteData::SetValue(const std::string& value)
 {
     ClearDynamic();
@@ -161,27 +211,112 @@ void IOT_WriteData::SetTimeToNow()
 
 bool IOT_WriteData::ToJSON(std::string& json) const
 {
-    Json::Value jsonVal;
-    Json::FastWriter fastWriter;
+    json.clear();
+    if(!AppendJSON(json)) {
+        return false;
+    }
 
-    if(!ToJSON(jsonVal)) {
+    json += '\n';
+    return true;
+}
+
+bool IOT_WriteData::AppendJSON(std::string& json, int decimals) const
+{
+    if(m_name == NULL || m_dataType == IOT_no_type || m_valSize == 0) {
         return false;
     }
 
-    json = fastWriter.write(jsonVal);
+    // Members in the order Json::Value keeps them, sorted by name
+    const uint8_t* data = getDataPointer();
+    json += "{\"dataType\":";
+    switch(m_dataType)
+    {
+    case IOT_double:
+        json += "\"double\"";
+        break;
+    case IOT_long:
+        json += "\"long\"";
+        break;
+    case IOT_bool:
+        json += "\"boolean\"";
+        break;
+    case IOT_string:
+        json += "\"string\"";
+        break;
+    case IOT_binary:
+        json += "\"binary\"";
+        break;
+    case IOT_no_type:
+    default:
+        break;
+    }
+
+    json += ",\"name\":";
+    json += m_name->GetQuoted();
+
+    if(m_path != NULL) {
+        json += ",\"path\":";
+        json += m_path->GetQuoted();
+    }
+
+    if(m_timeStampMs != 0) {
+        json += ",\"ts\":";
+        json += Json::valueToString(static_cast<Json::LargestUInt>(m_timeStampMs));
+    }
+
+    if(m_unit != NULL) {
+        json += ",\"unit\":";
+        json += m_unit->GetQuoted();
+    }
+
+    json += ",\"v\":";
+    switch(m_dataType)
+    {
+    case IOT_double: {
+        double value;
+        memcpy(&value, data, sizeof(value));
+        json += Json::valueToString(IOT_DoubleFormat::Quantize(value, decimals));
+        break;
+    }
+    case IOT_long: {
+        int64_t value;
+        memcpy(&value, data, sizeof(value));
+        json += Json::valueToString(static_cast<Json::LargestInt>(value));
+        break;
+    }
+    case IOT_bool:
+        json += *((bool*)data) ? "true" : "false";
+        break;
+    case IOT_string: {
+        // Stored strings may not be null terminated
+        const char* str = (const char*)data;
+        Json::appendQuotedString(json, str, std::find(str, str + m_valSize, '\0'));
+        break;
+    }
+    case IOT_binary: {
+        std::string encoded = IOT_Base64::encode(data, m_valSize);
+        Json::appendQuotedString(json, encoded.data(), encoded.data() + encoded.size());
+        break;
+    }
+    case IOT_no_type:
+    default:
+        break;
+    }
+
+    json += '}';
     return true;
 }
 
 bool IOT_WriteData::ToJSON(Json::Value& json) const
 {
-    if(m_name.empty() || m_dataType == IOT_no_type || m_valSize == 0) {
+    if(m_name == NULL || m_dataType == IOT_no_type || m_valSize == 0) {
         return false;
     }
 
-    json["name"] = m_name;
+    json["name"] = m_name->GetValue();
 
-    if(!m_path.empty()) {
-       json["path"] = m_path;
+    if(m_path != NULL) {
+       json["path"] = m_path->GetValue();
     }
 
     const uint8_t* data = getDataPointer();
@@ -216,8 +351,8 @@ bool IOT_WriteData::ToJSON(Json::Value& json) const
         json["ts"] = m_timeStampMs;
     }
 
-    if(!m_unit.empty()) {
-        json["unit"] = m_unit;
+    if(m_unit != NULL) {
+        json["unit"] = m_unit->GetValue();
     }
 
     return true;
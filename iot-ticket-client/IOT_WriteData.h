@@ -23,9 +23,11 @@
 #ifndef IOT_WRITEDATA_H
 #define IOT_WRITEDATA_H
 
+#include <memory>
 #include <string>
 #include <stdint.h>
 #include "IOT_defines.h"
+#include "IOT_InternedString.h"
 #include <json/json.h>
 
 //! \brief Representation of single measurement that can be logged
@@ -40,6 +42,16 @@ class IOT_WriteData
         bool SetPath(const std::string& path);
         bool SetUnit(const std::string& unit);
 
+        const std::string& GetName() const;
+        const std::string& GetPath() const;
+        const std::string& GetUnit() const;
+        IOTAPI::IOT_DataType GetDataType() const;
+        uint64_t GetTimeMs() const;
+
+        //! \brief Get value of a double, long or bool sample as double
+        //! \return false if the sample does not have a numeric value
+        bool GetNumericValue(double& value) const;
+
         void SetValue(const std::string& value);
         void SetValue(const char* value);
         void SetValue(double value);
@@ -54,10 +66,23 @@ class IOT_WriteData
         bool ToJSON(std::string& json) const;
         bool ToJSON(Json::Value& json) const;
 
+        //! \brief Append the sample to json as a compact JSON object
+        //! \note Same output as Json::FastWriter gives for ToJSON(Json::Value&),
+        //!       without the trailing newline. No document tree is built, and
+        //!       name, path and unit are interned (IOT_InternedString) so each
+        //!       distinct string is escaped only once in the process.
+        //! \param [in,out] json  - Output the sample is appended to
+        //! \param [in] decimals  - Round a double value to this many decimals
+        //!                         (0...IOT_DoubleFormat::MAX_DECIMALS), NO_PRECISION for full precision
+        bool AppendJSON(std::string& json, int decimals = NO_PRECISION) const;
+
         IOT_WriteData& operator= (const IOT_WriteData& other);
         IOT_WriteData(const IOT_WriteData& other);
         IOT_WriteData(IOT_WriteData& other);
 
+        //! Precision setting for full precision
+        static const int NO_PRECISION = -1;
+
     private:
         static const uint32_t MAX_STATIC_SIZE;
 
@@ -69,9 +94,13 @@ class IOT_WriteData
         //! of dynamic data if necessary.
         IOT_WriteData& Assign(const IOT_WriteData& other);
 
-        std::string m_name;
-        std::string m_path;
-        std::string m_unit;
+        //! Value of an interned string, empty string for NULL
+        static const std::string& ValueOf(const std::shared_ptr<const IOT_InternedString>& str);
+
+        //! Name, path and unit shared with the other samples of the datanode, NULL if empty
+        std::shared_ptr<const IOT_InternedString> m_name;
+        std::shared_ptr<const IOT_InternedString> m_path;
+        std::shared_ptr<const IOT_InternedString> m_unit;
 
         IOTAPI::IOT_DataType m_dataType;
 
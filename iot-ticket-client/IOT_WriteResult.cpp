@@ -0,0 +1,124 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "IOT_WriteResult.h"
+#include "IOT_API.h"
+#include "IOT_Metrics.h"
+
+IOT_WriteResult::IOT_WriteResult()
+{
+    Clear();
+}
+
+IOTAPI::IOTAPI_err IOT_WriteResult::GetStatus() const
+{
+    return m_status;
+}
+
+size_t IOT_WriteResult::GetSubmitted() const
+{
+    return m_submitted;
+}
+
+size_t IOT_WriteResult::GetAccepted() const
+{
+    return m_accepted;
+}
+
+size_t IOT_WriteResult::GetPayloadBytes() const
+{
+    return m_payloadBytes;
+}
+
+double IOT_WriteResult::GetLatencyMs() const
+{
+    return m_latencyMs;
+}
+
+size_t IOT_WriteResult::GetChunks() const
+{
+    return m_chunks;
+}
+
+size_t IOT_WriteResult::GetFailedChunks() const
+{
+    return m_failedChunks;
+}
+
+bool IOT_WriteResult::IsAccepted(size_t index) const
+{
+    if(index >= m_acceptedSamples.size()) {
+        return false;
+    }
+
+    return m_acceptedSamples[index];
+}
+
+void IOT_WriteResult::GetRejected(std::vector<size_t>& indices) const
+{
+    indices.clear();
+    for(size_t i = 0; i < m_submitted; ++i) {
+        if(!IsAccepted(i)) {
+            indices.push_back(i);
+        }
+    }
+}
+
+size_t IOT_WriteResult::Requeue(const std::vector<IOT_WriteData>& batch, bool retry,
+                                std::deque<IOT_WriteData>& queue, size_t maxQueued) const
+{
+    return Requeue(batch, retry, queue, maxQueued, [](const IOT_WriteData& data) { return data; });
+}
+
+IOTAPI::IOTAPI_err IOT_WriteResult::GetSampleStatus(size_t index) const
+{
+    return (index < m_sampleStatus.size()) ? m_sampleStatus[index] : m_status;
+}
+
+void IOT_WriteResult::SelectRequeue(bool retry, size_t room, std::vector<size_t>& indices) const
+{
+    std::vector<size_t> rejected;
+    GetRejected(rejected);
+
+    indices.clear();
+    for(size_t i = 0; i < rejected.size() && indices.size() < room; ++i) {
+        if(retry && IOT_API::IsRetryableError(GetSampleStatus(rejected[i]))) {
+            indices.push_back(rejected[i]);
+        }
+    }
+
+    IOT_Metrics::Instance().queueDepth.Add(indices.size());
+    IOT_Metrics::Instance().samplesDropped.Add(rejected.size() - indices.size());
+}
+
+void IOT_WriteResult::Clear()
+{
+    m_status = IOTAPI::IOT_ERR_GENERAL;
+    m_submitted = 0;
+    m_accepted = 0;
+    m_payloadBytes = 0;
+    m_latencyMs = 0.0;
+    m_chunks = 0;
+    m_failedChunks = 0;
+    m_acceptedSamples.clear();
+    m_sampleStatus.clear();
+}
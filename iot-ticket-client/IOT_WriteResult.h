@@ -0,0 +1,134 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Wapice Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons
+ * to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef IOT_WRITERESULT_H
+#define IOT_WRITERESULT_H
+
+#include <deque>
+#include <stddef.h>
+#include <vector>
+#include "IOT_defines.h"
+#include "IOT_WriteData.h"
+
+//! \brief Detailed result of a process data write
+class IOT_WriteResult
+{
+public:
+    IOT_WriteResult();
+
+    //! \brief Overall result of the write, same as returned by IOT_API::SendData()
+    IOTAPI::IOTAPI_err GetStatus() const;
+
+    //! \brief Number of samples passed to the write
+    size_t GetSubmitted() const;
+
+    //! \brief Number of samples the server reported as written
+    size_t GetAccepted() const;
+
+    //! \brief Size of the JSON payload(s) sent to the server in bytes
+    size_t GetPayloadBytes() const;
+
+    //! \brief Duration of the HTTP request(s) in milliseconds
+    double GetLatencyMs() const;
+
+    //! \brief Number of requests the write was split into
+    size_t GetChunks() const;
+
+    //! \brief Number of requests that still failed after retries
+    size_t GetFailedChunks() const;
+
+    //! \brief Check if single sample was written
+    //! \param [in] index - Index of the sample in the vector passed to the write
+    //! \return true if the server accepted the sample
+    bool IsAccepted(size_t index) const;
+
+    //! \brief Get indices of the samples that were not written
+    //! \param [out] indices - Indices of the samples in the vector passed to the write
+    void GetRejected(std::vector<size_t>& indices) const;
+
+    //! \brief Result of the request that carried single sample
+    //! \note IOTAPI::IOT_ERR_OK if the request succeeded, even if the server
+    //!       did not store this sample. GetStatus() for a write that was not sent.
+    //! \param [in] index - Index of the sample in the vector passed to the write
+    IOTAPI::IOTAPI_err GetSampleStatus(size_t index) const;
+
+    //! \brief Put the samples that were not written back to the front of a queue
+    //! \note The samples keep their order, so the queue keeps the order of the
+    //!       device. A sample is put back if the request that carried it failed
+    //!       with an error IOT_API::IsRetryableError() allows to retry, as long
+    //!       as the queue has room. The other unwritten samples are counted as
+    //!       dropped.
+    //! \param [in] batch     - Samples passed to the write
+    //! \param [in] retry     - false to drop the samples in any case, e.g. when stopping
+    //! \param [in,out] queue - Queue the batch was taken from
+    //! \param [in] maxQueued - Max number of samples in the queue
+    //! \param [in] entry     - Makes a queue entry of a sample
+    //! \return Number of samples put back
+    template<class Queue, class MakeEntry>
+    size_t Requeue(const std::vector<IOT_WriteData>& batch, bool retry, Queue& queue, size_t maxQueued,
+                   MakeEntry entry) const;
+
+    //! \brief Requeue() for a queue of plain samples
+    size_t Requeue(const std::vector<IOT_WriteData>& batch, bool retry, std::deque<IOT_WriteData>& queue,
+                   size_t maxQueued) const;
+
+    //! \brief Reset to the state of a newly constructed object
+    void Clear();
+
+private:
+    friend class IOT_API;
+    friend class IOT_PreparedWriter;
+    friend class IOT_WriteTester;
+
+    IOTAPI::IOTAPI_err m_status;
+    size_t m_submitted;
+    size_t m_accepted;
+    size_t m_payloadBytes;
+    double m_latencyMs;
+    size_t m_chunks;
+    size_t m_failedChunks;
+
+    //! Write status of each submitted sample
+    std::vector<bool> m_acceptedSamples;
+
+    //! Result of the request of each submitted sample, empty if nothing was sent
+    std::vector<IOTAPI::IOTAPI_err> m_sampleStatus;
+
+    //! Select unwritten samples that can be put back to a queue with room for
+    //! room samples, and count them in the queue depth or as dropped metrics
+    void SelectRequeue(bool retry, size_t room, std::vector<size_t>& indices) const;
+};
+
+template<class Queue, class MakeEntry>
+size_t IOT_WriteResult::Requeue(const std::vector<IOT_WriteData>& batch, bool retry, Queue& queue, size_t maxQueued,
+                                MakeEntry entry) const
+{
+    std::vector<size_t> indices;
+    SelectRequeue(retry, (queue.size() < maxQueued) ? maxQueued - queue.size() : 0, indices);
+
+    for(size_t i = indices.size(); i > 0; --i) {
+        queue.push_front(entry(batch[indices[i-1]]));
+    }
+    return indices.size();
+}
+
+#endif // IOT_WRITERESULT_H
@@ -64,12 +64,17 @@ namespace IOTAPI
         IOT_ERR_QUOTA         = 7,  //! Quota ran out from the server
         IOT_ERR_SERVER        = 8,  //! Internal server error
         IOT_ERR_WRITE_FAILED  = 9,  //! Writing data failed
-        IOT_ERR_CONN          = 10, //! Could not connect to WRM server because of network
+        IOT_ERR_CONN          = 10, //! Could not connect to WRM server because of network, the request was not sent
         IOT_ERR_SSL           = 11, //! Could not connect to WRM server because SSL failed
         IOT_ERR_CURL_CALL     = 12, //! Other curl library related errors
-        IOT_ERR_GENERAL       = 13  //! Error that could not be identified as none of the above
+        IOT_ERR_GENERAL       = 13, //! Error that could not be identified as none of the above
+        IOT_ERR_THROTTLED     = 14, //! Server asked to slow down (HTTP 429) or rate limiter held the request back
+        IOT_ERR_TIMEOUT       = 15  //! Request timed out after it was sent, the server may have processed it
     } IOTAPI_err;
 
+    //! Number of error codes in IOTAPI_err
+    const uint32_t IOTAPI_ERR_COUNT = IOT_ERR_TIMEOUT + 1;
+
     //! Ordering of results for read process data queries
     typedef enum
     {
@@ -77,6 +82,26 @@ namespace IOTAPI
         IOT_ORDER_ASCENDING,
         IOT_ORDER_DESCENDING
     } IOT_DataOrder;
+
+    //! HTTP protocol versions of requests
+    typedef enum
+    {
+        IOT_HTTP_DEFAULT            = 0,  //! libcurl default
+        IOT_HTTP_1_1                = 1,  //! HTTP/1.1 only
+        IOT_HTTP_2                  = 2,  //! HTTP/2 negotiated over TLS, HTTP/1.1 without TLS
+        IOT_HTTP_2_PRIOR_KNOWLEDGE  = 3   //! HTTP/2 without TLS (h2c), server must support it
+    } IOT_HttpVersion;
+
+    //! Server endpoints for which request statistics are collected
+    typedef enum
+    {
+        IOT_EP_DEVICES   = 0,  //! /devices and /devices/{id}
+        IOT_EP_DATANODES = 1,  //! /devices/{id}/datanodes
+        IOT_EP_WRITE     = 2,  //! /process/write
+        IOT_EP_READ      = 3,  //! /process/read
+        IOT_EP_QUOTA     = 4,  //! /quota
+        IOT_EP_COUNT     = 5   //! Number of endpoints (not an endpoint)
+    } IOT_Endpoint;
 }
 
 #endif // IOTAPI_DEFINES_H
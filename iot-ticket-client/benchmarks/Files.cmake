@@ -0,0 +1,27 @@
+
+set(IOTAPI_BENCHMARKS_SOURCES
+    benchmarks/IOT_DoubleFormatBench.cpp
+    benchmarks/IOT_NumberParseBench.cpp
+    benchmarks/IOT_ResponseDecoderBench.cpp
+    benchmarks/IOT_ValueArenaBench.cpp
+    benchmarks/IOT_JsonScanBench.cpp
+    benchmarks/IOT_MockServer.cpp
+    benchmarks/IOT_GatewayBench.cpp
+    benchmarks/IOT_UploadSchedulerBench.cpp
+    benchmarks/IOT_Http2Bench.cpp
+    benchmarks/IOT_WarmupBench.cpp
+    benchmarks/IOT_TlsResumeBench.cpp
+    benchmarks/IOT_RateLimitBench.cpp
+    benchmarks/main.cpp
+)
+
+add_executable(iot-ticket-benchmarks ${IOTAPI_BENCHMARKS_SOURCES} )
+target_link_libraries(iot-ticket-benchmarks IOT_API)
+
+# HTTPS and HTTP/2 over TLS in the mock server
+find_package(OpenSSL)
+if(OPENSSL_FOUND)
+    target_compile_definitions(iot-ticket-benchmarks PRIVATE IOT_MOCKSERVER_TLS)
+    target_include_directories(iot-ticket-benchmarks PRIVATE ${OPENSSL_INCLUDE_DIR})
+    target_link_libraries(iot-ticket-benchmarks ${OPENSSL_LIBRARIES})
+endif()
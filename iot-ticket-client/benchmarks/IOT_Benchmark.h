@@ -0,0 +1,47 @@
+
+
+#ifndef IOT_BENCHMARK_H
+#define IOT_BENCHMARK_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+//! Run fn repeatedly for about the given time and print calls per second
+template<typename Fn>
+double IOT_Benchmark(const std::string& name, Fn fn, double seconds = 0.5)
+{
+    typedef std::chrono::steady_clock clock;
+
+    uint64_t calls = 0;
+    clock::time_point start = clock::now();
+    clock::time_point end = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+    clock::time_point now = start;
+    while(now < end) {
+        for(int i = 0; i < 100; ++i) {
+            fn();
+        }
+        calls += 100;
+        now = clock::now();
+    }
+
+    double rate = calls / std::chrono::duration<double>(now - start).count();
+    std::cout << "  " << name << ": " << rate << " /s" << std::endl;
+    return rate;
+}
+
+void BenchDoubleFormat();
+void BenchNumberParse();
+void BenchResponseDecoder();
+void BenchValueArena();
+void BenchJsonScan();
+void BenchJsonEscape();
+void BenchGateway();
+void BenchUploadScheduler();
+void BenchHttp2();
+void BenchWarmup();
+void BenchTlsResume();
+void BenchRateLimit();
+
+#endif // IOT_BENCHMARK_H
@@ -0,0 +1,60 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_DoubleFormat.h"
+#include "IOT_WriteData.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+void BenchDoubleFormat()
+{
+    // Typical process values: a few significant digits plus measurement noise
+    std::vector<double> values;
+    srand(1);
+    for(int i = 0; i < 1000; ++i) {
+        values.push_back(20.0 + (rand() % 100000) / 1000.0 + rand() / (double)RAND_MAX * 1e-3);
+    }
+
+    char buffer[IOT_DoubleFormat::BUFFER_SIZE];
+    size_t index = 0;
+    size_t sink = 0;
+
+    double legacy = IOT_Benchmark("snprintf %.17g", [&]() {
+        sink += snprintf(buffer, sizeof(buffer), "%.17g", values[index++ % values.size()]);
+    });
+    double grisu = IOT_Benchmark("IOT_DoubleFormat", [&]() {
+        sink += IOT_DoubleFormat::Format(values[index++ % values.size()], buffer);
+    });
+    std::cout << "  speedup: " << grisu / legacy << "x" << std::endl;
+
+    // Payload size of the same samples written with different settings
+    size_t legacyBytes = 0;
+    for(size_t i = 0; i < values.size(); ++i) {
+        legacyBytes += snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+    }
+
+    const int precisions[] = { IOT_WriteData::NO_PRECISION, 3, 1 };
+    for(size_t p = 0; p < sizeof(precisions) / sizeof(precisions[0]); ++p) {
+        size_t valueBytes = 0;
+        size_t jsonBytes = 0;
+        IOT_WriteData data;
+        data.SetName("Temperature");
+        data.SetTimeMs(1420070400000ULL);
+
+        for(size_t i = 0; i < values.size(); ++i) {
+            data.SetValue(values[i]);
+            std::string json;
+            data.AppendJSON(json, precisions[p]);
+            jsonBytes += json.size();
+            valueBytes += IOT_DoubleFormat::ToString(IOT_DoubleFormat::Quantize(values[i], precisions[p])).size();
+        }
+
+        std::cout << "  precision " << precisions[p] << ": values " << valueBytes << " B (%.17g "
+                  << legacyBytes << " B), samples " << jsonBytes << " B" << std::endl;
+    }
+
+    if(sink == 0) {
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,111 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_MockServer.h"
+#include "IOT_Gateway.h"
+#include <stdio.h>
+
+typedef std::chrono::steady_clock bench_clock;
+
+//! Run transport and gateway until the given time, or until all is sent if time is not given
+static void Pump(IOT_AsyncTransport& transport, IOT_Gateway& gateway,
+                 bench_clock::time_point until = bench_clock::time_point())
+{
+    while(true) {
+        bench_clock::time_point now = bench_clock::now();
+        bool drain = (until == bench_clock::time_point());
+        if(drain ? (gateway.GetQueued() == 0 && gateway.GetInFlight() == 0) : now >= until) {
+            break;
+        }
+
+        long timeoutMs = gateway.GetNextTimeoutMs();
+        if(timeoutMs < 0 || timeoutMs > 100) {
+            timeoutMs = 100;
+        }
+        if(!drain) {
+            timeoutMs = std::min<long>(timeoutMs, std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count());
+        }
+        transport.Poll(static_cast<int>(timeoutMs));
+        gateway.Dispatch();
+    }
+}
+
+static void PrintStats(const IOT_Gateway& gateway, const IOT_MockServer& server, size_t samples, double seconds)
+{
+    IOT_Gateway::Stats stats;
+    gateway.GetStats(stats);
+    std::cout << "  samples written: " << stats.written << " of " << samples << std::endl;
+    std::cout << "  requests: " << stats.batches << " on " << server.GetConnections() << " connections" << std::endl;
+    std::cout << "  throughput: " << stats.written / seconds << " samples/s, "
+              << stats.batches / seconds << " requests/s" << std::endl;
+    std::cout << "  per device latency: mean " << stats.latency.GetMean() << " ms, p99 "
+              << stats.latency.GetPercentile(0.99) << " ms, max " << stats.latency.GetMax() << " ms" << std::endl;
+}
+
+void BenchGateway()
+{
+    // 5000 devices sending to a server taking 2 ms per request, over 8 connections
+    const size_t DEVICES = 5000;
+
+    std::vector<std::string> devices(DEVICES);
+    for(size_t d = 0; d < DEVICES; ++d) {
+        char id[32];
+        snprintf(id, sizeof(id), "device-%05zu", d);
+        devices[d] = id;
+    }
+
+    IOT_WriteData sample;
+    sample.SetName("temperature");
+    sample.SetUnit("C");
+
+    {
+        // Burst of 40 samples per device, as fast as the connections allow
+        const size_t ROUNDS = 40;
+        IOT_MockServer server(2);
+        IOT_API api(server.GetUrl(), "user", "pass", 20);
+        IOT_AsyncTransport transport(20, 8);
+        IOT_Gateway gateway(api, transport, 8);
+        gateway.SetBatching(20, 100);
+
+        std::cout << " burst" << std::endl;
+        bench_clock::time_point start = bench_clock::now();
+        for(size_t round = 0; round < ROUNDS; ++round) {
+            for(size_t d = 0; d < DEVICES; ++d) {
+                sample.SetValue(static_cast<double>(round));
+                sample.SetTimeToNow();
+                gateway.Enqueue(devices[d], sample);
+            }
+            transport.Poll(0);
+            gateway.Dispatch();
+        }
+        gateway.Flush();
+        Pump(transport, gateway);
+        PrintStats(gateway, server, DEVICES * ROUNDS, std::chrono::duration<double>(bench_clock::now() - start).count());
+    }
+
+    {
+        // Every device sends a sample each 200 ms for 6 seconds. Request rate
+        // is set by the flush interval: 5000 devices / 2 s.
+        const size_t ROUNDS = 30;
+        const std::chrono::milliseconds PERIOD(200);
+        IOT_MockServer server(2);
+        IOT_API api(server.GetUrl(), "user", "pass", 20);
+        IOT_AsyncTransport transport(20, 16);
+        IOT_Gateway gateway(api, transport, 16);
+        gateway.SetBatching(20, 2000);
+
+        std::cout << " paced, 25000 samples/s" << std::endl;
+        bench_clock::time_point start = bench_clock::now();
+        for(size_t round = 0; round < ROUNDS; ++round) {
+            for(size_t d = 0; d < DEVICES; ++d) {
+                sample.SetValue(static_cast<double>(round));
+                sample.SetTimeToNow();
+                gateway.Enqueue(devices[d], sample);
+            }
+            Pump(transport, gateway, start + PERIOD * (round + 1));
+        }
+        gateway.Flush();
+        Pump(transport, gateway);
+        PrintStats(gateway, server, DEVICES * ROUNDS, std::chrono::duration<double>(bench_clock::now() - start).count());
+    }
+}
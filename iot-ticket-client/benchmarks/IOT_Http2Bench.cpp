@@ -0,0 +1,69 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_MockServer.h"
+#include "IOT_Gateway.h"
+#include <stdio.h>
+
+//! Upload a burst of samples of many devices through a gateway and print the throughput
+static void RunBurst(const char* name, bool tls, IOTAPI::IOT_HttpVersion version, size_t connections, size_t inFlight)
+{
+    const size_t DEVICES = 2000;
+    const size_t ROUNDS = 20;
+
+    IOT_MockServer server(2, tls);
+    if(tls && !server.HasTls()) {
+        std::cout << " " << name << ": benchmarks built without OpenSSL" << std::endl;
+        return;
+    }
+    IOT_API api(server.GetUrl(), "user", "pass", 20);
+    IOT_AsyncTransport transport(20, connections);
+    if(transport.SetHttpVersion(version) != IOTAPI::IOT_ERR_OK) {
+        std::cout << " " << name << ": not supported by libcurl" << std::endl;
+        return;
+    }
+    IOT_Gateway gateway(api, transport, inFlight);
+    gateway.SetBatching(20, 100);
+
+    IOT_WriteData sample;
+    sample.SetName("temperature");
+    sample.SetUnit("C");
+    sample.SetValue(21.5);
+    sample.SetTimeToNow();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t round = 0; round < ROUNDS; ++round) {
+        for(size_t d = 0; d < DEVICES; ++d) {
+            gateway.Enqueue("device-" + std::to_string(d), sample);
+        }
+    }
+    gateway.Flush();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::seconds(30);
+    while((gateway.GetQueued() > 0 || gateway.GetInFlight() > 0) && std::chrono::steady_clock::now() < deadline) {
+        transport.Poll(100);
+        gateway.Dispatch();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    IOT_Gateway::Stats stats;
+    gateway.GetStats(stats);
+    std::cout << " " << name << std::endl;
+    std::cout << "  samples written: " << stats.written << " of " << DEVICES * ROUNDS << std::endl;
+    std::cout << "  requests: " << stats.batches << " on " << server.GetConnections() << " connections" << std::endl;
+    std::cout << "  throughput: " << stats.written / seconds << " samples/s, "
+              << stats.batches / seconds << " requests/s" << std::endl;
+}
+
+void BenchHttp2()
+{
+    // Server takes 2 ms per request. HTTP/1.1 needs a connection and a TLS
+    // handshake per request in flight, HTTP/2 multiplexes them on one connection.
+    RunBurst("HTTPS HTTP/1.1, 8 connections", true, IOTAPI::IOT_HTTP_1_1, 8, 8);
+    RunBurst("HTTPS HTTP/1.1, 64 connections", true, IOTAPI::IOT_HTTP_1_1, 64, 64);
+    RunBurst("HTTPS HTTP/2, 1 connection", true, IOTAPI::IOT_HTTP_2, 1, 64);
+#if LIBCURL_VERSION_NUM >= 0x080000
+    // libcurl 7.88 fails requests on a reused h2c connection, failed
+    // batches are retried until the deadline
+    RunBurst("HTTP/2 h2c, 1 connection", false, IOTAPI::IOT_HTTP_2_PRIOR_KNOWLEDGE, 1, 64);
+#endif
+}
@@ -0,0 +1,123 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_JsonScan.h"
+#include "IOT_JsonPullParser.h"
+#include "IOT_WriteData.h"
+#include "json/json.h"
+#include <sstream>
+#include <string.h>
+
+void BenchJsonScan()
+{
+    // Process read reply of 4 datanodes with 4000 values each
+    std::ostringstream reply;
+    reply << "{\"href\":\"https://my.iot-ticket.com/api/v1/process/read/dev\",\"datanodeReads\":[";
+    for(int node = 0; node < 4; ++node) {
+        reply << (node ? "," : "") << "{\"name\":\"n" << node << "\",\"path\":\"site/line\",\"unit\":\"C\","
+              << "\"dataType\":\"string\",\"values\":[";
+        for(int i = 0; i < 4000; ++i) {
+            reply << (i ? "," : "") << "{\"v\":\"status \\\"ok\\\" of pump " << i << ", inlet pressure nominal\",\"ts\":"
+                  << 1440000000000ULL + i * 1000 << "}";
+        }
+        reply << "]}";
+    }
+    reply << "]}";
+    const std::string json = reply.str();
+    const double megabytes = json.size() / 1e6;
+
+    std::string copy(json.size(), ' ');
+    double rate = IOT_Benchmark("memcpy", [&]() {
+        memcpy(&copy[0], json.data(), json.size());
+    }, 0.5);
+    std::cout << "  " << rate * megabytes << " MB/s" << std::endl;
+
+    size_t sink = 0;
+    const char* names[] = { "scalar", "sse2", "neon", "avx2" };
+    for(size_t n = 0; n < sizeof(names) / sizeof(names[0]); ++n) {
+        if(!IOT_JsonScan::SetImplementation(names[n])) {
+            continue;
+        }
+
+        rate = IOT_Benchmark(std::string("skip reply, ") + names[n], [&]() {
+            IOT_JsonPullParser parser(json);
+            parser.Next();
+            sink += parser.SkipValue();
+        }, 0.5);
+        std::cout << "  " << rate * megabytes << " MB/s" << std::endl;
+
+        rate = IOT_Benchmark(std::string("pull parse reply, ") + names[n], [&]() {
+            IOT_JsonPullParser parser(json);
+            while(parser.Next() > IOT_JsonPullParser::TOKEN_END) {
+                sink += parser.GetString().size();
+            }
+        }, 0.5);
+        std::cout << "  " << rate * megabytes << " MB/s" << std::endl;
+
+        Json::Reader reader;
+        rate = IOT_Benchmark(std::string("Json::Reader parse reply, ") + names[n], [&]() {
+            Json::Value root;
+            reader.parse(json, root, false);
+            sink += root.size();
+        }, 0.5);
+        std::cout << "  " << rate * megabytes << " MB/s" << std::endl;
+    }
+    IOT_JsonScan::SetImplementation(NULL);
+
+    if(sink == 0) {
+        std::cout << std::endl;
+    }
+}
+
+void BenchJsonEscape()
+{
+    // Long string sample value with an occasional character to escape
+    std::string text;
+    for(int i = 0; i < 64; ++i) {
+        text += "pump 7 status: running, inlet pressure 2.4 bar, outlet \"ok\"\n";
+    }
+    const double megabytes = text.size() / 1e6;
+
+    size_t sink = 0;
+    const char* names[] = { "scalar", "sse2", "neon", "avx2" };
+    for(size_t n = 0; n < sizeof(names) / sizeof(names[0]); ++n) {
+        if(!IOT_JsonScan::SetImplementation(names[n])) {
+            continue;
+        }
+
+        std::string quoted;
+        double rate = IOT_Benchmark(std::string("quote string, ") + names[n], [&]() {
+            quoted.clear();
+            Json::appendQuotedString(quoted, text.data(), text.data() + text.size());
+            sink += quoted.size();
+        });
+        std::cout << "  " << rate * megabytes << " MB/s" << std::endl;
+    }
+    IOT_JsonScan::SetImplementation(NULL);
+
+    // One sample as serialized for a write
+    IOT_WriteData data;
+    data.SetName("Temperature");
+    data.SetPath("site/line");
+    data.SetUnit("C");
+    data.SetValue(21.5);
+    data.SetTimeToNow();
+    Json::FastWriter writer;
+
+    double tree = IOT_Benchmark("write sample, Json::Value + FastWriter", [&]() {
+        Json::Value value;
+        data.ToJSON(value);
+        sink += writer.write(value).size();
+    });
+    std::string json;
+    double direct = IOT_Benchmark("write sample, AppendJSON", [&]() {
+        json.clear();
+        data.AppendJSON(json);
+        sink += json.size();
+    });
+    std::cout << "  speedup: " << direct / tree << "x" << std::endl;
+
+    if(sink == 0) {
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,614 @@
+
+
+#include "IOT_MockServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <vector>
+
+#ifdef IOT_MOCKSERVER_TLS
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#else
+typedef struct ssl_st SSL;
+#endif
+
+typedef std::chrono::steady_clock clock_t_;
+
+namespace
+{
+    struct Reply
+    {
+        clock_t_::time_point due;
+        std::string data;
+    };
+
+    enum Protocol
+    {
+        PROTOCOL_UNKNOWN,
+        PROTOCOL_HTTP1,
+        PROTOCOL_HTTP2
+    };
+
+    struct Connection
+    {
+        Connection(): protocol(PROTOCOL_UNKNOWN), ssl(NULL), handshaken(false), resumed(false), counted(false) {}
+
+        Protocol protocol;
+        SSL* ssl;
+        bool handshaken;
+        bool resumed;
+
+        //! Handshake has been counted in the statistics
+        bool counted;
+        std::string in;
+        std::string out;
+        std::deque<Reply> replies;
+
+        //! Request bodies of open HTTP/2 streams, by stream id
+        std::map<uint32_t, std::string> streams;
+    };
+
+    //! Client connection preface of HTTP/2
+    const std::string H2_PREFACE("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+
+    enum FrameType
+    {
+        FRAME_DATA          = 0x0,
+        FRAME_HEADERS       = 0x1,
+        FRAME_SETTINGS      = 0x4,
+        FRAME_PING          = 0x6,
+        FRAME_GOAWAY        = 0x7,
+        FRAME_WINDOW_UPDATE = 0x8
+    };
+
+    const uint8_t FLAG_END_STREAM  = 0x1;
+    const uint8_t FLAG_ACK         = 0x1;
+    const uint8_t FLAG_END_HEADERS = 0x4;
+    const uint8_t FLAG_PADDED      = 0x8;
+    const uint8_t FLAG_PRIORITY    = 0x20;
+
+    const uint32_t MAX_WINDOW = 0x7fffffff;
+    const uint32_t DEFAULT_WINDOW = 65535;
+
+    //! Connection window kept open to the client. Below the max, as received
+    //! data is given back to the window with WINDOW_UPDATE.
+    const uint32_t CONNECTION_WINDOW = 0x40000000;
+
+    //! Count samples of a write payload by their name fields
+    size_t CountSamples(const std::string& body)
+    {
+        size_t count = 0;
+        for(size_t pos = body.find("\"name\":"); pos != std::string::npos; pos = body.find("\"name\":", pos + 1)) {
+            ++count;
+        }
+        return count;
+    }
+
+    std::string WriteReply(const std::string& payload)
+    {
+        return "{\"totalWritten\":" + std::to_string(CountSamples(payload)) + "}";
+    }
+
+    //! Take one complete request from the input buffer and build its reply body
+    bool TakeRequest(std::string& in, std::string& body)
+    {
+        size_t end = in.find("\r\n\r\n");
+        if(end == std::string::npos) {
+            return false;
+        }
+
+        size_t length = 0;
+        for(size_t pos = 0; pos < end; pos = in.find("\r\n", pos) + 2) {
+            if(strncasecmp(in.c_str() + pos, "Content-Length:", 15) == 0) {
+                length = strtoul(in.c_str() + pos + 15, NULL, 10);
+            }
+        }
+        if(in.size() < end + 4 + length) {
+            return false;
+        }
+
+        if(in.compare(0, 5, "POST ") == 0 && in.find("/process/write/") < end) {
+            body = WriteReply(in.substr(end + 4, length));
+        } else {
+            body = "{}";
+        }
+        in.erase(0, end + 4 + length);
+        return true;
+    }
+
+    void AppendUint(std::string& out, uint32_t value, size_t bytes)
+    {
+        for(size_t i = bytes; i > 0; --i) {
+            out += static_cast<char>((value >> (8 * (i - 1))) & 0xff);
+        }
+    }
+
+    uint32_t ReadUint(const std::string& in, size_t pos, size_t bytes)
+    {
+        uint32_t value = 0;
+        for(size_t i = 0; i < bytes; ++i) {
+            value = (value << 8) | static_cast<uint8_t>(in[pos + i]);
+        }
+        return value;
+    }
+
+    std::string Frame(uint8_t type, uint8_t flags, uint32_t stream, const std::string& payload)
+    {
+        std::string frame;
+        AppendUint(frame, static_cast<uint32_t>(payload.size()), 3);
+        frame += static_cast<char>(type);
+        frame += static_cast<char>(flags);
+        AppendUint(frame, stream, 4);
+        return frame + payload;
+    }
+
+    //! HPACK literal header field without indexing, name from the static table
+    void AppendHeader(std::string& block, uint8_t nameIndex, const std::string& value)
+    {
+        block += static_cast<char>(0x0f);
+        block += static_cast<char>(nameIndex - 0x0f);
+        block += static_cast<char>(value.size());
+        block += value;
+    }
+
+    std::string Http2Reply(uint32_t stream, const std::string& body)
+    {
+        std::string block;
+        block += static_cast<char>(0x88);     // :status 200
+        AppendHeader(block, 31, "application/json");
+        AppendHeader(block, 28, std::to_string(body.size()));
+        return Frame(FRAME_HEADERS, FLAG_END_HEADERS, stream, block) + Frame(FRAME_DATA, FLAG_END_STREAM, stream, body);
+    }
+
+    //! Connection settings and flow control windows opened wide, so the
+    //! client never waits for window updates of request bodies
+    std::string Http2Start()
+    {
+        std::string settings;
+        AppendUint(settings, 0x3, 2);     // max concurrent streams
+        AppendUint(settings, 1000, 4);
+        AppendUint(settings, 0x4, 2);     // initial window size
+        AppendUint(settings, MAX_WINDOW, 4);
+
+        std::string increment;
+        AppendUint(increment, CONNECTION_WINDOW - DEFAULT_WINDOW, 4);
+        return Frame(FRAME_SETTINGS, 0, 0, settings) + Frame(FRAME_WINDOW_UPDATE, 0, 0, increment);
+    }
+
+    //! Check if the header block of a request starts with the indexed :method POST
+    bool IsPost(const std::string& block)
+    {
+        size_t pos = 0;
+        while(pos < block.size() && (static_cast<uint8_t>(block[pos]) & 0xe0) == 0x20) {
+            ++pos;    // dynamic table size update
+        }
+        return pos < block.size() && static_cast<uint8_t>(block[pos]) == 0x83;
+    }
+
+    //! Handle complete frames of the input buffer. Control frames are answered
+    //! right away and replies of completed requests added to the list.
+    //! \return false if the client closes the connection
+    bool TakeFrames(Connection& conn, std::vector<std::string>& replies)
+    {
+        while(conn.in.size() >= 9) {
+            uint32_t length = ReadUint(conn.in, 0, 3);
+            if(conn.in.size() < 9 + length) {
+                break;
+            }
+            uint8_t type = static_cast<uint8_t>(conn.in[3]);
+            uint8_t flags = static_cast<uint8_t>(conn.in[4]);
+            uint32_t stream = ReadUint(conn.in, 5, 4) & MAX_WINDOW;
+            std::string payload = conn.in.substr(9, length);
+            conn.in.erase(0, 9 + length);
+
+            size_t padding = 0;
+            if((type == FRAME_DATA || type == FRAME_HEADERS) && (flags & FLAG_PADDED) && !payload.empty()) {
+                padding = static_cast<uint8_t>(payload[0]);
+                payload.erase(0, 1);
+            }
+            if(type == FRAME_HEADERS && (flags & FLAG_PRIORITY)) {
+                payload.erase(0, 5);
+            }
+            payload.resize(payload.size() - std::min(padding, payload.size()));
+
+            bool complete = false;
+            switch(type)
+            {
+            case FRAME_DATA:
+                conn.streams[stream] += payload;
+                complete = (flags & FLAG_END_STREAM) != 0;
+                if(length > 0) {
+                    std::string increment;
+                    AppendUint(increment, length, 4);
+                    conn.out += Frame(FRAME_WINDOW_UPDATE, 0, 0, increment);
+                }
+                break;
+            case FRAME_HEADERS:
+                // Bodies of requests other than POST are not looked at, mark them with a space
+                conn.streams[stream] = IsPost(payload) ? "" : " ";
+                complete = (flags & FLAG_END_STREAM) != 0;
+                break;
+            case FRAME_SETTINGS:
+                if(!(flags & FLAG_ACK)) {
+                    conn.out += Frame(FRAME_SETTINGS, FLAG_ACK, 0, "");
+                }
+                break;
+            case FRAME_PING:
+                if(!(flags & FLAG_ACK)) {
+                    conn.out += Frame(FRAME_PING, FLAG_ACK, 0, payload);
+                }
+                break;
+            case FRAME_GOAWAY:
+                return false;
+            default:
+                break;
+            }
+
+            if(complete) {
+                const std::string& body = conn.streams[stream];
+                replies.push_back(Http2Reply(stream, (body == " ") ? "{}" : WriteReply(body)));
+                conn.streams.erase(stream);
+            }
+        }
+        return true;
+    }
+
+    //! Take the complete requests of the input buffer and build their replies
+    //! \return false if the connection is to be closed
+    bool TakeRequests(Connection& conn, std::vector<std::string>& replies)
+    {
+        if(conn.protocol == PROTOCOL_UNKNOWN) {
+            size_t common = std::min(conn.in.size(), H2_PREFACE.size());
+            if(conn.in.compare(0, common, H2_PREFACE, 0, common) != 0) {
+                conn.protocol = PROTOCOL_HTTP1;
+            } else if(common == H2_PREFACE.size()) {
+                conn.protocol = PROTOCOL_HTTP2;
+                conn.in.erase(0, common);
+                conn.out += Http2Start();
+            } else {
+                return true;
+            }
+        }
+
+        if(conn.protocol == PROTOCOL_HTTP2) {
+            return TakeFrames(conn, replies);
+        }
+
+        std::string body;
+        while(TakeRequest(conn.in, body)) {
+            replies.push_back("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                              std::to_string(body.size()) + "\r\n\r\n" + body);
+        }
+        return true;
+    }
+
+#ifdef IOT_MOCKSERVER_TLS
+    //! Select h2 if the client offers it, HTTP/1.1 otherwise
+    int SelectProtocol(SSL* /*ssl*/, const unsigned char** out, unsigned char* outlen,
+                       const unsigned char* in, unsigned int inlen, void* /*arg*/)
+    {
+        static const unsigned char PROTOCOLS[] = "\x02h2\x08http/1.1";
+        unsigned char* selected = NULL;
+        if(SSL_select_next_proto(&selected, outlen, PROTOCOLS, sizeof(PROTOCOLS) - 1, in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_NOACK;
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    //! Server context with a self-signed P-256 certificate for 127.0.0.1
+    SSL_CTX* CreateTlsContext()
+    {
+        EVP_PKEY* key = NULL;
+        EVP_PKEY_CTX* keyCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+        if(keyCtx == NULL || EVP_PKEY_keygen_init(keyCtx) <= 0 ||
+           EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyCtx, NID_X9_62_prime256v1) <= 0 ||
+           EVP_PKEY_keygen(keyCtx, &key) <= 0) {
+            EVP_PKEY_CTX_free(keyCtx);
+            return NULL;
+        }
+        EVP_PKEY_CTX_free(keyCtx);
+
+        X509* cert = X509_new();
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("127.0.0.1"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+
+        SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+        if(ctx != NULL) {
+            SSL_CTX_use_certificate(ctx, cert);
+            SSL_CTX_use_PrivateKey(ctx, key);
+            SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+            SSL_CTX_set_alpn_select_cb(ctx, SelectProtocol, NULL);
+        }
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return ctx;
+    }
+#endif
+
+    //! Read what the socket has into the input buffer
+    //! \return false if the connection is closed
+    bool ReadInput(int fd, Connection& conn, char* buffer, size_t size)
+    {
+#ifdef IOT_MOCKSERVER_TLS
+        if(conn.ssl != NULL) {
+            if(!conn.handshaken) {
+                int ret = SSL_accept(conn.ssl);
+                if(ret <= 0) {
+                    int err = SSL_get_error(conn.ssl, ret);
+                    return err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE;
+                }
+                conn.handshaken = true;
+                conn.resumed = (SSL_session_reused(conn.ssl) == 1);
+            }
+
+            while(true) {
+                int got = SSL_read(conn.ssl, buffer, static_cast<int>(size));
+                if(got > 0) {
+                    conn.in.append(buffer, got);
+                    continue;
+                }
+                int err = SSL_get_error(conn.ssl, got);
+                return err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE;
+            }
+        }
+#endif
+        ssize_t got = recv(fd, buffer, size, 0);
+        if(got <= 0) {
+            return false;
+        }
+        conn.in.append(buffer, got);
+        return true;
+    }
+
+    //! Send what the socket takes from the output buffer
+    //! \return false if the connection is closed
+    bool WriteOutput(int fd, Connection& conn)
+    {
+#ifdef IOT_MOCKSERVER_TLS
+        if(conn.ssl != NULL) {
+            int sent = SSL_write(conn.ssl, conn.out.data(), static_cast<int>(conn.out.size()));
+            if(sent > 0) {
+                conn.out.erase(0, sent);
+                return true;
+            }
+            int err = SSL_get_error(conn.ssl, sent);
+            return err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE;
+        }
+#endif
+        ssize_t sent = send(fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if(sent > 0) {
+            conn.out.erase(0, sent);
+        }
+        return sent >= 0;
+    }
+
+    void CloseConnection(int fd, Connection& conn)
+    {
+#ifdef IOT_MOCKSERVER_TLS
+        if(conn.ssl != NULL) {
+            SSL_free(conn.ssl);
+            conn.ssl = NULL;
+        }
+#endif
+        close(fd);
+    }
+}
+
+IOT_MockServer::IOT_MockServer(uint32_t delayMs, bool tls):
+    m_delayMs(delayMs), m_tls(NULL), m_port(0), m_stop(false), m_requests(0), m_connections(0),
+    m_handshakes(0), m_resumed(0), m_ratePerSecond(0), m_retryAfterS(0), m_throttled(0)
+{
+#ifdef IOT_MOCKSERVER_TLS
+    if(tls) {
+        m_tls = CreateTlsContext();
+    }
+#else
+    (void)tls;
+#endif
+
+    m_listen = socket(AF_INET, SOCK_STREAM, 0);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bind(m_listen, reinterpret_cast<sockaddr*>(&addr), len);
+    listen(m_listen, 128);
+    getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &len);
+    m_port = ntohs(addr.sin_port);
+
+    m_thread = std::thread(&IOT_MockServer::Run, this);
+}
+
+IOT_MockServer::~IOT_MockServer()
+{
+    m_stop = true;
+    m_thread.join();
+    close(m_listen);
+
+#ifdef IOT_MOCKSERVER_TLS
+    if(m_tls != NULL) {
+        SSL_CTX_free(m_tls);
+    }
+#endif
+}
+
+std::string IOT_MockServer::GetUrl() const
+{
+    return (HasTls() ? "https://127.0.0.1:" : "http://127.0.0.1:") + std::to_string(m_port);
+}
+
+bool IOT_MockServer::HasTls() const
+{
+    return m_tls != NULL;
+}
+
+uint64_t IOT_MockServer::GetRequests() const
+{
+    return m_requests.load();
+}
+
+uint64_t IOT_MockServer::GetConnections() const
+{
+    return m_connections.load();
+}
+
+uint64_t IOT_MockServer::GetHandshakes() const
+{
+    return m_handshakes.load();
+}
+
+uint64_t IOT_MockServer::GetResumedHandshakes() const
+{
+    return m_resumed.load();
+}
+
+void IOT_MockServer::SetRateLimit(uint32_t perSecond, uint32_t retryAfterS)
+{
+    m_retryAfterS = retryAfterS;
+    m_ratePerSecond = perSecond;
+}
+
+uint64_t IOT_MockServer::GetThrottled() const
+{
+    return m_throttled.load();
+}
+
+void IOT_MockServer::Run()
+{
+    std::map<int, Connection> connections;
+    char buffer[65536];
+
+    // Requests answered in the current second of the rate limit
+    clock_t_::time_point window = clock_t_::now();
+    uint32_t windowRequests = 0;
+
+    while(!m_stop) {
+        std::vector<pollfd> fds;
+        pollfd listen = { m_listen, POLLIN, 0 };
+        fds.push_back(listen);
+
+        clock_t_::time_point now = clock_t_::now();
+        int timeoutMs = 50;
+        for(std::map<int, Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+            Connection& conn = it->second;
+            while(!conn.replies.empty() && conn.replies.front().due <= now) {
+                conn.out += conn.replies.front().data;
+                conn.replies.pop_front();
+            }
+            if(!conn.replies.empty()) {
+                long left = std::chrono::duration_cast<std::chrono::milliseconds>(conn.replies.front().due - now).count();
+                timeoutMs = std::min<int>(timeoutMs, static_cast<int>(left) + 1);
+            }
+
+            pollfd fd = { it->first, static_cast<short>(POLLIN | (conn.out.empty() ? 0 : POLLOUT)), 0 };
+            fds.push_back(fd);
+        }
+
+        if(poll(&fds[0], fds.size(), timeoutMs) <= 0) {
+            continue;
+        }
+
+        if(fds[0].revents & POLLIN) {
+            int fd = accept(m_listen, NULL, NULL);
+            if(fd >= 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                Connection& conn = connections[fd];
+#ifdef IOT_MOCKSERVER_TLS
+                if(m_tls != NULL) {
+                    // TLS reads until the socket would block
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    conn.ssl = SSL_new(m_tls);
+                    SSL_set_fd(conn.ssl, fd);
+                }
+#else
+                (void)conn;
+#endif
+                ++m_connections;
+            }
+        }
+
+        for(size_t i = 1; i < fds.size(); ++i) {
+            Connection& conn = connections[fds[i].fd];
+            bool closed = (fds[i].revents & (POLLERR | POLLHUP)) != 0;
+
+            if(fds[i].revents & POLLIN) {
+                if(!ReadInput(fds[i].fd, conn, buffer, sizeof(buffer))) {
+                    closed = true;
+                } else {
+                    if(conn.handshaken && !conn.counted) {
+                        conn.counted = true;
+                        ++m_handshakes;
+                        m_resumed += conn.resumed ? 1 : 0;
+                    }
+                    std::vector<std::string> replies;
+                    closed = !TakeRequests(conn, replies);
+                    for(size_t r = 0; r < replies.size(); ++r) {
+                        uint32_t rate = m_ratePerSecond.load();
+                        if(rate > 0 && conn.protocol == PROTOCOL_HTTP1) {
+                            clock_t_::time_point arrived = clock_t_::now();
+                            if(arrived - window >= std::chrono::seconds(1)) {
+                                window = arrived;
+                                windowRequests = 0;
+                            }
+                            if(++windowRequests > rate) {
+                                uint32_t retryAfter = m_retryAfterS.load();
+                                replies[r] = "HTTP/1.1 429 Too Many Requests\r\nContent-Type: application/json\r\n" +
+                                    (retryAfter > 0 ? "Retry-After: " + std::to_string(retryAfter) + "\r\n" : std::string()) +
+                                    "Content-Length: 2\r\n\r\n{}";
+                                ++m_throttled;
+                            }
+                        }
+
+                        Reply reply;
+                        reply.due = clock_t_::now() + std::chrono::milliseconds(m_delayMs);
+                        reply.data.swap(replies[r]);
+                        conn.replies.push_back(reply);
+                        ++m_requests;
+                    }
+                    if(m_delayMs == 0) {
+                        while(!conn.replies.empty()) {
+                            conn.out += conn.replies.front().data;
+                            conn.replies.pop_front();
+                        }
+                    }
+                }
+            }
+
+            if(!closed && !conn.out.empty()) {
+                closed = !WriteOutput(fds[i].fd, conn);
+            }
+
+            if(closed) {
+                CloseConnection(fds[i].fd, conn);
+                connections.erase(fds[i].fd);
+            }
+        }
+    }
+
+    for(std::map<int, Connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+        CloseConnection(it->first, it->second);
+    }
+}
@@ -0,0 +1,71 @@
+
+
+#ifndef IOT_MOCKSERVER_H
+#define IOT_MOCKSERVER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+//! \brief Minimal IoT-Ticket server on loopback for benchmarks
+//! \note Serves HTTP/1.1 keep-alive connections and HTTP/2 connections
+//!       without TLS (h2c with prior knowledge) on one thread. Every write
+//!       request is answered as fully written and other requests with an
+//!       empty object, after the given server delay. Over HTTP/2 every POST
+//!       is taken as a write, as headers are not decoded.
+//!       With TLS, which needs the benchmarks built with OpenSSL, HTTP/2 is
+//!       negotiated with ALPN. The certificate is self-signed.
+class IOT_MockServer
+{
+public:
+    //! \param [in] delayMs - Time each request takes on the server
+    //! \param [in] tls     - Serve HTTPS instead of HTTP
+    explicit IOT_MockServer(uint32_t delayMs = 0, bool tls = false);
+    ~IOT_MockServer();
+
+    //! Base address to give to IOT_API
+    std::string GetUrl() const;
+
+    //! Check if HTTPS is served, false if TLS was asked but is not available
+    bool HasTls() const;
+
+    //! Number of requests answered
+    uint64_t GetRequests() const;
+
+    //! Number of connections accepted
+    uint64_t GetConnections() const;
+
+    //! Number of completed TLS handshakes
+    uint64_t GetHandshakes() const;
+
+    //! Number of TLS handshakes that resumed an earlier session
+    uint64_t GetResumedHandshakes() const;
+
+    //! \brief Answer HTTP/1.1 requests over a rate with 429 Too Many Requests
+    //! \param [in] perSecond   - Requests answered in each second, 0 for no limit
+    //! \param [in] retryAfterS - Retry-After of the 429 replies, 0 to leave it out
+    void SetRateLimit(uint32_t perSecond, uint32_t retryAfterS);
+
+    //! Number of requests answered with 429
+    uint64_t GetThrottled() const;
+
+private:
+    void Run();
+
+    uint32_t m_delayMs;
+    struct ssl_ctx_st* m_tls;
+    int m_listen;
+    int m_port;
+    std::atomic<bool> m_stop;
+    std::atomic<uint64_t> m_requests;
+    std::atomic<uint64_t> m_connections;
+    std::atomic<uint64_t> m_handshakes;
+    std::atomic<uint64_t> m_resumed;
+    std::atomic<uint32_t> m_ratePerSecond;
+    std::atomic<uint32_t> m_retryAfterS;
+    std::atomic<uint64_t> m_throttled;
+    std::thread m_thread;
+};
+
+#endif // IOT_MOCKSERVER_H
@@ -0,0 +1,45 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_NumberParse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void BenchNumberParse()
+{
+    // Read values arrive as strings such as "21.375" or "1.2e-05"
+    std::vector<std::string> values;
+    srand(1);
+    for(int i = 0; i < 1000; ++i) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), (i % 4) ? "%.*f" : "%.*e", 1 + rand() % 6, (rand() - RAND_MAX / 2) / 1000.0);
+        values.push_back(buffer);
+    }
+
+    size_t index = 0;
+    double sink = 0.0;
+
+    double legacy = IOT_Benchmark("std::istringstream", [&]() {
+        std::istringstream stream(values[index++ % values.size()]);
+        double value = 0.0;
+        stream >> value;
+        sink += value;
+    });
+    IOT_Benchmark("strtod", [&]() {
+        sink += strtod(values[index++ % values.size()].c_str(), NULL);
+    });
+    double fast = IOT_Benchmark("IOT_NumberParse", [&]() {
+        const std::string& str = values[index++ % values.size()];
+        double value = 0.0;
+        IOT_NumberParse::ParseDouble(str.data(), str.data() + str.size(), value);
+        sink += value;
+    });
+    std::cout << "  speedup: " << fast / legacy << "x" << std::endl;
+
+    if(sink == 0.5) {
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,84 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_MockServer.h"
+#include "IOT_API.h"
+#include "IOT_RateLimiter.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+//! Requests per second the mock server answers before 429
+static const uint32_t SERVER_RATE = 100;
+
+//! Send single samples from several threads for a while against the rate limited server
+static void Run(IOT_MockServer& server, IOT_RateLimiter& limiter, const char* name)
+{
+    const size_t THREADS = 4;
+    const double SECONDS = 3.0;
+
+    IOT_API api(server.GetUrl(), "user", "pass", 20, THREADS);
+    api.SetRateLimiter(&limiter);
+
+    IOT_WriteData sample;
+    sample.SetName("temperature");
+    sample.SetValue(21.5);
+    sample.SetTimeToNow();
+
+    uint64_t requests = server.GetRequests();
+    uint64_t throttled = server.GetThrottled();
+    std::atomic<uint64_t> written(0);
+    bench_clock::time_point end = bench_clock::now() +
+        std::chrono::duration_cast<bench_clock::duration>(std::chrono::duration<double>(SECONDS));
+
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < THREADS; ++t) {
+        threads.push_back(std::thread([&api, &sample, &written, end, t]() {
+            std::string devId = "device" + std::to_string(t);
+            while(bench_clock::now() < end) {
+                if(api.SendData(devId, sample) == IOTAPI::IOT_ERR_OK) {
+                    ++written;
+                }
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    IOT_RateLimiter::Stats stats = limiter.GetStats();
+    std::cout << "  " << name << ": " << written.load() / SECONDS << " samples/s written, "
+              << (server.GetRequests() - requests) / SECONDS << " requests/s, "
+              << server.GetThrottled() - throttled << " answered 429, "
+              << stats.pausedMs / 1000.0 << " s paused, " << stats.waitedMs / 1000.0 << " s waited" << std::endl;
+}
+
+void BenchRateLimit()
+{
+    IOT_MockServer server;
+    std::cout << " 4 threads writing single samples, server answers 429 over "
+              << SERVER_RATE << " requests/s" << std::endl;
+
+    {
+        // Old behaviour: failed writes are retried without waiting
+        server.SetRateLimit(SERVER_RATE, 0);
+        IOT_RateLimiter limiter;
+        limiter.SetPause(1, 1);
+        Run(server, limiter, "retry at once");
+    }
+
+    {
+        server.SetRateLimit(SERVER_RATE, 1);
+        IOT_RateLimiter limiter;
+        Run(server, limiter, "pause for Retry-After");
+    }
+
+    {
+        server.SetRateLimit(SERVER_RATE, 1);
+        IOT_RateLimiter limiter;
+        limiter.SetAccountRate(SERVER_RATE * 0.95, 5.0);
+        Run(server, limiter, "account rate 95/s");
+    }
+}
@@ -0,0 +1,49 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_ResponseDecoder.h"
+#include <sstream>
+
+void BenchResponseDecoder()
+{
+    // Process read reply of 4 datanodes with 1000 values each
+    std::ostringstream reply;
+    reply << "{\"href\":\"https://my.iot-ticket.com/api/v1/process/read/dev\",\"datanodeReads\":[";
+    for(int node = 0; node < 4; ++node) {
+        reply << (node ? "," : "") << "{\"href\":\"https://my.iot-ticket.com/api/v1/process/read/dev?datanodes=n" << node
+              << "\",\"name\":\"n" << node << "\",\"path\":\"site/line\",\"unit\":\"C\",\"dataType\":\"double\",\"values\":[";
+        for(int i = 0; i < 1000; ++i) {
+            reply << (i ? "," : "") << "{\"v\":\"" << 20.0 + i * 0.125 << "\",\"ts\":" << 1440000000000ULL + i * 1000 << "}";
+        }
+        reply << "]}";
+    }
+    reply << "]}";
+    const std::string json = reply.str();
+    std::cout << "  reply: " << json.size() << " B" << std::endl;
+
+    size_t sink = 0;
+    double tree = IOT_Benchmark("Json::Reader + FromJSON", [&]() {
+        Json::Value answer;
+        Json::Reader reader;
+        std::vector<IOT_ReadData> data;
+        if(reader.parse(json, answer, false)) {
+            for(Json::Value::iterator it = answer["datanodeReads"].begin(); it != answer["datanodeReads"].end(); ++it) {
+                IOT_ReadData item;
+                if(item.FromJSON(*it)) {
+                    data.push_back(item);
+                }
+            }
+        }
+        sink += data.size();
+    }, 1.0);
+    double pull = IOT_Benchmark("IOT_ResponseDecoder", [&]() {
+        std::vector<IOT_ReadData> data;
+        IOT_ResponseDecoder::DecodeDatanodes(json, "datanodeReads", data);
+        sink += data.size();
+    }, 1.0);
+    std::cout << "  speedup: " << pull / tree << "x" << std::endl;
+
+    if(sink == 0) {
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,70 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_MockServer.h"
+#include "IOT_API.h"
+#include <stdio.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock bench_clock;
+
+//! Time from creating the API instance, as after a restart, to the end of the first write
+static double FirstUpload(const std::string& url, const std::string& sessionFile, const IOT_WriteData& sample)
+{
+    bench_clock::time_point start = bench_clock::now();
+    IOT_API api(url, "user", "pass", 20, 1);
+    if(!sessionFile.empty()) {
+        api.SetSessionFile(sessionFile);
+    }
+    api.SendData("device", std::vector<IOT_WriteData>(1, sample));
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+void BenchTlsResume()
+{
+    const size_t RESTARTS = 50;
+
+    IOT_MockServer server(0, true);
+    if(!server.HasTls()) {
+        std::cout << " benchmarks built without OpenSSL" << std::endl;
+        return;
+    }
+
+    IOT_WriteData sample;
+    sample.SetName("temperature");
+    sample.SetUnit("C");
+    sample.SetValue(21.5);
+    sample.SetTimeToNow();
+
+    double total = 0.0;
+    for(size_t i = 0; i < RESTARTS; ++i) {
+        total += FirstUpload(server.GetUrl(), "", sample);
+    }
+    std::cout << " startup to first upload over HTTPS" << std::endl;
+    std::cout << "  full handshake: " << total / RESTARTS << " ms" << std::endl;
+
+    if(!IOT_RestClient::IsSessionFileSupported()) {
+        std::cout << "  session file: needs libcurl 8.12.0 or newer built with SSLS-EXPORT" << std::endl;
+        return;
+    }
+
+    char path[] = "/tmp/iot-sessions-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        return;
+    }
+    close(fd);
+
+    // The first start saves the session, the others resume it
+    FirstUpload(server.GetUrl(), path, sample);
+    uint64_t handshakes = server.GetHandshakes();
+    uint64_t resumed = server.GetResumedHandshakes();
+    total = 0.0;
+    for(size_t i = 0; i < RESTARTS; ++i) {
+        total += FirstUpload(server.GetUrl(), path, sample);
+    }
+    std::cout << "  session file: " << total / RESTARTS << " ms, "
+              << server.GetResumedHandshakes() - resumed << " of " << server.GetHandshakes() - handshakes
+              << " handshakes resumed" << std::endl;
+    unlink(path);
+}
@@ -0,0 +1,54 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_MockServer.h"
+#include "IOT_UploadScheduler.h"
+#include <stdio.h>
+
+void BenchUploadScheduler()
+{
+    // Skewed load: 8 hot devices produce 2000 samples each, 992 cold devices
+    // 20 each. Every 8th device is hot, so the hot ones all start on the work
+    // list of the first thread. Server takes 2 ms per request.
+    const size_t DEVICES = 1000;
+    const size_t HOT = 8;
+    const size_t HOT_STRIDE = 8;
+
+    std::vector<std::string> devices(DEVICES);
+    for(size_t d = 0; d < DEVICES; ++d) {
+        char id[32];
+        snprintf(id, sizeof(id), "device-%04zu", d);
+        devices[d] = id;
+    }
+
+    IOT_WriteData sample;
+    sample.SetName("temperature");
+    sample.SetUnit("C");
+    sample.SetValue(21.5);
+    sample.SetTimeToNow();
+
+    const size_t threadCounts[] = { 1, 4, 8 };
+    for(size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); ++t) {
+        IOT_MockServer server(2);
+        IOT_API api(server.GetUrl(), "user", "pass", 20, threadCounts[t]);
+        api.SetWriteConcurrency(1, 0);
+        IOT_UploadScheduler scheduler(api, threadCounts[t]);
+        scheduler.SetBatching(100, 1000);
+
+        size_t samples = 0;
+        for(size_t d = 0; d < DEVICES; ++d) {
+            samples += scheduler.Enqueue(devices[d], std::vector<IOT_WriteData>((d % HOT_STRIDE == 0 && d / HOT_STRIDE < HOT) ? 2000 : 20, sample));
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scheduler.Start();
+        scheduler.Stop(true);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << " " << threadCounts[t] << " threads" << std::endl;
+        std::cout << "  requests: " << server.GetRequests() << " on " << server.GetConnections()
+                  << " connections, " << scheduler.GetSteals() << " steals" << std::endl;
+        std::cout << "  throughput: " << samples / seconds << " samples/s, "
+                  << server.GetRequests() / seconds << " requests/s" << std::endl;
+    }
+}
@@ -0,0 +1,71 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_WriteData.h"
+#include "json/json.h"
+#include <sstream>
+
+void BenchValueArena()
+{
+    // Process read reply of 4 datanodes with 1000 values each
+    std::ostringstream reply;
+    reply << "{\"href\":\"https://my.iot-ticket.com/api/v1/process/read/dev\",\"datanodeReads\":[";
+    for(int node = 0; node < 4; ++node) {
+        reply << (node ? "," : "") << "{\"name\":\"n" << node << "\",\"path\":\"site/line\",\"unit\":\"C\","
+              << "\"dataType\":\"double\",\"values\":[";
+        for(int i = 0; i < 1000; ++i) {
+            reply << (i ? "," : "") << "{\"v\":\"" << 20.0 + i * 0.125 << "\",\"ts\":" << 1440000000000ULL + i * 1000 << "}";
+        }
+        reply << "]}";
+    }
+    reply << "]}";
+    const std::string json = reply.str();
+
+    size_t sink = 0;
+    Json::Reader reader;
+    double heap = IOT_Benchmark("parse, default allocator", [&]() {
+        Json::Value root;
+        reader.parse(json, root, false);
+        sink += root.size();
+    }, 1.0);
+
+    Json::ValueArena arena;
+    double pooled = IOT_Benchmark("parse, ValueArena", [&]() {
+        {
+            Json::Value root;
+            reader.parse(json, root, arena, false);
+            sink += root.size();
+        }
+        arena.reset();
+    }, 1.0);
+    std::cout << "  speedup: " << pooled / heap << "x, arena " << arena.capacity() << " B" << std::endl;
+
+    // Building the tree of one sample for a write, as IOT_API::SendData does
+    IOT_WriteData data;
+    data.SetName("Temperature");
+    data.SetPath("site/line");
+    data.SetUnit("C");
+    data.SetValue(21.5);
+    data.SetTimeToNow();
+    Json::FastWriter writer;
+
+    heap = IOT_Benchmark("write sample, default allocator", [&]() {
+        Json::Value value;
+        data.ToJSON(value);
+        sink += writer.write(value).size();
+    });
+    pooled = IOT_Benchmark("write sample, ValueArena", [&]() {
+        {
+            Json::ValueArena::Scope scope(&arena);
+            Json::Value value;
+            data.ToJSON(value);
+            sink += writer.write(value).size();
+        }
+        arena.reset();
+    });
+    std::cout << "  speedup: " << pooled / heap << "x" << std::endl;
+
+    if(sink == 0) {
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,75 @@
+
+
+#include "IOT_Benchmark.h"
+#include "IOT_MockServer.h"
+#include "IOT_API.h"
+#include <thread>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double SendOne(const IOT_API& api, const IOT_WriteData& sample)
+{
+    bench_clock::time_point start = bench_clock::now();
+    api.SendData("device", std::vector<IOT_WriteData>(1, sample));
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+void BenchWarmup()
+{
+    IOT_MockServer server(0, true);
+    if(!server.HasTls()) {
+        std::cout << " benchmarks built without OpenSSL" << std::endl;
+        return;
+    }
+
+    IOT_WriteData sample;
+    sample.SetName("temperature");
+    sample.SetUnit("C");
+    sample.SetValue(21.5);
+    sample.SetTimeToNow();
+
+    {
+        // First upload after startup, with and without warm-up
+        const size_t RUNS = 50;
+        double cold = 0.0;
+        double warm = 0.0;
+        for(size_t i = 0; i < RUNS; ++i) {
+            IOT_API coldApi(server.GetUrl(), "user", "pass", 20, 1);
+            cold += SendOne(coldApi, sample);
+
+            IOT_API warmApi(server.GetUrl(), "user", "pass", 20, 1);
+            warmApi.Warmup();
+            warm += SendOne(warmApi, sample);
+        }
+        std::cout << " time to first upload over HTTPS" << std::endl;
+        std::cout << "  cold: " << cold / RUNS << " ms" << std::endl;
+        std::cout << "  after Warmup(): " << warm / RUNS << " ms" << std::endl;
+    }
+
+    {
+        // Sparse sends, 2.2 s apart. libcurl counts idle time in whole
+        // seconds, so connections idle for 2 s are not reused with the 1 s
+        // limit, as with the 118 s default for devices sending every few minutes.
+        const size_t SENDS = 3;
+        const uint32_t limits[] = { 1, 10 };
+        std::cout << " sends every 2.2 s" << std::endl;
+        for(size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); ++l) {
+            IOT_KeepAlive policy;
+            policy.tcpKeepAlive = true;
+            policy.maxIdleS = limits[l];
+
+            uint64_t connections = server.GetConnections();
+            IOT_API api(server.GetUrl(), "user", "pass", 20, 1);
+            api.SetKeepAlive(policy);
+            api.Warmup();
+
+            double total = 0.0;
+            for(size_t i = 0; i < SENDS; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2200));
+                total += SendOne(api, sample);
+            }
+            std::cout << "  max idle " << limits[l] << " s: " << total / SENDS << " ms per send, "
+                      << server.GetConnections() - connections << " connections" << std::endl;
+        }
+    }
+}
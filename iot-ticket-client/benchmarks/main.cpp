@@ -0,0 +1,41 @@
+
+
+#include <cstring>
+#include <iostream>
+#include "IOT_Benchmark.h"
+
+//! Registered benchmarks, run all or the ones named on the command line
+static const struct
+{
+    const char* name;
+    void (*run)();
+} BENCHMARKS[] = {
+    { "doubleformat", BenchDoubleFormat },
+    { "numberparse", BenchNumberParse },
+    { "responsedecoder", BenchResponseDecoder },
+    { "valuearena", BenchValueArena },
+    { "jsonscan", BenchJsonScan },
+    { "jsonescape", BenchJsonEscape },
+    { "gateway", BenchGateway },
+    { "scheduler", BenchUploadScheduler },
+    { "http2", BenchHttp2 },
+    { "warmup", BenchWarmup },
+    { "tlsresume", BenchTlsResume },
+    { "ratelimit", BenchRateLimit }
+};
+
+int main(int argc, char* argv[])
+{
+    for(size_t i = 0; i < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); ++i) {
+        bool selected = (argc < 2);
+        for(int a = 1; a < argc; ++a) {
+            selected = selected || strcmp(argv[a], BENCHMARKS[i].name) == 0;
+        }
+
+        if(selected) {
+            std::cout << BENCHMARKS[i].name << std::endl;
+            BENCHMARKS[i].run();
+        }
+    }
+    return 0;
+}
@@ -216,6 +216,7 @@ namespace Json {
    // value.h
    typedef unsigned int ArrayIndex;
    class StaticString;
+   class ValueArena;
    class Path;
    class PathArgument;
    class Value;
@@ -400,6 +401,138 @@ namespace Json {
       const char *str_;
    };
 
+   /** \brief Monotonic memory pool for Value trees.
+    *
+    * While an arena is installed for the current thread with ValueArena::Scope,
+    * the strings, member names and object/array containers created by Value are
+    * carved from a few large blocks owned by the arena instead of being allocated
+    * one by one. Releasing them is a no-op and the memory is returned all at once
+    * when the arena is reset or destroyed.
+    *
+    * Values created or modified while a scope is active must not outlive the
+    * arena. Copying such a value outside of the scope makes an independent copy.
+    *
+    * \code
+    * Json::ValueArena arena;
+    * Json::Value root;
+    * reader.parse( document, root, arena );
+    * \endcode
+    */
+   class JSON_API ValueArena
+   {
+   public:
+      ValueArena( size_t blockSize = 16 * 1024 );
+      ~ValueArena();
+
+      /// Allocate memory aligned for any Value member.
+      void *allocate( size_t size );
+
+      /// Make all memory available again, keeping it for the next document.
+      /// No value allocated from the arena may be alive.
+      void reset();
+
+      /// Total size of the allocated blocks.
+      size_t capacity() const;
+
+      /// Arena used by Value allocations of the calling thread, 0 if none.
+      static ValueArena *current();
+
+      /// Installs an arena for the calling thread for the lifetime of the scope.
+      class JSON_API Scope
+      {
+      public:
+         explicit Scope( ValueArena *arena );
+         ~Scope();
+
+      private:
+         Scope( const Scope & );
+         Scope &operator =( const Scope & );
+
+         ValueArena *previous_;
+      };
+
+   private:
+      ValueArena( const ValueArena & );
+      ValueArena &operator =( const ValueArena & );
+
+      struct Block
+      {
+         Block *next_;
+         size_t size_;
+      };
+
+      void addBlock( size_t size );
+      void releaseBlocks();
+
+      Block *blocks_;
+      char *current_;
+      char *end_;
+      size_t blockSize_;
+      size_t capacity_;
+   };
+
+   /** \brief std::allocator replacement that takes memory from a ValueArena.
+    *
+    * The arena is the one current when the container is created. Without an
+    * arena memory is allocated with operator new.
+    */
+   template<typename T>
+   class ValueArenaAllocator
+   {
+   public:
+      typedef T value_type;
+
+      ValueArenaAllocator()
+         : arena_( ValueArena::current() )
+      {
+      }
+
+      template<typename U>
+      ValueArenaAllocator( const ValueArenaAllocator<U> &other )
+         : arena_( other.arena() )
+      {
+      }
+
+      T *allocate( size_t count )
+      {
+         if ( arena_ )
+            return static_cast<T *>( arena_->allocate( count * sizeof(T) ) );
+         return static_cast<T *>( ::operator new( count * sizeof(T) ) );
+      }
+
+      void deallocate( T *pointer, size_t )
+      {
+         if ( !arena_ )
+            ::operator delete( pointer );
+      }
+
+      /// Copies of a container use the arena current at the time of the copy.
+      ValueArenaAllocator select_on_container_copy_construction() const
+      {
+         return ValueArenaAllocator();
+      }
+
+      ValueArena *arena() const
+      {
+         return arena_;
+      }
+
+      template<typename U>
+      bool operator ==( const ValueArenaAllocator<U> &other ) const
+      {
+         return arena_ == other.arena();
+      }
+
+      template<typename U>
+      bool operator !=( const ValueArenaAllocator<U> &other ) const
+      {
+         return arena_ != other.arena();
+      }
+
+   private:
+      ValueArena *arena_;
+   };
+
    /** \brief Represents a <a HREF="http://www.json.org">JSON</a> value.
     *
     * This class is a discriminated union wrapper that can represents a:
@@ -480,7 +613,8 @@ namespace Json {
          {
             noDuplication = 0,
             duplicate,
-            duplicateOnCopy
+            duplicateOnCopy,
+            arenaDuplicate     // duplicated in a ValueArena, never released
          };
          CZString( ArrayIndex index );
          CZString( const char *cstr, DuplicationPolicy allocate );
@@ -500,7 +634,8 @@ namespace Json {
 
    public:
 #  ifndef JSON_USE_CPPTL_SMALLMAP
-      typedef std::map<CZString, Value> ObjectValues;
+      typedef std::map<CZString, Value, std::less<CZString>,
+                       ValueArenaAllocator<std::pair<const CZString, Value> > > ObjectValues;
 #  else
       typedef CppTL::SmallMap<CZString, Value> ObjectValues;
 #  endif // ifndef JSON_USE_CPPTL_SMALLMAP
@@ -1495,6 +1630,22 @@ namespace Json {
                   Value &root,
                   bool collectComments = true );
 
+      /** \brief Read a Value from a <a HREF="http://www.json.org">JSON</a> document
+       * into a tree allocated from an arena.
+       * \param arena Holds the strings and containers of \c root. It must outlive
+       *              \c root and every value created from it while parsing.
+       * \see ValueArena
+       */
+      bool parse( const std::string &document, 
+                  Value &root,
+                  ValueArena &arena,
+                  bool collectComments = true );
+
+      bool parse( const char *beginDoc, const char *endDoc, 
+                  Value &root,
+                  ValueArena &arena,
+                  bool collectComments = true );
+
       /// \brief Parse from input stream.
       /// \see Json::operator>>(std::istream&, Json::Value&).
       bool parse( std::istream &is,
@@ -1830,6 +1981,8 @@ namespace Json {
    std::string JSON_API valueToString( double value );
    std::string JSON_API valueToString( bool value );
    std::string JSON_API valueToQuotedString( const char *value );
+   /// \brief Append [begin, end) to document as a quoted and escaped JSON string.
+   void JSON_API appendQuotedString( std::string &document, const char *begin, const char *end );
 
    /// \brief Output using the StyledStreamWriter.
    /// \see Json::operator>>()
@@ -203,6 +203,8 @@ uintToString( LargestUInt value,
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include "IOT_NumberParse.h"
+#include "IOT_JsonScan.h"
 
 #if _MSC_VER >= 1400 // VC++ 8.0
 #pragma warning( disable : 4996 )   // disable warning about strdup being deprecated.
@@ -291,6 +293,28 @@ Reader::parse( const std::string &document,
 }
 
 
+bool 
+Reader::parse( const std::string &document, 
+               Value &root,
+               ValueArena &arena,
+               bool collectComments )
+{
+   ValueArena::Scope scope( &arena );
+   return parse( document, root, collectComments );
+}
+
+
+bool 
+Reader::parse( const char *beginDoc, const char *endDoc, 
+               Value &root,
+               ValueArena &arena,
+               bool collectComments )
+{
+   ValueArena::Scope scope( &arena );
+   return parse( beginDoc, endDoc, root, collectComments );
+}
+
+
 bool
 Reader::parse( std::istream& sin,
                Value &root,
@@ -624,16 +648,18 @@ Reader::readNumber()
 bool
 Reader::readString()
 {
-   Char c = 0;
    while ( current_ != end_ )
    {
-      c = getNextChar();
-      if ( c == '\\' )
-         getNextChar();
-      else if ( c == '"' )
+      current_ = IOT_JsonScan::FindQuoteOrEscape( current_, end_ );
+      if ( current_ == end_ )
+         break;
+      if ( *current_++ == '"' )
+         return true;
+      if ( current_ == end_ )
          break;
+      ++current_; // escaped character
    }
-   return c == '"';
+   return false;
 }
 
 
@@ -795,24 +821,10 @@ Reader::decodeNumber( Token &token )
 bool 
 Reader::decodeDouble( Token &token )
 {
+   // Locale independent, exact, and fast for the common short numbers
    double value = 0;
-   const int bufferSize = 32;
-   int count;
-   int length = int(token.end_ - token.start_);
-   if ( length <= bufferSize )
-   {
-      Char buffer[bufferSize+1];
-      memcpy( buffer, token.start_, length );
-      buffer[length] = 0;
-      count = sscanf( buffer, "%100lf", &value );
-   }
-   else
-   {
-      std::string buffer( token.start_, token.end_ );
-      count = sscanf( buffer.c_str(), "%100lf", &value );
-   }
-
-   if ( count != 1 )
+   const char* end = IOT_NumberParse::ParseDouble( token.start_, token.end_, value );
+   if ( end != token.end_ )
       return addError( "'" + std::string( token.start_, token.end_ ) + "' is not a number.", token );
    currentValue() = value;
    return true;
@@ -838,6 +850,11 @@ Reader::decodeString( Token &token, std::string &decoded )
    Location end = token.end_ - 1;      // do not include '"'
    while ( current != end )
    {
+      Location run = current;
+      current = IOT_JsonScan::FindQuoteOrEscape( current, end );
+      decoded.append( run, current );
+      if ( current == end )
+         break;
       Char c = *current++;
       if ( c == '"' )
          break;
@@ -868,10 +885,6 @@ Reader::decodeString( Token &token, std::string &decoded )
             return addError( "Bad escape sequence in string", token, current );
          }
       }
-      else
-      {
-         decoded += c;
-      }
    }
    return true;
 }
@@ -1559,6 +1572,8 @@ ValueIterator::operator =( const SelfType &other )
 # include <cpptl/conststring.h>
 #endif
 #include <cstddef>    // size_t
+#include <cstdlib>
+#include <new>
 
 #define JSON_ASSERT_UNREACHABLE assert( false )
 #define JSON_ASSERT( condition ) assert( condition );  // @todo <= change this into an exception throw
@@ -1613,6 +1628,179 @@ releaseStringValue( char *value )
       free( value );
 }
 
+
+/** Duplicates a string value or member name in the current ValueArena.
+ * Without an arena this is the same as duplicateStringValue(). Strings
+ * allocated from an arena must not be released with releaseStringValue().
+ */
+static inline char *
+duplicateArenaStringValue( const char *value, 
+                           unsigned int length = unknown )
+{
+   ValueArena *arena = ValueArena::current();
+   if ( !arena )
+      return duplicateStringValue( value, length );
+
+   if ( length == unknown )
+      length = (unsigned int)strlen(value);
+   char *newString = static_cast<char *>( arena->allocate( length + 1 ) );
+   memcpy( newString, value, length );
+   newString[length] = 0;
+   return newString;
+}
+
+
+# ifndef JSON_VALUE_USE_INTERNAL_MAP
+/** Allocate an object or array container from the current ValueArena,
+ * or with operator new if there is none.
+ */
+static inline Value::ObjectValues *
+newObjectValues( const Value::ObjectValues *other = 0 )
+{
+   ValueArena *arena = ValueArena::current();
+   void *memory = arena ? arena->allocate( sizeof(Value::ObjectValues) )
+                        : ::operator new( sizeof(Value::ObjectValues) );
+   if ( other )
+      return new ( memory ) Value::ObjectValues( *other );
+   return new ( memory ) Value::ObjectValues();
+}
+
+
+/** Destroy a container created by newObjectValues().
+ */
+static inline void
+deleteObjectValues( Value::ObjectValues *map )
+{
+   // The container itself comes from the same arena as its nodes
+   typedef Value::ObjectValues ObjectValues;
+   bool fromArena = map->get_allocator().arena() != 0;
+   map->~ObjectValues();
+   if ( !fromArena )
+      ::operator delete( map );
+}
+# endif
+
+
+// //////////////////////////////////////////////////////////////////
+// class ValueArena
+// //////////////////////////////////////////////////////////////////
+
+static const size_t arenaAlignment = sizeof(double) > sizeof(void *) ? sizeof(double) : sizeof(void *);
+static const size_t arenaMaxBlockSize = 1024 * 1024;
+static const size_t arenaBlockHeader = (sizeof(void *) + sizeof(size_t) + arenaAlignment - 1) & ~(arenaAlignment - 1);
+
+static thread_local ValueArena *currentArena = 0;
+
+
+ValueArena::ValueArena( size_t blockSize )
+   : blocks_( 0 )
+   , current_( 0 )
+   , end_( 0 )
+   , blockSize_( blockSize > 0 ? blockSize : 1 )
+   , capacity_( 0 )
+{
+}
+
+
+ValueArena::~ValueArena()
+{
+   releaseBlocks();
+}
+
+
+void *
+ValueArena::allocate( size_t size )
+{
+   size = (size + arenaAlignment - 1) & ~(arenaAlignment - 1);
+   if ( size > size_t(end_ - current_) )
+   {
+      // Blocks grow with the arena so that large documents need few of them
+      size_t blockSize = capacity_ > blockSize_ ? capacity_ : blockSize_;
+      if ( blockSize > arenaMaxBlockSize )
+         blockSize = arenaMaxBlockSize;
+      if ( blockSize < arenaBlockHeader + size )
+         blockSize = arenaBlockHeader + size;
+      addBlock( blockSize );
+   }
+
+   void *memory = current_;
+   current_ += size;
+   return memory;
+}
+
+
+void 
+ValueArena::reset()
+{
+   if ( blocks_  &&  blocks_->next_ )
+   {
+      // Merge the blocks so that a document of the same size fits in one
+      size_t size = capacity_;
+      releaseBlocks();
+      addBlock( size );
+   }
+   else if ( blocks_ )
+   {
+      current_ = reinterpret_cast<char *>( blocks_ ) + arenaBlockHeader;
+   }
+}
+
+
+size_t 
+ValueArena::capacity() const
+{
+   return capacity_;
+}
+
+
+ValueArena *
+ValueArena::current()
+{
+   return currentArena;
+}
+
+
+void 
+ValueArena::addBlock( size_t size )
+{
+   Block *block = static_cast<Block *>( malloc( size ) );
+   JSON_ASSERT_MESSAGE( block != 0, "Failed to allocate arena block" );
+   block->next_ = blocks_;
+   block->size_ = size;
+   blocks_ = block;
+   capacity_ += size;
+   current_ = reinterpret_cast<char *>( block ) + arenaBlockHeader;
+   end_ = reinterpret_cast<char *>( block ) + size;
+}
+
+
+void 
+ValueArena::releaseBlocks()
+{
+   while ( blocks_ )
+   {
+      Block *next = blocks_->next_;
+      free( blocks_ );
+      blocks_ = next;
+   }
+   current_ = 0;
+   end_ = 0;
+   capacity_ = 0;
+}
+
+
+ValueArena::Scope::Scope( ValueArena *arena )
+   : previous_( currentArena )
+{
+   currentArena = arena;
+}
+
+
+ValueArena::Scope::~Scope()
+{
+   currentArena = previous_;
+}
+
 } // namespace Json
 
 
@@ -1686,17 +1874,18 @@ Value::CZString::CZString( ArrayIndex index )
 }
 
 Value::CZString::CZString( const char *cstr, DuplicationPolicy allocate )
-   : cstr_( allocate == duplicate ? duplicateStringValue(cstr) 
+   : cstr_( allocate == duplicate ? duplicateArenaStringValue(cstr) 
                                   : cstr )
-   , index_( allocate )
+   , index_( allocate == duplicate  &&  ValueArena::current() ? arenaDuplicate : allocate )
 {
 }
 
 Value::CZString::CZString( const CZString &other )
 : cstr_( other.index_ != noDuplication &&  other.cstr_ != 0
-                ?  duplicateStringValue( other.cstr_ )
+                ?  duplicateArenaStringValue( other.cstr_ )
                 : other.cstr_ )
-   , index_( other.cstr_ ? (other.index_ == noDuplication ? noDuplication : duplicate)
+   , index_( other.cstr_ ? (other.index_ == noDuplication ? noDuplication 
+                                                          : (ValueArena::current() ? arenaDuplicate : duplicate))
                          : other.index_ )
 {
 }
@@ -1798,7 +1987,7 @@ Value::Value( ValueType type )
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      value_.map_ = new ObjectValues();
+      value_.map_ = newObjectValues();
       break;
 #else
    case arrayValue:
@@ -1874,40 +2063,40 @@ Value::Value( double value )
 
 Value::Value( const char *value )
    : type_( stringValue )
-   , allocated_( true )
+   , allocated_( ValueArena::current() == 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
 {
-   value_.string_ = duplicateStringValue( value );
+   value_.string_ = duplicateArenaStringValue( value );
 }
 
 
 Value::Value( const char *beginValue, 
               const char *endValue )
    : type_( stringValue )
-   , allocated_( true )
+   , allocated_( ValueArena::current() == 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
 {
-   value_.string_ = duplicateStringValue( beginValue, 
-                                          (unsigned int)(endValue - beginValue) );
+   value_.string_ = duplicateArenaStringValue( beginValue, 
+                                               (unsigned int)(endValue - beginValue) );
 }
 
 
 Value::Value( const std::string &value )
    : type_( stringValue )
-   , allocated_( true )
+   , allocated_( ValueArena::current() == 0 )
    , comments_( 0 )
 # ifdef JSON_VALUE_USE_INTERNAL_MAP
    , itemIsUsed_( 0 )
 #endif
 {
-   value_.string_ = duplicateStringValue( value.c_str(), 
-                                          (unsigned int)value.length() );
+   value_.string_ = duplicateArenaStringValue( value.c_str(), 
+                                               (unsigned int)value.length() );
 
 }
 
@@ -1966,8 +2155,8 @@ Value::Value( const Value &other )
    case stringValue:
       if ( other.value_.string_ )
       {
-         value_.string_ = duplicateStringValue( other.value_.string_ );
-         allocated_ = true;
+         value_.string_ = duplicateArenaStringValue( other.value_.string_ );
+         allocated_ = ValueArena::current() == 0;
       }
       else
          value_.string_ = 0;
@@ -1975,7 +2164,7 @@ Value::Value( const Value &other )
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      value_.map_ = new ObjectValues( *other.value_.map_ );
+      value_.map_ = newObjectValues( other.value_.map_ );
       break;
 #else
    case arrayValue:
@@ -2018,7 +2207,7 @@ Value::~Value()
 #ifndef JSON_VALUE_USE_INTERNAL_MAP
    case arrayValue:
    case objectValue:
-      delete value_.map_;
+      deleteObjectValues( value_.map_ );
       break;
 #else
    case arrayValue:
@@ -3397,6 +3586,7 @@ Path::make( Value &root ) const
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include "IOT_DoubleFormat.h"
 
 #if _MSC_VER >= 1400 // VC++ 8.0
 #pragma warning( disable : 4996 )   // disable warning about strdup being deprecated.
@@ -3404,17 +3594,6 @@ Path::make( Value &root ) const
 
 namespace Json {
 
-static bool containsControlCharacter( const char* str )
-{
-   while ( *str ) 
-   {
-      if ( isControlCharacter( *(str++) ) )
-         return true;
-   }
-   return false;
-}
-
-
 std::string valueToString( LargestInt value )
 {
    UIntToStringBuffer buffer;
@@ -3457,6 +3636,12 @@ std::string valueToString( UInt value )
 
 std::string valueToString( double value )
 {
+   // Shortest representation that reads back to the same value
+   char shortest[IOT_DoubleFormat::BUFFER_SIZE];
+   size_t length = IOT_DoubleFormat::Format(value, shortest);
+   if (length != 0)
+      return std::string(shortest, length);
+
    char buffer[32];
 #if defined(_MSC_VER) && defined(__STDC_SECURE_LIB__) // Use secure version with visual studio 2005 to avoid warning. 
    sprintf_s(buffer, sizeof(buffer), "%#.16g", value); 
@@ -3502,65 +3687,61 @@ std::string valueToString( bool value )
 
 std::string valueToQuotedString( const char *value )
 {
-   // Not sure how to handle unicode...
-   if (strpbrk(value, "\"\\\b\f\n\r\t") == NULL && !containsControlCharacter( value ))
-      return std::string("\"") + value + "\"";
-   // We have to walk value and escape any special characters.
-   // Appending to std::string is not efficient, but this should be rare.
-   // (Note: forward slashes are *not* rare, but I am not escaping them.)
-   std::string::size_type maxsize = strlen(value)*2 + 3; // allescaped+quotes+NULL
+   size_t length = strlen(value);
    std::string result;
-   result.reserve(maxsize); // to avoid lots of mallocs
-   result += "\"";
-   for (const char* c=value; *c != 0; ++c)
+   result.reserve( length + 2 );
+   appendQuotedString( result, value, value + length );
+   return result;
+}
+
+
+void appendQuotedString( std::string &document, const char *begin, const char *end )
+{
+   // Clean runs are found 16 or 32 bytes at a time and copied as a whole.
+   // (Note: forward slashes are *not* escaped.)
+   static const char hexDigits[] = "0123456789ABCDEF";
+   document += '"';
+   while ( begin != end )
    {
-      switch(*c)
+      const char *run = begin;
+      begin = IOT_JsonScan::FindEscapeNeeded( begin, end );
+      document.append( run, begin );
+      if ( begin == end )
+         break;
+
+      char c = *begin++;
+      switch ( c )
       {
          case '\"':
-            result += "\\\"";
+            document += "\\\"";
             break;
          case '\\':
-            result += "\\\\";
+            document += "\\\\";
             break;
          case '\b':
-            result += "\\b";
+            document += "\\b";
             break;
          case '\f':
-            result += "\\f";
+            document += "\\f";
             break;
          case '\n':
-            result += "\\n";
+            document += "\\n";
             break;
          case '\r':
-            result += "\\r";
+            document += "\\r";
             break;
          case '\t':
-            result += "\\t";
+            document += "\\t";
             break;
-         //case '/':
-            // Even though \/ is considered a legal escape in JSON, a bare
-            // slash is also legal, so I see no reason to escape it.
-            // (I hope I am not misunderstanding something.
-            // blep notes: actually escaping \/ may be useful in javascript to avoid </ 
-            // sequence.
-            // Should add a flag to allow this compatibility mode and prevent this 
-            // sequence from occurring.
          default:
-            if ( isControlCharacter( *c ) )
-            {
-               std::ostringstream oss;
-               oss << "\\u" << std::hex << std::uppercase << std::setfill('0') << std::setw(4) << static_cast<int>(*c);
-               result += oss.str();
-            }
-            else
             {
-               result += *c;
+               char escape[] = { '\\', 'u', '0', '0', hexDigits[(c >> 4) & 0xF], hexDigits[c & 0xF] };
+               document.append( escape, sizeof(escape) );
             }
             break;
       }
    }
-   result += "\"";
-   return result;
+   document += '"';
 }
 
 // Class Writer
@@ -3614,7 +3795,10 @@ FastWriter::writeValue( const Value &value )
       document_ += valueToString( value.asDouble() );
       break;
    case stringValue:
-      document_ += valueToQuotedString( value.asCString() );
+      {
+         const char *str = value.asCString();
+         appendQuotedString( document_, str, str + strlen(str) );
+      }
       break;
    case booleanValue:
       document_ += valueToString( value.asBool() );
@@ -3643,7 +3827,7 @@ FastWriter::writeValue( const Value &value )
             const std::string &name = *it;
             if ( it != members.begin() )
                document_ += ",";
-            document_ += valueToQuotedString( name.c_str() );
+            appendQuotedString( document_, name.data(), name.data() + name.size() );
             document_ += yamlCompatiblityEnabled_ ? ": " 
                                                   : ":";
             writeValue( value[name] );
@@ -3,12 +3,38 @@ set(IOTAPI_TESTS_SOURCES
     tests/IOT_Tester.cpp
     tests/IOT_Base64Tester.cpp
     tests/IOT_RestClientTester.cpp
+    tests/IOT_HistogramTester.cpp
+    tests/IOT_MetricsTester.cpp
+    tests/IOT_BatchControllerTester.cpp
+    tests/IOT_CompressorTester.cpp
+    tests/IOT_AggregatorTester.cpp
+    tests/IOT_QuotaGovernorTester.cpp
+    tests/IOT_DoubleFormatTester.cpp
+    tests/IOT_NumberParseTester.cpp
+    tests/IOT_ResponseDecoderTester.cpp
+    tests/IOT_ValueArenaTester.cpp
+    tests/IOT_JsonScanTester.cpp
+    tests/IOT_ClientPoolTester.cpp
+    tests/IOT_AsyncTransportTester.cpp
+    tests/IOT_GatewayTester.cpp
+    tests/IOT_UploadSchedulerTester.cpp
+    tests/IOT_UploaderTester.cpp
+    tests/IOT_TestServer.cpp
+    tests/IOT_SessionFileTester.cpp
+    tests/IOT_RateLimiterTester.cpp
+    tests/IOT_WriteTester.cpp
+    tests/IOT_PreparedWriterTester.cpp
     tests/main.cpp
 )
 
 add_executable(iot-ticket-tests ${IOTAPI_TESTS_SOURCES} )
 target_link_libraries(iot-ticket-tests IOT_API cppunit)
 
+# Fail the build instead of skipping testCoroutine if the compiler has no coroutines
+if(BUILD_CXX20)
+    target_compile_definitions(iot-ticket-tests PRIVATE IOT_REQUIRE_COROUTINES)
+endif()
+
 install(TARGETS iot-ticket-tests
     RUNTIME DESTINATION bin
     LIBRARY DESTINATION lib
@@ -0,0 +1,140 @@
+
+
+#include "IOT_AggregatorTester.h"
+#include "IOT_Aggregator.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_AggregatorTester );
+
+
+static IOT_WriteData Sample(uint64_t timeMs, double value)
+{
+    IOT_WriteData data;
+    data.SetName("Vibration");
+    data.SetPath("Motor");
+    data.SetUnit("mm/s");
+    data.SetTimeMs(timeMs);
+    data.SetValue(value);
+    return data;
+}
+
+static double Value(const IOT_WriteData& data)
+{
+    double value = 0.0;
+    data.GetNumericValue(value);
+    return value;
+}
+
+void IOT_AggregatorTester::testTumblingWindow()
+{
+    IOT_Aggregator aggregator;
+    IOT_Aggregator::Config config;
+    config.windowMs = 1000;
+    CPPUNIT_ASSERT(aggregator.SetConfig("Motor", "Vibration", config));
+
+    std::vector<IOT_WriteData> out;
+    for(uint64_t t = 0; t < 1000; t += 10) {
+        CPPUNIT_ASSERT(aggregator.Process(Sample(t, t / 10.0), out) == 0);
+    }
+
+    // First sample of the next window closes the previous one
+    CPPUNIT_ASSERT(aggregator.Process(Sample(1000, 5.0), out) == 4);
+    CPPUNIT_ASSERT(out[0].GetName() == "Vibration_min" && Value(out[0]) == 0.0);
+    CPPUNIT_ASSERT(out[1].GetName() == "Vibration_max" && Value(out[1]) == 99.0);
+    CPPUNIT_ASSERT(out[2].GetName() == "Vibration_mean" && Value(out[2]) == 49.5);
+    CPPUNIT_ASSERT(out[3].GetName() == "Vibration_count" && Value(out[3]) == 100.0);
+    CPPUNIT_ASSERT(out[3].GetDataType() == IOTAPI::IOT_long);
+    CPPUNIT_ASSERT(out[0].GetPath() == "Motor" && out[0].GetUnit() == "mm/s");
+    CPPUNIT_ASSERT(out[3].GetUnit().empty());
+    CPPUNIT_ASSERT(out[0].GetTimeMs() == 1000);
+
+    out.clear();
+    CPPUNIT_ASSERT(aggregator.Flush(out) == 4);
+    CPPUNIT_ASSERT(Value(out[3]) == 1.0 && Value(out[2]) == 5.0);
+    CPPUNIT_ASSERT(out[0].GetTimeMs() == 2000);
+}
+
+void IOT_AggregatorTester::testSlidingWindow()
+{
+    IOT_Aggregator aggregator;
+    IOT_Aggregator::Config config;
+    config.windowMs = 3000;
+    config.slideMs = 1000;
+    config.functions = IOT_Aggregator::AGG_MAX | IOT_Aggregator::AGG_COUNT;
+    CPPUNIT_ASSERT(aggregator.SetDefaultConfig(config));
+
+    std::vector<IOT_WriteData> out;
+    aggregator.Process(Sample(500, 7.0), out);
+    aggregator.Process(Sample(1500, 3.0), out);
+    aggregator.Process(Sample(2500, 4.0), out);
+    aggregator.Process(Sample(3500, 1.0), out);
+    aggregator.Process(Sample(4500, 2.0), out);
+
+    // Windows ending at 1000, 2000, 3000 and 4000
+    CPPUNIT_ASSERT(out.size() == 8);
+    CPPUNIT_ASSERT(Value(out[4]) == 7.0 && Value(out[5]) == 3.0);
+    CPPUNIT_ASSERT(out[6].GetTimeMs() == 4000);
+    CPPUNIT_ASSERT(Value(out[6]) == 4.0 && Value(out[7]) == 3.0);
+}
+
+void IOT_AggregatorTester::testBlockInput()
+{
+    IOT_Aggregator aggregator;
+    IOT_Aggregator::Config config;
+    config.windowMs = 100;
+    CPPUNIT_ASSERT(aggregator.SetConfig("Motor", "Current", config));
+
+    // 1 kHz signal for one second
+    std::vector<uint64_t> times;
+    std::vector<double> values;
+    for(uint64_t t = 0; t < 1000; ++t) {
+        times.push_back(t);
+        values.push_back((t % 100 == 37) ? -1.0 : static_cast<double>(t % 7));
+    }
+
+    std::vector<IOT_WriteData> out;
+    CPPUNIT_ASSERT(aggregator.Process("Motor", "Current", "A", &times[0], &values[0], times.size(), out) == 9 * 4);
+    CPPUNIT_ASSERT(aggregator.Flush(out) == 4);
+    for(size_t i = 0; i < out.size(); i += 4) {
+        CPPUNIT_ASSERT(Value(out[i]) == -1.0);
+        CPPUNIT_ASSERT(Value(out[i + 1]) == 6.0);
+        CPPUNIT_ASSERT(Value(out[i + 3]) == 100.0);
+    }
+
+    // Unconfigured datanode is not aggregated
+    CPPUNIT_ASSERT(aggregator.Process("Motor", "Other", "", &times[0], &values[0], times.size(), out) == 0);
+}
+
+void IOT_AggregatorTester::testGapAndLateSamples()
+{
+    IOT_Aggregator aggregator;
+    IOT_Aggregator::Config config;
+    config.windowMs = 1000;
+    config.functions = IOT_Aggregator::AGG_COUNT;
+    aggregator.SetDefaultConfig(config);
+
+    std::vector<IOT_WriteData> out;
+    aggregator.Process(Sample(100, 1.0), out);
+    aggregator.Process(Sample(3600000, 1.0), out);
+    CPPUNIT_ASSERT(out.size() == 1);
+
+    // Window of the late sample has already been emitted
+    aggregator.Process(Sample(500, 1.0), out);
+    IOT_Aggregator::Stats stats;
+    CPPUNIT_ASSERT(aggregator.GetStats("Motor", "Vibration", stats));
+    CPPUNIT_ASSERT(stats.received == 3 && stats.late == 1 && stats.windows == 1);
+}
+
+void IOT_AggregatorTester::testInvalidConfig()
+{
+    IOT_Aggregator aggregator;
+    IOT_Aggregator::Config config;
+    config.windowMs = 1000;
+    config.slideMs = 300;
+    CPPUNIT_ASSERT(!aggregator.SetDefaultConfig(config));
+    config.slideMs = 2000;
+    CPPUNIT_ASSERT(!aggregator.SetDefaultConfig(config));
+    config.slideMs = 250;
+    config.functions = 0;
+    CPPUNIT_ASSERT(!aggregator.SetDefaultConfig(config));
+}
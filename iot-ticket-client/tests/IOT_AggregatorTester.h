@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_AGGREGATORTESTER_H
+#define IOT_AGGREGATORTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_AggregatorTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_AggregatorTester );
+    CPPUNIT_TEST( testTumblingWindow );
+    CPPUNIT_TEST( testSlidingWindow );
+    CPPUNIT_TEST( testBlockInput );
+    CPPUNIT_TEST( testGapAndLateSamples );
+    CPPUNIT_TEST( testInvalidConfig );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testTumblingWindow();
+    void testSlidingWindow();
+    void testBlockInput();
+    void testGapAndLateSamples();
+    void testInvalidConfig();
+};
+
+#endif // IOT_AGGREGATORTESTER_H
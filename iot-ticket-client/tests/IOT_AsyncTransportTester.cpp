@@ -0,0 +1,274 @@
+
+
+#include "IOT_AsyncTransportTester.h"
+#include "IOT_AsyncTransport.h"
+#include "IOT_Coroutine.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_AsyncTransportTester );
+
+static const std::string HTTP_GET_URL  = "https://httpbin.org/get?test=testdata";
+static const std::string HTTP_GET_RET  = "\"url\": \"https://httpbin.org/get?test=testdata\"";
+static const std::string HTTP_AUTH_URL = "https://httpbin.org/basic-auth/user/pass";
+static const std::string HTTP_POST_URL = "https://httpbin.org/post";
+
+//! Nothing listens on the discard port, so requests fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+
+void IOT_AsyncTransportTester::testConcurrent()
+{
+    IOT_AsyncTransport transport(20);
+    size_t completed = 0;
+
+    for(size_t i = 0; i < 5; ++i) {
+        std::string data = "async POST " + std::to_string(i);
+        transport.Post(HTTP_POST_URL, "", "", data,
+            [&completed, data](IOTAPI::IOTAPI_err ret, const std::string& response, const IOT_RequestTiming& timing) {
+                CPPUNIT_ASSERT(ret == IOTAPI::IOT_ERR_OK);
+                CPPUNIT_ASSERT(response.find(data) != std::string::npos);
+                CPPUNIT_ASSERT(timing.httpCode == 200);
+                ++completed;
+            });
+    }
+
+    // Requests can be started from any thread
+    std::thread starter([&transport, &completed]() {
+        transport.Get(HTTP_GET_URL, "", "",
+            [&completed](IOTAPI::IOTAPI_err ret, const std::string& response, const IOT_RequestTiming&) {
+                CPPUNIT_ASSERT(ret == IOTAPI::IOT_ERR_OK);
+                CPPUNIT_ASSERT(response.find(HTTP_GET_RET) != std::string::npos);
+                ++completed;
+            });
+    });
+    starter.join();
+
+    CPPUNIT_ASSERT(transport.GetPending() == 6);
+    transport.Run();
+    CPPUNIT_ASSERT(completed == 6);
+    CPPUNIT_ASSERT(transport.GetPending() == 0);
+}
+
+void IOT_AsyncTransportTester::testHandleReuse()
+{
+    IOT_AsyncTransport transport(20);
+    std::string get;
+    std::string post;
+
+    // Request started from a callback reuses the handle of the completed POST
+    transport.Post(HTTP_POST_URL, "", "", "payload",
+        [&transport, &get, &post](IOTAPI::IOTAPI_err ret, const std::string& response, const IOT_RequestTiming&) {
+            CPPUNIT_ASSERT(ret == IOTAPI::IOT_ERR_OK);
+            post = response;
+            transport.Get(HTTP_GET_URL, "", "",
+                [&get](IOTAPI::IOTAPI_err ret, const std::string& response, const IOT_RequestTiming&) {
+                    CPPUNIT_ASSERT(ret == IOTAPI::IOT_ERR_OK);
+                    get = response;
+                });
+        });
+    transport.Run();
+
+    CPPUNIT_ASSERT(post.find("payload") != std::string::npos);
+    CPPUNIT_ASSERT(get.find(HTTP_GET_RET) != std::string::npos);
+    CPPUNIT_ASSERT(get.find("payload") == std::string::npos);
+}
+
+void IOT_AsyncTransportTester::testAuthFail()
+{
+    IOT_AsyncTransport transport(20);
+    IOTAPI::IOTAPI_err ok = IOTAPI::IOT_ERR_GENERAL;
+    IOTAPI::IOTAPI_err fail = IOTAPI::IOT_ERR_OK;
+
+    transport.Get(HTTP_AUTH_URL, "user", "pass",
+        [&ok](IOTAPI::IOTAPI_err ret, const std::string&, const IOT_RequestTiming&) { ok = ret; });
+    transport.Get(HTTP_AUTH_URL, "user", "wrong pass",
+        [&fail](IOTAPI::IOTAPI_err ret, const std::string&, const IOT_RequestTiming&) { fail = ret; });
+    transport.Run();
+
+    CPPUNIT_ASSERT(ok == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(fail == IOTAPI::IOT_ERR_AUTH);
+}
+
+void IOT_AsyncTransportTester::testApiAsync()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_AsyncTransport transport(5);
+
+    std::vector<IOT_GetDevice> devices;
+    IOTAPI::IOTAPI_err devicesRet = IOTAPI::IOT_ERR_OK;
+    api.GetDevicesAsync(transport, devices, [&devicesRet](IOTAPI::IOTAPI_err ret) { devicesRet = ret; });
+
+    std::vector<IOT_WriteData> data(2);
+    data[0].SetName("temperature");
+    data[0].SetValue(21.5);
+    data[1].SetName("humidity");
+    data[1].SetValue(40.0);
+    IOT_WriteResult result;
+    IOTAPI::IOTAPI_err writeRet = IOTAPI::IOT_ERR_OK;
+    api.SetWriteChunkLimits(1, 1024);
+    api.SendDataAsync(transport, "device", data, result, [&writeRet](IOTAPI::IOTAPI_err ret) { writeRet = ret; });
+
+    transport.Run();
+
+    CPPUNIT_ASSERT(devicesRet == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(writeRet == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetChunks() == 2);
+    CPPUNIT_ASSERT(result.GetFailedChunks() == 2);
+    CPPUNIT_ASSERT(result.GetAccepted() == 0);
+
+    // Invalid write completes without a request
+    std::vector<IOT_WriteData> empty;
+    writeRet = IOTAPI::IOT_ERR_OK;
+    api.SendDataAsync(transport, "device", empty, result, [&writeRet](IOTAPI::IOTAPI_err ret) { writeRet = ret; });
+    CPPUNIT_ASSERT(writeRet == IOTAPI::IOT_ERR_PARAM);
+    CPPUNIT_ASSERT(transport.GetPending() == 0);
+}
+
+#ifdef IOT_HAS_COROUTINES
+
+//! Coroutine that starts at once and is not awaited by anyone
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() { return DetachedTask(); }
+        std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+        void return_void() {}
+        void unhandled_exception() {}
+    };
+};
+
+static DetachedTask ReadDevices(const IOT_API& api, IOT_AsyncTransport& transport, std::vector<IOTAPI::IOTAPI_err>& rets)
+{
+    std::vector<IOT_GetDevice> devices;
+    rets.push_back(co_await IOT_Await::GetDevices(api, transport, devices));
+
+    std::vector<IOT_WriteData> empty;
+    IOT_WriteResult result;
+    rets.push_back(co_await IOT_Await::SendData(api, transport, "device", empty, result));
+}
+
+void IOT_AsyncTransportTester::testCoroutine()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_AsyncTransport transport(5);
+
+    std::vector<IOTAPI::IOTAPI_err> rets[3];
+    for(size_t i = 0; i < 3; ++i) {
+        ReadDevices(api, transport, rets[i]);
+        CPPUNIT_ASSERT(rets[i].empty());
+    }
+    CPPUNIT_ASSERT(transport.GetPending() == 3);
+
+    transport.Run();
+
+    for(size_t i = 0; i < 3; ++i) {
+        CPPUNIT_ASSERT(rets[i].size() == 2);
+        CPPUNIT_ASSERT(rets[i][0] == IOTAPI::IOT_ERR_CONN);
+        CPPUNIT_ASSERT(rets[i][1] == IOTAPI::IOT_ERR_PARAM);
+    }
+}
+
+#elif defined(IOT_REQUIRE_COROUTINES)
+
+#error "BUILD_CXX20 is set but the compiler does not support coroutines"
+
+#else
+
+void IOT_AsyncTransportTester::testCoroutine()
+{
+    // Coroutines need C++20, build with -DBUILD_CXX20=1
+}
+
+#endif
+
+void IOT_AsyncTransportTester::testEventLoop()
+{
+    IOT_AsyncTransport transport(20);
+    int epfd = epoll_create1(0);
+    long timeoutMs = -1;
+    size_t watched = 0;
+
+    IOTAPI::IOTAPI_err ret = transport.SetEventLoop(
+        [epfd, &watched](curl_socket_t fd, int events) {
+            epoll_event ev = epoll_event();
+            ev.data.fd = fd;
+            ev.events = ((events & IOT_AsyncTransport::IO_IN) ? EPOLLIN : 0) |
+                        ((events & IOT_AsyncTransport::IO_OUT) ? EPOLLOUT : 0);
+            if(events == 0) {
+                epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+            } else if(epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) != 0) {
+                epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+                ++watched;
+            }
+        },
+        [&timeoutMs](long ms) { timeoutMs = ms; });
+    CPPUNIT_ASSERT(ret == IOTAPI::IOT_ERR_OK);
+
+    IOTAPI::IOTAPI_err getRet = IOTAPI::IOT_ERR_GENERAL;
+    IOTAPI::IOTAPI_err closedRet = IOTAPI::IOT_ERR_OK;
+    std::string response;
+    transport.Get(HTTP_GET_URL, "", "",
+        [&getRet, &response](IOTAPI::IOTAPI_err ret, const std::string& data, const IOT_RequestTiming&) {
+            getRet = ret;
+            response = data;
+        });
+    transport.Get(CLOSED_URL, "", "",
+        [&closedRet](IOTAPI::IOTAPI_err ret, const std::string&, const IOT_RequestTiming&) { closedRet = ret; });
+
+    // Starting requests asks the loop to run the timer
+    CPPUNIT_ASSERT(timeoutMs >= 0);
+    CPPUNIT_ASSERT(transport.SetEventLoop(NULL, NULL) == IOTAPI::IOT_ERR_INITIALIZED);
+    CPPUNIT_ASSERT(transport.Poll(0) == 0);
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while(transport.GetPending() > 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        epoll_event events[8];
+        int count = epoll_wait(epfd, events, 8, (timeoutMs < 0) ? 1000 : static_cast<int>(timeoutMs));
+        if(count == 0) {
+            timeoutMs = -1;
+            transport.OnTimeout();
+        }
+        for(int i = 0; i < count; ++i) {
+            int flags = ((events[i].events & EPOLLIN) ? IOT_AsyncTransport::IO_IN : 0) |
+                        ((events[i].events & EPOLLOUT) ? IOT_AsyncTransport::IO_OUT : 0) |
+                        ((events[i].events & (EPOLLERR | EPOLLHUP)) ? IOT_AsyncTransport::IO_ERROR : 0);
+            transport.OnSocketEvent(events[i].data.fd, flags);
+        }
+    }
+    close(epfd);
+
+    CPPUNIT_ASSERT(transport.GetPending() == 0);
+    CPPUNIT_ASSERT(watched > 0);
+    CPPUNIT_ASSERT(closedRet == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(getRet == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(response.find(HTTP_GET_RET) != std::string::npos);
+}
+
+void IOT_AsyncTransportTester::testHttpVersion()
+{
+    IOT_AsyncTransport transport(20, 1);
+    bool http2 = IOT_RestClient::IsHttpVersionSupported(IOTAPI::IOT_HTTP_2);
+    CPPUNIT_ASSERT(transport.SetHttpVersion(IOTAPI::IOT_HTTP_2) == (http2 ? IOTAPI::IOT_ERR_OK : IOTAPI::IOT_ERR_PARAM));
+    CPPUNIT_ASSERT(transport.SetHttpVersion(IOTAPI::IOT_HTTP_1_1) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(transport.SetHttpVersion(IOTAPI::IOT_HTTP_2) == (http2 ? IOTAPI::IOT_ERR_OK : IOTAPI::IOT_ERR_PARAM));
+
+    // Requests multiplexed on one connection
+    std::vector<IOTAPI::IOTAPI_err> rets(4, IOTAPI::IOT_ERR_GENERAL);
+    for(size_t i = 0; i < rets.size(); ++i) {
+        transport.Get(HTTP_GET_URL, "", "",
+            [&rets, i](IOTAPI::IOTAPI_err ret, const std::string&, const IOT_RequestTiming&) { rets[i] = ret; });
+    }
+    transport.Run();
+
+    for(size_t i = 0; i < rets.size(); ++i) {
+        CPPUNIT_ASSERT(rets[i] == IOTAPI::IOT_ERR_OK);
+    }
+    CPPUNIT_ASSERT(transport.SetHttpVersion(IOTAPI::IOT_HTTP_1_1) == IOTAPI::IOT_ERR_INITIALIZED);
+}
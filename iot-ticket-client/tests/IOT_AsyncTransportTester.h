@@ -0,0 +1,30 @@
+
+
+#ifndef IOT_ASYNCTRANSPORTTESTER_H
+#define IOT_ASYNCTRANSPORTTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_AsyncTransportTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_AsyncTransportTester );
+    CPPUNIT_TEST( testConcurrent );
+    CPPUNIT_TEST( testHandleReuse );
+    CPPUNIT_TEST( testAuthFail );
+    CPPUNIT_TEST( testApiAsync );
+    CPPUNIT_TEST( testCoroutine );
+    CPPUNIT_TEST( testEventLoop );
+    CPPUNIT_TEST( testHttpVersion );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testConcurrent();
+    void testHandleReuse();
+    void testAuthFail();
+    void testApiAsync();
+    void testCoroutine();
+    void testEventLoop();
+    void testHttpVersion();
+};
+
+#endif // IOT_ASYNCTRANSPORTTESTER_H
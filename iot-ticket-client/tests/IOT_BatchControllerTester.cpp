@@ -0,0 +1,83 @@
+
+
+#include "IOT_BatchControllerTester.h"
+#include "IOT_BatchController.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_BatchControllerTester );
+
+
+void IOT_BatchControllerTester::testAdditiveIncrease()
+{
+    IOT_BatchController ctrl;
+    CPPUNIT_ASSERT(ctrl.SetLatencyTarget(1000));
+    ctrl.SetIncreaseStep(10);
+
+    size_t batch = ctrl.GetBatchSize();
+    ctrl.OnRequestComplete(batch, batch * 50, 100.0, true);
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == batch + 10);
+    CPPUNIT_ASSERT(ctrl.GetState().lastDecision == IOT_BatchController::DECISION_INCREASE);
+
+    // Partially filled batch does not tell anything about the capacity
+    ctrl.OnRequestComplete(1, 50, 100.0, true);
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == batch + 10);
+    CPPUNIT_ASSERT(ctrl.GetState().lastDecision == IOT_BatchController::DECISION_HOLD);
+
+    // Flush interval leaves room for the request latency within the target
+    CPPUNIT_ASSERT(ctrl.GetFlushIntervalMs() == 900);
+}
+
+void IOT_BatchControllerTester::testDecreaseOnLatency()
+{
+    IOT_BatchController ctrl;
+    CPPUNIT_ASSERT(ctrl.SetLatencyTarget(500));
+
+    size_t batch = ctrl.GetBatchSize();
+    ctrl.OnRequestComplete(batch, batch * 50, 800.0, true);
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == batch / 2);
+    CPPUNIT_ASSERT(ctrl.GetState().lastDecision == IOT_BatchController::DECISION_DECREASE_LATENCY);
+    CPPUNIT_ASSERT(ctrl.GetState().decreases == 1);
+}
+
+void IOT_BatchControllerTester::testDecreaseOnError()
+{
+    IOT_BatchController ctrl;
+    CPPUNIT_ASSERT(ctrl.SetFlushIntervalLimits(10, 5000));
+
+    size_t batch = ctrl.GetBatchSize();
+    ctrl.OnRequestComplete(batch, 0, 0.0, false);
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == batch / 2);
+    CPPUNIT_ASSERT(ctrl.GetState().lastDecision == IOT_BatchController::DECISION_DECREASE_ERROR);
+
+    // Repeated errors back off the flush interval to its maximum
+    CPPUNIT_ASSERT(ctrl.GetFlushIntervalMs() == 5000);
+}
+
+void IOT_BatchControllerTester::testPayloadCap()
+{
+    IOT_BatchController ctrl;
+    ctrl.SetMaxPayloadBytes(1000);
+
+    size_t batch = ctrl.GetBatchSize();
+    ctrl.OnRequestComplete(batch, batch * 100, 10.0, true);
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == 10);
+    CPPUNIT_ASSERT(ctrl.GetState().lastDecision == IOT_BatchController::DECISION_PAYLOAD_CAP);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(100.0, ctrl.GetState().avgBytesPerSample, 0.001);
+}
+
+void IOT_BatchControllerTester::testLimits()
+{
+    IOT_BatchController ctrl;
+    CPPUNIT_ASSERT(!ctrl.SetBatchLimits(0, 10));
+    CPPUNIT_ASSERT(!ctrl.SetBatchLimits(20, 10));
+    CPPUNIT_ASSERT(!ctrl.SetLatencyTarget(0));
+    CPPUNIT_ASSERT(!ctrl.SetFlushIntervalLimits(100, 10));
+
+    CPPUNIT_ASSERT(ctrl.SetBatchLimits(5, 8));
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == 8);
+
+    for(int i=0; i<10; ++i) {
+        ctrl.OnRequestComplete(0, 0, 0.0, false);
+    }
+    CPPUNIT_ASSERT(ctrl.GetBatchSize() == 5);
+}
@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_BATCHCONTROLLERTESTER_H
+#define IOT_BATCHCONTROLLERTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_BatchControllerTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_BatchControllerTester );
+    CPPUNIT_TEST( testAdditiveIncrease );
+    CPPUNIT_TEST( testDecreaseOnLatency );
+    CPPUNIT_TEST( testDecreaseOnError );
+    CPPUNIT_TEST( testPayloadCap );
+    CPPUNIT_TEST( testLimits );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testAdditiveIncrease();
+    void testDecreaseOnLatency();
+    void testDecreaseOnError();
+    void testPayloadCap();
+    void testLimits();
+};
+
+#endif // IOT_BATCHCONTROLLERTESTER_H
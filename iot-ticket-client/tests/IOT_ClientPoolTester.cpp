@@ -0,0 +1,132 @@
+
+
+#include "IOT_ClientPoolTester.h"
+#include "IOT_ClientPool.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_ClientPoolTester );
+
+
+void IOT_ClientPoolTester::testLease()
+{
+    IOT_ClientPool pool(2);
+    CPPUNIT_ASSERT(pool.GetSize() == 2);
+    CPPUNIT_ASSERT(pool.GetCreated() == 0);
+
+    IOT_RestClient* first = NULL;
+    {
+        IOT_ClientPool::Lease lease(pool);
+        first = &*lease;
+        CPPUNIT_ASSERT(pool.GetCreated() == 1);
+    }
+
+    // The same thread gets the same client back
+    for(int i = 0; i < 10; ++i) {
+        IOT_ClientPool::Lease lease(pool);
+        CPPUNIT_ASSERT(&*lease == first);
+    }
+    CPPUNIT_ASSERT(pool.GetCreated() == 1);
+
+    IOT_ClientPool defaultSize;
+    CPPUNIT_ASSERT(defaultSize.GetSize() >= 1);
+}
+
+void IOT_ClientPoolTester::testOverflow()
+{
+    IOT_ClientPool pool(2);
+
+    IOT_ClientPool::Lease a(pool);
+    IOT_ClientPool::Lease b(pool);
+    CPPUNIT_ASSERT(&*a != &*b);
+    CPPUNIT_ASSERT(pool.GetOverflows() == 0);
+
+    IOT_RestClient* extra = NULL;
+    {
+        IOT_ClientPool::Lease c(pool);
+        CPPUNIT_ASSERT(&*c != &*a && &*c != &*b);
+        CPPUNIT_ASSERT(pool.GetOverflows() == 1);
+        extra = &*c;
+    }
+    CPPUNIT_ASSERT(pool.GetCreated() == 2);
+
+    // Extra client is kept and reused by the next overflow
+    {
+        IOT_ClientPool::Lease c(pool);
+        CPPUNIT_ASSERT(&*c == extra);
+        CPPUNIT_ASSERT(pool.GetOverflows() == 2);
+
+        IOT_ClientPool::Lease d(pool);
+        CPPUNIT_ASSERT(&*d != extra);
+    }
+    CPPUNIT_ASSERT(pool.GetExtra() == 2);
+}
+
+void IOT_ClientPoolTester::testThreads()
+{
+    IOT_ClientPool pool(4);
+
+    // Each client must be used by one thread at a time
+    std::mutex lock;
+    std::map<IOT_RestClient*, int> users;
+    std::atomic<int> conflicts(0);
+
+    auto worker = [&]() {
+        for(int i = 0; i < 2000; ++i) {
+            IOT_ClientPool::Lease lease(pool);
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(users[&*lease]++ != 0) {
+                    conflicts++;
+                }
+            }
+            std::this_thread::yield();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                users[&*lease]--;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 8; ++i) {
+        threads.push_back(std::thread(worker));
+    }
+    for(size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+
+    CPPUNIT_ASSERT(conflicts == 0);
+    CPPUNIT_ASSERT(pool.GetCreated() <= 4);
+}
+
+void IOT_ClientPoolTester::testHttpVersion()
+{
+    IOT_ClientPool pool(2);
+    CPPUNIT_ASSERT(pool.SetHttpVersion(IOTAPI::IOT_HTTP_1_1) == IOTAPI::IOT_ERR_OK);
+
+    {
+        IOT_ClientPool::Lease client(pool);
+    }
+    CPPUNIT_ASSERT(pool.SetHttpVersion(IOTAPI::IOT_HTTP_2) == IOTAPI::IOT_ERR_INITIALIZED);
+}
+
+void IOT_ClientPoolTester::testWarmup()
+{
+    IOT_ClientPool pool(2, 5);
+    IOT_KeepAlive policy;
+    policy.tcpKeepAlive = true;
+    policy.maxIdleS = 600;
+    policy.dnsCacheS = 300;
+    CPPUNIT_ASSERT(pool.SetKeepAlive(policy) == IOTAPI::IOT_ERR_OK);
+
+    // Nothing listens on the discard port
+    CPPUNIT_ASSERT(pool.Warmup("http://127.0.0.1:9/", 5) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(pool.GetCreated() == 2);
+    CPPUNIT_ASSERT(pool.GetOverflows() == 0);
+    CPPUNIT_ASSERT(pool.SetKeepAlive(IOT_KeepAlive()) == IOTAPI::IOT_ERR_INITIALIZED);
+}
@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_CLIENTPOOLTESTER_H
+#define IOT_CLIENTPOOLTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_ClientPoolTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_ClientPoolTester );
+    CPPUNIT_TEST( testLease );
+    CPPUNIT_TEST( testOverflow );
+    CPPUNIT_TEST( testThreads );
+    CPPUNIT_TEST( testHttpVersion );
+    CPPUNIT_TEST( testWarmup );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testLease();
+    void testOverflow();
+    void testThreads();
+    void testHttpVersion();
+    void testWarmup();
+};
+
+#endif // IOT_CLIENTPOOLTESTER_H
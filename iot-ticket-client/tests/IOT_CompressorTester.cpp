@@ -0,0 +1,155 @@
+
+
+#include "IOT_CompressorTester.h"
+#include "IOT_Compressor.h"
+#include <math.h>
+#include <stdlib.h>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_CompressorTester );
+
+
+static IOT_WriteData Sample(uint64_t timeMs, double value)
+{
+    IOT_WriteData data;
+    data.SetName("Temperature");
+    data.SetPath("Process/Line1");
+    data.SetTimeMs(timeMs);
+    data.SetValue(value);
+    return data;
+}
+
+void IOT_CompressorTester::testDeadband()
+{
+    IOT_Compressor compressor;
+    IOT_Compressor::Config config;
+    config.method = IOT_Compressor::COMPRESS_DEADBAND;
+    config.deviation = 0.5;
+    CPPUNIT_ASSERT(compressor.SetConfig("Process/Line1", "Temperature", config));
+
+    std::vector<IOT_WriteData> out;
+    CPPUNIT_ASSERT(compressor.Process(Sample(1000, 20.0), out) == 1);
+    CPPUNIT_ASSERT(compressor.Process(Sample(2000, 20.4), out) == 0);
+    CPPUNIT_ASSERT(compressor.Process(Sample(3000, 19.6), out) == 0);
+    CPPUNIT_ASSERT(compressor.Process(Sample(4000, 20.6), out) == 1);
+    CPPUNIT_ASSERT(out.size() == 2);
+    CPPUNIT_ASSERT(out[1].GetTimeMs() == 4000);
+
+    IOT_Compressor::Stats stats;
+    CPPUNIT_ASSERT(compressor.GetStats("Process/Line1", "Temperature", stats));
+    CPPUNIT_ASSERT(stats.received == 4);
+    CPPUNIT_ASSERT(stats.passed == 2);
+    CPPUNIT_ASSERT(stats.GetRatio() == 2.0);
+    CPPUNIT_ASSERT(stats.errorBound == 0.5);
+}
+
+void IOT_CompressorTester::testPercentDeadband()
+{
+    IOT_Compressor compressor;
+    IOT_Compressor::Config config;
+    config.method = IOT_Compressor::COMPRESS_DEADBAND;
+    config.percent = 1.0;
+    CPPUNIT_ASSERT(compressor.SetDefaultConfig(config));
+
+    std::vector<IOT_WriteData> out;
+    compressor.Process(Sample(1000, 200.0), out);
+    CPPUNIT_ASSERT(compressor.Process(Sample(2000, 201.9), out) == 0);
+    CPPUNIT_ASSERT(compressor.Process(Sample(3000, 202.1), out) == 1);
+
+    // Percent deadband is not meaningful for swinging door
+    config.method = IOT_Compressor::COMPRESS_SWINGING_DOOR;
+    CPPUNIT_ASSERT(!compressor.SetDefaultConfig(config));
+}
+
+void IOT_CompressorTester::testSwingingDoorErrorBound()
+{
+    const double deviation = 0.2;
+
+    IOT_Compressor compressor;
+    IOT_Compressor::Config config;
+    config.method = IOT_Compressor::COMPRESS_SWINGING_DOOR;
+    config.deviation = deviation;
+    CPPUNIT_ASSERT(compressor.SetDefaultConfig(config));
+
+    std::vector<double> values;
+    std::vector<IOT_WriteData> out;
+    srand(42);
+    double value = 50.0;
+    for(uint64_t i = 0; i < 5000; ++i) {
+        value += 0.05 * sin(i / 100.0) + (rand() % 100 - 50) / 2000.0;
+        values.push_back(value);
+        compressor.Process(Sample(i * 100, value), out);
+    }
+    compressor.Flush(out);
+
+    CPPUNIT_ASSERT(out.front().GetTimeMs() == 0);
+    CPPUNIT_ASSERT(out.back().GetTimeMs() == 4999 * 100);
+    CPPUNIT_ASSERT(out.size() < values.size() / 4);
+
+    // Linear interpolation between passed samples stays within the deviation
+    size_t segment = 0;
+    for(size_t i = 0; i < values.size(); ++i) {
+        uint64_t timeMs = i * 100;
+        while(out[segment + 1].GetTimeMs() < timeMs) {
+            ++segment;
+        }
+
+        double v0, v1;
+        CPPUNIT_ASSERT(out[segment].GetNumericValue(v0));
+        CPPUNIT_ASSERT(out[segment + 1].GetNumericValue(v1));
+        double t0 = out[segment].GetTimeMs();
+        double t1 = out[segment + 1].GetTimeMs();
+        double estimate = v0 + (v1 - v0) * (timeMs - t0) / (t1 - t0);
+        CPPUNIT_ASSERT(fabs(estimate - values[i]) <= deviation + 1e-9);
+    }
+
+    IOT_Compressor::Stats stats;
+    compressor.GetTotalStats(stats);
+    CPPUNIT_ASSERT(stats.received == values.size());
+    CPPUNIT_ASSERT(stats.passed == out.size());
+    CPPUNIT_ASSERT(stats.errorBound == deviation);
+}
+
+void IOT_CompressorTester::testMaxGap()
+{
+    IOT_Compressor compressor;
+    IOT_Compressor::Config config;
+    config.method = IOT_Compressor::COMPRESS_SWINGING_DOOR;
+    config.deviation = 1.0;
+    config.maxGapMs = 10000;
+    CPPUNIT_ASSERT(compressor.SetDefaultConfig(config));
+
+    std::vector<IOT_WriteData> out;
+    for(uint64_t i = 0; i <= 60; ++i) {
+        compressor.Process(Sample(i * 1000, 10.0), out);
+    }
+    compressor.Flush(out);
+
+    for(size_t i = 1; i < out.size(); ++i) {
+        CPPUNIT_ASSERT(out[i].GetTimeMs() - out[i-1].GetTimeMs() <= 10000);
+    }
+    CPPUNIT_ASSERT(out.size() == 7);
+}
+
+void IOT_CompressorTester::testPassThrough()
+{
+    IOT_Compressor compressor;
+    std::vector<IOT_WriteData> out;
+
+    // No compression configured
+    CPPUNIT_ASSERT(compressor.Process(Sample(1000, 1.0), out) == 1);
+    CPPUNIT_ASSERT(compressor.Process(Sample(2000, 1.0), out) == 1);
+
+    IOT_Compressor::Config config;
+    config.method = IOT_Compressor::COMPRESS_DEADBAND;
+    config.deviation = 100.0;
+    compressor.SetDefaultConfig(config);
+
+    // Non-numeric samples are always passed
+    IOT_WriteData text;
+    text.SetName("State");
+    text.SetValue("Running");
+    CPPUNIT_ASSERT(compressor.Process(text, out) == 1);
+    CPPUNIT_ASSERT(compressor.Process(text, out) == 1);
+    CPPUNIT_ASSERT(out.size() == 4);
+}
@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_COMPRESSORTESTER_H
+#define IOT_COMPRESSORTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_CompressorTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_CompressorTester );
+    CPPUNIT_TEST( testDeadband );
+    CPPUNIT_TEST( testPercentDeadband );
+    CPPUNIT_TEST( testSwingingDoorErrorBound );
+    CPPUNIT_TEST( testMaxGap );
+    CPPUNIT_TEST( testPassThrough );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testDeadband();
+    void testPercentDeadband();
+    void testSwingingDoorErrorBound();
+    void testMaxGap();
+    void testPassThrough();
+};
+
+#endif // IOT_COMPRESSORTESTER_H
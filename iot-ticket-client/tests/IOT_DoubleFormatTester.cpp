@@ -0,0 +1,84 @@
+
+
+#include "IOT_DoubleFormatTester.h"
+#include "IOT_DoubleFormat.h"
+#include "IOT_WriteData.h"
+#include <limits>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_DoubleFormatTester );
+
+
+void IOT_DoubleFormatTester::testFormat()
+{
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(0.1) == "0.1");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(0.1 + 0.2) == "0.30000000000000004");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(100.0) == "100.0");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(-21.5) == "-21.5");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(0.0) == "0.0");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(0.000001) == "0.000001");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(1e-7) == "1e-7");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(1.5e300) == "1.5e300");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(5e-324) == "5e-324");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(std::numeric_limits<double>::infinity()).empty());
+
+    // jsoncpp writer uses the same representation
+    Json::FastWriter writer;
+    Json::Value value(0.1);
+    CPPUNIT_ASSERT(writer.write(value) == "0.1\n");
+}
+
+void IOT_DoubleFormatTester::testRoundTrip()
+{
+    char buffer[IOT_DoubleFormat::BUFFER_SIZE];
+    srand(7);
+
+    for(int i = 0; i < 100000; ++i) {
+        uint64_t bits = (static_cast<uint64_t>(rand()) << 42) ^ (static_cast<uint64_t>(rand()) << 21) ^ rand();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if(i % 2) {
+            value = rand() / 1000.0 - 1e6;
+        }
+        if(!isfinite(value)) {
+            continue;
+        }
+
+        size_t length = IOT_DoubleFormat::Format(value, buffer);
+        CPPUNIT_ASSERT(length == strlen(buffer));
+        CPPUNIT_ASSERT(strtod(buffer, NULL) == value);
+    }
+}
+
+void IOT_DoubleFormatTester::testQuantize()
+{
+    CPPUNIT_ASSERT(IOT_DoubleFormat::Quantize(3.14159, 2) == 3.14);
+    CPPUNIT_ASSERT(IOT_DoubleFormat::Quantize(-2.5, 0) == -3.0);
+    CPPUNIT_ASSERT(IOT_DoubleFormat::ToString(IOT_DoubleFormat::Quantize(21.456789, 3)) == "21.457");
+    CPPUNIT_ASSERT(IOT_DoubleFormat::Quantize(1e300, 5) == 1e300);
+    CPPUNIT_ASSERT(IOT_DoubleFormat::Quantize(1.23456, -1) == 1.23456);
+}
+
+void IOT_DoubleFormatTester::testWriteDataPrecision()
+{
+    IOT_WriteData data;
+    data.SetName("Temperature");
+    data.SetValue(21.456789);
+
+    std::string json;
+    CPPUNIT_ASSERT(data.AppendJSON(json, 1));
+    CPPUNIT_ASSERT(json.find("\"v\":21.5}") != std::string::npos);
+
+    json.clear();
+    CPPUNIT_ASSERT(data.AppendJSON(json, IOT_WriteData::NO_PRECISION));
+    CPPUNIT_ASSERT(json.find("\"v\":21.456789}") != std::string::npos);
+
+    // Only doubles are rounded
+    data.SetValue(static_cast<int64_t>(21));
+    json.clear();
+    CPPUNIT_ASSERT(data.AppendJSON(json, 0));
+    CPPUNIT_ASSERT(json.find("\"v\":21}") != std::string::npos);
+}
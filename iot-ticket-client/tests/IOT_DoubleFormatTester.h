@@ -0,0 +1,24 @@
+
+
+#ifndef IOT_DOUBLEFORMATTESTER_H
+#define IOT_DOUBLEFORMATTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_DoubleFormatTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_DoubleFormatTester );
+    CPPUNIT_TEST( testFormat );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testQuantize );
+    CPPUNIT_TEST( testWriteDataPrecision );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testFormat();
+    void testRoundTrip();
+    void testQuantize();
+    void testWriteDataPrecision();
+};
+
+#endif // IOT_DOUBLEFORMATTESTER_H
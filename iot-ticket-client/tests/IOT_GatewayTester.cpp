@@ -0,0 +1,114 @@
+
+
+#include "IOT_GatewayTester.h"
+#include "IOT_Gateway.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_GatewayTester );
+
+//! Nothing listens on the discard port, so writes fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+static std::vector<IOT_WriteData> Samples(size_t count)
+{
+    std::vector<IOT_WriteData> data(count);
+    for(size_t i = 0; i < count; ++i) {
+        data[i].SetName("value");
+        data[i].SetValue(static_cast<int64_t>(i));
+    }
+    return data;
+}
+
+
+void IOT_GatewayTester::testBatching()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    IOT_AsyncTransport transport(5);
+    IOT_Gateway gateway(api, transport);
+    CPPUNIT_ASSERT(!gateway.SetBatching(0, 100));
+    CPPUNIT_ASSERT(gateway.SetBatching(100, 500));
+
+    // Full batch is sent at once, one batch of a device at a time
+    CPPUNIT_ASSERT(gateway.Enqueue("a", Samples(250)) == 250);
+    CPPUNIT_ASSERT(gateway.GetInFlight() == 1);
+    CPPUNIT_ASSERT(gateway.GetQueued() == 150);
+
+    // Partial batch waits for the flush interval
+    CPPUNIT_ASSERT(gateway.Enqueue("b", Samples(10)) == 10);
+    CPPUNIT_ASSERT(gateway.GetInFlight() == 1);
+    CPPUNIT_ASSERT(gateway.GetNextTimeoutMs() > 0);
+    CPPUNIT_ASSERT(gateway.GetNextTimeoutMs() <= 501);
+    CPPUNIT_ASSERT(gateway.GetDevices() == 2);
+
+    CPPUNIT_ASSERT(gateway.Flush() == 1);
+    CPPUNIT_ASSERT(gateway.GetInFlight() == 2);
+
+    while(gateway.GetInFlight() > 0) {
+        transport.Poll(100);
+    }
+
+    IOT_Gateway::Stats stats;
+    CPPUNIT_ASSERT(!gateway.GetStats("c", stats));
+    CPPUNIT_ASSERT(gateway.GetStats("b", stats));
+    CPPUNIT_ASSERT(stats.enqueued == 10);
+    CPPUNIT_ASSERT(stats.written == 0);
+    CPPUNIT_ASSERT(stats.batches == 1);
+    CPPUNIT_ASSERT(stats.failed == 1);
+    CPPUNIT_ASSERT(stats.latency.GetCount() == 1);
+
+    // Failed samples are queued again for retry
+    CPPUNIT_ASSERT(stats.queued == 10);
+    CPPUNIT_ASSERT(stats.dropped == 0);
+    CPPUNIT_ASSERT(gateway.GetNextTimeoutMs() > 0);
+}
+
+void IOT_GatewayTester::testFairness()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    IOT_AsyncTransport transport(5);
+    IOT_Gateway gateway(api, transport, 1);
+    gateway.SetBatching(10, 60000);
+
+    gateway.Enqueue("a", Samples(30));
+    gateway.Enqueue("b", Samples(30));
+    gateway.Enqueue("c", Samples(30));
+    CPPUNIT_ASSERT(gateway.GetInFlight() == 1);
+
+    // Other devices get their turn before the first one is retried
+    const char* devices[] = { "a", "b", "c" };
+    const uint64_t expected[3][3] = { { 1, 1, 0 }, { 1, 1, 1 }, { 1, 1, 1 } };
+    for(size_t turn = 0; turn < 3; ++turn) {
+        while(transport.Poll(100) == 0) {
+        }
+
+        IOT_Gateway::Stats stats;
+        for(size_t i = 0; i < 3; ++i) {
+            CPPUNIT_ASSERT(gateway.GetStats(devices[i], stats));
+            CPPUNIT_ASSERT(stats.batches == expected[turn][i]);
+        }
+    }
+    CPPUNIT_ASSERT(gateway.GetInFlight() == 0);
+
+    IOT_Gateway::Stats total;
+    gateway.GetStats(total);
+    CPPUNIT_ASSERT(total.batches == 3);
+}
+
+void IOT_GatewayTester::testQueueLimit()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_AsyncTransport transport(5);
+    IOT_Gateway gateway(api, transport);
+    gateway.SetMaxQueued(5);
+
+    CPPUNIT_ASSERT(gateway.Enqueue("a", Samples(10)) == 5);
+    CPPUNIT_ASSERT(!gateway.Enqueue("a", Samples(1)[0]));
+
+    IOT_Gateway::Stats stats;
+    gateway.GetStats(stats);
+    CPPUNIT_ASSERT(stats.enqueued == 5);
+    CPPUNIT_ASSERT(stats.dropped == 6);
+    CPPUNIT_ASSERT(stats.queued == 5);
+}
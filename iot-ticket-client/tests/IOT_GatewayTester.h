@@ -0,0 +1,22 @@
+
+
+#ifndef IOT_GATEWAYTESTER_H
+#define IOT_GATEWAYTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_GatewayTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_GatewayTester );
+    CPPUNIT_TEST( testBatching );
+    CPPUNIT_TEST( testFairness );
+    CPPUNIT_TEST( testQueueLimit );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testBatching();
+    void testFairness();
+    void testQueueLimit();
+};
+
+#endif // IOT_GATEWAYTESTER_H
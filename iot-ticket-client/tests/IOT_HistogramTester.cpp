@@ -0,0 +1,149 @@
+
+
+#include <thread>
+#include <vector>
+#include "IOT_HistogramTester.h"
+#include "IOT_Histogram.h"
+#include "IOT_EndpointStats.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_HistogramTester );
+
+
+void IOT_HistogramTester::testRecord()
+{
+    IOT_Histogram hist;
+    CPPUNIT_ASSERT(hist.GetCount() == 0);
+    CPPUNIT_ASSERT(hist.GetMean() == 0.0);
+
+    hist.Record(0.5);
+    hist.Record(1.0);
+    hist.Record(3.0);
+    hist.Record(60000.0);
+
+    CPPUNIT_ASSERT(hist.GetCount() == 4);
+    CPPUNIT_ASSERT(hist.GetBucketCount(0) == 2);
+    CPPUNIT_ASSERT(hist.GetBucketCount(2) == 1);
+    CPPUNIT_ASSERT(hist.GetBucketCount(IOT_Histogram::BUCKETS - 1) == 1);
+    CPPUNIT_ASSERT(IOT_Histogram::GetBucketBound(IOT_Histogram::BUCKETS - 1) < 0.0);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(60004.5, hist.GetSum(), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(60000.0, hist.GetMax(), 0.0001);
+
+    hist.Clear();
+    CPPUNIT_ASSERT(hist.GetCount() == 0);
+}
+
+void IOT_HistogramTester::testPercentile()
+{
+    IOT_Histogram hist;
+    for(int i=0; i<99; ++i) {
+        hist.Record(8.0);
+    }
+    hist.Record(150.0);
+
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(10.0, hist.GetPercentile(0.5), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(10.0, hist.GetPercentile(0.99), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(150.0, hist.GetPercentile(1.0), 0.0001);
+}
+
+void IOT_HistogramTester::testMerge()
+{
+    IOT_Histogram a;
+    IOT_Histogram b;
+    a.Record(1.0);
+    b.Record(1.0);
+    b.Record(25.0);
+
+    a.Merge(b);
+    CPPUNIT_ASSERT(a.GetCount() == 3);
+    CPPUNIT_ASSERT(a.GetBucketCount(0) == 2);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(25.0, a.GetMax(), 0.0001);
+}
+
+void IOT_HistogramTester::testEndpointPhases()
+{
+    IOT_RequestTiming timing;
+    timing.nameLookupMs = 4.0;
+    timing.connectMs = 14.0;
+    timing.appConnectMs = 114.0;
+    timing.preTransferMs = 115.0;
+    timing.startTransferMs = 415.0;
+    timing.totalMs = 416.0;
+    timing.bytesUp = 100;
+    timing.bytesDown = 50;
+
+    IOT_EndpointStats stats;
+    stats.Record(timing, true);
+
+    timing.connectionReused = true;
+    stats.Record(timing, false);
+
+    CPPUNIT_ASSERT(stats.GetRequests() == 2);
+    CPPUNIT_ASSERT(stats.GetFailedRequests() == 1);
+    CPPUNIT_ASSERT(stats.GetReusedConnections() == 1);
+    CPPUNIT_ASSERT(stats.GetBytesUp() == 200);
+    CPPUNIT_ASSERT(stats.GetBytesDown() == 100);
+
+    // Connection setup phases are only recorded for new connections
+    CPPUNIT_ASSERT(stats.GetDnsHistogram().GetCount() == 1);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(10.0, stats.GetConnectHistogram().GetSum(), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(100.0, stats.GetTlsHistogram().GetSum(), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(600.0, stats.GetServerHistogram().GetSum(), 0.0001);
+    CPPUNIT_ASSERT(stats.GetTotalHistogram().GetCount() == 2);
+
+    // Failed to connect: counted, but no phases recorded
+    IOT_RequestTiming refused;
+    refused.nameLookupMs = 2.0;
+    refused.totalMs = 3.0;
+    stats.Record(refused, false);
+
+    CPPUNIT_ASSERT(stats.GetRequests() == 3);
+    CPPUNIT_ASSERT(stats.GetFailedRequests() == 2);
+    CPPUNIT_ASSERT(stats.GetUnconnectedRequests() == 1);
+    CPPUNIT_ASSERT(stats.GetReusedConnections() == 1);
+    CPPUNIT_ASSERT(stats.GetDnsHistogram().GetCount() == 1);
+    CPPUNIT_ASSERT(stats.GetConnectHistogram().GetCount() == 1);
+    CPPUNIT_ASSERT(stats.GetTotalHistogram().GetCount() == 3);
+}
+
+void IOT_HistogramTester::testSharedStats()
+{
+    IOT_RequestTiming timing;
+    timing.nameLookupMs = 4.0;
+    timing.connectMs = 14.0;
+    timing.preTransferMs = 15.0;
+    timing.startTransferMs = 25.0;
+    timing.totalMs = 30.5;
+    timing.bytesUp = 10;
+
+    // Threads record to the same statistics without locking
+    IOT_SharedEndpointStats shared;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([&]() {
+            for(int i = 0; i < 1000; ++i) {
+                shared.Record(timing, i % 2 == 0);
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+
+    IOT_EndpointStats stats;
+    shared.MergeTo(stats);
+    CPPUNIT_ASSERT(stats.GetRequests() == 4000);
+    CPPUNIT_ASSERT(stats.GetFailedRequests() == 2000);
+    CPPUNIT_ASSERT(stats.GetBytesUp() == 40000);
+    CPPUNIT_ASSERT(stats.GetTotalHistogram().GetCount() == 4000);
+    CPPUNIT_ASSERT(stats.GetTotalHistogram().GetBucketCount(5) == 4000);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(122000.0, stats.GetTotalHistogram().GetSum(), 0.01);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(30.5, stats.GetTotalHistogram().GetMax(), 0.0001);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(40000.0, stats.GetConnectHistogram().GetSum(), 0.01);
+
+    shared.Clear();
+    IOT_EndpointStats cleared;
+    shared.MergeTo(cleared);
+    CPPUNIT_ASSERT(cleared.GetRequests() == 0);
+    CPPUNIT_ASSERT(cleared.GetTotalHistogram().GetCount() == 0);
+}
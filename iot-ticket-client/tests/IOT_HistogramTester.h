@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_HISTOGRAMTESTER_H
+#define IOT_HISTOGRAMTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_HistogramTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_HistogramTester );
+    CPPUNIT_TEST( testRecord );
+    CPPUNIT_TEST( testPercentile );
+    CPPUNIT_TEST( testMerge );
+    CPPUNIT_TEST( testEndpointPhases );
+    CPPUNIT_TEST( testSharedStats );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testRecord();
+    void testPercentile();
+    void testMerge();
+    void testEndpointPhases();
+    void testSharedStats();
+};
+
+#endif // IOT_HISTOGRAMTESTER_H
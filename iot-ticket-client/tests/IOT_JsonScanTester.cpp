@@ -0,0 +1,356 @@
+
+
+#include "IOT_JsonScanTester.h"
+#include "IOT_JsonScan.h"
+#include "IOT_JsonPullParser.h"
+#include "IOT_WriteData.h"
+#include "IOT_InternedString.h"
+#include "json/json.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_JsonScanTester );
+
+
+static const char* IMPLEMENTATIONS[] = { "scalar", "sse2", "avx2", "neon" };
+
+//! Names of the implementations this CPU can run
+static std::vector<const char*> Supported()
+{
+    std::vector<const char*> names;
+    for(size_t i = 0; i < sizeof(IMPLEMENTATIONS) / sizeof(IMPLEMENTATIONS[0]); ++i) {
+        if(IOT_JsonScan::SetImplementation(IMPLEMENTATIONS[i])) {
+            names.push_back(IMPLEMENTATIONS[i]);
+        }
+    }
+    return names;
+}
+
+//! Small deterministic generator so failures can be reproduced
+static unsigned int Random(unsigned int& state)
+{
+    state = state * 1103515245 + 12345;
+    return (state >> 16) & 0x7FFF;
+}
+
+//! Random JSON value with nested containers, escapes and runs of backslashes
+static void RandomValue(std::string& json, unsigned int& state, int depth)
+{
+    switch(Random(state) % (depth > 4 ? 3 : 5)) {
+    case 0:
+        json += Random(state) % 2 ? "12.5e3" : "true";
+        break;
+    case 1:
+    case 2: {
+        json += '"';
+        int length = Random(state) % 90;
+        for(int i = 0; i < length; ++i) {
+            switch(Random(state) % 12) {
+            case 0:
+                json.append(1 + 2 * (Random(state) % 3), '\\');
+                json += Random(state) % 2 ? '"' : ']';
+                break;
+            case 1:
+                json.append(2 * (Random(state) % 3 + 1), '\\');
+                break;
+            case 2:
+                json += "{[]}";
+                break;
+            case 3:
+                json += "\\u00e4";
+                break;
+            default:
+                json += static_cast<char>('a' + Random(state) % 26);
+                break;
+            }
+        }
+        json += '"';
+        break;
+    }
+    case 3: {
+        json += '[';
+        int count = Random(state) % 6;
+        for(int i = 0; i < count; ++i) {
+            json += i ? "," : "";
+            RandomValue(json, state, depth + 1);
+        }
+        json += ']';
+        break;
+    }
+    default: {
+        json += '{';
+        int count = Random(state) % 6;
+        for(int i = 0; i < count; ++i) {
+            json += i ? ",\"k" : "\"k";
+            json += static_cast<char>('0' + i);
+            json += "\": ";
+            RandomValue(json, state, depth + 1);
+        }
+        json += '}';
+        break;
+    }
+    }
+}
+
+//! Character by character version of IOT_JsonScan::SkipContainer
+static const char* ReferenceSkip(const char* pos, const char* end)
+{
+    int depth = 1;
+    bool inString = false;
+    for(; pos != end; ++pos) {
+        if(inString) {
+            if(*pos == '\\') {
+                if(++pos == end) {
+                    return NULL;
+                }
+            } else if(*pos == '"') {
+                inString = false;
+            }
+        } else if(*pos == '"') {
+            inString = true;
+        } else if(*pos == '{' || *pos == '[') {
+            ++depth;
+        } else if((*pos == '}' || *pos == ']') && --depth == 0) {
+            return pos + 1;
+        }
+    }
+    return NULL;
+}
+
+//! Character by character version of Json::appendQuotedString
+static std::string ReferenceQuote(const std::string& text)
+{
+    std::string quoted = "\"";
+    for(size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = text[i];
+        if(c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if(c == '\n') {
+            quoted += "\\n";
+        } else if(c == '\t') {
+            quoted += "\\t";
+        } else if(c < 0x20 && c != '\b' && c != '\f' && c != '\r') {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04X", c);
+            quoted += escape;
+        } else if(c < 0x20) {
+            quoted += '\\';
+            quoted += (c == '\b') ? 'b' : (c == '\f') ? 'f' : 'r';
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+void IOT_JsonScanTester::tearDown()
+{
+    IOT_JsonScan::SetImplementation(NULL);
+}
+
+void IOT_JsonScanTester::testFindQuoteOrEscape()
+{
+    std::vector<const char*> names = Supported();
+    CPPUNIT_ASSERT(!names.empty());
+    CPPUNIT_ASSERT(!IOT_JsonScan::SetImplementation("unknown"));
+
+    std::string text(200, 'x');
+    for(size_t n = 0; n < names.size(); ++n) {
+        CPPUNIT_ASSERT(IOT_JsonScan::SetImplementation(names[n]));
+        CPPUNIT_ASSERT(std::string(IOT_JsonScan::GetImplementation()) == names[n]);
+
+        for(size_t first = 0; first < 40; ++first) {
+            for(size_t last = first; last <= text.size(); last += 7) {
+                const char* begin = text.data();
+                CPPUNIT_ASSERT(IOT_JsonScan::FindQuoteOrEscape(begin + first, begin + last) == begin + last);
+
+                for(size_t at = first; at < last; at += 5) {
+                    text[at] = (at % 2) ? '"' : '\\';
+                    CPPUNIT_ASSERT(IOT_JsonScan::FindQuoteOrEscape(begin + first, begin + last) == begin + at);
+                    text[at] = 'x';
+                }
+            }
+        }
+    }
+}
+
+void IOT_JsonScanTester::testSkipContainer()
+{
+    std::vector<const char*> names = Supported();
+    unsigned int state = 1;
+
+    for(int doc = 0; doc < 400; ++doc) {
+        std::string json = "[";
+        while(json.size() < 20 + static_cast<size_t>(doc) * 8) {
+            json += json.size() > 1 ? "," : "";
+            RandomValue(json, state, 1);
+        }
+        json += "] ";
+
+        const char* begin = json.data() + 1;
+        const char* end = json.data() + json.size();
+        const char* expected = ReferenceSkip(begin, end);
+        CPPUNIT_ASSERT(expected == end - 1);
+
+        // Cut at different places, including inside escapes and strings
+        size_t cut = json.size() - 2 - Random(state) % (json.size() - 2);
+
+        for(size_t n = 0; n < names.size(); ++n) {
+            CPPUNIT_ASSERT(IOT_JsonScan::SetImplementation(names[n]));
+            CPPUNIT_ASSERT(IOT_JsonScan::SkipContainer(begin, end) == expected);
+            CPPUNIT_ASSERT(IOT_JsonScan::SkipContainer(begin, json.data() + cut) == ReferenceSkip(begin, json.data() + cut));
+        }
+    }
+}
+
+void IOT_JsonScanTester::testParsers()
+{
+    std::vector<const char*> names = Supported();
+
+    std::string text(100, 'y');
+    text[40] = '\\';
+    text[41] = '"';
+    text[70] = '\\';
+    text[71] = 'n';
+    std::string expected(text);
+    expected.replace(70, 2, "\n");
+    expected.replace(40, 2, "\"");
+
+    std::string json = "{\"skip\":[{\"a\":\"]}\\\\\"},[\"" + text + "\"]],\"text\":\"" + text + "\"}";
+
+    for(size_t n = 0; n < names.size(); ++n) {
+        CPPUNIT_ASSERT(IOT_JsonScan::SetImplementation(names[n]));
+
+        IOT_JsonPullParser parser(json);
+        CPPUNIT_ASSERT(parser.Next() == IOT_JsonPullParser::TOKEN_OBJECT_BEGIN);
+        CPPUNIT_ASSERT(parser.Next() == IOT_JsonPullParser::TOKEN_KEY);
+        CPPUNIT_ASSERT(parser.SkipValue());
+        CPPUNIT_ASSERT(parser.GetToken() == IOT_JsonPullParser::TOKEN_ARRAY_END);
+        CPPUNIT_ASSERT(parser.Next() == IOT_JsonPullParser::TOKEN_KEY);
+        CPPUNIT_ASSERT(parser.Next() == IOT_JsonPullParser::TOKEN_STRING);
+        CPPUNIT_ASSERT(parser.GetString() == expected);
+        CPPUNIT_ASSERT(parser.SkipToEnd());
+
+        Json::Value root;
+        Json::Reader reader;
+        CPPUNIT_ASSERT(reader.parse(json, root, false));
+        CPPUNIT_ASSERT(root["text"].asString() == expected);
+        CPPUNIT_ASSERT(root["skip"][0]["a"].asString() == "]}\\");
+
+        // Brackets of the wrong kind and unterminated containers
+        IOT_JsonPullParser mismatched("{\"a\":[1,{}}");
+        mismatched.Next();
+        mismatched.Next();
+        CPPUNIT_ASSERT(!mismatched.SkipValue());
+
+        IOT_JsonPullParser truncated("[{\"a\":\"}]");
+        truncated.Next();
+        CPPUNIT_ASSERT(!truncated.SkipValue());
+        CPPUNIT_ASSERT(!reader.parse("[\"abc\\\"]", root, false));
+    }
+}
+
+void IOT_JsonScanTester::testEscape()
+{
+    std::vector<const char*> names = Supported();
+    const char special[] = { '"', '\\', '\n', '\t', '\b', '\f', '\r', '\x01', '\x1F', '\x7F', '\xC3', '/' };
+
+    unsigned int state = 7;
+    for(int round = 0; round < 300; ++round) {
+        std::string text;
+        int length = Random(state) % 120;
+        for(int i = 0; i < length; ++i) {
+            text += (Random(state) % 8 == 0) ? special[Random(state) % sizeof(special)]
+                                             : static_cast<char>('a' + Random(state) % 26);
+        }
+        std::string expected = ReferenceQuote(text);
+
+        for(size_t n = 0; n < names.size(); ++n) {
+            CPPUNIT_ASSERT(IOT_JsonScan::SetImplementation(names[n]));
+            CPPUNIT_ASSERT(IOT_JsonScan::FindEscapeNeeded(text.data(), text.data() + text.size()) ==
+                           text.data() + std::min(text.find_first_of(std::string(special, 9)), text.size()));
+
+            std::string quoted = "prefix";
+            Json::appendQuotedString(quoted, text.data(), text.data() + text.size());
+            CPPUNIT_ASSERT(quoted == "prefix" + expected);
+            CPPUNIT_ASSERT(Json::valueToQuotedString(text.c_str()) == expected);
+
+            Json::Value root;
+            Json::Reader reader;
+            CPPUNIT_ASSERT(reader.parse("[" + expected + "]", root, false));
+            CPPUNIT_ASSERT(root[0].asString() == text);
+        }
+    }
+}
+
+void IOT_JsonScanTester::testWriteData()
+{
+    IOT_WriteData sample;
+    CPPUNIT_ASSERT(sample.SetName("Tank \"A\"\\level\n"));
+    CPPUNIT_ASSERT(sample.SetUnit("m\xC2\xB3"));
+
+    std::vector<IOT_WriteData> samples;
+    sample.SetValue(21.25);
+    samples.push_back(sample);
+    sample.SetValue(0.123456);
+    samples.push_back(sample);
+    CPPUNIT_ASSERT(sample.SetPath("site/tank1"));
+    sample.SetTimeMs(1440000000123ULL);
+    sample.SetValue(static_cast<int64_t>(-42));
+    samples.push_back(sample);
+    sample.SetValue(true);
+    samples.push_back(sample);
+    sample.SetValue("pump \"on\"\tvalve\\open, long enough to be stored on the heap");
+    samples.push_back(sample);
+    uint8_t bytes[] = { 0, 1, 2, 250, 251, 252, 253, 254, 255 };
+    sample.SetValue(bytes, sizeof(bytes));
+    samples.push_back(sample);
+    IOT_WriteData copy(sample);
+    CPPUNIT_ASSERT(copy.SetName("Other"));
+    samples.push_back(copy);
+
+    Json::FastWriter writer;
+    for(size_t i = 0; i < samples.size(); ++i) {
+        Json::Value value;
+        CPPUNIT_ASSERT(samples[i].ToJSON(value));
+
+        std::string json;
+        CPPUNIT_ASSERT(samples[i].ToJSON(json));
+        CPPUNIT_ASSERT(json == writer.write(value));
+
+        std::string appended = "[";
+        CPPUNIT_ASSERT(samples[i].AppendJSON(appended));
+        CPPUNIT_ASSERT(appended + "\n" == "[" + json);
+    }
+
+    IOT_WriteData empty;
+    std::string json;
+    CPPUNIT_ASSERT(!empty.AppendJSON(json));
+    CPPUNIT_ASSERT(json.empty());
+}
+
+void IOT_JsonScanTester::testInternedString()
+{
+    CPPUNIT_ASSERT(IOT_InternedString::Get("") == NULL);
+
+    std::shared_ptr<const IOT_InternedString> level = IOT_InternedString::Get("Tank \"B\" level");
+    CPPUNIT_ASSERT(level->GetValue() == "Tank \"B\" level");
+    CPPUNIT_ASSERT(level->GetQuoted() == "\"Tank \\\"B\\\" level\"");
+    CPPUNIT_ASSERT(IOT_InternedString::Get(std::string("Tank \"B\" level")) == level);
+    CPPUNIT_ASSERT(IOT_InternedString::Get("Tank \"C\" level") != level);
+
+    // Samples of a datanode share the escaped strings
+    IOT_WriteData a;
+    IOT_WriteData b;
+    CPPUNIT_ASSERT(a.SetName("Tank \"B\" level") && b.SetName("Tank \"B\" level"));
+    CPPUNIT_ASSERT(&a.GetName() == &level->GetValue());
+    CPPUNIT_ASSERT(&b.GetName() == &a.GetName());
+    CPPUNIT_ASSERT(a.GetPath().empty() && a.GetUnit().empty());
+
+    IOT_WriteData copy(a);
+    CPPUNIT_ASSERT(&copy.GetName() == &a.GetName());
+}
@@ -0,0 +1,30 @@
+
+
+#ifndef IOT_JSONSCANTESTER_H
+#define IOT_JSONSCANTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_JsonScanTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_JsonScanTester );
+    CPPUNIT_TEST( testFindQuoteOrEscape );
+    CPPUNIT_TEST( testSkipContainer );
+    CPPUNIT_TEST( testParsers );
+    CPPUNIT_TEST( testEscape );
+    CPPUNIT_TEST( testWriteData );
+    CPPUNIT_TEST( testInternedString );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void tearDown();
+
+    void testFindQuoteOrEscape();
+    void testSkipContainer();
+    void testParsers();
+    void testEscape();
+    void testWriteData();
+    void testInternedString();
+};
+
+#endif // IOT_JSONSCANTESTER_H
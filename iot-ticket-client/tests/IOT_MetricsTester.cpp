@@ -0,0 +1,100 @@
+
+
+#include "IOT_MetricsTester.h"
+#include "IOT_Metrics.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_MetricsTester );
+
+
+void IOT_MetricsTester::testCounterThreads()
+{
+    IOT_Metrics::Counter counter;
+
+    auto func = [&counter](){
+        for(int i=0; i<10000; ++i) {
+            counter.Add();
+        }
+    };
+
+    std::thread t1(func);
+    std::thread t2(func);
+    std::thread t3(func);
+
+    t1.join();
+    t2.join();
+    t3.join();
+
+    CPPUNIT_ASSERT(counter.Get() == 30000);
+}
+
+void IOT_MetricsTester::testHistogram()
+{
+    const double bounds[] = { 1.0, 10.0 };
+    IOT_Metrics::Histogram hist(bounds, 2);
+
+    hist.Record(0.5);
+    hist.Record(5.0);
+    hist.Record(5.0);
+    hist.Record(100.0);
+
+    CPPUNIT_ASSERT(hist.GetBounds() == 2);
+    CPPUNIT_ASSERT(hist.GetBucketCount(0) == 1);
+    CPPUNIT_ASSERT(hist.GetBucketCount(1) == 2);
+    CPPUNIT_ASSERT(hist.GetBucketCount(2) == 1);
+    CPPUNIT_ASSERT(hist.GetCount() == 4);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(110.5, hist.GetSum(), 0.0001);
+}
+
+void IOT_MetricsTester::testPrometheusText()
+{
+    IOT_Metrics metrics;
+    IOT_RequestTiming timing;
+    timing.totalMs = 30.0;
+    timing.bytesUp = 120;
+
+    metrics.RecordRequest(IOTAPI::IOT_EP_WRITE, IOTAPI::IOT_ERR_OK, timing);
+    metrics.RecordRequest(IOTAPI::IOT_EP_WRITE, IOTAPI::IOT_ERR_QUOTA, timing);
+    metrics.RecordWriteBatch(10, 8);
+
+    std::string text;
+    metrics.ToPrometheus(text);
+
+    CPPUNIT_ASSERT(text.find("iot_samples_sent_total 8\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_samples_rejected_total 2\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_bytes_sent_total 240\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_requests_total{endpoint=\"write\",result=\"ok\"} 1\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_requests_total{endpoint=\"write\",result=\"quota\"} 1\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_request_duration_seconds_bucket{endpoint=\"write\",le=\"0.05\"} 2\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_request_duration_seconds_count{endpoint=\"write\"} 2\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("# TYPE iot_write_batch_samples histogram\n") != std::string::npos);
+
+    metrics.RecordRequest(IOTAPI::IOT_EP_WRITE, IOTAPI::IOT_ERR_THROTTLED, timing);
+    metrics.throttlePauseMicros.Add(1500000);
+    metrics.ToPrometheus(text);
+    CPPUNIT_ASSERT(text.find("iot_requests_total{endpoint=\"write\",result=\"throttled\"} 1\n") != std::string::npos);
+    CPPUNIT_ASSERT(text.find("iot_throttle_pause_seconds_total 1.5\n") != std::string::npos);
+}
+
+void IOT_MetricsTester::testExportToFile()
+{
+    IOT_Metrics metrics;
+    metrics.RecordWriteBatch(3, 3);
+
+    std::stringstream path;
+    path << "/tmp/iot-metrics-test-" << getpid() << ".prom";
+
+    CPPUNIT_ASSERT(metrics.ExportToFile(path.str()) == IOTAPI::IOT_ERR_OK);
+
+    std::ifstream file(path.str().c_str());
+    std::stringstream content;
+    content << file.rdbuf();
+    CPPUNIT_ASSERT(content.str().find("iot_samples_sent_total 3\n") != std::string::npos);
+
+    unlink(path.str().c_str());
+    CPPUNIT_ASSERT(metrics.ExportToFile("") == IOTAPI::IOT_ERR_PARAM);
+}
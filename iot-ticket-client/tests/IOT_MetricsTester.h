@@ -0,0 +1,24 @@
+
+
+#ifndef IOT_METRICSTESTER_H
+#define IOT_METRICSTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_MetricsTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_MetricsTester );
+    CPPUNIT_TEST( testCounterThreads );
+    CPPUNIT_TEST( testHistogram );
+    CPPUNIT_TEST( testPrometheusText );
+    CPPUNIT_TEST( testExportToFile );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testCounterThreads();
+    void testHistogram();
+    void testPrometheusText();
+    void testExportToFile();
+};
+
+#endif // IOT_METRICSTESTER_H
@@ -0,0 +1,121 @@
+
+
+#include "IOT_NumberParseTester.h"
+#include "IOT_NumberParse.h"
+#include "IOT_DoubleFormat.h"
+#include "IOT_ReadData.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_NumberParseTester );
+
+
+static bool ParseDouble(const char* str, double& value)
+{
+    const char* last = str + strlen(str);
+    return IOT_NumberParse::ParseDouble(str, last, value) == last;
+}
+
+void IOT_NumberParseTester::testIntegers()
+{
+    const char* str = "-9223372036854775808";
+    int64_t value = 0;
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseInt64(str, str + strlen(str), value) == str + strlen(str));
+    CPPUNIT_ASSERT(value == INT64_MIN);
+
+    str = "9223372036854775808";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseInt64(str, str + strlen(str), value) == NULL);
+
+    uint64_t uvalue = 0;
+    str = "18446744073709551615";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseUInt64(str, str + strlen(str), uvalue) != NULL);
+    CPPUNIT_ASSERT(uvalue == UINT64_MAX);
+
+    // Parsing stops at the first character that is not part of the number
+    str = "42.5";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseInt64(str, str + strlen(str), value) == str + 2);
+    CPPUNIT_ASSERT(value == 42);
+
+    str = "abc";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseInt64(str, str + strlen(str), value) == NULL);
+    str = "-";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseInt64(str, str + strlen(str), value) == NULL);
+}
+
+void IOT_NumberParseTester::testDoubles()
+{
+    double value = 0.0;
+    CPPUNIT_ASSERT(ParseDouble("12.5", value) && value == 12.5);
+    CPPUNIT_ASSERT(ParseDouble("-1.5E+3", value) && value == -1500.0);
+    CPPUNIT_ASSERT(ParseDouble("0.1", value) && value == 0.1);
+    CPPUNIT_ASSERT(ParseDouble("-0", value) && value == 0.0 && signbit(value));
+    CPPUNIT_ASSERT(ParseDouble("1e23", value) && value == 1e23);
+    CPPUNIT_ASSERT(ParseDouble("9007199254740993", value) && value == 9007199254740992.0);
+    CPPUNIT_ASSERT(ParseDouble("2.2250738585072011e-308", value) && value == strtod("2.2250738585072011e-308", NULL));
+    CPPUNIT_ASSERT(ParseDouble("123456789012345678901234567890", value) && value == 123456789012345678901234567890.0);
+
+    const char* str = "1e";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseDouble(str, str + 2, value) == str + 1);
+    str = ".";
+    CPPUNIT_ASSERT(IOT_NumberParse::ParseDouble(str, str + 1, value) == NULL);
+}
+
+void IOT_NumberParseTester::testRoundTrip()
+{
+    char buffer[IOT_DoubleFormat::BUFFER_SIZE];
+    srand(11);
+
+    for(int i = 0; i < 100000; ++i) {
+        uint64_t bits = (static_cast<uint64_t>(rand()) << 42) ^ (static_cast<uint64_t>(rand()) << 21) ^ rand();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if(i % 2) {
+            value = (rand() % 10000000) / 1000.0;
+        }
+        if(!isfinite(value)) {
+            continue;
+        }
+
+        IOT_DoubleFormat::Format(value, buffer);
+        double parsed = 0.0;
+        CPPUNIT_ASSERT(ParseDouble(buffer, parsed));
+        CPPUNIT_ASSERT(memcmp(&parsed, &value, sizeof(value)) == 0);
+    }
+}
+
+void IOT_NumberParseTester::testJsonReader()
+{
+    Json::Reader reader;
+    Json::Value value;
+
+    CPPUNIT_ASSERT(reader.parse("[0.1, -1.5e3, 42, 1e400]", value));
+    CPPUNIT_ASSERT(value[0].asDouble() == 0.1);
+    CPPUNIT_ASSERT(value[1].asDouble() == -1500.0);
+    CPPUNIT_ASSERT(value[2].isIntegral());
+    CPPUNIT_ASSERT(isinf(value[3].asDouble()));
+
+    CPPUNIT_ASSERT(!reader.parse("[1.2.3]", value));
+}
+
+void IOT_NumberParseTester::testReadData()
+{
+    Json::Reader reader;
+    Json::Value json;
+    CPPUNIT_ASSERT(reader.parse("{\"name\":\"Temperature\",\"dataType\":\"double\",\"values\":["
+                                "{\"ts\":1,\"v\":\"21.5\"},{\"ts\":2,\"v\":\"-0.125\"},{\"ts\":3,\"v\":\"1e3\"}]}", json));
+
+    IOT_ReadData data;
+    CPPUNIT_ASSERT(data.FromJSON(json));
+
+    double value = 0.0;
+    CPPUNIT_ASSERT(data.GetConvertedValue(1, value) && value == -0.125);
+
+    std::vector<double> values;
+    CPPUNIT_ASSERT(data.GetConvertedValues(values));
+    CPPUNIT_ASSERT(values.size() == 3 && values[0] == 21.5 && values[2] == 1000.0);
+
+    std::vector<long> longs;
+    CPPUNIT_ASSERT(!data.GetConvertedValues(longs));
+}
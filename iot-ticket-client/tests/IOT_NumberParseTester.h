@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_NUMBERPARSETESTER_H
+#define IOT_NUMBERPARSETESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_NumberParseTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_NumberParseTester );
+    CPPUNIT_TEST( testIntegers );
+    CPPUNIT_TEST( testDoubles );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testJsonReader );
+    CPPUNIT_TEST( testReadData );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testIntegers();
+    void testDoubles();
+    void testRoundTrip();
+    void testJsonReader();
+    void testReadData();
+};
+
+#endif // IOT_NUMBERPARSETESTER_H
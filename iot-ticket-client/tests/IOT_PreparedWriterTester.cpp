@@ -0,0 +1,100 @@
+
+
+#include "IOT_PreparedWriterTester.h"
+#include "IOT_PreparedWriter.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_PreparedWriterTester );
+
+//! Nothing listens on the discard port, so requests fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+static IOT_WriteData MakeSample(double value)
+{
+    IOT_WriteData sample;
+    sample.SetName("value");
+    sample.SetValue(value);
+    return sample;
+}
+
+
+void IOT_PreparedWriterTester::testInvalid()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_PreparedWriter noDevice(api, "");
+    CPPUNIT_ASSERT(noDevice.GetStatus() == IOTAPI::IOT_ERR_PARAM);
+    CPPUNIT_ASSERT(noDevice.Send(MakeSample(1.0)) == IOTAPI::IOT_ERR_PARAM);
+
+    IOT_PreparedWriter writer(api, "device");
+    CPPUNIT_ASSERT(writer.GetStatus() == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(writer.GetDeviceId() == "device");
+
+    IOT_WriteResult result;
+    std::vector<IOT_WriteData> empty;
+    CPPUNIT_ASSERT(writer.Send(empty, result) == IOTAPI::IOT_ERR_PARAM);
+    CPPUNIT_ASSERT(result.GetStatus() == IOTAPI::IOT_ERR_PARAM);
+}
+
+void IOT_PreparedWriterTester::testFailedSend()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 2);
+    api.ResetRequestStats();
+    IOT_PreparedWriter writer(api, "device");
+
+    std::vector<IOT_WriteData> data;
+    data.push_back(MakeSample(1.0));
+    data.push_back(MakeSample(2.0));
+
+    // Connect failures are retried, each attempt recorded like IOT_API::SendData() does
+    IOT_WriteResult result;
+    CPPUNIT_ASSERT(writer.Send(data, result) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetStatus() == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetSubmitted() == 2);
+    CPPUNIT_ASSERT(result.GetAccepted() == 0);
+    CPPUNIT_ASSERT(result.GetChunks() == 1);
+    CPPUNIT_ASSERT(result.GetFailedChunks() == 1);
+    CPPUNIT_ASSERT(!result.IsAccepted(0) && !result.IsAccepted(1));
+
+    IOT_EndpointStats stats;
+    CPPUNIT_ASSERT(api.GetRequestStats(IOTAPI::IOT_EP_WRITE, stats) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(stats.GetRequests() == 3);
+    CPPUNIT_ASSERT(stats.GetFailedRequests() == 3);
+
+    // The same payload goes out as from IOT_API::SendData()
+    IOT_WriteResult apiResult;
+    CPPUNIT_ASSERT(api.SendData("device", data, apiResult) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetPayloadBytes() == apiResult.GetPayloadBytes());
+}
+
+void IOT_PreparedWriterTester::testThrottled()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 1);
+    IOT_PreparedWriter writer(api, "device");
+
+    // Paused device fails without a request
+    api.GetRateLimiter().OnReply("device", 429, 60);
+    IOT_WriteResult result;
+    std::vector<IOT_WriteData> data(1, MakeSample(1.0));
+    CPPUNIT_ASSERT(writer.Send(data, result) == IOTAPI::IOT_ERR_THROTTLED);
+    CPPUNIT_ASSERT(result.GetPayloadBytes() == 0);
+    CPPUNIT_ASSERT(result.GetFailedChunks() == 1);
+}
+
+void IOT_PreparedWriterTester::testLargeWrite()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(2, 0);
+    CPPUNIT_ASSERT(api.SetWriteChunkLimits(2, 1000));
+    IOT_PreparedWriter writer(api, "device");
+
+    // Writes over the chunk limits are split by the API
+    std::vector<IOT_WriteData> data;
+    for(size_t i = 0; i < 5; ++i) {
+        data.push_back(MakeSample(static_cast<double>(i)));
+    }
+    IOT_WriteResult result;
+    CPPUNIT_ASSERT(writer.Send(data, result) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetChunks() == 3);
+    CPPUNIT_ASSERT(result.GetFailedChunks() == 3);
+}
@@ -0,0 +1,24 @@
+
+
+#ifndef IOT_PREPAREDWRITERTESTER_H
+#define IOT_PREPAREDWRITERTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_PreparedWriterTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_PreparedWriterTester );
+    CPPUNIT_TEST( testInvalid );
+    CPPUNIT_TEST( testFailedSend );
+    CPPUNIT_TEST( testThrottled );
+    CPPUNIT_TEST( testLargeWrite );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testInvalid();
+    void testFailedSend();
+    void testThrottled();
+    void testLargeWrite();
+};
+
+#endif // IOT_PREPAREDWRITERTESTER_H
@@ -0,0 +1,195 @@
+
+
+#include "IOT_QuotaGovernorTester.h"
+#include "IOT_QuotaGovernor.h"
+#include "IOT_TestServer.h"
+#include <sstream>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_QuotaGovernorTester );
+
+
+static IOT_Quota Quota(uint64_t used, uint64_t max)
+{
+    std::stringstream json;
+    json << "{\"totalDevices\":1,\"maxNumberOfDevices\":10,\"maxDataNodePerDevice\":100,"
+         << "\"usedStorageSize\":" << used << ",\"maxStorageSize\":" << max << "}";
+
+    IOT_Quota quota;
+    quota.FromJSON(json.str());
+    return quota;
+}
+
+static IOT_QuotaDevice DeviceQuota(uint64_t storage)
+{
+    std::stringstream json;
+    json << "{\"totalRequestToday\":0,\"maxReadRequestPerDay\":1000,\"numberOfDataNodes\":3,"
+         << "\"storageSize\":" << storage << "}";
+
+    IOT_QuotaDevice quota;
+    quota.FromJSON(json.str());
+    return quota;
+}
+
+static IOT_WriteData Sample(const std::string& name)
+{
+    IOT_WriteData data;
+    data.SetName(name);
+    data.SetValue(1.0);
+    return data;
+}
+
+void IOT_QuotaGovernorTester::testLevels()
+{
+    IOT_API api("http://127.0.0.1:1/", "user", "pw");
+    IOT_QuotaGovernor governor(api);
+    CPPUNIT_ASSERT(governor.SetThresholds(50.0, 90.0));
+    CPPUNIT_ASSERT(!governor.SetThresholds(90.0, 50.0));
+
+    // Nothing known, nothing throttled
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_NORMAL);
+
+    governor.OnQuota(Quota(100, 1000));
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_NORMAL);
+    governor.OnQuota(Quota(600, 1000));
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_THROTTLE);
+    governor.OnQuota(Quota(950, 1000));
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_CRITICAL);
+    CPPUNIT_ASSERT(governor.GetState().refreshes == 3);
+}
+
+void IOT_QuotaGovernorTester::testEstimate()
+{
+    IOT_API api("http://127.0.0.1:1/", "user", "pw");
+    IOT_QuotaGovernor governor(api);
+    CPPUNIT_ASSERT(governor.SetThresholds(50.0, 90.0));
+
+    governor.OnQuota(Quota(1000, 100000));
+
+    // Before calibration the payload size is used as the estimate
+    governor.OnWrite(100, 5000, IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(governor.GetState().estimatedStorage == 6000);
+
+    // Server grew 2000 bytes for the 100 samples written
+    governor.OnQuota(Quota(3000, 100000));
+    CPPUNIT_ASSERT(governor.GetState().bytesPerSample == 20.0);
+    CPPUNIT_ASSERT(governor.GetState().samplesSinceRefresh == 0);
+
+    // Local writes alone push the estimate over the threshold without a refresh
+    governor.OnWrite(2500, 125000, IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(governor.GetState().estimatedStorage == 53000);
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_THROTTLE);
+    CPPUNIT_ASSERT(governor.GetState().growthBytesPerSec > 0.0);
+    CPPUNIT_ASSERT(governor.GetState().secondsToExhaustion > 0.0);
+}
+
+void IOT_QuotaGovernorTester::testPriorities()
+{
+    IOT_API api("http://127.0.0.1:1/", "user", "pw");
+    IOT_QuotaGovernor governor(api);
+    CPPUNIT_ASSERT(governor.SetThresholds(50.0, 90.0));
+    CPPUNIT_ASSERT(governor.SetDownsampleFactor(4));
+    governor.SetPriority("", "Debug", IOT_QuotaGovernor::PRIORITY_LOW);
+    governor.SetPriority("", "Alarm", IOT_QuotaGovernor::PRIORITY_HIGH);
+
+    std::vector<IOT_WriteData> data;
+    for(int i = 0; i < 8; ++i) {
+        data.push_back(Sample("Debug"));
+        data.push_back(Sample("Temperature"));
+        data.push_back(Sample("Alarm"));
+    }
+
+    std::vector<IOT_WriteData> filtered = data;
+    governor.OnQuota(Quota(100, 1000));
+    CPPUNIT_ASSERT(governor.Filter(filtered) == 0);
+
+    // Throttle: low priority downsampled
+    filtered = data;
+    governor.OnQuota(Quota(600, 1000));
+    CPPUNIT_ASSERT(governor.Filter(filtered) == 6);
+
+    // Critical: low priority dropped, normal downsampled
+    filtered = data;
+    governor.OnQuota(Quota(950, 1000));
+    CPPUNIT_ASSERT(governor.Filter(filtered) == 8 + 6);
+    CPPUNIT_ASSERT(governor.Admit(Sample("Alarm")));
+    CPPUNIT_ASSERT(!governor.Admit(Sample("Debug")));
+    CPPUNIT_ASSERT(governor.GetState().dropped == 6 + 14 + 1);
+}
+
+void IOT_QuotaGovernorTester::testExhausted()
+{
+    IOT_API api("http://127.0.0.1:1/", "user", "pw");
+    IOT_QuotaGovernor governor(api);
+    governor.OnQuota(Quota(100, 1000));
+
+    governor.OnWrite(0, 0, IOTAPI::IOT_ERR_QUOTA);
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_EXHAUSTED);
+    CPPUNIT_ASSERT(!governor.Admit(Sample("Temperature")));
+
+    // Still full according to the server
+    governor.OnQuota(Quota(1000, 1000));
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_EXHAUSTED);
+
+    governor.OnQuota(Quota(200, 1000));
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_NORMAL);
+    CPPUNIT_ASSERT(governor.Admit(Sample("Temperature")));
+}
+
+void IOT_QuotaGovernorTester::testDevices()
+{
+    IOT_API api("http://127.0.0.1:1/", "user", "pw");
+    IOT_QuotaGovernor governor(api);
+    CPPUNIT_ASSERT(governor.SetThresholds(50.0, 90.0));
+    governor.SetPriority("", "Debug", IOT_QuotaGovernor::PRIORITY_LOW);
+
+    governor.AddDevice("noisy");
+    governor.SetDeviceBudget("noisy", 1000);
+    governor.AddDevice("noisy");
+    governor.AddDevice("quiet");
+    governor.OnQuota(Quota(100, 100000));
+
+    // Device over its budget is filtered while the account is fine
+    governor.OnDeviceQuota("noisy", DeviceQuota(950));
+    governor.OnDeviceQuota("quiet", DeviceQuota(950));
+    governor.OnDeviceQuota("unknown", DeviceQuota(950));
+    CPPUNIT_ASSERT(governor.GetLevel() == IOT_QuotaGovernor::LEVEL_NORMAL);
+    CPPUNIT_ASSERT(governor.GetLevel("noisy") == IOT_QuotaGovernor::LEVEL_CRITICAL);
+    CPPUNIT_ASSERT(governor.GetLevel("quiet") == IOT_QuotaGovernor::LEVEL_NORMAL);
+    CPPUNIT_ASSERT(!governor.Admit("noisy", Sample("Debug")));
+    CPPUNIT_ASSERT(governor.Admit("quiet", Sample("Debug")));
+    CPPUNIT_ASSERT(governor.Admit(Sample("Debug")));
+
+    IOT_QuotaGovernor::DeviceState state;
+    CPPUNIT_ASSERT(!governor.GetDeviceState("unknown", state));
+    CPPUNIT_ASSERT(governor.GetDeviceState("noisy", state));
+    CPPUNIT_ASSERT(state.quotaKnown && state.usedStorage == 950 && state.maxStorage == 1000 && state.dataNodes == 3);
+
+    // Writes of a device count in its estimate and in the account
+    governor.OnDeviceQuota("noisy", DeviceQuota(100));
+    CPPUNIT_ASSERT(governor.GetLevel("noisy") == IOT_QuotaGovernor::LEVEL_NORMAL);
+    governor.OnWrite("noisy", 10, 500, IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(governor.GetDeviceState("noisy", state) && state.estimatedStorage == 600);
+    CPPUNIT_ASSERT(governor.GetLevel("noisy") == IOT_QuotaGovernor::LEVEL_THROTTLE);
+    CPPUNIT_ASSERT(governor.GetState().estimatedStorage == 600);
+
+    // Account level applies to every device
+    governor.OnQuota(Quota(99000, 100000));
+    CPPUNIT_ASSERT(governor.GetLevel("quiet") == IOT_QuotaGovernor::LEVEL_CRITICAL);
+
+    // Refresh queries the account and each added device
+    IOT_TestServer server([](const std::string&) {
+        IOT_TestServer::Reply r = { 200, "{\"totalDevices\":2,\"maxNumberOfDevices\":10,\"maxDataNodePerDevice\":100,"
+                                         "\"usedStorageSize\":100,\"maxStorageSize\":100000,\"storageSize\":980,"
+                                         "\"numberOfDataNodes\":5}" };
+        return r;
+    });
+    IOT_API serverApi(server.GetUrl(), "user", "pw", 5);
+    IOT_QuotaGovernor refreshed(serverApi);
+    refreshed.SetDeviceBudget("noisy", 1000);
+    CPPUNIT_ASSERT(refreshed.Refresh() == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(server.GetRequests() == 2);
+    CPPUNIT_ASSERT(refreshed.GetLevel() == IOT_QuotaGovernor::LEVEL_NORMAL);
+    CPPUNIT_ASSERT(refreshed.GetLevel("noisy") == IOT_QuotaGovernor::LEVEL_CRITICAL);
+    CPPUNIT_ASSERT(refreshed.GetDeviceState("noisy", state) && state.dataNodes == 5);
+}
@@ -0,0 +1,26 @@
+
+
+#ifndef IOT_QUOTAGOVERNORTESTER_H
+#define IOT_QUOTAGOVERNORTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_QuotaGovernorTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_QuotaGovernorTester );
+    CPPUNIT_TEST( testLevels );
+    CPPUNIT_TEST( testEstimate );
+    CPPUNIT_TEST( testPriorities );
+    CPPUNIT_TEST( testExhausted );
+    CPPUNIT_TEST( testDevices );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testLevels();
+    void testEstimate();
+    void testPriorities();
+    void testExhausted();
+    void testDevices();
+};
+
+#endif // IOT_QUOTAGOVERNORTESTER_H
@@ -0,0 +1,164 @@
+
+
+#include "IOT_RateLimiterTester.h"
+#include "IOT_RateLimiter.h"
+#include "IOT_API.h"
+#include <thread>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_RateLimiterTester );
+
+//! Nothing listens on the discard port, so requests fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+
+void IOT_RateLimiterTester::testRates()
+{
+    IOT_RateLimiter limiter;
+    CPPUNIT_ASSERT(!limiter.SetAccountRate(-1.0, 1.0));
+    CPPUNIT_ASSERT(!limiter.SetDeviceRate(10.0, 0.5));
+    CPPUNIT_ASSERT(!limiter.SetDeviceRate("", 10.0, 1.0));
+
+    // No limits by default
+    for(size_t i = 0; i < 100; ++i) {
+        CPPUNIT_ASSERT(limiter.TryAcquire("device") == 0);
+    }
+
+    // Burst goes out at once, the next request waits for the refill
+    CPPUNIT_ASSERT(limiter.SetDeviceRate(10.0, 3.0));
+    for(size_t i = 0; i < 3; ++i) {
+        CPPUNIT_ASSERT(limiter.TryAcquire("device") == 0);
+    }
+    long wait = limiter.TryAcquire("device");
+    CPPUNIT_ASSERT(wait > 0 && wait <= 100);
+    CPPUNIT_ASSERT(limiter.GetDelayMs("device") > 0);
+
+    // Other devices and account requests have their own lanes
+    CPPUNIT_ASSERT(limiter.TryAcquire("other") == 0);
+    CPPUNIT_ASSERT(limiter.TryAcquire("") == 0);
+
+    // Device with a rate of its own keeps it when the default changes
+    CPPUNIT_ASSERT(limiter.SetDeviceRate("fast", 0.0, 1.0));
+    for(size_t i = 0; i < 10; ++i) {
+        CPPUNIT_ASSERT(limiter.TryAcquire("fast") == 0);
+    }
+
+    // Account bucket is shared by all
+    CPPUNIT_ASSERT(limiter.SetAccountRate(1.0, 2.0));
+    CPPUNIT_ASSERT(limiter.TryAcquire("fast") == 0);
+    CPPUNIT_ASSERT(limiter.TryAcquire("") == 0);
+    CPPUNIT_ASSERT(limiter.TryAcquire("fast") > 0);
+
+    // Blocking acquire fails at once if it would wait too long
+    CPPUNIT_ASSERT(!limiter.Acquire("fast", 10));
+    CPPUNIT_ASSERT(limiter.SetAccountRate(100.0, 1.0));
+    CPPUNIT_ASSERT(limiter.TryAcquire("fast") == 0);
+    CPPUNIT_ASSERT(limiter.Acquire("fast", 1000));
+
+    IOT_RateLimiter::Stats stats = limiter.GetStats();
+    CPPUNIT_ASSERT(stats.refused == 1);
+    CPPUNIT_ASSERT(stats.delayed == 1);
+    CPPUNIT_ASSERT(stats.waitedMs > 0.0);
+}
+
+void IOT_RateLimiterTester::testPause()
+{
+    IOT_RateLimiter limiter;
+
+    // 429 to a device request pauses the device for Retry-After
+    limiter.OnReply("device", 429, 30);
+    long delay = limiter.GetDelayMs("device");
+    CPPUNIT_ASSERT(delay > 29000 && delay <= 30000);
+    CPPUNIT_ASSERT(limiter.TryAcquire("device") > 29000);
+    CPPUNIT_ASSERT(limiter.TryAcquire("other") == 0);
+    CPPUNIT_ASSERT(limiter.TryAcquire("") == 0);
+
+    // Paused lane is not waited for longer than the caller can
+    CPPUNIT_ASSERT(!limiter.Acquire("device", 1000));
+
+    // 503 pauses everything, a shorter pause does not end a longer one
+    limiter.OnReply("other", 503, 5);
+    CPPUNIT_ASSERT(limiter.GetDelayMs("") > 4000);
+    CPPUNIT_ASSERT(limiter.GetDelayMs("other") > 4000);
+    CPPUNIT_ASSERT(limiter.GetDelayMs("device") > 29000);
+
+    // Retry-After is capped by the max pause
+    IOT_RateLimiter capped;
+    CPPUNIT_ASSERT(!capped.SetPause(0, 100));
+    CPPUNIT_ASSERT(!capped.SetPause(200, 100));
+    CPPUNIT_ASSERT(capped.SetPause(50, 100));
+    capped.OnReply("", 429, 3600);
+    CPPUNIT_ASSERT(capped.GetDelayMs("device") <= 100);
+    CPPUNIT_ASSERT(capped.Acquire("device", 1000));
+
+    IOT_RateLimiter::Stats stats = limiter.GetStats();
+    CPPUNIT_ASSERT(stats.throttled == 2);
+    CPPUNIT_ASSERT(stats.refused == 1);
+    CPPUNIT_ASSERT(stats.pausedMs > 34000.0 && stats.pausedMs <= 35000.0);
+}
+
+void IOT_RateLimiterTester::testBackoff()
+{
+    IOT_RateLimiter limiter;
+    CPPUNIT_ASSERT(limiter.SetPause(1000, 3000));
+
+    // Without Retry-After the pause doubles up to the max
+    limiter.OnReply("device", 429, 0);
+    CPPUNIT_ASSERT(limiter.GetDelayMs("device") <= 1000);
+    limiter.OnReply("device", 429, 0);
+    CPPUNIT_ASSERT(limiter.GetDelayMs("device") > 1000);
+    limiter.OnReply("device", 429, 0);
+    limiter.OnReply("device", 429, 0);
+    long delay = limiter.GetDelayMs("device");
+    CPPUNIT_ASSERT(delay > 2000 && delay <= 3000);
+
+    // Success starts over from the initial pause
+    IOT_RateLimiter quick;
+    CPPUNIT_ASSERT(quick.SetPause(20, 1000));
+    quick.OnReply("device", 429, 0);
+    quick.OnReply("device", 429, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CPPUNIT_ASSERT(quick.GetDelayMs("device") == 0);
+    quick.OnReply("device", 200, 0);
+    quick.OnReply("device", 429, 0);
+    CPPUNIT_ASSERT(quick.GetDelayMs("device") <= 20);
+}
+
+void IOT_RateLimiterTester::testApi()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 1);
+    std::vector<IOT_WriteData> data(1);
+    data[0].SetName("value");
+    data[0].SetValue(1.0);
+
+    // Paused device fails without a request, other devices still try
+    api.GetRateLimiter().OnReply("device", 429, 60);
+    CPPUNIT_ASSERT(api.GetThrottleDelayMs("device") > 59000);
+    IOT_WriteResult result;
+    CPPUNIT_ASSERT(api.SendData("device", data, result) == IOTAPI::IOT_ERR_THROTTLED);
+    CPPUNIT_ASSERT(result.GetPayloadBytes() == 0);
+    CPPUNIT_ASSERT(api.SendData("other", data) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(IOT_API::IsRetryableError(IOTAPI::IOT_ERR_THROTTLED));
+
+    // Shared limiter pauses the account for all instances using it
+    IOT_RateLimiter shared;
+    IOT_API second(CLOSED_URL, "user", "pass", 1);
+    api.SetRateLimiter(&shared);
+    second.SetRateLimiter(&shared);
+    CPPUNIT_ASSERT(api.GetThrottleDelayMs("device") == 0);
+    shared.OnReply("", 503, 60);
+    std::vector<IOT_GetDevice> devices;
+    CPPUNIT_ASSERT(second.GetDevices(devices) == IOTAPI::IOT_ERR_THROTTLED);
+    CPPUNIT_ASSERT(api.SendData("other", data) == IOTAPI::IOT_ERR_THROTTLED);
+
+    IOT_AsyncTransport transport(1);
+    IOTAPI::IOTAPI_err asyncRet = IOTAPI::IOT_ERR_OK;
+    second.SendDataAsync(transport, "other", data, result, [&asyncRet](IOTAPI::IOTAPI_err ret) { asyncRet = ret; });
+    CPPUNIT_ASSERT(asyncRet == IOTAPI::IOT_ERR_THROTTLED);
+    CPPUNIT_ASSERT(transport.GetPending() == 0);
+
+    // Back to the own limiter
+    api.SetRateLimiter(NULL);
+    CPPUNIT_ASSERT(api.GetThrottleDelayMs("other") == 0);
+    CPPUNIT_ASSERT(&api.GetRateLimiter() != &shared);
+}
@@ -0,0 +1,24 @@
+
+
+#ifndef IOT_RATELIMITERTESTER_H
+#define IOT_RATELIMITERTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_RateLimiterTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_RateLimiterTester );
+    CPPUNIT_TEST( testRates );
+    CPPUNIT_TEST( testPause );
+    CPPUNIT_TEST( testBackoff );
+    CPPUNIT_TEST( testApi );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testRates();
+    void testPause();
+    void testBackoff();
+    void testApi();
+};
+
+#endif // IOT_RATELIMITERTESTER_H
@@ -0,0 +1,172 @@
+
+
+#include "IOT_ResponseDecoderTester.h"
+#include "IOT_ResponseDecoder.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_ResponseDecoderTester );
+
+typedef IOT_JsonPullParser Parser;
+
+static bool IsValidJson(const char* json)
+{
+    return Parser(json).SkipToEnd();
+}
+
+static const char* DEVICE =
+    "{\"deviceId\":\"0123456789abcdef0123456789abcdef\",\"href\":\"https://host/devices/1\","
+    "\"createdAt\":\"2015-01-01T00:00:00Z\",\"name\":\"Engine\",\"manufacturer\":\"Wapice\","
+    "\"type\":\"PLC\",\"attributes\":[{\"key\":\"color\",\"value\":\"red\"},{\"key\":\"x\"}]}";
+
+void IOT_ResponseDecoderTester::testPullParser()
+{
+    std::string json = " {\"a\\\"b\": [1, -2.5e3, \"x\\u00e4\\ud83d\\ude00\\n\", true, false, null, {}], \"c\":{\"d\":[]}} ";
+    Parser parser(json);
+
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_OBJECT_BEGIN);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_KEY && parser.GetString() == "a\"b");
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_ARRAY_BEGIN);
+    CPPUNIT_ASSERT(parser.GetDepth() == 2);
+
+    int64_t integer = 0;
+    double real = 0.0;
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_NUMBER && parser.GetInt64(integer) && integer == 1);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_NUMBER && !parser.IsInteger());
+    CPPUNIT_ASSERT(!parser.GetInt64(integer) && parser.GetDouble(real) && real == -2500.0);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_STRING && parser.GetString() == "x\xc3\xa4\xf0\x9f\x98\x80\n");
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_TRUE);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_FALSE);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_NULL);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_OBJECT_BEGIN);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_OBJECT_END);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_ARRAY_END);
+
+    // Skipping a member skips its whole value
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_KEY && parser.IsKey("c"));
+    CPPUNIT_ASSERT(parser.SkipValue());
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_OBJECT_END);
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_END);
+    CPPUNIT_ASSERT(parser.GetDepth() == 0);
+}
+
+void IOT_ResponseDecoderTester::testPullParserErrors()
+{
+    CPPUNIT_ASSERT(IsValidJson("[1,2,{\"a\":\"b\"}]"));
+    CPPUNIT_ASSERT(IsValidJson("-0.5e-3"));
+
+    const char* invalid[] = {
+        "", "[1,]", "{\"a\":1,}", "{\"a\" 1}", "[1 2]", "{\"a\":1]", "[\"abc]", "01", "1.", "-", ".5",
+        "tru", "[1]]", "{} {}", "\"\\x\"", "\"\\ud83d\"", "[\"\\u12\"]", "{1:2}"
+    };
+    for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        CPPUNIT_ASSERT_MESSAGE(invalid[i], !IsValidJson(invalid[i]));
+    }
+
+    // Errors are sticky
+    Parser parser("[1,]");
+    parser.SkipToEnd();
+    CPPUNIT_ASSERT(parser.Next() == Parser::TOKEN_ERROR);
+}
+
+void IOT_ResponseDecoderTester::testDevices()
+{
+    std::string devices = std::string("{\"offset\":0,\"items\":[") + DEVICE + ",{\"name\":\"incomplete\"},7," + DEVICE + "]}";
+
+    std::vector<IOT_GetDevice> result;
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDevices(devices, result) == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(result.size() == 2);
+    CPPUNIT_ASSERT(result[1].GetDeviceID() == "0123456789abcdef0123456789abcdef");
+    CPPUNIT_ASSERT(result[1].GetName() == "Engine" && result[1].GetType() == "PLC");
+    CPPUNIT_ASSERT(result[1].GetAttribute("color") == "red");
+
+    // Same result as the document tree based FromJSON()
+    Json::Value tree;
+    IOT_GetDevice expected;
+    CPPUNIT_ASSERT(Json::Reader().parse(DEVICE, tree) && expected.FromJSON(tree));
+    std::string expectedJson, decodedJson;
+    CPPUNIT_ASSERT(expected.ToJSON(expectedJson) && result[0].ToJSON(decodedJson));
+    CPPUNIT_ASSERT(expectedJson == decodedJson);
+
+    result.clear();
+    devices.erase(devices.size() - 2);
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDevices(devices, result) == IOT_ResponseDecoder::DECODE_MALFORMED);
+    CPPUNIT_ASSERT(result.empty());
+
+    IOT_GetDevice device;
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDevice("{\"name\":\"incomplete\"}", device) == IOT_ResponseDecoder::DECODE_INVALID);
+    CPPUNIT_ASSERT(device.GetName().empty());
+    CPPUNIT_ASSERT(device.FromJSON(std::string(DEVICE)) && device.GetManufacturer() == "Wapice");
+
+    std::string devId;
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDeviceId("{\"href\":\"x\",\"deviceId\":\"abc\"}", devId) == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(devId == "abc");
+}
+
+void IOT_ResponseDecoderTester::testDatanodes()
+{
+    std::string reads = "{\"href\":\"x\",\"datanodeReads\":["
+        "{\"name\":\"Temp\",\"path\":\"a/b\",\"unit\":\"c\",\"dataType\":\"double\","
+        "\"values\":[{\"v\":\"21.5\",\"ts\":1000},{\"ts\":2000,\"v\":\"22\",\"extra\":[1]}]},"
+        "{\"name\":\"On\",\"dataType\":\"boolean\",\"values\":[{\"ts\":1,\"v\":true}]}]}";
+
+    std::vector<IOT_ReadData> data(1);
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDatanodes(reads, "datanodeReads", data) == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(data.size() == 3);
+    CPPUNIT_ASSERT(data[1].GetName() == "Temp" && data[1].GetPath() == "a/b" && data[1].GetUnit() == "c");
+    CPPUNIT_ASSERT(data[1].GetDatatype() == IOTAPI::IOT_double && data[1].ProcessValues() == 2);
+
+    unsigned long ts = 0;
+    double value = 0.0;
+    CPPUNIT_ASSERT(data[1].GetTimestamp(1, ts) && ts == 2000);
+    CPPUNIT_ASSERT(data[1].GetConvertedValue(0, value) && value == 21.5);
+
+    bool on = false;
+    CPPUNIT_ASSERT(data[2].GetConvertedValue(0, on) && on);
+
+    // Numeric values are not accepted as strings, like Json::Value::asString()
+    data.clear();
+    std::string invalid = "{\"datanodeReads\":[{\"name\":\"A\",\"values\":[]},{\"name\":\"B\",\"values\":[{\"ts\":1,\"v\":2}]},{\"name\":\"C\"}]}";
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDatanodes(invalid, "datanodeReads", data) == IOT_ResponseDecoder::DECODE_INVALID);
+    CPPUNIT_ASSERT(data.size() == 1 && data[0].GetName() == "A");
+
+    data.clear();
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeDatanodes("{\"items\":[{\"name\":\"A\",\"dataType\":\"long\"}]}", "items", data) == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(data.size() == 1 && data[0].GetDatatype() == IOTAPI::IOT_long);
+}
+
+void IOT_ResponseDecoderTester::testQuota()
+{
+    IOT_Quota quota;
+    CPPUNIT_ASSERT(quota.FromJSON(std::string("{\"totalDevices\":3,\"maxNumberOfDevices\":10,\"maxDataNodePerDevice\":100,"
+                                              "\"usedStorageSize\":5000000000,\"maxStorageSize\":9000000000.0}")));
+    CPPUNIT_ASSERT(quota.GetTotalDevices() == 3 && quota.GetMaxDevicesAllowed() == 10);
+    CPPUNIT_ASSERT(quota.GetUsedStorage() == 5000000000UL && quota.GetMaxStorage() == 9000000000UL);
+
+    CPPUNIT_ASSERT(!quota.FromJSON(std::string("{\"totalDevices\":\"3\"}")));
+    CPPUNIT_ASSERT(!quota.FromJSON(std::string("{\"totalDevices\":5000000000}")));
+    CPPUNIT_ASSERT(quota.GetTotalDevices() == 3);
+
+    IOT_QuotaDevice device;
+    CPPUNIT_ASSERT(device.FromJSON(std::string("{\"totalRequestToday\":5,\"maxReadRequestPerDay\":1000,"
+                                               "\"numberOfDataNodes\":2,\"storageSize\":1024,\"deviceId\":\"abc\"}")));
+    CPPUNIT_ASSERT(device.GetReadRequestsToday() == 5 && device.GetStorageSize() == 1024 && device.GetDeviceId() == "abc");
+
+    int code = 0;
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeErrorCode("{\"description\":\"x\",\"code\":8001}", code) == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(code == 8001);
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeErrorCode("<html>", code) == IOT_ResponseDecoder::DECODE_MALFORMED);
+}
+
+void IOT_ResponseDecoderTester::testWriteReply()
+{
+    IOT_ResponseDecoder::WriteReply reply;
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeWriteReply("{\"responses\":[{\"href\":\"h?datanodes=a\",\"written\":2},"
+                                                         "{\"href\":\"h?datanodes=b\"},3],\"totalWritten\":2}", reply)
+                   == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(reply.hasTotal && reply.totalWritten == 2);
+    CPPUNIT_ASSERT(reply.hasResponses && reply.written.size() == 1);
+    CPPUNIT_ASSERT(reply.written[0].first == "h?datanodes=a" && reply.written[0].second == 2);
+
+    CPPUNIT_ASSERT(IOT_ResponseDecoder::DecodeWriteReply("{\"totalWritten\":\"2\"}", reply) == IOT_ResponseDecoder::DECODE_OK);
+    CPPUNIT_ASSERT(!reply.hasTotal && !reply.hasResponses);
+}
@@ -0,0 +1,28 @@
+
+
+#ifndef IOT_RESPONSEDECODERTESTER_H
+#define IOT_RESPONSEDECODERTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_ResponseDecoderTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_ResponseDecoderTester );
+    CPPUNIT_TEST( testPullParser );
+    CPPUNIT_TEST( testPullParserErrors );
+    CPPUNIT_TEST( testDevices );
+    CPPUNIT_TEST( testDatanodes );
+    CPPUNIT_TEST( testQuota );
+    CPPUNIT_TEST( testWriteReply );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testPullParser();
+    void testPullParserErrors();
+    void testDevices();
+    void testDatanodes();
+    void testQuota();
+    void testWriteReply();
+};
+
+#endif // IOT_RESPONSEDECODERTESTER_H
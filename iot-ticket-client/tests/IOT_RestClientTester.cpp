@@ -38,6 +38,9 @@ static const std::string HTTP_AUTH_RET = "{\"authenticated\":true,\"user\":\"use
 static const std::string HTTP_POST_URL  = "https://httpbin.org/post";
 static const std::string HTTP_POST_DATA = "This is test POST data";
 
+// Nothing listens on port 1, so connecting fails at once
+static const std::string CLOSED_PORT_URL = "http://127.0.0.1:1/";
+
 
 void IOT_RestClientTester::testHttpGet()
 {
@@ -85,6 +88,27 @@ void IOT_RestClientTester::testHttpPost()
     CPPUNIT_ASSERT(response.find(HTTP_POST_DATA) != std::string::npos);
 }
 
+void IOT_RestClientTester::testPreparedPost()
+{
+    IOT_RestClient client;
+    std::string response;
+
+    CPPUNIT_ASSERT(client.PostPrepared(HTTP_POST_DATA, response) == IOTAPI::IOT_ERR_INITIALIZED);
+    CPPUNIT_ASSERT(client.PreparePost(HTTP_POST_URL, "user", "pass") == IOTAPI::IOT_ERR_OK);
+
+    for(size_t i = 0; i < 3; ++i) {
+        std::string data = HTTP_POST_DATA + " " + std::to_string(i);
+        CPPUNIT_ASSERT(client.PostPrepared(data, response) == IOTAPI::IOT_ERR_OK);
+        CPPUNIT_ASSERT(response.find(data) != std::string::npos);
+        CPPUNIT_ASSERT(response.find("Basic dXNlcjpwYXNz") != std::string::npos);
+    }
+
+    // Other requests do not change the prepared one
+    CPPUNIT_ASSERT(client.GetResource(HTTP_GET_URL, "", "", response) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(client.PostPrepared(HTTP_POST_DATA, response) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(response.find(HTTP_POST_DATA) != std::string::npos);
+}
+
 void IOT_RestClientTester::testMultiThread()
 {
     auto func = [](){
@@ -105,3 +129,17 @@ void IOT_RestClientTester::testMultiThread()
     t3.join();
 }
 
+
+void IOT_RestClientTester::testConnectFailTiming()
+{
+    IOT_RestClient client;
+    std::string response;
+
+    // A request that never got a connection is not counted as a reuse
+    for(size_t i = 0; i < 2; ++i) {
+        IOT_RequestTiming timing;
+        CPPUNIT_ASSERT(client.GetResource(CLOSED_PORT_URL, "", "", response, &timing) == IOTAPI::IOT_ERR_CONN);
+        CPPUNIT_ASSERT(timing.httpCode == 0);
+        CPPUNIT_ASSERT(!timing.connectionReused);
+    }
+}
@@ -34,7 +34,9 @@ class IOT_RestClientTester : public CppUnit::TestFixture
     CPPUNIT_TEST( testHttpBasicAuth );
     CPPUNIT_TEST( testHttpAuthFail );
     CPPUNIT_TEST( testHttpPost );
+    CPPUNIT_TEST( testPreparedPost );
     CPPUNIT_TEST( testMultiThread );
+    CPPUNIT_TEST( testConnectFailTiming );
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -43,7 +45,9 @@ public:
     void testHttpBasicAuth();
     void testHttpAuthFail();
     void testHttpPost();
+    void testPreparedPost();
     void testMultiThread();
+    void testConnectFailTiming();
 };
 
 #endif // IOT_RESTCLIENTTESTER_H
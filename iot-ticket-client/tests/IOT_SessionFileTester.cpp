@@ -0,0 +1,139 @@
+
+
+#include "IOT_SessionFileTester.h"
+#include "IOT_SessionFile.h"
+#include "IOT_RestClient.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_SessionFileTester );
+
+static IOT_SessionFile::Entry MakeEntry(const std::string& key, size_t size, int64_t validUntil)
+{
+    IOT_SessionFile::Entry entry;
+    entry.key = key;
+    for(size_t i = 0; i < size; ++i) {
+        entry.data.push_back(static_cast<uint8_t>(i * 7));
+    }
+    entry.validUntil = validUntil;
+    return entry;
+}
+
+
+void IOT_SessionFileTester::setUp()
+{
+    char path[] = "/tmp/iot-sessiontest-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd >= 0) {
+        close(fd);
+    }
+    m_path = path;
+}
+
+void IOT_SessionFileTester::tearDown()
+{
+    unlink(m_path.c_str());
+    unlink((m_path + ".lock").c_str());
+}
+
+void IOT_SessionFileTester::testRoundTrip()
+{
+    std::vector<IOT_SessionFile::Entry> entries;
+    entries.push_back(MakeEntry("example.com:443:ALPN=h2", 200, 2000));
+    entries.push_back(MakeEntry("", 50, 0));
+    entries[1].shmac.assign(32, 0xab);
+    CPPUNIT_ASSERT(IOT_SessionFile::Write(m_path, entries));
+
+    // Session data must not be readable by others
+    struct stat info;
+    CPPUNIT_ASSERT(stat(m_path.c_str(), &info) == 0);
+    CPPUNIT_ASSERT((info.st_mode & 0777) == 0600);
+
+    std::vector<IOT_SessionFile::Entry> read;
+    CPPUNIT_ASSERT(IOT_SessionFile::Read(m_path, 1000, read));
+    CPPUNIT_ASSERT(read.size() == 2);
+    CPPUNIT_ASSERT(read[0].key == entries[0].key);
+    CPPUNIT_ASSERT(read[0].shmac.empty());
+    CPPUNIT_ASSERT(read[0].data == entries[0].data);
+    CPPUNIT_ASSERT(read[0].validUntil == 2000);
+    CPPUNIT_ASSERT(read[1].key.empty());
+    CPPUNIT_ASSERT(read[1].shmac == entries[1].shmac);
+    CPPUNIT_ASSERT(read[1].data == entries[1].data);
+}
+
+void IOT_SessionFileTester::testExpired()
+{
+    std::vector<IOT_SessionFile::Entry> entries;
+    entries.push_back(MakeEntry("old", 10, 1000));
+    entries.push_back(MakeEntry("new", 10, 3000));
+    entries.push_back(MakeEntry("unknown", 10, 0));
+    CPPUNIT_ASSERT(IOT_SessionFile::Write(m_path, entries));
+
+    std::vector<IOT_SessionFile::Entry> read;
+    CPPUNIT_ASSERT(IOT_SessionFile::Read(m_path, 2000, read));
+    CPPUNIT_ASSERT(read.size() == 2);
+    CPPUNIT_ASSERT(read[0].key == "new");
+    CPPUNIT_ASSERT(read[1].key == "unknown");
+}
+
+void IOT_SessionFileTester::testInvalid()
+{
+    std::vector<IOT_SessionFile::Entry> read;
+    CPPUNIT_ASSERT(!IOT_SessionFile::Read(m_path + ".missing", 0, read));
+
+    {
+        std::ofstream file(m_path.c_str());
+        file << "not a session file\n";
+    }
+    CPPUNIT_ASSERT(!IOT_SessionFile::Read(m_path, 0, read));
+
+    // Broken lines are skipped
+    {
+        std::ofstream file(m_path.c_str());
+        file << "IOT_TLS_SESSIONS 1\n" << "0 a2V5 - !!!\n" << "garbage\n" << "0 a2V5 - AQID\n";
+    }
+    CPPUNIT_ASSERT(IOT_SessionFile::Read(m_path, 0, read));
+    CPPUNIT_ASSERT(read.size() == 1);
+    CPPUNIT_ASSERT(read[0].key == "key");
+    CPPUNIT_ASSERT(read[0].data.size() == 3);
+}
+
+void IOT_SessionFileTester::testMerge()
+{
+    std::vector<IOT_SessionFile::Entry> first;
+    first.push_back(MakeEntry("a.example.com", 10, 3000));
+    first.push_back(MakeEntry("b.example.com", 10, 3000));
+    first.push_back(MakeEntry("old.example.com", 10, 1500));
+    CPPUNIT_ASSERT(IOT_SessionFile::Merge(m_path, 1000, first));
+
+    // Another client saves its own sessions without dropping the others
+    std::vector<IOT_SessionFile::Entry> second;
+    second.push_back(MakeEntry("b.example.com", 20, 4000));
+    second.push_back(MakeEntry("c.example.com", 10, 4000));
+    CPPUNIT_ASSERT(IOT_SessionFile::Merge(m_path, 2000, second));
+
+    std::vector<IOT_SessionFile::Entry> read;
+    CPPUNIT_ASSERT(IOT_SessionFile::Read(m_path, 2000, read));
+    CPPUNIT_ASSERT(read.size() == 3);
+    CPPUNIT_ASSERT(read[0].key == "a.example.com");
+    CPPUNIT_ASSERT(read[1].key == "b.example.com");
+    CPPUNIT_ASSERT(read[1].data.size() == 20);
+    CPPUNIT_ASSERT(read[2].key == "c.example.com");
+
+    // Merging into a missing file creates it
+    unlink(m_path.c_str());
+    CPPUNIT_ASSERT(IOT_SessionFile::Merge(m_path, 2000, second));
+    CPPUNIT_ASSERT(IOT_SessionFile::Read(m_path, 2000, read));
+    CPPUNIT_ASSERT(read.size() == 2);
+}
+
+void IOT_SessionFileTester::testClient()
+{
+    IOT_RestClient client;
+    bool supported = IOT_RestClient::IsSessionFileSupported();
+    CPPUNIT_ASSERT(client.SetSessionFile(m_path) == (supported ? IOTAPI::IOT_ERR_OK : IOTAPI::IOT_ERR_PARAM));
+    CPPUNIT_ASSERT(client.SetSessionFile("") == IOTAPI::IOT_ERR_PARAM);
+}
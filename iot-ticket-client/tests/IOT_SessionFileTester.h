@@ -0,0 +1,32 @@
+
+
+#ifndef IOT_SESSIONFILETESTER_H
+#define IOT_SESSIONFILETESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_SessionFileTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_SessionFileTester );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testExpired );
+    CPPUNIT_TEST( testInvalid );
+    CPPUNIT_TEST( testMerge );
+    CPPUNIT_TEST( testClient );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+
+    void testRoundTrip();
+    void testExpired();
+    void testInvalid();
+    void testMerge();
+    void testClient();
+
+private:
+    std::string m_path;
+};
+
+#endif // IOT_SESSIONFILETESTER_H
@@ -0,0 +1,125 @@
+
+
+#include "IOT_TestServer.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+//! Interval to check for stop while waiting for connections
+static const int ACCEPT_POLL_MS = 50;
+
+IOT_TestServer::IOT_TestServer(Handler handler):
+    m_handler(handler), m_listenFd(-1), m_port(0), m_stop(false), m_requests(0)
+{
+    m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if(bind(m_listenFd, (struct sockaddr*)&addr, sizeof(addr)) == 0 && listen(m_listenFd, 16) == 0 &&
+       getsockname(m_listenFd, (struct sockaddr*)&addr, &len) == 0) {
+        m_port = ntohs(addr.sin_port);
+    }
+
+    m_thread = std::thread(&IOT_TestServer::Serve, this);
+}
+
+IOT_TestServer::~IOT_TestServer()
+{
+    m_stop = true;
+    m_thread.join();
+    close(m_listenFd);
+}
+
+std::string IOT_TestServer::GetUrl() const
+{
+    return "http://127.0.0.1:" + std::to_string(m_port);
+}
+
+size_t IOT_TestServer::GetRequests() const
+{
+    return m_requests.load();
+}
+
+void IOT_TestServer::Serve()
+{
+    while(!m_stop) {
+        struct pollfd pfd = { m_listenFd, POLLIN, 0 };
+        if(poll(&pfd, 1, ACCEPT_POLL_MS) <= 0) {
+            continue;
+        }
+
+        int fd = accept(m_listenFd, NULL, NULL);
+        if(fd >= 0) {
+            HandleConnection(fd);
+            close(fd);
+        }
+    }
+}
+
+void IOT_TestServer::HandleConnection(int fd)
+{
+    std::string request;
+    char buffer[4096];
+    size_t headerEnd = std::string::npos;
+    size_t contentLength = 0;
+    bool continueSent = false;
+
+    while(true) {
+        if(headerEnd == std::string::npos) {
+            headerEnd = request.find("\r\n\r\n");
+            if(headerEnd != std::string::npos) {
+                std::string headers = request.substr(0, headerEnd);
+                size_t pos = headers.find("\r\n");
+                while(pos != std::string::npos) {
+                    size_t next = headers.find("\r\n", pos + 2);
+                    std::string line = headers.substr(pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2);
+                    if(strncasecmp(line.c_str(), "Content-Length:", 15) == 0) {
+                        contentLength = strtoul(line.c_str() + 15, NULL, 10);
+                    } else if(strncasecmp(line.c_str(), "Expect: 100-continue", 20) == 0 && !continueSent) {
+                        const char* cont = "HTTP/1.1 100 Continue\r\n\r\n";
+                        if(send(fd, cont, strlen(cont), MSG_NOSIGNAL) < 0) {
+                            return;
+                        }
+                        continueSent = true;
+                    }
+                    pos = next;
+                }
+                headerEnd += 4;
+            }
+        }
+
+        if(headerEnd != std::string::npos && request.size() >= headerEnd + contentLength) {
+            break;
+        }
+
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if(got <= 0) {
+            return;
+        }
+        request.append(buffer, got);
+    }
+
+    m_requests++;
+    Reply reply = m_handler(request.substr(headerEnd, contentLength));
+
+    std::string response = "HTTP/1.1 " + std::to_string(reply.status) + " Test\r\n"
+                           "Content-Type: application/json\r\n"
+                           "Content-Length: " + std::to_string(reply.body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + reply.body;
+    size_t sent = 0;
+    while(sent < response.size()) {
+        ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0) {
+            return;
+        }
+        sent += n;
+    }
+}
@@ -0,0 +1,51 @@
+
+
+#ifndef IOT_TESTSERVER_H
+#define IOT_TESTSERVER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+//! \brief HTTP server on the loopback interface that answers requests with a handler
+//! \note Requests are served one at a time and every connection is closed
+//!       after its reply.
+class IOT_TestServer
+{
+public:
+    //! Reply to a request
+    struct Reply
+    {
+        int status;
+        std::string body;
+    };
+
+    //! Makes the reply from the body of a request
+    typedef std::function<Reply(const std::string& body)> Handler;
+
+    explicit IOT_TestServer(Handler handler);
+    ~IOT_TestServer();
+
+    //! Address of the server, e.g. "http://127.0.0.1:40000"
+    std::string GetUrl() const;
+
+    //! Number of requests served
+    size_t GetRequests() const;
+
+private:
+    IOT_TestServer(const IOT_TestServer&);
+    IOT_TestServer& operator=(const IOT_TestServer&);
+
+    void Serve();
+    void HandleConnection(int fd);
+
+    Handler m_handler;
+    int m_listenFd;
+    int m_port;
+    std::atomic<bool> m_stop;
+    std::atomic<size_t> m_requests;
+    std::thread m_thread;
+};
+
+#endif // IOT_TESTSERVER_H
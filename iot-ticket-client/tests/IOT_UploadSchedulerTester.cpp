@@ -0,0 +1,97 @@
+
+
+#include "IOT_UploadSchedulerTester.h"
+#include "IOT_UploadScheduler.h"
+#include <thread>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_UploadSchedulerTester );
+
+//! Nothing listens on the discard port, so writes fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+static std::vector<IOT_WriteData> Samples(size_t count)
+{
+    std::vector<IOT_WriteData> data(count);
+    for(size_t i = 0; i < count; ++i) {
+        data[i].SetName("value");
+        data[i].SetValue(static_cast<int64_t>(i));
+    }
+    return data;
+}
+
+
+void IOT_UploadSchedulerTester::testStartStop()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_UploadScheduler scheduler(api, 3);
+
+    CPPUNIT_ASSERT(scheduler.GetThreads() == 3);
+    CPPUNIT_ASSERT(!scheduler.SetBatching(0, 100));
+    CPPUNIT_ASSERT(scheduler.Start() == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(scheduler.Start() == IOTAPI::IOT_ERR_INITIALIZED);
+    scheduler.Stop();
+    CPPUNIT_ASSERT(scheduler.Start() == IOTAPI::IOT_ERR_OK);
+    scheduler.Stop(false);
+}
+
+void IOT_UploadSchedulerTester::testDrain()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    IOT_UploadScheduler scheduler(api, 4);
+    scheduler.SetBatching(5, 60000);
+
+    // Queued before start, sent with flush on stop
+    for(size_t d = 0; d < 20; ++d) {
+        CPPUNIT_ASSERT(scheduler.Enqueue("device" + std::to_string(d), Samples(10)) == 10);
+    }
+    CPPUNIT_ASSERT(scheduler.GetQueued() == 200);
+    CPPUNIT_ASSERT(scheduler.GetQueued("device3") == 10);
+
+    CPPUNIT_ASSERT(scheduler.Start() == IOTAPI::IOT_ERR_OK);
+    scheduler.Stop(true);
+
+    // Failed samples are not retried when stopping
+    CPPUNIT_ASSERT(scheduler.GetQueued() == 0);
+    CPPUNIT_ASSERT(scheduler.GetQueued("device3") == 0);
+}
+
+void IOT_UploadSchedulerTester::testRetry()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    IOT_UploadScheduler scheduler(api, 2);
+    scheduler.SetBatching(100, 60000);
+    scheduler.Start();
+
+    CPPUNIT_ASSERT(scheduler.Enqueue("device", Samples(10)) == 10);
+
+    // Failed batch returns to the queue to wait for the retry
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if(scheduler.GetQueued("device") == 10) {
+            break;
+        }
+    }
+    CPPUNIT_ASSERT(scheduler.GetQueued("device") == 10);
+
+    // Samples queued meanwhile wait behind the failed ones
+    CPPUNIT_ASSERT(scheduler.Enqueue("device", Samples(1)[0]));
+    CPPUNIT_ASSERT(scheduler.GetQueued("device") == 11);
+
+    scheduler.Stop(false);
+    CPPUNIT_ASSERT(scheduler.GetQueued() == 11);
+}
+
+void IOT_UploadSchedulerTester::testQueueLimit()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_UploadScheduler scheduler(api, 1);
+    scheduler.SetMaxQueued(5);
+
+    CPPUNIT_ASSERT(scheduler.Enqueue("device", Samples(10)) == 5);
+    CPPUNIT_ASSERT(!scheduler.Enqueue("device", Samples(1)[0]));
+    CPPUNIT_ASSERT(scheduler.GetQueued() == 5);
+}
@@ -0,0 +1,24 @@
+
+
+#ifndef IOT_UPLOADSCHEDULERTESTER_H
+#define IOT_UPLOADSCHEDULERTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_UploadSchedulerTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_UploadSchedulerTester );
+    CPPUNIT_TEST( testStartStop );
+    CPPUNIT_TEST( testDrain );
+    CPPUNIT_TEST( testRetry );
+    CPPUNIT_TEST( testQueueLimit );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testStartStop();
+    void testDrain();
+    void testRetry();
+    void testQueueLimit();
+};
+
+#endif // IOT_UPLOADSCHEDULERTESTER_H
@@ -0,0 +1,95 @@
+
+
+#include "IOT_UploaderTester.h"
+#include "IOT_Uploader.h"
+#include <thread>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_UploaderTester );
+
+//! Nothing listens on the discard port, so writes fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+static std::vector<IOT_WriteData> Samples(size_t count)
+{
+    std::vector<IOT_WriteData> data(count);
+    for(size_t i = 0; i < count; ++i) {
+        data[i].SetName("value");
+        data[i].SetValue(static_cast<int64_t>(i));
+    }
+    return data;
+}
+
+//! Number of write requests made through an API instance
+static uint64_t Writes(const IOT_API& api)
+{
+    IOT_EndpointStats stats;
+    api.GetRequestStats(IOTAPI::IOT_EP_WRITE, stats);
+    return stats.GetRequests();
+}
+
+//! Wait until the condition holds or the timeout expires
+template<class Condition>
+static bool WaitFor(Condition condition, int timeoutMs)
+{
+    for(int waited = 0; waited < timeoutMs; waited += 10) {
+        if(condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+
+void IOT_UploaderTester::testPriorityQueueLimit()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_Uploader uploader(api, "device", 5);
+
+    CPPUNIT_ASSERT(uploader.Enqueue(Samples(8), IOT_Uploader::LANE_HIGH) == 5);
+    CPPUNIT_ASSERT(!uploader.Enqueue(Samples(1)[0], IOT_Uploader::LANE_HIGH));
+    CPPUNIT_ASSERT(uploader.GetQueued(IOT_Uploader::LANE_HIGH) == 5);
+    CPPUNIT_ASSERT(uploader.GetQueued(IOT_Uploader::LANE_BULK) == 0);
+}
+
+void IOT_UploaderTester::testPriorityRetryLimit()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    IOT_Uploader uploader(api, "device");
+    uploader.SetPriorityFlushInterval(0);
+    CPPUNIT_ASSERT(uploader.Start() == IOTAPI::IOT_ERR_OK);
+
+    // Failed batch is retried five times in a row and dropped after that
+    CPPUNIT_ASSERT(uploader.Enqueue(Samples(3), IOT_Uploader::LANE_HIGH) == 3);
+    CPPUNIT_ASSERT(WaitFor([&]() { return uploader.GetQueued(IOT_Uploader::LANE_HIGH) == 0 &&
+                                          Writes(api) == 6; }, 5000));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CPPUNIT_ASSERT(Writes(api) == 6);
+    uploader.Stop(false);
+}
+
+void IOT_UploaderTester::testBulkDuringPriorityRetry()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    IOT_API priorityApi(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    priorityApi.SetWriteConcurrency(1, 0);
+
+    IOT_Uploader uploader(api, priorityApi, "device");
+    uploader.SetPriorityFlushInterval(0);
+    CPPUNIT_ASSERT(uploader.Start() == IOTAPI::IOT_ERR_OK);
+
+    CPPUNIT_ASSERT(uploader.Enqueue(Samples(1), IOT_Uploader::LANE_HIGH) == 1);
+    CPPUNIT_ASSERT(WaitFor([&]() { return Writes(priorityApi) >= 1; }, 2000));
+
+    // Bulk batch is sent while the high priority sample waits for its retry
+    CPPUNIT_ASSERT(uploader.Enqueue(Samples(10)) == 10);
+    uploader.Flush();
+    CPPUNIT_ASSERT(WaitFor([&]() { return Writes(api) >= 1; }, 500));
+    CPPUNIT_ASSERT(uploader.GetQueued(IOT_Uploader::LANE_HIGH) == 1);
+
+    uploader.Stop(false);
+}
@@ -0,0 +1,22 @@
+
+
+#ifndef IOT_UPLOADERTESTER_H
+#define IOT_UPLOADERTESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_UploaderTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_UploaderTester );
+    CPPUNIT_TEST( testPriorityQueueLimit );
+    CPPUNIT_TEST( testPriorityRetryLimit );
+    CPPUNIT_TEST( testBulkDuringPriorityRetry );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testPriorityQueueLimit();
+    void testPriorityRetryLimit();
+    void testBulkDuringPriorityRetry();
+};
+
+#endif // IOT_UPLOADERTESTER_H
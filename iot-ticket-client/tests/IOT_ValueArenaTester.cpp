@@ -0,0 +1,81 @@
+
+
+#include "IOT_ValueArenaTester.h"
+#include "json/json.h"
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_ValueArenaTester );
+
+
+static const char* DOCUMENT =
+    "{\"href\":\"https://host/process/read/dev\",\"datanodeReads\":[{\"name\":\"Temperature\","
+    "\"dataType\":\"double\",\"values\":[{\"v\":\"21.5\",\"ts\":1000},{\"v\":\"22.0\",\"ts\":2000}]},"
+    "{\"name\":\"On\",\"dataType\":\"boolean\",\"values\":[{\"v\":\"true\",\"ts\":1000}]}],\"n\":[1,-2,3.5,null]}";
+
+void IOT_ValueArenaTester::testParse()
+{
+    Json::Reader reader;
+    Json::FastWriter writer;
+
+    Json::Value expected;
+    CPPUNIT_ASSERT(reader.parse(DOCUMENT, expected, false));
+
+    Json::ValueArena arena;
+    Json::Value root;
+    CPPUNIT_ASSERT(reader.parse(DOCUMENT, root, arena, false));
+    CPPUNIT_ASSERT(Json::ValueArena::current() == NULL);
+    CPPUNIT_ASSERT(arena.capacity() > 0);
+    CPPUNIT_ASSERT(root == expected);
+    CPPUNIT_ASSERT(writer.write(root) == writer.write(expected));
+
+    // Values can still be modified after parsing, the new parts use the heap
+    root["datanodeReads"][1]["unit"] = "state";
+    root["n"].append("text");
+    CPPUNIT_ASSERT(root["datanodeReads"][1]["unit"].asString() == "state");
+    CPPUNIT_ASSERT(root["n"].size() == 5);
+
+    CPPUNIT_ASSERT(!reader.parse("{\"a\":[1,2}", root, arena, false));
+}
+
+void IOT_ValueArenaTester::testCopyOut()
+{
+    Json::Value copy;
+    {
+        Json::ValueArena arena;
+        Json::Value root;
+        Json::Reader reader;
+        CPPUNIT_ASSERT(reader.parse(DOCUMENT, root, arena, false));
+
+        // A copy made outside of the scope does not use the arena
+        copy = root["datanodeReads"][0];
+    }
+
+    CPPUNIT_ASSERT(copy["name"].asString() == "Temperature");
+    CPPUNIT_ASSERT(copy["values"][1]["v"].asString() == "22.0");
+}
+
+void IOT_ValueArenaTester::testReset()
+{
+    Json::ValueArena arena(256);
+    Json::Reader reader;
+
+    for(int i = 0; i < 10; ++i) {
+        {
+            Json::Value root;
+            CPPUNIT_ASSERT(reader.parse(DOCUMENT, root, arena, false));
+            CPPUNIT_ASSERT(root["datanodeReads"][0]["values"][0]["ts"].asUInt64() == 1000);
+        }
+        arena.reset();
+    }
+
+    // After the first document the kept block is reused
+    size_t capacity = arena.capacity();
+    {
+        Json::ValueArena::Scope scope(&arena);
+        CPPUNIT_ASSERT(Json::ValueArena::current() == &arena);
+        Json::Value value("some text");
+        CPPUNIT_ASSERT(value.asString() == "some text");
+    }
+    CPPUNIT_ASSERT(arena.capacity() == capacity);
+    CPPUNIT_ASSERT(Json::ValueArena::current() == NULL);
+}
@@ -0,0 +1,22 @@
+
+
+#ifndef IOT_VALUEARENATESTER_H
+#define IOT_VALUEARENATESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_ValueArenaTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_ValueArenaTester );
+    CPPUNIT_TEST( testParse );
+    CPPUNIT_TEST( testCopyOut );
+    CPPUNIT_TEST( testReset );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testParse();
+    void testCopyOut();
+    void testReset();
+};
+
+#endif // IOT_VALUEARENATESTER_H
@@ -0,0 +1,382 @@
+
+
+#include "IOT_WriteTester.h"
+#include "IOT_API.h"
+#include "IOT_TestServer.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION( IOT_WriteTester );
+
+//! Nothing listens on the discard port, so requests fail at once
+static const std::string CLOSED_URL = "http://127.0.0.1:9";
+
+//! Start of hrefs in write replies
+static const std::string HREF = "https://my.iot-ticket.com/api/v1/process/read/device?datanodes=";
+
+static IOT_WriteData MakeSample(const std::string& path, const std::string& name, double value)
+{
+    IOT_WriteData sample;
+    sample.SetPath(path);
+    sample.SetName(name);
+    sample.SetValue(value);
+    return sample;
+}
+
+
+void IOT_WriteTester::testChunkLimits()
+{
+    IOT_API api(CLOSED_URL, "user", "pass");
+    std::vector<IOT_API::WriteChunk> chunks;
+
+    std::vector<std::string> items(7, "1");
+    CPPUNIT_ASSERT(api.SetWriteChunkLimits(3, 1000));
+    api.BuildWriteChunks(items, chunks);
+    CPPUNIT_ASSERT(chunks.size() == 3);
+    CPPUNIT_ASSERT(chunks[0].begin == 0 && chunks[0].end == 3);
+    CPPUNIT_ASSERT(chunks[0].payload == "[1,1,1]");
+    CPPUNIT_ASSERT(chunks[2].begin == 6 && chunks[2].end == 7);
+    CPPUNIT_ASSERT(chunks[2].payload == "[1]");
+
+    // Byte limit covers brackets and separators
+    items.assign(5, "aaaa");
+    CPPUNIT_ASSERT(api.SetWriteChunkLimits(100, 12));
+    api.BuildWriteChunks(items, chunks);
+    CPPUNIT_ASSERT(chunks.size() == 3);
+    CPPUNIT_ASSERT(chunks[0].payload == "[aaaa,aaaa]");
+    for(size_t i = 0; i < chunks.size(); ++i) {
+        CPPUNIT_ASSERT(chunks[i].payload.size() <= 12);
+    }
+    CPPUNIT_ASSERT(chunks[2].begin == 4 && chunks[2].end == 5);
+
+    // One sample per chunk
+    CPPUNIT_ASSERT(api.SetWriteChunkLimits(1, 1000));
+    api.BuildWriteChunks(items, chunks);
+    CPPUNIT_ASSERT(chunks.size() == items.size());
+    for(size_t i = 0; i < chunks.size(); ++i) {
+        CPPUNIT_ASSERT(chunks[i].begin == i && chunks[i].end == i + 1);
+        CPPUNIT_ASSERT(chunks[i].payload == "[aaaa]");
+    }
+
+    items.clear();
+    api.BuildWriteChunks(items, chunks);
+    CPPUNIT_ASSERT(chunks.empty());
+    CPPUNIT_ASSERT(!api.SetWriteChunkLimits(0, 1000));
+    CPPUNIT_ASSERT(!api.SetWriteChunkLimits(10, 0));
+}
+
+void IOT_WriteTester::testOversizedSample()
+{
+    IOT_API api(CLOSED_URL, "user", "pass");
+    std::vector<IOT_API::WriteChunk> chunks;
+    CPPUNIT_ASSERT(api.SetWriteChunkLimits(100, 10));
+
+    // A sample over the byte limit goes alone and does not hold back the others
+    std::vector<std::string> items;
+    items.push_back("a");
+    items.push_back(std::string(20, 'b'));
+    items.push_back("c");
+    items.push_back("d");
+    api.BuildWriteChunks(items, chunks);
+    CPPUNIT_ASSERT(chunks.size() == 3);
+    CPPUNIT_ASSERT(chunks[0].payload == "[a]");
+    CPPUNIT_ASSERT(chunks[1].begin == 1 && chunks[1].end == 2);
+    CPPUNIT_ASSERT(chunks[1].payload == "[" + items[1] + "]");
+    CPPUNIT_ASSERT(chunks[2].payload == "[c,d]");
+}
+
+void IOT_WriteTester::testRetryable()
+{
+    // Requests that never reached the server or were refused unprocessed
+    CPPUNIT_ASSERT(IOT_API::IsRetryableError(IOTAPI::IOT_ERR_CONN));
+    CPPUNIT_ASSERT(IOT_API::IsRetryableError(IOTAPI::IOT_ERR_SERVER));
+    CPPUNIT_ASSERT(IOT_API::IsRetryableError(IOTAPI::IOT_ERR_THROTTLED));
+
+    // The server may have stored a write that failed after it was sent
+    CPPUNIT_ASSERT(!IOT_API::IsRetryableError(IOTAPI::IOT_ERR_TIMEOUT));
+    CPPUNIT_ASSERT(!IOT_API::IsRetryableError(IOTAPI::IOT_ERR_CURL_CALL));
+    CPPUNIT_ASSERT(!IOT_API::IsRetryableError(IOTAPI::IOT_ERR_SSL));
+    CPPUNIT_ASSERT(!IOT_API::IsRetryableError(IOTAPI::IOT_ERR_AGAIN));
+    CPPUNIT_ASSERT(!IOT_API::IsRetryableError(IOTAPI::IOT_ERR_WRITE_FAILED));
+    CPPUNIT_ASSERT(!IOT_API::IsRetryableError(IOTAPI::IOT_ERR_OK));
+}
+
+void IOT_WriteTester::testThrottleDeadline()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 1);
+    api.SetWriteChunkLimits(1, 1000);
+    CPPUNIT_ASSERT(api.GetRateLimiter().SetDeviceRate(1.0, 1.0));
+
+    std::vector<IOT_WriteData> data(6);
+    for(size_t i = 0; i < data.size(); ++i) {
+        data[i].SetName("value");
+        data[i].SetValue(static_cast<int64_t>(i));
+    }
+
+    // Chunks held back by the rate limiter share one timeout instead of
+    // each waiting for one
+    IOT_WriteResult result;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    CPPUNIT_ASSERT(api.SendData("device", data, result) != IOTAPI::IOT_ERR_OK);
+    double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    CPPUNIT_ASSERT(elapsedS < 2.0);
+    CPPUNIT_ASSERT(result.GetChunks() == data.size());
+    CPPUNIT_ASSERT(result.GetFailedChunks() == data.size());
+}
+
+void IOT_WriteTester::testParseWriteResponse()
+{
+    IOT_API api(CLOSED_URL, "user", "pass");
+    std::vector<IOT_WriteData> data;
+    data.push_back(MakeSample("", "a", 1.0));
+    data.push_back(MakeSample("", "a", 2.0));
+    data.push_back(MakeSample("dir", "b", 3.0));
+    data.push_back(MakeSample("", "c", 4.0));
+    std::vector<bool> accepted(data.size(), false);
+
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_OK, "{\"totalWritten\":4}", data, 0, 4, accepted) ==
+                   IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(std::count(accepted.begin(), accepted.end(), true) == 4);
+
+    // Successful reply without the written count: nothing is known to be stored
+    const char* unknown[] = { "", "not json", "{}", "{\"totalWritten\":4", "[4]" };
+    for(size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); ++i) {
+        accepted.assign(data.size(), false);
+        CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_OK, unknown[i], data, 0, 4, accepted) ==
+                       IOTAPI::IOT_ERR_GENERAL);
+        CPPUNIT_ASSERT(std::count(accepted.begin(), accepted.end(), true) == 0);
+    }
+
+    // Partial write is accepted per datanode, only for fully written ones
+    accepted.assign(data.size(), false);
+    std::string partial = "{\"totalWritten\":3,\"responses\":["
+                          "{\"href\":\"" + HREF + "a\",\"written\":2},"
+                          "{\"href\":\"" + HREF + "dir%2Fb&fromdate=1\",\"written\":1},"
+                          "{\"href\":\"" + HREF + "c\",\"written\":0}]}";
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_OK, partial, data, 0, 4, accepted) ==
+                   IOTAPI::IOT_ERR_WRITE_FAILED);
+    CPPUNIT_ASSERT(accepted[0] && accepted[1] && accepted[2] && !accepted[3]);
+
+    // One of two samples of a datanode written rejects both
+    accepted.assign(data.size(), false);
+    partial = "{\"totalWritten\":2,\"responses\":["
+              "{\"href\":\"" + HREF + "a\",\"written\":1},"
+              "{\"href\":\"" + HREF + "c\",\"written\":1}]}";
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_OK, partial, data, 0, 4, accepted) ==
+                   IOTAPI::IOT_ERR_WRITE_FAILED);
+    CPPUNIT_ASSERT(!accepted[0] && !accepted[1] && !accepted[2] && accepted[3]);
+
+    // Partial write without per datanode counts
+    accepted.assign(data.size(), false);
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_OK, "{\"totalWritten\":2}", data, 0, 4, accepted) ==
+                   IOTAPI::IOT_ERR_WRITE_FAILED);
+    CPPUNIT_ASSERT(std::count(accepted.begin(), accepted.end(), true) == 0);
+
+    // Only the samples of the chunk are marked
+    accepted.assign(data.size(), false);
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_OK, "{\"totalWritten\":2}", data, 2, 4, accepted) ==
+                   IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(!accepted[0] && !accepted[1] && accepted[2] && accepted[3]);
+
+    // Failed requests map the error code of the reply
+    accepted.assign(data.size(), false);
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_CURL_CALL, "{\"code\":8002}", data, 0, 4, accepted) ==
+                   IOTAPI::IOT_ERR_QUOTA);
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_THROTTLED, "{\"code\":8000}", data, 0, 4, accepted) ==
+                   IOTAPI::IOT_ERR_THROTTLED);
+    CPPUNIT_ASSERT(api.ParseWriteResponse(IOTAPI::IOT_ERR_CONN, "", data, 0, 4, accepted) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(std::count(accepted.begin(), accepted.end(), true) == 0);
+}
+
+void IOT_WriteTester::testDatanodeFromHref()
+{
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref(HREF + "Temperature") == "Temperature");
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref(HREF + "%2FEngine%2fTemp&fromdate=1") == "Engine/Temp");
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref(HREF + "first,second") == "first");
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref(HREF + "Load%20100%25") == "Load 100%");
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref(HREF + "bad%zz%4") == "bad%zz%4");
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref(HREF).empty());
+    CPPUNIT_ASSERT(IOT_API::DatanodeFromHref("https://my.iot-ticket.com/api/v1/process/read/device").empty());
+
+    CPPUNIT_ASSERT(IOT_API::DatanodeKey("", "name") == "name");
+    CPPUNIT_ASSERT(IOT_API::DatanodeKey("dir", "name") == "dir/name");
+    CPPUNIT_ASSERT(IOT_API::DatanodeKey("/dir", "name") == "dir/name");
+}
+
+void IOT_WriteTester::testResendRejected()
+{
+    IOT_API api(CLOSED_URL, "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+
+    std::vector<IOT_WriteData> data;
+    data.push_back(MakeSample("", "a", 1.0));
+    data.push_back(MakeSample("", "b", 2.0));
+    data.push_back(MakeSample("", "c", 3.0));
+
+    IOT_WriteResult result;
+    CPPUNIT_ASSERT(api.ResendRejected("device", data, result) == IOTAPI::IOT_ERR_PARAM);
+
+    // Nothing rejected, nothing sent
+    result.Clear();
+    result.m_submitted = data.size();
+    result.m_acceptedSamples.assign(data.size(), true);
+    result.m_accepted = data.size();
+    CPPUNIT_ASSERT(api.ResendRejected("device", data, result) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(result.GetPayloadBytes() == 0);
+
+    // Only the rejected sample is sent again
+    result.m_acceptedSamples[1] = false;
+    result.m_accepted = 2;
+    std::string item;
+    CPPUNIT_ASSERT(data[1].AppendJSON(item));
+    CPPUNIT_ASSERT(api.ResendRejected("device", data, result) == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetPayloadBytes() == item.size() + 2);
+    CPPUNIT_ASSERT(result.GetAccepted() == 2);
+    CPPUNIT_ASSERT(result.IsAccepted(0) && !result.IsAccepted(1) && result.IsAccepted(2));
+    CPPUNIT_ASSERT(result.GetStatus() == IOTAPI::IOT_ERR_CONN);
+    CPPUNIT_ASSERT(result.GetFailedChunks() == 1);
+}
+
+void IOT_WriteTester::testRequeue()
+{
+    std::vector<IOT_WriteData> batch;
+    batch.push_back(MakeSample("", "a", 1.0));
+    batch.push_back(MakeSample("", "b", 2.0));
+    batch.push_back(MakeSample("", "c", 3.0));
+
+    IOT_WriteResult result;
+    result.m_submitted = batch.size();
+    result.m_acceptedSamples.assign(batch.size(), false);
+    result.m_acceptedSamples[1] = true;
+    result.m_accepted = 1;
+    result.m_status = IOTAPI::IOT_ERR_CONN;
+
+    // Unwritten samples go in front of the queue in the order of the batch
+    std::deque<IOT_WriteData> queue(1, MakeSample("", "d", 4.0));
+    CPPUNIT_ASSERT(result.Requeue(batch, true, queue, 3) == 2);
+    CPPUNIT_ASSERT(queue.size() == 3);
+    CPPUNIT_ASSERT(queue[0].GetName() == "a" && queue[1].GetName() == "c" && queue[2].GetName() == "d");
+
+    // Put back as far as the queue has room, not at all if retry is not allowed or the error is final
+    queue.resize(2);
+    CPPUNIT_ASSERT(result.Requeue(batch, true, queue, 3) == 1);
+    CPPUNIT_ASSERT(queue.size() == 3 && queue[0].GetName() == "a");
+    queue.resize(1);
+    CPPUNIT_ASSERT(result.Requeue(batch, false, queue, 10) == 0);
+    result.m_status = IOTAPI::IOT_ERR_GENERAL;
+    CPPUNIT_ASSERT(result.Requeue(batch, true, queue, 10) == 0);
+    CPPUNIT_ASSERT(queue.size() == 1);
+
+    // Status of the request that carried each sample decides
+    result.m_sampleStatus.assign(batch.size(), IOTAPI::IOT_ERR_OK);
+    result.m_sampleStatus[0] = IOTAPI::IOT_ERR_WRITE_FAILED;
+    result.m_sampleStatus[2] = IOTAPI::IOT_ERR_THROTTLED;
+    CPPUNIT_ASSERT(result.Requeue(batch, true, queue, 10) == 1);
+    CPPUNIT_ASSERT(queue.size() == 2 && queue[0].GetName() == "c");
+    result.m_sampleStatus.clear();
+
+    // Queue entries made by the caller
+    result.m_status = IOTAPI::IOT_ERR_SERVER;
+    std::deque<std::string> names;
+    CPPUNIT_ASSERT(result.Requeue(batch, true, names, 10,
+                                  [](const IOT_WriteData& data) { return data.GetName(); }) == 2);
+    CPPUNIT_ASSERT(names.size() == 2 && names[0] == "a" && names[1] == "c");
+}
+
+void IOT_WriteTester::testRequeueMixedChunks()
+{
+    // Samples named "bad" are refused for good, the others hit a busy server
+    IOT_TestServer server([](const std::string& body) {
+        IOT_TestServer::Reply r = { 503, "" };
+        if(body.find("\"bad\"") != std::string::npos) {
+            r.status = 400;
+            r.body = "{\"code\":8004}";
+        }
+        return r;
+    });
+    IOT_API api(server.GetUrl(), "user", "pass", 5);
+    api.SetWriteConcurrency(1, 0);
+    CPPUNIT_ASSERT(api.SetWriteChunkLimits(1, 1000));
+
+    for(int order = 0; order < 2; ++order) {
+        std::vector<IOT_WriteData> batch;
+        batch.push_back(MakeSample("", (order == 0) ? "bad" : "good", 1.0));
+        batch.push_back(MakeSample("", (order == 0) ? "good" : "bad", 2.0));
+
+        IOT_WriteResult result;
+        CPPUNIT_ASSERT(api.SendData("device", batch, result) != IOTAPI::IOT_ERR_OK);
+        CPPUNIT_ASSERT(result.GetFailedChunks() == 2);
+
+        // Only the sample of the busy request goes back, whichever chunk failed first
+        std::deque<IOT_WriteData> queue;
+        CPPUNIT_ASSERT(result.Requeue(batch, true, queue, 10) == 1);
+        CPPUNIT_ASSERT(queue.size() == 1 && queue[0].GetName() == "good");
+        CPPUNIT_ASSERT(result.GetSampleStatus(order) == IOTAPI::IOT_ERR_WRITE_FAILED);
+        CPPUNIT_ASSERT(result.GetSampleStatus(1 - order) == IOTAPI::IOT_ERR_SERVER);
+    }
+}
+
+void IOT_WriteTester::testPrecision()
+{
+    IOT_API api(CLOSED_URL, "user", "pass");
+    CPPUNIT_ASSERT(api.GetPrecision("engine", "temp") == IOT_WriteData::NO_PRECISION);
+    CPPUNIT_ASSERT(!api.SetPrecision("engine", "temp", 16));
+    CPPUNIT_ASSERT(!api.SetPrecision("engine", "temp", -2));
+    CPPUNIT_ASSERT(api.SetPrecision("/engine", "temp", 1));
+    CPPUNIT_ASSERT(api.GetPrecision("engine", "temp") == 1);
+    CPPUNIT_ASSERT(api.GetPrecision("", "temp") == IOT_WriteData::NO_PRECISION);
+
+    // Set per datanode, samples of other datanodes keep full precision
+    std::vector<IOT_WriteData> data;
+    data.push_back(MakeSample("engine", "temp", 87.5312));
+    data.push_back(MakeSample("engine", "temp", 87.5712));
+    data.push_back(MakeSample("", "temp", 87.5312));
+    data.push_back(MakeSample("engine", "temp", 87.0));
+
+    std::vector<IOT_API::WriteChunk> chunks;
+    IOT_WriteResult result;
+    CPPUNIT_ASSERT(api.PrepareWrite(data, chunks, result) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(chunks.size() == 1);
+    const std::string& payload = chunks[0].payload;
+    CPPUNIT_ASSERT(payload.find("\"v\":87.5}") != std::string::npos);
+    CPPUNIT_ASSERT(payload.find("\"v\":87.6}") != std::string::npos);
+    CPPUNIT_ASSERT(payload.find("\"v\":87.5312}") != std::string::npos);
+    CPPUNIT_ASSERT(payload.find("\"v\":87.0}") != std::string::npos);
+
+    CPPUNIT_ASSERT(api.SetPrecision("engine", "temp", IOT_WriteData::NO_PRECISION));
+    CPPUNIT_ASSERT(api.GetPrecision("engine", "temp") == IOT_WriteData::NO_PRECISION);
+    CPPUNIT_ASSERT(api.PrepareWrite(data, chunks, result) == IOTAPI::IOT_ERR_OK);
+    CPPUNIT_ASSERT(chunks[0].payload.find("\"v\":87.5712}") != std::string::npos);
+}
+
+void IOT_WriteTester::testServerErrorReply()
+{
+    IOT_API api(CLOSED_URL, "user", "pass");
+    const std::string reply = "{\"code\":8000,\"description\":\"Service unavailable\"}";
+
+    // Status of the reply stands, the body only refines client errors
+    CPPUNIT_ASSERT(api.GetErrorCode(reply, IOTAPI::IOT_ERR_SERVER) == IOTAPI::IOT_ERR_SERVER);
+    CPPUNIT_ASSERT(api.GetErrorCode(reply, IOTAPI::IOT_ERR_TIMEOUT) == IOTAPI::IOT_ERR_TIMEOUT);
+    CPPUNIT_ASSERT(api.GetErrorCode(reply, IOTAPI::IOT_ERR_THROTTLED) == IOTAPI::IOT_ERR_THROTTLED);
+    CPPUNIT_ASSERT(api.GetErrorCode("{\"code\":8004}", IOTAPI::IOT_ERR_GENERAL) == IOTAPI::IOT_ERR_WRITE_FAILED);
+
+    // 503 with a JSON body can be retried
+    IOT_TestServer server([&reply](const std::string&) {
+        IOT_TestServer::Reply r = { 503, reply };
+        return r;
+    });
+    IOT_API serverApi(server.GetUrl(), "user", "pass", 5);
+    serverApi.SetWriteConcurrency(1, 0);
+
+    std::vector<IOT_WriteData> data(1, MakeSample("", "a", 1.0));
+    IOT_WriteResult result;
+    IOTAPI::IOTAPI_err ret = serverApi.SendData("device", data, result);
+    CPPUNIT_ASSERT(ret == IOTAPI::IOT_ERR_SERVER);
+    CPPUNIT_ASSERT(IOT_API::IsRetryableError(ret));
+    CPPUNIT_ASSERT(server.GetRequests() == 1);
+
+    std::vector<IOT_GetDevice> devices;
+    CPPUNIT_ASSERT(serverApi.GetDevices(devices) == IOTAPI::IOT_ERR_SERVER);
+}
@@ -0,0 +1,38 @@
+
+
+#ifndef IOT_WRITETESTER_H
+#define IOT_WRITETESTER_H
+
+#include "cppunit/extensions/HelperMacros.h"
+
+class IOT_WriteTester : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( IOT_WriteTester );
+    CPPUNIT_TEST( testChunkLimits );
+    CPPUNIT_TEST( testOversizedSample );
+    CPPUNIT_TEST( testRetryable );
+    CPPUNIT_TEST( testThrottleDeadline );
+    CPPUNIT_TEST( testParseWriteResponse );
+    CPPUNIT_TEST( testDatanodeFromHref );
+    CPPUNIT_TEST( testResendRejected );
+    CPPUNIT_TEST( testRequeue );
+    CPPUNIT_TEST( testRequeueMixedChunks );
+    CPPUNIT_TEST( testPrecision );
+    CPPUNIT_TEST( testServerErrorReply );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testChunkLimits();
+    void testOversizedSample();
+    void testRetryable();
+    void testThrottleDeadline();
+    void testParseWriteResponse();
+    void testDatanodeFromHref();
+    void testResendRejected();
+    void testRequeue();
+    void testRequeueMixedChunks();
+    void testPrecision();
+    void testServerErrorReply();
+};
+
+#endif // IOT_WRITETESTER_H